@@ -0,0 +1,69 @@
+#include "addshader-sched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+__declspec(align(8))
+#elif defined(__GNUC__)
+__attribute__((aligned(8)))
+#endif
+uint32_t addshader_sched[100] = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x100200a7,
+0x15827d80, 0x100200e7,
+0x15827d80, 0x10020127,
+0x00000040, 0xe00208e7,
+0x90000040, 0xe0020c67,
+0x80012000, 0xe00208a7,
+0x11105dc0, 0xd0020867,
+0x0c9e7280, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x00ca7000, 0x100009e7,
+0x90000040, 0xe0020c67,
+0x80012010, 0xe00208a7,
+0x0c9e7280, 0x10020c67,
+0x150a7d80, 0x10020ca7,
+0x00ca7000, 0x100009e7,
+0x11101dc0, 0xd0020867,
+0x00201a00, 0xe00208a7,
+0x0c9e7280, 0x10020c67,
+0x00101a00, 0xe00208a7,
+0x0c067cc0, 0x10020067,
+0x0c0a7cc0, 0x100200a7,
+0x0c9e7280, 0x10021c67,
+0x00000001, 0xe00202a7,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020867,
+0x009f2000, 0x100009e7,
+0x15c27d80, 0x100208a7,
+0x0c9f2280, 0x10020867,
+0x0d281dc0, 0xd00222a7,
+0x159e7240, 0x10020c27,
+0xffffffb0, 0xf03809e7,
+0x009f2000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x11108dc0, 0xd0020867,
+0x80904000, 0xe00208a7,
+0x0c9e7280, 0x10021c67,
+0x0d001dc0, 0xd0022027,
+0x8c0e7cf6, 0x100240f2,
+0xfffffec0, 0xf03809e7,
+0x009f2000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x300009e7,
+0x00000001, 0xe00209a7,
+0x009e7000, 0x100009e7
+};
+#ifdef __HIGHC__
+#pragma Align_to(8, addshader_sched)
+#endif
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#ifndef addshader_sched_H
+#define addshader_sched_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// addshader after host/sched-shaders; regenerate with "make -C host shaders".
+extern uint32_t addshader_sched[100];
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
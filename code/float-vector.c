@@ -0,0 +1,161 @@
+#include "rpi.h"
+#include <string.h>
+#include "float-vector.h"
+#include "kernel-abi.h"
+
+// each vector starts on a VPM-row boundary.
+#define FVEC_ALIGN 64
+
+// the kernels are built here.
+#define FVEC_CODE_MAX QB_MAP2_MAX
+
+// qb_map2's uniforms are laid out as qb_map2_tmu's, and qb_fma's are the most.
+_Static_assert(sizeof(struct qb_map1s_unifs) <= sizeof(struct qb_fma_unifs), "qb_map1s uniforms fit");
+_Static_assert(sizeof(struct qb_map2_tmu_unifs) <= sizeof(struct qb_fma_unifs), "qb_map2 uniforms fit");
+
+static uint32_t padded(int n)
+{
+	return (n + FVEC_BLOCK - 1) / FVEC_BLOCK * FVEC_BLOCK;
+}
+
+uint32_t fvec_gpu_size(void)
+{
+	return 8 * FVEC_CODE_MAX + V3D_NUM_QPUS * sizeof(struct qb_fma_unifs) + 16;
+}
+
+uint32_t fvec_size(int n)
+{
+	return padded(n) * sizeof(float) + FVEC_ALIGN;
+}
+
+int fvec_gpu_init(gpu_ctx_t *ctx, fvec_gpu_t *g, int num_qpus)
+{
+	assert(num_qpus >= 1 && num_qpus <= V3D_NUM_QPUS);
+	memset(g, 0, sizeof *g);
+	g->ctx = ctx;
+	g->num_qpus = num_qpus;
+	g->code = (uint32_t *)gpu_alloc(ctx, 8 * FVEC_CODE_MAX, 8);
+	if (!g->code)
+		return -1;
+
+	// uniforms for every QPU, for whichever kernel is built.
+	g->kernel.num_qpus = V3D_NUM_QPUS;
+	if (!gpu_kernel_unifs(ctx, &g->kernel, KERNEL_NUNIFS(qb_fma)))
+		return -1;
+	g->kernel.code = gpu_bus(ctx, g->code);
+	return 0;
+}
+
+int fvec_alloc(gpu_ctx_t *ctx, fvec_t *v, int n)
+{
+	v->n = n;
+	v->v = gpu_alloc(ctx, padded(n) * sizeof(float), FVEC_ALIGN);
+	if (!v->v)
+		return -1;
+	memset((void *)v->v, 0, padded(n) * sizeof(float));
+	return 0;
+}
+
+// run the kernel with 'nin' inputs (qb_map1s, qb_map2 or qb_fma) over n
+// elements: vec[] holds the inputs then the output, and s is qb_map1s's
+// scalar.  Rebuilds the kernel if the last run used another.
+static int run(fvec_gpu_t *g, int nin, int op, int n, const fvec_t *vec[], float s)
+{
+	uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS], bus[4];
+	gpu_ctx_t *ctx = g->ctx;
+	int max = nin == 1 ? qb_map1s_rows(g->num_qpus)
+		: nin == 2 ? qb_map2_rows(g->num_qpus) : qb_fma_rows(g->num_qpus);
+	int rows = max, nrows = padded(n) / 16;
+
+	for (int i = 0; i <= nin; i++)
+	{
+		if (vec[i]->n != n)
+			return -1;
+		bus[i] = gpu_bus(ctx, vec[i]->v);
+	}
+	if (!n)
+		return 0;
+	while (nrows % rows)
+		rows--;
+	if (g->nin != nin || g->op != op || g->rows != rows)
+	{
+		qb_t b;
+		qb_init(&b, g->code, FVEC_CODE_MAX);
+		if (nin == 1)
+			qb_map1s(&b, op, rows, 0);
+		else if (nin == 2)
+			qb_map2(&b, op, rows, 0);
+		else
+			qb_fma(&b, rows, 0);
+		if (b.err)
+		{
+			g->nin = 0;
+			return -1;
+		}
+		gpu_dirty(GPU_DIRTY_CODE);
+		g->nin = nin;
+		g->op = op;
+		g->rows = rows;
+	}
+
+	int used = gpu_partition(nrows / rows, g->num_qpus, first, count);
+	if (nin == 1)
+	{
+		struct qb_map1s_unifs u[V3D_NUM_QPUS];
+		for (int i = 0; i < used; i++)
+		{
+			uint32_t off = first[i] * rows * 64;
+			u[i] = (struct qb_map1s_unifs){ .blocks = count[i], .a = bus[0] + off, .s = s, .c = bus[1] + off, .qpu = i };
+		}
+		KERNEL_SET_UNIFS(qb_map1s, ctx, &g->kernel, u, used);
+	}
+	else if (nin == 2)
+	{
+		struct qb_map2_tmu_unifs u[V3D_NUM_QPUS];
+		for (int i = 0; i < used; i++)
+		{
+			uint32_t off = first[i] * rows * 64;
+			u[i] = (struct qb_map2_tmu_unifs){ .blocks = count[i], .a = bus[0] + off, .b = bus[1] + off, .c = bus[2] + off, .qpu = i };
+		}
+		KERNEL_SET_UNIFS(qb_map2_tmu, ctx, &g->kernel, u, used);
+	}
+	else
+	{
+		struct qb_fma_unifs u[V3D_NUM_QPUS];
+		for (int i = 0; i < used; i++)
+		{
+			uint32_t off = first[i] * rows * 64;
+			u[i] = (struct qb_fma_unifs){ .blocks = count[i], .a = bus[0] + off, .b = bus[1] + off, .c = bus[2] + off, .d = bus[3] + off, .qpu = i };
+		}
+		KERNEL_SET_UNIFS(qb_fma, ctx, &g->kernel, u, used);
+	}
+	g->kernel.num_qpus = used;
+	return gpu_launch(&g->kernel) ? -1 : 0;
+}
+
+static int float_op(int op)
+{
+	return op == FVEC_ADD || op == FVEC_SUB || op == FVEC_MUL || op == FVEC_MIN || op == FVEC_MAX;
+}
+
+int fvec_map(fvec_gpu_t *g, int op, fvec_t *c, const fvec_t *a, const fvec_t *b)
+{
+	const fvec_t *vec[] = { a, b, c };
+	if (!float_op(op))
+		return -1;
+	return run(g, 2, op, a->n, vec, 0);
+}
+
+int fvec_map_scalar(fvec_gpu_t *g, int op, fvec_t *c, const fvec_t *a, float s)
+{
+	const fvec_t *vec[] = { a, c };
+	if (!float_op(op))
+		return -1;
+	return run(g, 1, op, a->n, vec, s);
+}
+
+int fvec_fma(fvec_gpu_t *g, fvec_t *d, const fvec_t *a, const fvec_t *b, const fvec_t *c)
+{
+	const fvec_t *vec[] = { a, b, c, d };
+	return run(g, 3, 0, a->n, vec, 0);
+}
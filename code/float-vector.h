@@ -0,0 +1,77 @@
+#ifndef FLOAT_VECTOR_H
+#define FLOAT_VECTOR_H
+
+#include <stdint.h>
+#include "gpu-runtime.h"
+#include "qpu-builder.h"
+
+/*
+ * float32 elementwise math on the QPUs: C = A op B, C = A op s and
+ * D = A * B + C, over vectors in a gpu context.
+ *
+ *	fvec_gpu_t g;
+ *	fvec_t a, b, c;
+ *	fvec_gpu_init(&ctx, &g, num_qpus);
+ *	fvec_alloc(&ctx, &a, n); ...
+ *	fvec_mul(&g, &c, &a, &b);	// c = a * b
+ *	fvec_add(&g, &c, &c, 1.5f);	// c = c + 1.5
+ *
+ * The op macros pick the vector or the scalar kernel from the type of
+ * their last argument.  Kernels are built (qb_map2, qb_map1s, qb_fma) the
+ * first time an op is used on a vector size and rebuilt when the op
+ * changes.  Each returns 0, or -1 if the lengths differ.
+ */
+
+#define FVEC_ADD QPU_A_FADD
+#define FVEC_SUB QPU_A_FSUB
+#define FVEC_MUL QB_FMUL
+#define FVEC_MIN QPU_A_FMIN
+#define FVEC_MAX QPU_A_FMAX
+
+// elements a vector is padded to.
+#define FVEC_BLOCK 64
+
+typedef struct fvec
+{
+	volatile float *v;
+	int n;
+} fvec_t;
+
+typedef struct fvec_gpu
+{
+	gpu_ctx_t *ctx;
+	gpu_kernel_t kernel;
+	uint32_t *code;		// where the kernels are built
+	int num_qpus;
+	int nin, op, rows;	// the kernel in code: qb_map1s, qb_map2 or qb_fma inputs, or 0
+} fvec_gpu_t;
+
+// context bytes for fvec_gpu_init, and for an n-element vector.
+uint32_t fvec_gpu_size(void);
+uint32_t fvec_size(int n);
+
+// Run the ops on up to num_qpus (1..16) QPUs; 0, or -1 if out of memory.
+int fvec_gpu_init(gpu_ctx_t *ctx, fvec_gpu_t *g, int num_qpus);
+// An n-element vector, zeroed; 0, or -1 if out of memory.
+int fvec_alloc(gpu_ctx_t *ctx, fvec_t *v, int n);
+
+// c = a op b, op one of FVEC_*.
+int fvec_map(fvec_gpu_t *g, int op, fvec_t *c, const fvec_t *a, const fvec_t *b);
+// c = a op s.
+int fvec_map_scalar(fvec_gpu_t *g, int op, fvec_t *c, const fvec_t *a, float s);
+// d = a * b + c, the product rounded first.
+int fvec_fma(fvec_gpu_t *g, fvec_t *d, const fvec_t *a, const fvec_t *b, const fvec_t *c);
+
+#define FVEC_OP(g, op, c, a, x) _Generic((x), \
+	float: fvec_map_scalar, \
+	double: fvec_map_scalar, \
+	int: fvec_map_scalar, \
+	default: fvec_map)(g, op, c, a, x)
+
+#define fvec_add(g, c, a, x) FVEC_OP(g, FVEC_ADD, c, a, x)
+#define fvec_sub(g, c, a, x) FVEC_OP(g, FVEC_SUB, c, a, x)
+#define fvec_mul(g, c, a, x) FVEC_OP(g, FVEC_MUL, c, a, x)
+#define fvec_min(g, c, a, x) FVEC_OP(g, FVEC_MIN, c, a, x)
+#define fvec_max(g, c, a, x) FVEC_OP(g, FVEC_MAX, c, a, x)
+
+#endif /* FLOAT_VECTOR_H */
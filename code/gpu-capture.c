@@ -0,0 +1,76 @@
+#include "rpi.h"
+#include <string.h>
+#include "gpu-capture.h"
+
+uint32_t gpu_capture_size(gpu_ctx_t *ctx)
+{
+	// at worst a zero count and a literal count every other word.
+	uint32_t words = ctx->used / 4 + 2;
+	return sizeof(gpu_capture_t) + 2 * 4 * (words + words / 2 + 2);
+}
+
+// append w[0..n) as runs to buf[len..max); returns the new length or -1.
+static int put_runs(const volatile uint32_t *w, uint32_t n, uint8_t *buf, uint32_t len, uint32_t max)
+{
+	uint32_t *out = (uint32_t *)(buf + len), *end = (uint32_t *)(buf + (max & ~3u));
+
+	for (uint32_t i = 0; i < n;)
+	{
+		uint32_t z = i, lit;
+		while (z < n && !w[z])
+			z++;
+		// literals run until two zeros in a row: a lone zero is cheaper inline.
+		for (lit = z; lit < n && (w[lit] || (lit + 1 < n && w[lit + 1])); lit++)
+			;
+		if (end - out < 2 + (lit - z))
+			return -1;
+		*out++ = z - i;
+		*out++ = lit - z;
+		for (uint32_t j = z; j < lit; j++)
+			*out++ = w[j];
+		i = lit;
+	}
+	return (uint8_t *)out - buf;
+}
+
+int gpu_capture(gpu_ctx_t *ctx, gpu_kernel_t *k, uint32_t code_bytes, void *buf, uint32_t max)
+{
+	gpu_capture_t h;
+
+	if (((uintptr_t)buf & 3) || max < sizeof h)
+		return -1;
+	memset(&h, 0, sizeof h);
+	h.magic = GPU_CAPTURE_MAGIC;
+	h.version = GPU_CAPTURE_VERSION;
+	h.code = k->code;
+	h.code_bytes = code_bytes;
+	h.num_qpus = k->num_qpus;
+	for (int q = 0; q < k->num_qpus; q++)
+		h.unif[q] = k->unif[q];
+	h.bus = ctx->bus;
+	h.nwords = ctx->used / 4;
+	memcpy(buf, &h, sizeof h);
+	return put_runs((const volatile uint32_t *)ctx->cpu, h.nwords, buf, sizeof h, max);
+}
+
+int gpu_capture_result(gpu_ctx_t *ctx, void *buf, uint32_t len, uint32_t max)
+{
+	gpu_capture_t *h = buf;
+
+	if (h->has_result || h->nwords > ctx->used / 4)
+		return -1;
+	h->has_result = 1;
+	int n = put_runs((const volatile uint32_t *)ctx->cpu, h->nwords, buf, len, max);
+	if (n < 0)
+		h->has_result = 0;
+	return n;
+}
+
+int gpu_launch_captured(gpu_ctx_t *ctx, gpu_kernel_t *k, uint32_t code_bytes, void *buf, uint32_t max)
+{
+	int n = gpu_capture(ctx, k, code_bytes, buf, max);
+	if (n < 0)
+		return -1;
+	gpu_launch(k);
+	return gpu_capture_result(ctx, buf, n, max);
+}
@@ -0,0 +1,52 @@
+#ifndef GPU_CAPTURE_H
+#define GPU_CAPTURE_H
+
+#include <stdint.h>
+#include "gpu-runtime.h"
+
+/*
+ * Launch capture: a snapshot of everything a kernel launch reads, to
+ * replay it off the Pi (host/replay runs it on the emulator's timing
+ * model with per-instruction counters and diffs the output).
+ *
+ * A capture is the header below, then the words of the launch context from
+ * its start to ctx->used (code, uniforms and the buffers they point to) as
+ * the kernel found them, then, if has_result, the same words as it left
+ * them.  Each copy is stored as runs: a count of zero words, a count of
+ * literal words, the literals; until nwords are covered.  All words are
+ * little-endian.
+ *
+ *	uint8_t buf[...];
+ *	int n = gpu_launch_captured(&ctx, &k, sizeof addshader, buf, sizeof buf);
+ *	    ... write buf[0..n) to a file
+ */
+#define GPU_CAPTURE_MAGIC 0x50414351	// "QCAP"
+#define GPU_CAPTURE_VERSION 1
+
+typedef struct gpu_capture
+{
+	uint32_t magic, version;
+	uint32_t code;			// bus address of the program
+	uint32_t code_bytes;		// its length, or 0 if not known
+	uint32_t num_qpus;
+	uint32_t unif[V3D_NUM_QPUS];	// each QPU's uniforms
+	uint32_t bus;			// bus address of the first word captured
+	uint32_t nwords;		// words in each copy
+	uint32_t has_result;
+} gpu_capture_t;
+
+// Bytes a capture of 'ctx' (with its result) can take, at most.
+uint32_t gpu_capture_size(gpu_ctx_t *ctx);
+
+/*
+ * Snapshot 'k', about to be launched from 'ctx', into buf[0..max).
+ * 'code_bytes' is the program's length (0 if not known).  Returns the
+ * bytes written, or -1 if they do not fit.
+ */
+int gpu_capture(gpu_ctx_t *ctx, gpu_kernel_t *k, uint32_t code_bytes, void *buf, uint32_t max);
+// After the launch: append ctx's memory to the capture of 'len' bytes in buf.
+int gpu_capture_result(gpu_ctx_t *ctx, void *buf, uint32_t len, uint32_t max);
+// gpu_capture, gpu_launch, gpu_capture_result.
+int gpu_launch_captured(gpu_ctx_t *ctx, gpu_kernel_t *k, uint32_t code_bytes, void *buf, uint32_t max);
+
+#endif /* GPU_CAPTURE_H */
@@ -0,0 +1,209 @@
+#include "rpi.h"
+#include <stddef.h>
+#include <string.h>
+#include "gpu-runtime.h"
+#include "mailbox.h"
+#include "mbox-prop.h"
+
+// contexts alive; the QPUs stay enabled while any exist.
+static unsigned nctx;
+
+__attribute__((weak)) volatile void *gpu_bus_to_cpu(uint32_t bus)
+{
+	return (volatile void *)(uintptr_t)(bus & ~GPU_ALIAS_MASK);
+}
+
+int gpu_init(gpu_ctx_t *ctx, uint32_t size)
+{
+	return gpu_init_mem(ctx, size, GPU_MEM_FLG);
+}
+
+int gpu_init_mem(gpu_ctx_t *ctx, uint32_t size, uint32_t mem)
+{
+	mbox_gpu_mem_t g;
+
+	memset(ctx, 0, sizeof *ctx);
+	// the first context also enables the QPUs, in the same round trip.
+	int ret = mbox_gpu_mem_open(&g, size, 4096, mem, !nctx);
+	if (ret < 0)
+		return ret;
+
+	ctx->handle = g.handle;
+	ctx->bus = g.bus;
+	ctx->cpu = gpu_bus_to_cpu(g.bus);
+	ctx->size = size;
+	ctx->used = 0;
+	ctx->mem = mem;
+	nctx++;
+	return 0;
+}
+
+void gpu_release(gpu_ctx_t *ctx)
+{
+	if (!ctx->handle)
+		return;
+	mem_unlock(ctx->handle);
+	mem_free(ctx->handle);
+	ctx->handle = 0;
+	if (!--nctx)
+		qpu_enable(0);
+}
+
+void gpu_dirty(unsigned what)
+{
+	unsigned caches = 0;
+
+	if (what & GPU_DIRTY_CODE)
+		caches |= V3D_CACHE_INSN;
+	if (what & GPU_DIRTY_UNIFS)
+		caches |= V3D_CACHE_UNIF;
+	if (what & GPU_DIRTY_TEX)
+		caches |= V3D_CACHE_TMU;
+	// the mailbox alias picks how the VideoCore L2 caches the memory; the
+	// V3D's own L2 (L2C) sits in front of it for every alias and may still
+	// hold the old lines whichever one the ARM wrote through.
+	if (caches)
+		caches |= V3D_CACHE_L2;
+	v3d_cache_dirty(caches);
+}
+
+volatile void *gpu_alloc(gpu_ctx_t *ctx, uint32_t nbytes, uint32_t align)
+{
+	if (align < 4)
+		align = 4;
+	uint32_t off = (ctx->used + align - 1) & ~(align - 1);
+	if (off > ctx->size || nbytes > ctx->size - off)
+		return NULL;
+	ctx->used = off + nbytes;
+	// fresh memory may reuse a resident kernel's code or uniforms.
+	v3d_invalidate();
+	return ctx->cpu + off;
+}
+
+void gpu_free(gpu_ctx_t *ctx, volatile void *p)
+{
+	uint32_t off = (volatile uint8_t *)p - ctx->cpu;
+	assert(off <= ctx->used);
+	ctx->used = off;
+}
+
+uint32_t gpu_bus(gpu_ctx_t *ctx, const volatile void *p)
+{
+	uint32_t off = (const volatile uint8_t *)p - ctx->cpu;
+	assert(off <= ctx->size);
+	return ctx->bus + off;
+}
+
+uint32_t gpu_load_code(gpu_ctx_t *ctx, const uint32_t *code, uint32_t nbytes)
+{
+	// QPU instructions are 64-bit.
+	volatile void *p = gpu_alloc(ctx, nbytes, 8);
+	if (!p)
+		return 0;
+	memcpy((void *)p, code, nbytes);
+	gpu_dirty(GPU_DIRTY_CODE);
+	return gpu_bus(ctx, p);
+}
+
+int gpu_kernel_init(
+	gpu_ctx_t *ctx,
+	gpu_kernel_t *k,
+	const uint32_t *code,
+	uint32_t nbytes,
+	int num_qpus)
+{
+	memset(k, 0, sizeof *k);
+	if (num_qpus <= 0 || num_qpus > V3D_NUM_QPUS)
+		return -1;
+	k->code = gpu_load_code(ctx, code, nbytes);
+	if (!k->code)
+		return -1;
+	k->num_qpus = num_qpus;
+	return 0;
+}
+
+volatile uint32_t *gpu_kernel_unifs(gpu_ctx_t *ctx, gpu_kernel_t *k, int nunifs)
+{
+	assert(nunifs > 0 && nunifs <= GPU_MAX_UNIFS);
+	volatile uint32_t *u = gpu_alloc(ctx, k->num_qpus * nunifs * sizeof *u, 16);
+	if (!u)
+		return NULL;
+	for (int q = 0; q < k->num_qpus; q++)
+		k->unif[q] = gpu_bus(ctx, &u[q * nunifs]);
+	// the caller fills them in before the next launch.
+	gpu_dirty(GPU_DIRTY_UNIFS);
+	return u;
+}
+
+void gpu_kernel_set_unifs(gpu_ctx_t *ctx, gpu_kernel_t *k, const void *u, uint32_t size, int num_qpus)
+{
+	assert(num_qpus >= 0 && num_qpus <= V3D_NUM_QPUS && size <= GPU_MAX_UNIFS * sizeof(uint32_t));
+	for (int q = 0; q < num_qpus; q++)
+	{
+		// uniforms gpu_kernel_unifs never gave q (unif[q] 0) are not in ctx.
+		assert(k->unif[q] - ctx->bus <= ctx->size - size);
+		memcpy((void *)gpu_bus_to_cpu(k->unif[q]), (const uint8_t *)u + q * size, size);
+	}
+	gpu_dirty(GPU_DIRTY_UNIFS);
+}
+
+int gpu_partition(uint32_t nblocks, int num_qpus, uint32_t first[], uint32_t count[])
+{
+	if (num_qpus <= 0 || nblocks == 0)
+		return 0;
+	if (num_qpus > nblocks)
+		num_qpus = nblocks;
+
+	uint32_t each = nblocks / num_qpus, extra = nblocks % num_qpus;
+	uint32_t next = 0;
+	for (int q = 0; q < num_qpus; q++)
+	{
+		first[q] = next;
+		count[q] = each + (q < extra);
+		next += count[q];
+	}
+	return num_qpus;
+}
+
+unsigned gpu_launch(gpu_kernel_t *k)
+{
+	return gpu_fft_base_exec_direct(k->code, k->unif, k->num_qpus);
+}
+
+unsigned gpu_launch_resident(gpu_kernel_t *k)
+{
+	qpu_job_t job = {0};
+
+	if (qpu_job_submit(&job, k->code, k->unif, k->num_qpus, QPU_JOB_RESIDENT) < 0)
+		return -1;
+	qpu_job_wait(&job);
+	return 0;
+}
+
+int gpu_launch_async(gpu_kernel_t *k, qpu_job_t *job, unsigned flags)
+{
+	return qpu_job_submit(job, k->code, k->unif, k->num_qpus, flags);
+}
+
+void gpu_batch_init(gpu_batch_t *b, qpu_req_t *reqs, int max)
+{
+	b->reqs = reqs;
+	b->n = 0;
+	b->max = max;
+}
+
+int gpu_batch_add(gpu_batch_t *b, gpu_kernel_t *k)
+{
+	if (!k->any_qpu || b->n + k->num_qpus > b->max)
+		return -1;
+	for (int q = 0; q < k->num_qpus; q++)
+		b->reqs[b->n++] = (qpu_req_t){ .code = k->code, .unif = k->unif[q] };
+	return 0;
+}
+
+unsigned gpu_batch_run(gpu_batch_t *b)
+{
+	int ret = qpu_batch_run(b->reqs, b->n);
+	b->n = 0;
+	return ret;
+}
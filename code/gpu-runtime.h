@@ -0,0 +1,178 @@
+#ifndef GPU_RUNTIME_H
+#define GPU_RUNTIME_H
+
+#include <stdint.h>
+#include "v3d.h"
+
+/*
+ * GPU buffer/job runtime.
+ *
+ * A gpu_ctx_t owns one locked VideoCore allocation and hands out
+ * sub-regions of it for code, uniforms and data, so kernels share a single
+ * mapping and pay the mailbox allocate/lock/enable cost once:
+ *
+ *	gpu_ctx_t ctx;
+ *	gpu_init(&ctx, 1 << 20);
+ *	gpu_kernel_t k;
+ *	gpu_kernel_init(&ctx, &k, addshader, sizeof addshader, num_qpus);
+ *	volatile uint32_t *u = gpu_kernel_unifs(&ctx, &k, 5);
+ *	... fill u[q * 5 + i] ...
+ *	gpu_launch(&k);
+ *	gpu_release(&ctx);
+ *
+ * Sub-allocations are bump allocated, and freed LIFO: gpu_free(p) gives
+ * back p and everything allocated after it, whoever owns it.  Free in the
+ * reverse order of allocation (objects holding several allocations, like
+ * the add and multiply launchers, check that nothing of anyone else's came
+ * after theirs); gpu_release() reclaims the rest.
+ *
+ * Bus addresses (what the QPUs see) and ARM addresses differ by the VC
+ * alias bits; always convert with gpu_bus().
+ *
+ * Every buffer in a context shares its memory attributes, so buffers that
+ * want different ones go in different contexts (gpu_init_mem).  Launches
+ * only clear the V3D caches the CPU dirtied since the last one: the
+ * runtime reports code and uniforms it writes itself, and callers report
+ * later rewrites with gpu_dirty().
+ */
+
+// memory attributes (mailbox MEM_FLAG_* cache modes).
+#define GPU_MEM_CACHED 0xC		// allocating in the VC L2
+#define GPU_MEM_COHERENT 0x8	// non-allocating in the VC L2
+#define GPU_MEM_DIRECT 0x4		// uncached
+#define GPU_MEM_FLG GPU_MEM_CACHED
+#define GPU_BASE 0x40000000
+#define GPU_ALIAS_MASK 0xC0000000
+
+#define GPU_MAX_UNIFS 16 // per QPU
+
+typedef struct gpu_ctx
+{
+	uint32_t handle;
+	uint32_t bus;			// bus address of the allocation
+	volatile uint8_t *cpu;	// ARM address of the allocation
+	uint32_t size;
+	uint32_t used;
+	uint32_t mem;			// GPU_MEM_* of the allocation
+} gpu_ctx_t;
+
+/*
+ * A launchable kernel: code address, one uniforms block per QPU, and how
+ * many QPUs to run it on.
+ */
+typedef struct gpu_kernel
+{
+	uint32_t code;
+	uint32_t unif[V3D_NUM_QPUS];
+	int num_qpus;
+	int any_qpu;	// its VPM rows follow the QPU it lands on: it can be batched
+} gpu_kernel_t;
+
+// ARM address of a bus address.  Host builds override this.
+volatile void *gpu_bus_to_cpu(uint32_t bus);
+
+/*
+ * Enable the QPUs and allocate + lock 'size' bytes.  Returns 0 on success,
+ * -2 if the QPUs could not be enabled, -3 if the allocation failed, -4 if
+ * it could not be locked.
+ */
+int gpu_init(gpu_ctx_t *ctx, uint32_t size);
+// gpu_init with GPU_MEM_* attributes 'mem' instead of GPU_MEM_FLG.
+int gpu_init_mem(gpu_ctx_t *ctx, uint32_t size, uint32_t mem);
+void gpu_release(gpu_ctx_t *ctx);
+
+// what the CPU rewrote, for gpu_dirty().
+#define GPU_DIRTY_CODE (1 << 0)
+#define GPU_DIRTY_UNIFS (1 << 1)
+#define GPU_DIRTY_TEX (1 << 2) // data kernels read through the TMU
+
+/*
+ * Make the next launch clear the caches that may hold stale copies of
+ * 'what'.  The V3D caches are shared by every context, and whatever a
+ * context's memory attributes, its lines can sit in them, so this takes
+ * no context.
+ */
+void gpu_dirty(unsigned what);
+
+// 'nbytes' of 'align'-aligned memory (align a power of 2), or NULL.
+volatile void *gpu_alloc(gpu_ctx_t *ctx, uint32_t nbytes, uint32_t align);
+// Give back 'p' and everything allocated after it (LIFO).  'p' must still
+// be allocated: not given back already with something before it.
+void gpu_free(gpu_ctx_t *ctx, volatile void *p);
+
+// Bus address of 'p', which must point into ctx's allocation.
+uint32_t gpu_bus(gpu_ctx_t *ctx, const volatile void *p);
+
+// Copy 'nbytes' of QPU code into the context; returns its bus address or 0.
+uint32_t gpu_load_code(gpu_ctx_t *ctx, const uint32_t *code, uint32_t nbytes);
+
+/*
+ * Load 'code' and set up 'k' to run on 'num_qpus' QPUs.  Returns 0, or -1
+ * if out of memory or num_qpus is out of range.
+ */
+int gpu_kernel_init(gpu_ctx_t *ctx, gpu_kernel_t *k, const uint32_t *code, uint32_t nbytes, int num_qpus);
+
+/*
+ * Allocate 'nunifs' uniforms for each of k's QPUs and point k->unif[] at
+ * them.  QPU q's uniforms are u[q * nunifs + 0 .. nunifs-1].
+ */
+volatile uint32_t *gpu_kernel_unifs(gpu_ctx_t *ctx, gpu_kernel_t *k, int nunifs);
+/*
+ * Copy the uniforms of QPUs 0..num_qpus-1 of 'k' into place in one pass:
+ * 'u' is num_qpus blocks of 'size' bytes, QPU q's at u + q * size.  Each
+ * of those QPUs must have uniforms in ctx from gpu_kernel_unifs (checked:
+ * k->num_qpus may since have dropped below that, but not k->unif[]).  See
+ * kernel-abi.h for typed blocks.
+ */
+void gpu_kernel_set_unifs(gpu_ctx_t *ctx, gpu_kernel_t *k, const void *u, uint32_t size, int num_qpus);
+
+/*
+ * Split 'nblocks' equal work blocks over at most 'num_qpus' QPUs: QPU q
+ * gets count[q] blocks starting at block first[q], with counts differing
+ * by at most one.  Returns how many QPUs got work, which is never more
+ * than nblocks (kernels loop do-while, so an idle QPU must not run).
+ */
+int gpu_partition(uint32_t nblocks, int num_qpus, uint32_t first[], uint32_t count[]);
+
+// Run 'k' to completion.
+unsigned gpu_launch(gpu_kernel_t *k);
+/*
+ * Run 'k' to completion through the resident fast path (QPU_JOB_RESIDENT):
+ * for kernels relaunched back to back whose code and uniform addresses do
+ * not change between calls.  Falls back to a full launch when 'k' is not
+ * the kernel that ran last.
+ */
+unsigned gpu_launch_resident(gpu_kernel_t *k);
+// Start 'k' and return; see qpu_job_is_done/qpu_job_wait.
+int gpu_launch_async(gpu_kernel_t *k, qpu_job_t *job, unsigned flags);
+
+/*
+ * A batch of independent kernel launches run in one scheduler pass (see
+ * qpu_batch_run).  The caller provides the request storage:
+ *
+ *	qpu_req_t reqs[64 * V3D_NUM_QPUS];
+ *	gpu_batch_t b;
+ *	gpu_batch_init(&b, reqs, 64 * V3D_NUM_QPUS);
+ *	for (...) gpu_batch_add(&b, &kernel[i]);
+ *	gpu_batch_run(&b);
+ *
+ * The requests of different kernels run on the QPUs at the same time, so
+ * a kernel that picks its VPM rows by its index among its own QPUs would
+ * share them with the others.  Only kernels whose rows follow the
+ * hardware QPU number (any_qpu set: qpu-builder.h's qb_t.qpu_num) can be
+ * batched.
+ */
+typedef struct gpu_batch
+{
+	qpu_req_t *reqs;
+	int n, max;
+} gpu_batch_t;
+
+void gpu_batch_init(gpu_batch_t *b, qpu_req_t *reqs, int max);
+// Queue every QPU request of 'k'.  Returns -1 if the batch is full or
+// 'k' is not any_qpu.
+int gpu_batch_add(gpu_batch_t *b, gpu_kernel_t *k);
+// Run everything queued and empty the batch.
+unsigned gpu_batch_run(gpu_batch_t *b);
+
+#endif /* GPU_RUNTIME_H */
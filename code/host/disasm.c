@@ -0,0 +1,51 @@
+// disassemble the assembled shaders (qpu-disasm.h), as they are and as
+// scheduled.  Per-instruction counts and stalls come from the timing
+// model's report: see host/replay for a launch captured on the Pi.
+//
+//   usage: disasm [name...]        (default all)
+#include "rpi.h"
+#include "qpu-disasm.h"
+#include "addshader.h"
+#include "mulshader.h"
+#include "simpleshader.h"
+#include "mandelbrotshader.h"
+#include "addshader-sched.h"
+#include "mulshader-sched.h"
+#include "simpleshader-sched.h"
+#include "mandelbrotshader-sched.h"
+
+static const struct
+{
+    const char *name;
+    const uint32_t *code;
+    unsigned nbytes;
+} shaders[] = {
+    { "addshader", addshader, sizeof addshader },
+    { "mulshader", mulshader, sizeof mulshader },
+    { "simpleshader", simpleshader, sizeof simpleshader },
+    { "mandelbrotshader", mandelbrotshader, sizeof mandelbrotshader },
+    { "addshader_sched", addshader_sched, sizeof addshader_sched },
+    { "mulshader_sched", mulshader_sched, sizeof mulshader_sched },
+    { "simpleshader_sched", simpleshader_sched, sizeof simpleshader_sched },
+    { "mandelbrotshader_sched", mandelbrotshader_sched, sizeof mandelbrotshader_sched },
+};
+
+int main(int argc, char *argv[])
+{
+    int n = sizeof shaders / sizeof shaders[0], found = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        int want = argc < 2;
+        for (int a = 1; a < argc; a++)
+            want |= strcmp(argv[a], shaders[i].name) == 0;
+        if (!want)
+            continue;
+        printk("%s: %u instructions\n", shaders[i].name, shaders[i].nbytes / 8);
+        qpu_disasm_print(shaders[i].code, shaders[i].nbytes, 0);
+        found++;
+    }
+    if (!found)
+        panic("usage: disasm [name...]\n");
+    return 0;
+}
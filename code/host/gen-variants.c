@@ -0,0 +1,99 @@
+// build the kernels specialized to fixed sizes (kernel-variants.h) with the
+// kernel builder and write them to kernel-variants-table.c, with a size
+// report on stdout.
+//
+//   usage: gen-variants [dir]     (default ..)
+#include "rpi.h"
+#include "qpu-builder.h"
+#include "mandelbrot.h"
+
+#define MAX_INS 1024
+
+// the sizes production jobs run at.
+static const uint32_t vec_sizes[] = { 4096, 65536 };
+static const int vec_qpus[] = { 1, 2, 4, 8, 12 };
+static const struct { int res, iters; } mandel_sizes[] = { { 64, 100 } };
+static const int mandel_qpus[] = { 1, 4, 8, 12 };
+
+static FILE *f;
+static char table[1 << 14];
+static int ntable;
+
+static void emit(const char *name, const qb_t *b, uint32_t size, uint32_t iters, int num_qpus, int rows)
+{
+    if (b->err)
+        panic("%s: does not build\n", name);
+    fprintf(f, "\nstatic const uint32_t %s[%d] __attribute__((aligned(8))) = {\n", name, 2 * b->n);
+    for (int i = 0; i < b->n; i++)
+        fprintf(f, "0x%08x, 0x%08x%s\n", b->code[2 * i], b->code[2 * i + 1], i + 1 < b->n ? "," : "");
+    fprintf(f, "};\n");
+    ntable += snprintf(table + ntable, sizeof table - ntable, "\t{ %s, sizeof %s, %u, %u, %d, %d },\n",
+        name, name, size, iters, num_qpus, rows);
+    printf("%-24s %6d instructions\n", name, b->n);
+}
+
+static void end_table(const char *name)
+{
+    fprintf(f, "\nconst kernel_variant_t %s[] = {\n%s\t{ 0 },\n};\n", name, table);
+    ntable = 0;
+}
+
+// add and mul: the most rows per block that split 'n' evenly.
+static void vec_variants(const char *kernel, int op)
+{
+    static uint32_t code[2 * MAX_INS];
+    char name[64];
+    qb_t b;
+
+    for (int i = 0; i < sizeof vec_sizes / sizeof vec_sizes[0]; i++)
+        for (int j = 0; j < sizeof vec_qpus / sizeof vec_qpus[0]; j++)
+        {
+            uint32_t n = vec_sizes[i];
+            int nq = vec_qpus[j], rows = qb_map2_rows(nq);
+            while (rows > 0 && n % (16 * rows * nq) != 0)
+                rows--;
+            if (!rows)
+                continue;
+            qb_init(&b, code, MAX_INS);
+            qb_map2(&b, op, rows, n / (16 * rows * nq));
+            snprintf(name, sizeof name, "%s_%u_%d", kernel, n, nq);
+            emit(name, &b, n, 0, nq, rows);
+        }
+    snprintf(name, sizeof name, "%s_variants", kernel);
+    end_table(name);
+}
+
+static void mandel_variants(void)
+{
+    static uint32_t code[2 * MAX_INS];
+    char name[64];
+    qb_t b;
+
+    for (int i = 0; i < sizeof mandel_sizes / sizeof mandel_sizes[0]; i++)
+        for (int j = 0; j < sizeof mandel_qpus / sizeof mandel_qpus[0]; j++)
+        {
+            int res = mandel_sizes[i].res, iters = mandel_sizes[i].iters, nq = mandel_qpus[j];
+            qb_init(&b, code, MAX_INS);
+            qb_mandelbrot(&b, res, mandelbrot_step(res), iters, nq);
+            snprintf(name, sizeof name, "mandelbrot_%d_%d_%d", res, iters, nq);
+            emit(name, &b, res, iters, nq, 0);
+        }
+    end_table("mandelbrot_variants");
+}
+
+int main(int argc, char *argv[])
+{
+    char path[512];
+    const char *dir = argc > 1 ? argv[1] : "..";
+
+    snprintf(path, sizeof path, "%s/kernel-variants-table.c", dir);
+    if (!(f = fopen(path, "w")))
+        panic("cannot create %s\n", path);
+    fprintf(f, "// kernels specialized to fixed sizes, from host/gen-variants; regenerate\n");
+    fprintf(f, "// with \"make -C host variants\".\n#include \"kernel-variants.h\"\n");
+    vec_variants("add", QPU_A_ADD);
+    vec_variants("mul", QB_MUL24);
+    mandel_variants();
+    fclose(f);
+    return 0;
+}
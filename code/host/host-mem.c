@@ -0,0 +1,217 @@
+#include "rpi.h"
+#include "mbox-prop.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "mbox-mock.h"
+
+#define MAXBLOCKS 256
+
+host_mem_stats_t host_mem_stats;
+uint32_t host_mem_fail_tag;
+
+static uint8_t *arena;
+
+// a handle is index+1 into blocks[].
+static struct block
+{
+    uint32_t off, size, flags;
+    unsigned live, locked;
+} blocks[MAXBLOCKS];
+static unsigned nblocks;
+static uint32_t top;
+
+// the VC alias the firmware hands out for each MEM_FLAG cache mode.
+static uint32_t alias(uint32_t flags)
+{
+    switch (flags & 0xC)
+    {
+    case 0x4: return 0xC0000000;    // direct
+    case 0x8: return 0x80000000;    // coherent
+    case 0xC: return 0x40000000;    // L1 non-allocating
+    default: return 0;
+    }
+}
+
+static void arena_init(void)
+{
+    if (arena)
+        return;
+    arena = aligned_alloc(4096, HOST_MEM_SIZE);
+    assert(arena);
+    memset(arena, 0, HOST_MEM_SIZE);
+}
+
+void host_mem_reset(void)
+{
+    arena_init();
+    memset(blocks, 0, sizeof blocks);
+    nblocks = 0;
+    top = 0;
+    memset(&host_mem_stats, 0, sizeof host_mem_stats);
+    host_mem_fail_tag = 0;
+    mbox_mock_init();
+}
+
+void *host_mem_ptr(uint32_t bus)
+{
+    uint32_t phys = bus & ~GPU_ALIAS_MASK;
+    arena_init();
+    if (phys < HOST_MEM_PHYS || phys - HOST_MEM_PHYS >= HOST_MEM_SIZE)
+        return NULL;
+    return arena + (phys - HOST_MEM_PHYS);
+}
+
+volatile void *gpu_bus_to_cpu(uint32_t bus)
+{
+    void *p = host_mem_ptr(bus);
+    if (!p)
+        panic("bus address %x is not in the host arena\n", bus);
+    return p;
+}
+
+static struct block *lookup(uint32_t handle)
+{
+    if (!handle || handle > nblocks || !blocks[handle - 1].live)
+        return NULL;
+    return &blocks[handle - 1];
+}
+
+static uint32_t fw_alloc(uint32_t size, uint32_t align, uint32_t flags)
+{
+    arena_init();
+    if (!align)
+        align = 4096;
+    // freed space is only reused when it is at the top of the arena.
+    while (nblocks && !blocks[nblocks - 1].live)
+        top = blocks[--nblocks].off;
+
+    uint32_t off = (top + align - 1) & ~(align - 1);
+    if (nblocks == MAXBLOCKS || off > HOST_MEM_SIZE || size > HOST_MEM_SIZE - off)
+        return 0;
+
+    blocks[nblocks] = (struct block){ .off = off, .size = size, .flags = flags, .live = 1 };
+    top = off + size;
+    host_mem_stats.nalloc++;
+    host_mem_stats.bytes_live += size;
+    return ++nblocks;
+}
+
+static uint32_t fw_free(uint32_t handle)
+{
+    struct block *b = lookup(handle);
+    if (!b)
+        return 1;
+    b->live = 0;
+    host_mem_stats.nfree++;
+    host_mem_stats.bytes_live -= b->size;
+    return 0;
+}
+
+static uint32_t fw_lock(uint32_t handle)
+{
+    struct block *b = lookup(handle);
+    if (!b)
+        return 0;
+    b->locked = 1;
+    host_mem_stats.nlock++;
+    return alias(b->flags) | (HOST_MEM_PHYS + b->off);
+}
+
+static uint32_t fw_unlock(uint32_t handle)
+{
+    struct block *b = lookup(handle);
+    if (!b)
+        return 1;
+    b->locked = 0;
+    host_mem_stats.nunlock++;
+    return 0;
+}
+
+static uint32_t fw_enable_qpu(uint32_t enable)
+{
+    host_mem_stats.qpu_enabled = enable;
+    if (enable)
+        host_mem_stats.nenable++;
+    return 0;
+}
+
+// answer one tag in place; returns 0 if the tag is unknown or too small.
+static int fw_tag(uint32_t tag, uint32_t *v, uint32_t bufsize)
+{
+    unsigned nout = (tag == MBOX_TAG_GET_ARM_MEMORY || tag == MBOX_TAG_GET_VC_MEMORY) ? 2 : 1;
+    unsigned nin = tag == MBOX_TAG_ALLOCATE_MEMORY ? 3 : 1;
+
+    if (tag == host_mem_fail_tag)
+        return 0;
+    if (tag == MBOX_TAG_GET_ARM_MEMORY || tag == MBOX_TAG_GET_VC_MEMORY)
+        nin = 0;
+    if (bufsize < 4 * (nin > nout ? nin : nout))
+        return 0;
+
+    switch (tag)
+    {
+    case MBOX_TAG_GET_ARM_MEMORY:
+        v[0] = 0;
+        v[1] = HOST_MEM_PHYS;
+        break;
+    case MBOX_TAG_GET_VC_MEMORY:
+        v[0] = HOST_MEM_PHYS;
+        v[1] = HOST_MEM_SIZE;
+        break;
+    case MBOX_TAG_ALLOCATE_MEMORY:
+        v[0] = fw_alloc(v[0], v[1], v[2]);
+        break;
+    case MBOX_TAG_LOCK_MEMORY:
+        v[0] = fw_lock(v[0]);
+        break;
+    case MBOX_TAG_UNLOCK_MEMORY:
+        v[0] = fw_unlock(v[0]);
+        break;
+    case MBOX_TAG_RELEASE_MEMORY:
+        v[0] = fw_free(v[0]);
+        break;
+    case MBOX_TAG_ENABLE_QPU:
+        v[0] = fw_enable_qpu(v[0]);
+        break;
+    default:
+        return 0;
+    }
+    return 4 * nout;
+}
+
+int host_fw_property(uint32_t *msg)
+{
+    if ((uintptr_t)msg & 0xF)
+        return 0;
+    host_mem_stats.nmbox++;
+
+    // the firmware rejects a message whose size word or tag list is off,
+    // before running any of its tags.
+    uint32_t nwords = msg[0] / 4;
+    if (msg[0] % 4 || nwords < 3 || msg[1] != MBOX_REQUEST)
+        goto bad;
+    unsigned i = 2;
+    while (i < nwords && msg[i] != 0)
+    {
+        if (i + 3 > nwords || msg[i + 1] % 4 || i + 3 + msg[i + 1] / 4 > nwords)
+            goto bad;
+        if (msg[i + 2] & MBOX_TAG_RESPONSE)
+            goto bad;
+        i += 3 + msg[i + 1] / 4;
+    }
+    if (i != nwords - 1)
+        goto bad;
+
+    for (i = 2; msg[i] != 0; i += 3 + msg[i + 1] / 4)
+    {
+        host_mem_stats.ntags++;
+        int len = fw_tag(msg[i], &msg[i + 3], msg[i + 1]);
+        if (len)
+            msg[i + 2] = MBOX_TAG_RESPONSE | len;
+    }
+    msg[1] = MBOX_RESPONSE_OK;
+    return 1;
+bad:
+    msg[1] = 0x80000001; // parse error
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef __HOST_MEM_H__
+#define __HOST_MEM_H__
+/*
+ * Host stand-in for the VideoCore firmware and its memory: property
+ * messages that reach the fake mailbox (mbox-mock.h) go to
+ * host_fw_property(), which answers the memory, QPU-enable and memory-split property tags against
+ * one malloc'd arena that plays the part of the GPU's share of SDRAM.  It
+ * checks each message's encoding the way the firmware does and rejects
+ * malformed ones.  Locked allocations get bus addresses with the same alias
+ * bits the firmware would use for their flags, and gpu_bus_to_cpu() maps
+ * any bus address in the arena back to host memory.
+ */
+#include <stdint.h>
+
+// physical address of the arena as the "GPU" sees it.
+#define HOST_MEM_PHYS 0x1e000000
+#define HOST_MEM_SIZE (64 << 20)
+
+typedef struct host_mem_stats
+{
+    unsigned nalloc, nfree, nlock, nunlock;
+    unsigned qpu_enabled;
+    unsigned nenable;       // number of qpu_enable(1) calls
+    uint32_t bytes_live;
+    unsigned nmbox;         // mailbox round trips
+    unsigned ntags;         // property tags processed
+} host_mem_stats_t;
+
+extern host_mem_stats_t host_mem_stats;
+
+// a tag the firmware leaves unanswered, to exercise error paths (0: none).
+extern uint32_t host_mem_fail_tag;
+
+// host pointer for a bus address, or NULL if it is not in the arena.
+void *host_mem_ptr(uint32_t bus);
+
+// run the property tags in 'msg' like the firmware; returns what
+// mbox_property would.
+int host_fw_property(uint32_t *msg);
+
+// free everything, zero the stats and clear host_mem_fail_tag; also
+// resets and installs the fake mailbox.
+void host_mem_reset(void);
+
+#endif
@@ -0,0 +1,35 @@
+// host implementations of the libpi routines declared in rpi.h.
+#include <time.h>
+#include "rpi.h"
+
+uint32_t GET32(uint32_t addr)
+{
+    panic("no MMIO on the host: GET32(%x)\n", addr);
+}
+
+void PUT32(uint32_t addr, uint32_t v)
+{
+    panic("no MMIO on the host: PUT32(%x, %x)\n", addr, v);
+}
+
+unsigned timer_get_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+void delay_ms(unsigned ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+    nanosleep(&ts, 0);
+}
+
+void kmalloc_init(unsigned mb) { }
+
+void *kmalloc(unsigned nbytes)
+{
+    void *p = calloc(1, nbytes);
+    assert(p);
+    return p;
+}
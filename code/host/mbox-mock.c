@@ -0,0 +1,115 @@
+#include "rpi.h"
+#include "mbox-mock.h"
+#include "host-mem.h"
+
+#define MAILBOX_BASE 0x2000B880
+#define MAILBOX_READ (MAILBOX_BASE + 0x0)
+#define MAILBOX_STATUS (MAILBOX_BASE + 0x18)
+#define MAILBOX_WRITE (MAILBOX_BASE + 0x20)
+
+#define MAILBOX_FULL 0x80000000
+#define MAILBOX_EMPTY 0x40000000
+
+mbox_mock_t mbox_mock;
+
+// fake bus address (slot << 4) of every message buffer seen so far.
+#define NSLOTS 256
+static volatile void *slots[NSLOTS];
+static unsigned nslots;
+
+uint32_t mbox_bus_addr(volatile void *p)
+{
+    // keep the low bits so misaligned buffers still look misaligned.
+    uintptr_t base = (uintptr_t)p & ~(uintptr_t)0xF;
+    for (unsigned i = 1; i <= nslots; i++)
+        if ((uintptr_t)slots[i] == base)
+            return i << 4 | ((uintptr_t)p & 0xF);
+    assert(nslots + 1 < NSLOTS);
+    slots[++nslots] = (volatile void *)base;
+    return nslots << 4 | ((uintptr_t)p & 0xF);
+}
+
+static uint32_t *slot_ptr(uint32_t addr)
+{
+    unsigned i = addr >> 4;
+    assert(i && i <= nslots);
+    return (uint32_t *)slots[i];
+}
+
+void mbox_mock_push(uint8_t channel, uint32_t data)
+{
+    mbox_mock_t *m = &mbox_mock;
+    assert(m->in_n < 64);
+    m->in[(m->in_head + m->in_n++) % 64] = (data & ~0xF) | (channel & 0xF);
+}
+
+unsigned mbox_mock_reply(unsigned n)
+{
+    mbox_mock_t *m = &mbox_mock;
+    unsigned i;
+
+    for (i = 0; i < n && m->out_n; i++)
+    {
+        uint32_t data = m->out[0];
+        memmove(m->out, m->out + 1, --m->out_n * sizeof m->out[0]);
+        // the firmware only serves the property channel; others are dropped.
+        if ((data & 0xF) != MBOX_CH_PROP)
+            continue;
+        host_fw_property(slot_ptr(data & ~0xF));
+        mbox_mock_push(MBOX_CH_PROP, data);
+    }
+    return i;
+}
+
+static uint32_t mock_get32(uint32_t addr)
+{
+    mbox_mock_t *m = &mbox_mock;
+
+    switch (addr)
+    {
+    case MAILBOX_STATUS:
+        return (m->out_n == MBOX_MOCK_FIFO ? MAILBOX_FULL : 0)
+            | (m->in_n ? 0 : MAILBOX_EMPTY);
+    case MAILBOX_READ:
+    {
+        // reading an empty FIFO would block on the hardware.
+        assert(m->in_n);
+        uint32_t data = m->in[m->in_head];
+        m->in_head = (m->in_head + 1) % 64;
+        m->in_n--;
+        m->nreads++;
+        return data;
+    }
+    default:
+        return 0;
+    }
+}
+
+static void mock_put32(uint32_t addr, uint32_t v)
+{
+    mbox_mock_t *m = &mbox_mock;
+
+    if (addr != MAILBOX_WRITE)
+        return;
+    m->nwrites++;
+    if (m->out_n == MBOX_MOCK_FIFO)
+    {
+        m->overflow++;
+        return;
+    }
+    m->out[m->out_n++] = v;
+    if (m->auto_reply)
+        mbox_mock_reply(m->out_n);
+}
+
+static const mbox_backend_t mock_backend = {
+    .get32 = mock_get32,
+    .put32 = mock_put32,
+};
+
+void mbox_mock_init(void)
+{
+    memset(&mbox_mock, 0, sizeof mbox_mock);
+    mbox_mock.auto_reply = 1;
+    mbox_set_backend(&mock_backend);
+}
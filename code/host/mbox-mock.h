@@ -0,0 +1,44 @@
+#ifndef __MBOX_MOCK_H__
+#define __MBOX_MOCK_H__
+/*
+ * Host mock of the ARM<->VC mailbox, backed by plain memory.
+ *
+ * Writes from the ARM land in an MBOX_MOCK_FIFO-deep outbound FIFO (the
+ * status FULL bit is set while it is full).  Property-channel writes are
+ * answered by the fake firmware (host_fw_property) --- immediately if
+ * auto_reply is set, otherwise when the test calls mbox_mock_reply().
+ * Replies, and anything the test posts with mbox_mock_push(), go into the
+ * inbound FIFO the ARM reads, in order, whatever their channel.
+ *
+ * Message buffers live at 64-bit host addresses, so mbox_bus_addr() hands
+ * out small fake bus addresses and the mock maps them back.
+ */
+#include <stdint.h>
+#include "mailbox.h"
+
+#define MBOX_MOCK_FIFO 8
+
+typedef struct mbox_mock
+{
+    uint32_t in[64];            // VC -> ARM, read through MAILBOX_READ
+    unsigned in_head, in_n;
+    uint32_t out[MBOX_MOCK_FIFO];   // ARM -> VC, not yet answered
+    unsigned out_n;
+
+    unsigned auto_reply;
+    unsigned nwrites, nreads;
+    unsigned overflow;          // writes while FULL was set
+} mbox_mock_t;
+
+extern mbox_mock_t mbox_mock;
+
+// reset the mock (auto_reply on) and install it as the mailbox backend.
+void mbox_mock_init(void);
+
+// the VC posts 'data' on 'channel'.
+void mbox_mock_push(uint8_t channel, uint32_t data);
+
+// answer up to 'n' outstanding writes, oldest first; returns how many.
+unsigned mbox_mock_reply(unsigned n);
+
+#endif
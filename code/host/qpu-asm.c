@@ -0,0 +1,616 @@
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include "rpi.h"
+#include "qpu-isa.h"
+#include "qpu-asm.h"
+
+typedef struct as
+{
+    uint32_t *code;
+    int n, max;
+    int line;
+    char *err;
+    size_t max_err;
+    struct
+    {
+        char name[32];
+        int at;
+    } label[QPU_ASM_MAX_LABELS];
+    int nlabels;
+    // branches waiting for their label.
+    struct
+    {
+        char name[32];
+        int at, line;
+    } fix[QPU_ASM_MAX_LABELS];
+    int nfix;
+} as_t;
+
+// an operand: where it is read from or written to.
+enum { OPD_ACC, OPD_A, OPD_B, OPD_EITHER, OPD_IMM, OPD_NONE };
+
+typedef struct opd
+{
+    int kind;
+    uint32_t num;       // accumulator, register or special address; the constant
+    int is_float;       // the constant was written as a float
+} opd_t;
+
+static int fail(as_t *a, const char *fmt, ...)
+{
+    va_list ap;
+    int k = snprintf(a->err, a->max_err, "line %d: ", a->line);
+
+    va_start(ap, fmt);
+    if (k >= 0 && (size_t)k < a->max_err)
+        vsnprintf(a->err + k, a->max_err - k, fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+static const char *skip(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static const char *trim(const char *p, const char *end)
+{
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+    return end;
+}
+
+static int is(const char *p, const char *end, const char *word)
+{
+    size_t n = strlen(word);
+    return (size_t)(end - p) == n && !memcmp(p, word, n);
+}
+
+static int lookup(const char *const *tab, int ntab, const char *p, const char *end)
+{
+    for (int i = 0; i < ntab; i++)
+        if (tab[i] && is(p, end, tab[i]))
+            return i;
+    return -1;
+}
+
+//
+// Constants: numbers and the vc4.qinc helpers.
+//
+
+static int expr(as_t *a, const char **pp, const char *end, opd_t *v);
+
+static int call(as_t *a, const char *name, int nargs, const uint32_t *x, uint32_t *v)
+{
+    static const struct
+    {
+        const char *name;
+        int nargs;
+    } funcs[] = {
+        { "vdr_setup_0", 4 }, { "vdr_setup_1", 1 }, { "vdr_h32", 3 }, { "vdw_setup_0", 3 },
+        { "vdw_setup_1", 1 }, { "dma_h32", 2 }, { "vpm_setup", 3 }, { "h32", 1 },
+    };
+    int f;
+
+    for (f = 0; f < 8; f++)
+        if (!strcmp(name, funcs[f].name))
+            break;
+    if (f == 8)
+        return fail(a, "unknown function '%s'", name);
+    if (nargs != funcs[f].nargs)
+        return fail(a, "%s takes %d arguments", name, funcs[f].nargs);
+    switch (f)
+    {
+    case 0: *v = 0x80000000 | x[0] << 24 | (x[1] & 0xf) << 20 | (x[2] & 0xf) << 16 | x[3]; break;
+    case 1: *v = 0x90000000 | x[0]; break;
+    case 2: *v = (x[0] & 0xf) << 12 | x[1] << 4 | x[2]; break;
+    case 3: *v = 0x80000000 | (x[0] & 0x7f) << 23 | (x[1] & 0x7f) << 16 | (x[2] & 0xffff); break;
+    case 4: *v = 0xc0000000 | x[0]; break;
+    case 5: *v = 0x4000 | x[0] << 7 | x[1] << 3; break;
+    case 6: *v = (x[0] & 0xf) << 20 | (x[1] & 0x3f) << 12 | x[2]; break;
+    default: *v = 0xa00 | x[0]; break;
+    }
+    return 0;
+}
+
+// a number, -expr, or name(expr, ...).
+static int expr(as_t *a, const char **pp, const char *end, opd_t *v)
+{
+    const char *p = skip(*pp, end);
+    char buf[64];
+
+    *v = (opd_t){ .kind = OPD_IMM };
+    if (p < end && *p == '-')
+    {
+        *pp = p + 1;
+        if (expr(a, pp, end, v) < 0)
+            return -1;
+        if (v->is_float)
+            v->num ^= 0x80000000;
+        else
+            v->num = -v->num;
+        return 0;
+    }
+    const char *q = p;
+    while (q < end && (isalnum((unsigned char)*q) || *q == '_' || *q == '.'))
+        q++;
+    if (q == p || q - p >= (int)sizeof buf)
+        return fail(a, "bad constant '%.*s'", (int)(end - p), p);
+    memcpy(buf, p, q - p);
+    buf[q - p] = 0;
+
+    if (isdigit((unsigned char)buf[0]))
+    {
+        char *e;
+        if (strchr(buf, '.') && strncmp(buf, "0x", 2))
+        {
+            float f = strtof(buf, &e);
+            memcpy(&v->num, &f, 4);
+            v->is_float = 1;
+        }
+        else
+            v->num = strtoul(buf, &e, 0);
+        if (*e)
+            return fail(a, "bad number '%s'", buf);
+        *pp = q;
+        return 0;
+    }
+
+    // a helper call.
+    uint32_t x[4];
+    int n = 0;
+    q = skip(q, end);
+    if (q >= end || *q != '(')
+        return fail(a, "unknown operand '%s'", buf);
+    q = skip(q + 1, end);
+    while (q < end && *q != ')')
+    {
+        opd_t arg;
+        if (n == 4 || expr(a, &q, end, &arg) < 0)
+            return n == 4 ? fail(a, "too many arguments to %s", buf) : -1;
+        x[n++] = arg.num;
+        q = skip(q, end);
+        if (q < end && *q == ',')
+            q = skip(q + 1, end);
+    }
+    if (q >= end)
+        return fail(a, "missing ')'");
+    *pp = q + 1;
+    return call(a, buf, n, x, &v->num);
+}
+
+//
+// Operands.
+//
+
+static int reg_num(const char *p, const char *end, const char *prefix, int max)
+{
+    size_t n = strlen(prefix);
+    if ((size_t)(end - p) <= n || memcmp(p, prefix, n))
+        return -1;
+    int r = 0;
+    for (p += n; p < end; p++)
+    {
+        if (!isdigit((unsigned char)*p))
+            return -1;
+        r = 10 * r + *p - '0';
+    }
+    return r < max ? r : -1;
+}
+
+static const struct
+{
+    const char *name;
+    int kind;
+    uint32_t addr;
+} reads[] = {
+    { "unif", OPD_EITHER, QPU_R_UNIF }, { "vary", OPD_EITHER, QPU_R_VARY },
+    { "elem_num", OPD_A, QPU_R_ELEM_QPU }, { "qpu_num", OPD_B, QPU_R_ELEM_QPU },
+    { "vpm", OPD_EITHER, QPU_R_VPM }, { "vr_busy", OPD_A, QPU_R_VPM_BUSY },
+    { "vw_busy", OPD_B, QPU_R_VPM_BUSY }, { "vr_wait", OPD_A, QPU_R_VPM_WAIT },
+    { "vw_wait", OPD_B, QPU_R_VPM_WAIT }, { "mutex", OPD_EITHER, QPU_R_MUTEX },
+    { "mutex_acquire", OPD_EITHER, QPU_R_MUTEX },
+}, writes[] = {
+    { "vpm", OPD_EITHER, QPU_W_VPM }, { "vr_setup", OPD_A, QPU_W_VPM_SETUP },
+    { "vw_setup", OPD_B, QPU_W_VPM_SETUP }, { "vr_addr", OPD_A, QPU_W_VPM_ADDR },
+    { "vw_addr", OPD_B, QPU_W_VPM_ADDR }, { "mutex", OPD_EITHER, QPU_W_MUTEX },
+    { "mutex_release", OPD_EITHER, QPU_W_MUTEX }, { "interrupt", OPD_EITHER, QPU_W_HOST_INT },
+    { "host_int", OPD_EITHER, QPU_W_HOST_INT }, { "unif_addr", OPD_EITHER, QPU_W_UNIF_ADDR },
+    { "sfu_recip", OPD_EITHER, QPU_W_SFU_RECIP }, { "sfu_recipsqrt", OPD_EITHER, QPU_W_SFU_RECIPSQRT },
+    { "sfu_exp", OPD_EITHER, QPU_W_SFU_EXP }, { "sfu_log", OPD_EITHER, QPU_W_SFU_LOG },
+    { "tmu0_s", OPD_EITHER, QPU_W_TMU0_S }, { "tmu1_s", OPD_EITHER, QPU_W_TMU1_S },
+};
+
+static int operand(as_t *a, const char *p, const char *end, int dst, opd_t *o)
+{
+    p = skip(p, end);
+    end = trim(p, end);
+    int r;
+
+    if (p == end)
+        return fail(a, "missing operand");
+    if (is(p, end, "-"))
+    {
+        if (!dst)
+            return fail(a, "'-' is not a source");
+        *o = (opd_t){ .kind = OPD_NONE, .num = QPU_W_NOP };
+        return 0;
+    }
+    if ((r = reg_num(p, end, "ra", QPU_NUM_REGS)) >= 0)
+    {
+        *o = (opd_t){ .kind = OPD_A, .num = r };
+        return 0;
+    }
+    if ((r = reg_num(p, end, "rb", QPU_NUM_REGS)) >= 0)
+    {
+        *o = (opd_t){ .kind = OPD_B, .num = r };
+        return 0;
+    }
+    if ((r = reg_num(p, end, "r", 6)) >= 0)
+    {
+        // r4 is only read, r5 only through its own write addresses.
+        if (dst && r > 3)
+            return fail(a, "cannot write r%d", r);
+        *o = (opd_t){ .kind = OPD_ACC, .num = dst ? QPU_W_R0 + r : r };
+        return 0;
+    }
+    for (unsigned i = 0; i < (dst ? sizeof writes / sizeof writes[0] : sizeof reads / sizeof reads[0]); i++)
+        if (is(p, end, dst ? writes[i].name : reads[i].name))
+        {
+            *o = (opd_t){ .kind = dst ? writes[i].kind : reads[i].kind, .num = dst ? writes[i].addr : reads[i].addr };
+            return 0;
+        }
+    if (dst)
+        return fail(a, "cannot write '%.*s'", (int)(end - p), p);
+    if (expr(a, &p, end, o) < 0)
+        return -1;
+    if (skip(p, end) != end)
+        return fail(a, "junk after constant");
+    return 0;
+}
+
+// the small immediate for constant 'v', or -1.
+static int small_imm(const opd_t *v)
+{
+    if (v->is_float)
+    {
+        float f;
+        memcpy(&f, &v->num, 4);
+        for (int i = 0; i < 16; i++)
+            if (f == ldexpf(1, i < 8 ? i : i - 16))
+                return 32 + i;
+        return -1;
+    }
+    int32_t x = v->num;
+    return x >= -16 && x <= 15 ? x & 31 : -1;
+}
+
+static int put(as_t *a, uint32_t lo, uint32_t hi)
+{
+    if (a->n == a->max)
+        return fail(a, "out of code space");
+    a->code[2 * a->n] = lo;
+    a->code[2 * a->n + 1] = hi;
+    a->n++;
+    return 0;
+}
+
+// write address and ws bit for 'd' written by the add (mul == 0) or mul pipe.
+static void dest(const opd_t *d, int mul, uint32_t *waddr, uint32_t *ws)
+{
+    *waddr = d->num;
+    // ws=0: the add pipe writes file A, the mul pipe file B.
+    *ws = d->kind == OPD_A ? mul : d->kind == OPD_B ? !mul : 0;
+}
+
+// the read ports for 'x' and 'y': fixed files first, then either.
+static int ports(as_t *a, opd_t *src[2], uint32_t mux[2], uint32_t *raddr_a, uint32_t *raddr_b, uint32_t *sig)
+{
+    *raddr_a = *raddr_b = QPU_R_NOP;
+    *sig = QPU_SIG_NONE;
+    for (int pass = 0; pass < 2; pass++)
+        for (int i = 0; i < 2; i++)
+        {
+            opd_t *o = src[i];
+            if ((o->kind == OPD_EITHER) != pass)
+                continue;
+            switch (o->kind)
+            {
+            case OPD_ACC:
+                mux[i] = o->num;
+                break;
+            case OPD_A:
+            case OPD_EITHER:
+                if (*raddr_a == QPU_R_NOP || *raddr_a == o->num)
+                {
+                    *raddr_a = o->num;
+                    mux[i] = QPU_MUX_A;
+                    break;
+                }
+                if (o->kind == OPD_A)
+                    return fail(a, "two reads from register file A");
+                // fall through: either file
+            case OPD_B:
+                if (*sig == QPU_SIG_SMALL_IMM)
+                    return fail(a, "a register file B read next to a small immediate");
+                if (*raddr_b != QPU_R_NOP && *raddr_b != o->num)
+                    return fail(a, "two reads from register file B");
+                *raddr_b = o->num;
+                mux[i] = QPU_MUX_B;
+                break;
+            case OPD_IMM:
+            {
+                int imm = small_imm(o);
+                if (imm < 0)
+                    return fail(a, "constant %#x does not fit a small immediate", o->num);
+                if (*raddr_b != QPU_R_NOP && (*sig != QPU_SIG_SMALL_IMM || *raddr_b != (uint32_t)imm))
+                    return fail(a, "a register file B read next to a small immediate");
+                *raddr_b = imm;
+                *sig = QPU_SIG_SMALL_IMM;
+                mux[i] = QPU_MUX_B;
+                break;
+            }
+            }
+        }
+    return 0;
+}
+
+static const char *const add_ops[32] = {
+    [QPU_A_FADD] = "fadd", [QPU_A_FSUB] = "fsub", [QPU_A_FMIN] = "fmin", [QPU_A_FMAX] = "fmax",
+    [QPU_A_FMINABS] = "fminabs", [QPU_A_FMAXABS] = "fmaxabs", [QPU_A_FTOI] = "ftoi",
+    [QPU_A_ITOF] = "itof", [QPU_A_ADD] = "add", [QPU_A_SUB] = "sub", [QPU_A_SHR] = "shr",
+    [QPU_A_ASR] = "asr", [QPU_A_ROR] = "ror", [QPU_A_SHL] = "shl", [QPU_A_MIN] = "min",
+    [QPU_A_MAX] = "max", [QPU_A_AND] = "and", [QPU_A_OR] = "or", [QPU_A_XOR] = "xor",
+    [QPU_A_NOT] = "not", [QPU_A_CLZ] = "clz", [QPU_A_V8ADDS] = "v8adds", [QPU_A_V8SUBS] = "v8subs",
+};
+
+static const char *const mul_ops[8] = {
+    [QPU_M_FMUL] = "fmul", [QPU_M_MUL24] = "mul24", [QPU_M_V8MULD] = "v8muld",
+    [QPU_M_V8MIN] = "v8min", [QPU_M_V8MAX] = "v8max",
+};
+
+static const char *const conds[8] = {
+    [QPU_COND_NEVER] = "never", [QPU_COND_ALWAYS] = "always",
+    [QPU_COND_ZS] = "ifz", [QPU_COND_ZC] = "ifnz", [QPU_COND_NS] = "ifn",
+    [QPU_COND_NC] = "ifnn", [QPU_COND_CS] = "ifc", [QPU_COND_CC] = "ifnc",
+};
+
+static const char *const br_conds[16] = {
+    "allz", "allnz", "anyz", "anynz", "alln", "allnn", "anyn", "anynn",
+    "allc", "allnc", "anyc", "anync",
+};
+
+// split "a, f(b, c), d" at the top-level commas.
+static int split(const char *p, const char *end, const char *arg[], const char *arg_end[], int max)
+{
+    int n = 0, depth = 0;
+
+    arg[0] = p;
+    for (; p < end; p++)
+        if (*p == '(')
+            depth++;
+        else if (*p == ')')
+            depth--;
+        else if (*p == ',' && !depth)
+        {
+            if (n + 1 == max)
+                return -1;
+            arg_end[n++] = p;
+            arg[n] = p + 1;
+        }
+    arg_end[n++] = end;
+    return n;
+}
+
+static int branch(as_t *a, int cond, const char *p, const char *end)
+{
+    const char *arg[2], *arg_end[2];
+    opd_t d;
+    uint32_t waddr, ws;
+
+    if (split(p, end, arg, arg_end, 2) != 2)
+        return fail(a, "brr takes a destination and a label");
+    if (operand(a, arg[0], arg_end[0], 1, &d) < 0)
+        return -1;
+    const char *l = skip(arg[1], arg_end[1]), *l_end = trim(l, arg_end[1]);
+    if (l >= l_end || *l != ':' || l_end - l - 1 >= 32)
+        return fail(a, "brr needs a :label");
+    if (a->nfix == QPU_ASM_MAX_LABELS)
+        return fail(a, "too many branches");
+    memcpy(a->fix[a->nfix].name, l + 1, l_end - l - 1);
+    a->fix[a->nfix].name[l_end - l - 1] = 0;
+    a->fix[a->nfix].at = a->n;
+    a->fix[a->nfix++].line = a->line;
+
+    dest(&d, 0, &waddr, &ws);
+    return put(a, 0, QPU_SIG_BRANCH << 28 | cond << 20 | 1 << 19 | ws << 12 | waddr << 6 | QPU_W_NOP);
+}
+
+static int instruction(as_t *a, const char *p, const char *end)
+{
+    const char *m = p, *m_end = p;
+    while (m_end < end && *m_end != ' ' && *m_end != '\t')
+        m_end++;
+    const char *dot = memchr(m, '.', m_end - m);
+    const char *base_end = dot ? dot : m_end;
+    int cond = -1, setf = 0, br = QPU_BR_ALWAYS;
+
+    // modifiers
+    for (const char *q = dot; q && q < m_end;)
+    {
+        const char *e = memchr(q + 1, '.', m_end - q - 1);
+        if (!e)
+            e = m_end;
+        int c;
+        if (is(q + 1, e, "setf"))
+            setf = 1;
+        else if ((c = lookup(conds, 8, q + 1, e)) >= 0)
+            cond = c;
+        else if (is(m, base_end, "brr") && (c = lookup(br_conds, 16, q + 1, e)) >= 0)
+            br = c;
+        else
+            return fail(a, "unknown modifier '%.*s'", (int)(e - q), q);
+        q = e;
+    }
+
+    if (is(m, base_end, "nop") || is(m, base_end, "thrend"))
+    {
+        if (skip(m_end, end) != end || dot)
+            return fail(a, "%.*s takes nothing", (int)(base_end - m), m);
+        uint32_t sig = is(m, base_end, "nop") ? QPU_SIG_NONE : QPU_SIG_PROG_END;
+        return put(a, QPU_R_NOP << 18 | QPU_R_NOP << 12, sig << 28 | QPU_W_NOP << 6 | QPU_W_NOP);
+    }
+    if (is(m, base_end, "brr"))
+    {
+        if (setf || cond >= 0)
+            return fail(a, "brr takes a branch condition");
+        return branch(a, br, m_end, end);
+    }
+
+    int op, mul = 0, ldi = is(m, base_end, "ldi"), mov = ldi || is(m, base_end, "mov");
+    if (mov)
+        op = QPU_A_OR;
+    else if ((op = lookup(add_ops, 32, m, base_end)) < 0)
+    {
+        if ((op = lookup(mul_ops, 8, m, base_end)) < 0)
+            return fail(a, "unknown instruction '%.*s'", (int)(base_end - m), m);
+        mul = 1;
+    }
+    int unary = mov || op == QPU_A_FTOI || op == QPU_A_ITOF || op == QPU_A_NOT || op == QPU_A_CLZ;
+
+    const char *arg[3], *arg_end[3];
+    int n = split(m_end, end, arg, arg_end, 3);
+    opd_t d, x, y;
+    if (n != (unary ? 2 : 3))
+        return fail(a, "%.*s takes %d operands", (int)(base_end - m), m, unary ? 2 : 3);
+    if (operand(a, arg[0], arg_end[0], 1, &d) < 0 || operand(a, arg[1], arg_end[1], 0, &x) < 0)
+        return -1;
+    if (unary)
+        y = x;
+    else if (operand(a, arg[2], arg_end[2], 0, &y) < 0)
+        return -1;
+
+    // a write nobody sees is not made, unless for the flags.
+    if (cond < 0)
+        cond = d.kind == OPD_NONE && !setf ? QPU_COND_NEVER : QPU_COND_ALWAYS;
+    uint32_t waddr, ws;
+    dest(&d, mul, &waddr, &ws);
+
+    // mov of a constant: a load immediate.
+    if (ldi && x.kind != OPD_IMM)
+        return fail(a, "ldi takes a constant");
+    if (mov && x.kind == OPD_IMM)
+        return put(a, x.num, QPU_SIG_LOAD_IMM << 28 | cond << 17 | setf << 13 | ws << 12 | waddr << 6 | QPU_W_NOP);
+
+    // add/sub of a constant that only fits negated.
+    if ((op == QPU_A_ADD || op == QPU_A_SUB) && !mul && y.kind == OPD_IMM && small_imm(&y) < 0)
+    {
+        opd_t neg = y;
+        neg.num = -neg.num;
+        if (small_imm(&neg) >= 0)
+        {
+            y = neg;
+            op = op == QPU_A_ADD ? QPU_A_SUB : QPU_A_ADD;
+        }
+    }
+
+    opd_t *src[2] = { &x, &y };
+    uint32_t mux[2], raddr_a, raddr_b, sig;
+    if (ports(a, src, mux, &raddr_a, &raddr_b, &sig) < 0)
+        return -1;
+    uint32_t lo = raddr_a << 18 | raddr_b << 12, hi = sig << 28 | setf << 13 | ws << 12;
+    if (mul)
+    {
+        lo |= (uint32_t)op << 29 | mux[0] << 3 | mux[1];
+        hi |= cond << 14 | QPU_W_NOP << 6 | waddr;
+    }
+    else
+    {
+        lo |= (uint32_t)op << 24 | mux[0] << 9 | mux[1] << 6;
+        hi |= cond << 17 | waddr << 6 | QPU_W_NOP;
+    }
+    return put(a, lo, hi);
+}
+
+static int signal(as_t *a, const char *p, const char *end)
+{
+    uint32_t *hi = &a->code[2 * a->n - 1];
+
+    if (!is(p, end, "thrend"))
+        return fail(a, "unknown signal '%.*s'", (int)(end - p), p);
+    if (*hi >> 28 != QPU_SIG_NONE)
+        return fail(a, "the instruction already has a signal");
+    *hi = (*hi & 0x0fffffff) | QPU_SIG_PROG_END << 28;
+    return 0;
+}
+
+static int label(as_t *a, const char *p, const char *end)
+{
+    if (end - p >= 32 || end == p)
+        return fail(a, "bad label");
+    for (int i = 0; i < a->nlabels; i++)
+        if (is(p, end, a->label[i].name))
+            return fail(a, "label '%.*s' defined twice", (int)(end - p), p);
+    if (a->nlabels == QPU_ASM_MAX_LABELS)
+        return fail(a, "too many labels");
+    memcpy(a->label[a->nlabels].name, p, end - p);
+    a->label[a->nlabels].name[end - p] = 0;
+    a->label[a->nlabels++].at = a->n;
+    return 0;
+}
+
+int qpu_asm(const char *src, uint32_t *code, int max, char *err, size_t max_err)
+{
+    as_t a = { .code = code, .max = max, .err = err, .max_err = max_err };
+
+    err[0] = 0;
+    for (const char *l = src; *l;)
+    {
+        const char *nl = strchr(l, '\n'), *end = nl ? nl : l + strlen(l);
+        const char *hash = memchr(l, '#', end - l);
+        const char *p = skip(l, end), *e = trim(p, hash ? hash : end);
+
+        a.line++;
+        if (p < e && *p == ':')
+        {
+            const char *q = p + 1;
+            while (q < e && *q != ' ' && *q != '\t')
+                q++;
+            if (label(&a, p + 1, q) < 0)
+                return -1;
+            p = skip(q, e);
+        }
+        if (p < e && *p == '.')
+        {
+            if (e - p < 8 || memcmp(p, ".include", 8))
+                return fail(&a, "unsupported directive '%.*s'", (int)(e - p), p);
+        }
+        else if (p < e)
+        {
+            // "op; thrend": the signal rides on the op.
+            const char *semi = memchr(p, ';', e - p);
+            if (instruction(&a, p, semi ? trim(p, semi) : e) < 0)
+                return -1;
+            if (semi && signal(&a, skip(semi + 1, e), e) < 0)
+                return -1;
+        }
+        l = nl ? nl + 1 : end;
+    }
+
+    for (int i = 0; i < a.nfix; i++)
+    {
+        int j;
+        for (j = 0; j < a.nlabels; j++)
+            if (!strcmp(a.fix[i].name, a.label[j].name))
+                break;
+        a.line = a.fix[i].line;
+        if (j == a.nlabels)
+            return fail(&a, "no label '%s'", a.fix[i].name);
+        // relative to the instruction after the delay slots.
+        code[2 * a.fix[i].at] = 8 * (a.label[j].at - (a.fix[i].at + 1 + QPU_BRANCH_DELAY));
+    }
+    return a.n;
+}
@@ -0,0 +1,36 @@
+#ifndef __QPU_ASM_H__
+#define __QPU_ASM_H__
+/*
+ * Assembler for the part of vc4asm's syntax the kernels here use, so the
+ * host can run .qasm sources (mandelbrot-ra.qasm from the register
+ * allocator, say) without vc4asm.  It encodes as vc4asm does, bit for bit
+ * on the checked-in *shader.c arrays:
+ *
+ *   - one ALU op a line, add or mul pipe by mnemonic, with .setf and a
+ *     condition (.ifz, .ifn, ...);
+ *   - mov of a constant is a load immediate; other constants are small
+ *     immediates, and add/sub of one that does not fit becomes sub/add
+ *     of its negation if that does;
+ *   - brr with a branch condition to a :label, nop, thrend;
+ *   - constants are numbers or the vc4.qinc helpers (vpm_setup, h32,
+ *     vdw_setup_0, dma_h32, vdr_setup_0/1, vdr_h32, vdw_setup_1), which
+ *     are built in: .include lines are skipped.
+ *
+ * It refuses what vc4asm would, as far as that goes: two registers read
+ * from one file, a file B read next to a small immediate, and operands or
+ * directives it does not know.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define QPU_ASM_MAX_LABELS 64
+
+/*
+ * Assemble the NUL-terminated 'src' into 'code' (two words an
+ * instruction, low first), which has room for 'max' instructions.
+ * Returns the number of instructions, or -1 with a message ("line N:
+ * ...") in 'err'.
+ */
+int qpu_asm(const char *src, uint32_t *code, int max, char *err, size_t max_err);
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdarg.h>
+#include "rpi.h"
+#include "qpu-isa.h"
+#include "qpu-emu.h"
+#include "qpu-disasm.h"
+
+typedef struct out
+{
+    char *p;
+    size_t n, len;
+} out_t;
+
+static void put(out_t *o, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    int k = vsnprintf(o->p + (o->len < o->n ? o->len : o->n),
+        o->len < o->n ? o->n - o->len : 0, fmt, ap);
+    va_end(ap);
+    if (k > 0)
+        o->len += k;
+}
+
+static const char *const add_ops[32] = {
+    [QPU_A_NOP] = "nop", [QPU_A_FADD] = "fadd", [QPU_A_FSUB] = "fsub",
+    [QPU_A_FMIN] = "fmin", [QPU_A_FMAX] = "fmax", [QPU_A_FMINABS] = "fminabs",
+    [QPU_A_FMAXABS] = "fmaxabs", [QPU_A_FTOI] = "ftoi", [QPU_A_ITOF] = "itof",
+    [QPU_A_ADD] = "add", [QPU_A_SUB] = "sub", [QPU_A_SHR] = "shr", [QPU_A_ASR] = "asr",
+    [QPU_A_ROR] = "ror", [QPU_A_SHL] = "shl", [QPU_A_MIN] = "min", [QPU_A_MAX] = "max",
+    [QPU_A_AND] = "and", [QPU_A_OR] = "or", [QPU_A_XOR] = "xor", [QPU_A_NOT] = "not",
+    [QPU_A_CLZ] = "clz", [QPU_A_V8ADDS] = "v8adds", [QPU_A_V8SUBS] = "v8subs",
+};
+
+static const char *const mul_ops[8] = {
+    "nop", "fmul", "mul24", "v8muld", "v8min", "v8max", "v8adds", "v8subs",
+};
+
+static const char *const conds[8] = {
+    ".never", "", ".ifz", ".ifnz", ".ifn", ".ifnn", ".ifc", ".ifnc",
+};
+
+static const char *const br_conds[16] = {
+    ".allz", ".allnz", ".anyz", ".anynz", ".alln", ".allnn", ".anyn", ".anynn",
+    ".allc", ".allnc", ".anyc", ".anync", ".cond12", ".cond13", ".cond14", "",
+};
+
+static const char *const sigs[16] = {
+    [QPU_SIG_BREAK] = "bkpt", [QPU_SIG_THREAD_SWITCH] = "thrsw",
+    [QPU_SIG_PROG_END] = "thrend", [QPU_SIG_WAIT_SCORE] = "sbwait",
+    [QPU_SIG_UNLOCK_SCORE] = "sbdone", [QPU_SIG_LAST_THREAD_SWITCH] = "lthrsw",
+    [QPU_SIG_COVERAGE_LOAD] = "loadcv", [QPU_SIG_COLOR_LOAD] = "loadc",
+    [QPU_SIG_COLOR_LOAD_END] = "ldcend", [QPU_SIG_LOAD_TMU0] = "ldtmu0",
+    [QPU_SIG_LOAD_TMU1] = "ldtmu1", [QPU_SIG_ALPHA_LOAD] = "loadam",
+};
+
+static int unary(uint32_t op)
+{
+    return op == QPU_A_FTOI || op == QPU_A_ITOF || op == QPU_A_NOT || op == QPU_A_CLZ;
+}
+
+static void reg_read(out_t *o, int file_b, uint32_t raddr)
+{
+    if (raddr < QPU_NUM_REGS)
+        put(o, "r%c%u", file_b ? 'b' : 'a', raddr);
+    else if (raddr == QPU_R_UNIF)
+        put(o, "unif");
+    else if (raddr == QPU_R_VARY)
+        put(o, "vary");
+    else if (raddr == QPU_R_ELEM_QPU)
+        put(o, file_b ? "qpu_num" : "elem_num");
+    else if (raddr == QPU_R_NOP)
+        put(o, "-");
+    else if (raddr == QPU_R_XY)
+        put(o, file_b ? "y_coord" : "x_coord");
+    else if (raddr == QPU_R_MS_FLAGS)
+        put(o, file_b ? "rev_flag" : "ms_mask");
+    else if (raddr == QPU_R_VPM)
+        put(o, "vpm");
+    else if (raddr == QPU_R_VPM_BUSY)
+        put(o, file_b ? "vw_busy" : "vr_busy");
+    else if (raddr == QPU_R_VPM_WAIT)
+        put(o, file_b ? "vw_wait" : "vr_wait");
+    else if (raddr == QPU_R_MUTEX)
+        put(o, "mutex");
+    else
+        put(o, "r%c?%u", file_b ? 'b' : 'a', raddr);
+}
+
+static void small_imm(out_t *o, uint32_t v)
+{
+    if (v < 32)
+        put(o, "%d", (int32_t)qpu_small_imm(v));
+    else if (v < 48)
+    {
+        uint32_t bits = qpu_small_imm(v);
+        float f;
+        memcpy(&f, &bits, 4);
+        put(o, "%g", f);
+    }
+    else
+        put(o, "0");    // a rotation: the operand is r5 or an accumulator
+}
+
+static void reg_write(out_t *o, int file_b, uint32_t waddr)
+{
+    static const char *const io[32] = {
+        [QPU_W_R0 - 32] = "r0", [QPU_W_R1 - 32] = "r1", [QPU_W_R2 - 32] = "r2",
+        [QPU_W_R3 - 32] = "r3", [QPU_W_TMU_NOSWAP - 32] = "tmu_noswap",
+        [QPU_W_R5 - 32] = "r5", [QPU_W_HOST_INT - 32] = "host_int",
+        [QPU_W_NOP - 32] = "-", [QPU_W_VPM - 32] = "vpm",
+        [QPU_W_MUTEX - 32] = "mutex_release", [QPU_W_SFU_RECIP - 32] = "sfu_recip",
+        [QPU_W_SFU_RECIPSQRT - 32] = "sfu_recipsqrt", [QPU_W_SFU_EXP - 32] = "sfu_exp",
+        [QPU_W_SFU_LOG - 32] = "sfu_log", [QPU_W_TMU0_S - 32] = "tmu0_s",
+        [QPU_W_TMU0_T - 32] = "tmu0_t", [QPU_W_TMU0_R - 32] = "tmu0_r",
+        [QPU_W_TMU0_B - 32] = "tmu0_b", [QPU_W_TMU1_S - 32] = "tmu1_s",
+        [QPU_W_TMU1_T - 32] = "tmu1_t", [QPU_W_TMU1_R - 32] = "tmu1_r",
+        [QPU_W_TMU1_B - 32] = "tmu1_b",
+    };
+
+    if (waddr < QPU_NUM_REGS)
+        put(o, "r%c%u", file_b ? 'b' : 'a', waddr);
+    else if (waddr == QPU_W_UNIF_ADDR)
+        put(o, file_b ? "unif_addr_rel" : "unif_addr");
+    else if (waddr == QPU_W_VPM_SETUP)
+        put(o, file_b ? "vw_setup" : "vr_setup");
+    else if (waddr == QPU_W_VPM_ADDR)
+        put(o, file_b ? "vw_addr" : "vr_addr");
+    else if (io[waddr - 32])
+        put(o, "%s", io[waddr - 32]);
+    else
+        put(o, "w%c?%u", file_b ? 'b' : 'a', waddr);
+}
+
+static void mux(out_t *o, uint64_t ins, uint32_t m)
+{
+    if (m <= QPU_MUX_R5)
+        put(o, "r%u", m);
+    else if (m == QPU_MUX_A)
+        reg_read(o, 0, QPU_RADDR_A(ins));
+    else if (QPU_SIG(ins) == QPU_SIG_SMALL_IMM)
+        small_imm(o, QPU_RADDR_B(ins));
+    else
+        reg_read(o, 1, QPU_RADDR_B(ins));
+}
+
+// one pipe's operation; 'sf' if it sets the flags.
+static void alu(out_t *o, uint64_t ins, int is_mul, int sf)
+{
+    uint32_t op = is_mul ? QPU_OP_MUL(ins) : QPU_OP_ADD(ins);
+    uint32_t a = is_mul ? QPU_MUL_A(ins) : QPU_ADD_A(ins), b = is_mul ? QPU_MUL_B(ins) : QPU_ADD_B(ins);
+    uint32_t cond = is_mul ? QPU_COND_MUL(ins) : QPU_COND_ADD(ins);
+    int mov = a == b && (is_mul ? op == QPU_M_V8MIN : op == QPU_A_OR);
+
+    uint32_t waddr = is_mul ? QPU_WADDR_MUL(ins) : QPU_WADDR_ADD(ins);
+
+    // vc4asm never writes a result with nowhere to go.
+    if (cond == QPU_COND_NEVER && waddr == QPU_W_NOP)
+        cond = QPU_COND_ALWAYS;
+    put(o, "%s%s%s", mov ? "mov" : is_mul ? mul_ops[op] : add_ops[op] ? add_ops[op] : "add?",
+        conds[cond], sf ? ".setf" : "");
+    // pack goes with the write it packs (the mul pipe's with pm), unpack with the reads.
+    if (QPU_PACK(ins) && QPU_PM(ins) == is_mul)
+        put(o, ".pack%u", QPU_PACK(ins));
+    if (QPU_UNPACK(ins) && (QPU_PM(ins) || (a == QPU_MUX_A || b == QPU_MUX_A)))
+        put(o, ".unpack%u", QPU_UNPACK(ins));
+    put(o, " ");
+    reg_write(o, QPU_WS(ins) ^ is_mul, waddr);
+    put(o, ", ");
+    mux(o, ins, a);
+    if (!mov && !(!is_mul && unary(op)))
+    {
+        put(o, ", ");
+        mux(o, ins, b);
+    }
+    if (is_mul && QPU_SIG(ins) == QPU_SIG_SMALL_IMM && QPU_RADDR_B(ins) >= 48)
+    {
+        if (QPU_RADDR_B(ins) == 48)
+            put(o, " >> r5");
+        else
+            put(o, " >> %u", QPU_RADDR_B(ins) - 48);
+    }
+}
+
+int qpu_disasm(uint64_t ins, uint32_t pc, char *buf, size_t n)
+{
+    out_t o = { buf, n, 0 };
+    uint32_t sig = QPU_SIG(ins);
+    int ws = QPU_WS(ins);
+
+    if (n)
+        buf[0] = 0;
+    if (sig == QPU_SIG_BRANCH)
+    {
+        int32_t imm = (int32_t)QPU_IMM(ins);
+        put(&o, "%s%s ", QPU_BR_REL(ins) ? "brr" : "bra", br_conds[QPU_BR_COND(ins)]);
+        reg_write(&o, ws, QPU_WADDR_ADD(ins));
+        if (QPU_WADDR_MUL(ins) != QPU_W_NOP)
+        {
+            put(&o, ", ");
+            reg_write(&o, !ws, QPU_WADDR_MUL(ins));
+        }
+        put(&o, ", ");
+        if (QPU_BR_REG(ins))
+        {
+            reg_read(&o, 0, QPU_BR_RADDR_A(ins));
+            put(&o, " + ");
+        }
+        if (QPU_BR_REL(ins) && !QPU_BR_REG(ins))
+            put(&o, "0x%x", pc + 8 * (QPU_BRANCH_DELAY + 1) + imm);
+        else
+            put(&o, "%s0x%x", QPU_BR_REL(ins) ? "pc + " : "", imm);
+        return o.len;
+    }
+    if (sig == QPU_SIG_LOAD_IMM)
+    {
+        uint32_t imm = QPU_IMM(ins), mode = QPU_LDI_MODE(ins);
+        if (mode == QPU_LDI_SEMA)
+        {
+            put(&o, "%s -, %u", QPU_SEMA_ACQUIRE(ins) ? "sacq" : "srel", QPU_SEMA_NUM(ins));
+            return o.len;
+        }
+        const char *kind = mode == QPU_LDI_EL_SIGNED ? ".pes" : mode == QPU_LDI_EL_UNSIGNED ? ".peu" : "";
+        int any = 0;
+        if (QPU_WADDR_ADD(ins) != QPU_W_NOP || QPU_WADDR_MUL(ins) == QPU_W_NOP)
+        {
+            put(&o, "ldi%s%s%s ", kind, conds[QPU_COND_ADD(ins)], QPU_SF(ins) ? ".setf" : "");
+            reg_write(&o, ws, QPU_WADDR_ADD(ins));
+            put(&o, ", 0x%x", imm);
+            any = 1;
+        }
+        if (QPU_WADDR_MUL(ins) != QPU_W_NOP)
+        {
+            put(&o, "%sldi%s%s ", any ? "; " : "", kind, conds[QPU_COND_MUL(ins)]);
+            reg_write(&o, !ws, QPU_WADDR_MUL(ins));
+            put(&o, ", 0x%x", imm);
+        }
+        return o.len;
+    }
+
+    int add = QPU_OP_ADD(ins) != QPU_A_NOP, mul = QPU_OP_MUL(ins) != QPU_M_NOP;
+    if (add)
+        alu(&o, ins, 0, QPU_SF(ins));
+    if (mul)
+    {
+        if (add)
+            put(&o, "; ");
+        alu(&o, ins, 1, QPU_SF(ins) && !add);
+    }
+    if (sigs[sig])
+        put(&o, "%s%s", add || mul ? "; " : "", sigs[sig]);
+    else if (!add && !mul)
+        put(&o, "nop");
+    return o.len;
+}
+
+void qpu_disasm_print(const uint32_t *code, uint32_t nbytes, uint32_t pc)
+{
+    char buf[160];
+
+    for (uint32_t i = 0; i + 8 <= nbytes; i += 8)
+    {
+        qpu_disasm(QPU_INS(code[i / 4], code[i / 4 + 1]), pc + i, buf, sizeof buf);
+        printk("  %4x  %08x %08x  %s\n", pc + i, code[i / 4 + 1], code[i / 4], buf);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef __QPU_DISASM_H__
+#define __QPU_DISASM_H__
+/*
+ * Disassembler for QPU instructions (the arrays vc4asm emits into the
+ * *shader.c files), in vc4asm syntax as far as it goes:
+ *
+ *   fadd.setf ra1, r0, rb2; fmul r3, r1, 2.0; thrend
+ *   mov.ifn rb7, 1
+ *   brr.anynz -, 0x1a8
+ *
+ * An add-pipe or with both operands the same is shown as mov, and a
+ * mul-pipe v8min as well.  Branch targets are absolute bus offsets, from
+ * 'pc' (the instruction's own); pack and unpack modes, which vc4asm
+ * spells per operand, are shown as .pack<n> and .unpack<n> after the op.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+// Write the text of 'ins', at 'pc', to buf[0..n); returns its length.
+int qpu_disasm(uint64_t ins, uint32_t pc, char *buf, size_t n);
+
+// Print 'code' (nbytes long, loaded at 'pc') one instruction a line.
+void qpu_disasm_print(const uint32_t *code, uint32_t nbytes, uint32_t pc);
+
+#endif
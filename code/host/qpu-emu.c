@@ -0,0 +1,939 @@
+#include <math.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sched.h>
+#include "rpi.h"
+#include "qpu-emu.h"
+#include "qpu-xlate.h"
+
+typedef union
+{
+    float f;
+    uint32_t u;
+} fbits_t;
+
+// the QPUs flush denormals to zero on the way in and out.
+static float f32(uint32_t u)
+{
+    fbits_t x = { .u = u };
+    if (!(x.u & 0x7f800000))
+        x.u &= 0x80000000;
+    return x.f;
+}
+
+static uint32_t u32(float f)
+{
+    fbits_t x = { .f = f };
+    if (!(x.u & 0x7f800000))
+        x.u &= 0x80000000;
+    return x.u;
+}
+
+// QPUs may fault on several threads at once; the first message wins.
+static pthread_mutex_t err_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int fault(qpu_emu_t *e, qpu_t *q, const char *fmt, ...)
+{
+    pthread_mutex_lock(&err_lock);
+    if (!e->err[0])
+    {
+        va_list ap;
+        int n = snprintf(e->err, sizeof e->err, "qpu %d pc %x: ", q->num, q->pc - 8);
+        va_start(ap, fmt);
+        vsnprintf(e->err + n, sizeof e->err - n, fmt, ap);
+        va_end(ap);
+    }
+    pthread_mutex_unlock(&err_lock);
+    q->state = QPU_EMU_FAULT;
+    return QPU_EMU_FAULT;
+}
+
+static uint32_t *word(qpu_emu_t *e, qpu_t *q, uint32_t bus)
+{
+    uint32_t *p = (bus & 3) ? NULL : e->mem(bus);
+    if (!p)
+        fault(e, q, "bad bus address %x", bus);
+    return p;
+}
+
+static void fill(uint32_t v[QPU_NUM_LANES], uint32_t x)
+{
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        v[i] = x;
+}
+
+void qpu_emu_init(qpu_emu_t *e, void *(*mem)(uint32_t bus))
+{
+    memset(e, 0, sizeof *e);
+    e->mem = mem;
+    e->max_instrs = 1 << 26;
+    e->quantum = QPU_EMU_QUANTUM;
+    for (int i = 0; i < QPU_EMU_NUM_QPUS; i++)
+        e->qpu[i].num = i;
+}
+
+void qpu_emu_start(qpu_emu_t *e, int num, uint32_t code, uint32_t unif)
+{
+    qpu_t *q = &e->qpu[num];
+
+    // real QPUs keep stale registers; zero them so runs are repeatable.
+    memset(q, 0, sizeof *q);
+    q->num = num;
+    q->code = code;
+    q->pc = code;
+    q->unif = unif;
+    q->state = QPU_EMU_RUNNING;
+}
+
+//
+// VPM and DMA.
+//
+
+static uint32_t *vpm_word(qpu_emu_t *e, qpu_t *q, unsigned row, unsigned col)
+{
+    if (row >= QPU_EMU_VPM_ROWS || col >= QPU_NUM_LANES)
+    {
+        fault(e, q, "VPM row %d column %d is out of range", row, col);
+        return NULL;
+    }
+    return &e->vpm[row][col];
+}
+
+// generic block setup: vr_setup (with a count) or vw_setup.
+static int vpm_setup(qpu_emu_t *e, qpu_t *q, qpu_vpm_stream_t *s, uint32_t v, int read)
+{
+    if (((v >> 8) & 3) != 2)
+        return fault(e, q, "only 32-bit VPM access is supported (setup %x)", v);
+    s->addr = v & 0xff;
+    s->stride = (v >> 12) & 0x3f;
+    if (!s->stride)
+        s->stride = 64;
+    s->horiz = (v >> 11) & 1;
+    if (read)
+    {
+        s->left = (v >> 20) & 0xf;
+        if (!s->left)
+            s->left = 16;
+    }
+    return 0;
+}
+
+// the VPM word lane 'i' of the current vector maps to.
+static uint32_t *vpm_lane(qpu_emu_t *e, qpu_t *q, qpu_vpm_stream_t *s, int i)
+{
+    if (s->horiz)
+        return vpm_word(e, q, s->addr, i);
+    // vertical: a column of a 16x16 block.
+    return vpm_word(e, q, (s->addr & 0xf0) + i, s->addr & 0xf);
+}
+
+static int vpm_read(qpu_emu_t *e, qpu_t *q, uint32_t out[QPU_NUM_LANES])
+{
+    qpu_vpm_stream_t *s = &q->vpr;
+
+    if (s->left <= 0)
+        return fault(e, q, "VPM read with no read set up");
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        uint32_t *w = vpm_lane(e, q, s, i);
+        if (!w)
+            return QPU_EMU_FAULT;
+        out[i] = *w;
+    }
+    s->addr += s->stride;
+    s->left--;
+    return 0;
+}
+
+static int vpm_write(qpu_emu_t *e, qpu_t *q, const uint32_t v[QPU_NUM_LANES], const uint8_t en[QPU_NUM_LANES])
+{
+    qpu_vpm_stream_t *s = &q->vpw;
+
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        uint32_t *w = vpm_lane(e, q, s, i);
+        if (!w)
+            return QPU_EMU_FAULT;
+        if (en[i])
+            *w = v[i];
+    }
+    s->addr += s->stride;
+    return 0;
+}
+
+// VDR: memory -> VPM, started by a vr_addr write.
+static int dma_load(qpu_emu_t *e, qpu_t *q, uint32_t addr)
+{
+    uint32_t s = q->vdr_setup;
+
+    if (!(s >> 31))
+        return fault(e, q, "DMA load with no setup");
+    if ((s >> 28) & 7)
+        return fault(e, q, "only 32-bit DMA loads are supported (setup %x)", s);
+
+    unsigned mpitch = (s >> 24) & 0xf;
+    unsigned rowlen = (s >> 20) & 0xf ? (s >> 20) & 0xf : 16;
+    unsigned nrows = (s >> 16) & 0xf ? (s >> 16) & 0xf : 16;
+    unsigned vpitch = (s >> 12) & 0xf ? (s >> 12) & 0xf : 16;
+    unsigned vert = (s >> 11) & 1;
+    unsigned y = (s >> 4) & 0x7f, x = s & 0xf;
+    uint32_t pitch = mpitch ? 8u << mpitch : q->vdr_stride;
+
+    for (unsigned r = 0; r < nrows; r++)
+        for (unsigned w = 0; w < rowlen; w++)
+        {
+            uint32_t *m = word(e, q, addr + r * pitch + 4 * w);
+            uint32_t *v = vert ? vpm_word(e, q, y + w, x + r * vpitch)
+                               : vpm_word(e, q, y + r * vpitch, x + w);
+            if (!m || !v)
+                return QPU_EMU_FAULT;
+            *v = *m;
+        }
+    return 0;
+}
+
+// VDW: VPM -> memory, started by a vw_addr write.
+static int dma_store(qpu_emu_t *e, qpu_t *q, uint32_t addr)
+{
+    uint32_t s = q->vdw_setup;
+
+    if ((s >> 30) != 2)
+        return fault(e, q, "DMA store with no setup");
+    if (s & 7)
+        return fault(e, q, "only 32-bit DMA stores are supported (setup %x)", s);
+
+    unsigned units = (s >> 23) & 0x7f ? (s >> 23) & 0x7f : 128;
+    unsigned depth = (s >> 16) & 0x7f ? (s >> 16) & 0x7f : 128;
+    unsigned horiz = (s >> 14) & 1;
+    unsigned y = (s >> 7) & 0x7f, x = (s >> 3) & 0xf;
+    uint32_t pitch = depth * 4 + q->vdw_stride;
+
+    for (unsigned u = 0; u < units; u++)
+        for (unsigned d = 0; d < depth; d++)
+        {
+            uint32_t *m = word(e, q, addr + u * pitch + 4 * d);
+            uint32_t *v = horiz ? vpm_word(e, q, y + u, x + d)
+                                : vpm_word(e, q, y + d, x + u);
+            if (!m || !v)
+                return QPU_EMU_FAULT;
+            *m = *v;
+        }
+    return 0;
+}
+
+//
+// Register reads and writes.
+//
+
+static int read_reg(qpu_emu_t *e, qpu_t *q, int file_b, uint32_t raddr, uint32_t out[QPU_NUM_LANES])
+{
+    if (raddr < QPU_NUM_REGS)
+    {
+        memcpy(out, file_b ? q->rb[raddr] : q->ra[raddr], QPU_NUM_LANES * sizeof out[0]);
+        return 0;
+    }
+
+    switch (raddr)
+    {
+    case QPU_R_UNIF:
+    {
+        uint32_t *p = word(e, q, q->unif);
+        if (!p)
+            return QPU_EMU_FAULT;
+        q->unif += 4;
+        fill(out, *p);
+        return 0;
+    }
+    case QPU_R_ELEM_QPU:
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+            out[i] = file_b ? q->num : i;
+        return 0;
+    case QPU_R_VPM:
+        return vpm_read(e, q, out);
+    case QPU_R_NOP:
+    // DMA finishes as soon as it starts; the mutex was taken in exec_alu.
+    case QPU_R_VPM_BUSY:
+    case QPU_R_VPM_WAIT:
+    case QPU_R_MUTEX:
+        fill(out, 0);
+        return 0;
+    default:
+        return fault(e, q, "unsupported read of %c%d", file_b ? 'B' : 'A', raddr);
+    }
+}
+
+static uint32_t sfu(uint32_t waddr, uint32_t x)
+{
+    float f = f32(x);
+    switch (waddr)
+    {
+    case QPU_W_SFU_RECIP: return u32(1.0f / f);
+    case QPU_W_SFU_RECIPSQRT: return u32(1.0f / sqrtf(f));
+    case QPU_W_SFU_EXP: return u32(exp2f(f));
+    default: return u32(log2f(f));
+    }
+}
+
+static int tmu_lookup(qpu_emu_t *e, qpu_t *q, int t, const uint32_t v[QPU_NUM_LANES])
+{
+    if (q->tmu_n[t] == QPU_EMU_TMU_FIFO)
+        return fault(e, q, "TMU%d request FIFO overflow", t);
+    uint32_t *slot = q->tmu[t][(q->tmu_head[t] + q->tmu_n[t]++) % QPU_EMU_TMU_FIFO];
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        uint32_t *m = word(e, q, v[i]);
+        if (!m)
+            return QPU_EMU_FAULT;
+        slot[i] = *m;
+    }
+    return 0;
+}
+
+static int write_reg(qpu_emu_t *e, qpu_t *q, int file_b, uint32_t waddr,
+    const uint32_t v[QPU_NUM_LANES], const uint8_t en[QPU_NUM_LANES])
+{
+    if (waddr < QPU_NUM_REGS)
+    {
+        uint32_t *r = file_b ? q->rb[waddr] : q->ra[waddr];
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+            if (en[i])
+                r[i] = v[i];
+        return 0;
+    }
+
+    switch (waddr)
+    {
+    case QPU_W_R0:
+    case QPU_W_R1:
+    case QPU_W_R2:
+    case QPU_W_R3:
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+            if (en[i])
+                q->acc[waddr - QPU_W_R0][i] = v[i];
+        return 0;
+    case QPU_W_R5:
+        // A: element 0 of each quad to the quad; B: element 0 to all.
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+        {
+            int src = file_b ? 0 : i & ~3;
+            if (en[src])
+                q->acc[5][i] = v[src];
+        }
+        return 0;
+    case QPU_W_NOP:
+    case QPU_W_TMU_NOSWAP:
+        return 0;
+    case QPU_W_MUTEX:
+        if (__atomic_load_n(&e->mutex, __ATOMIC_RELAXED) != q->num + 1)
+            return fault(e, q, "mutex released by a QPU that does not hold it");
+        __atomic_store_n(&e->mutex, 0, __ATOMIC_RELEASE);
+        return 0;
+    case QPU_W_HOST_INT:
+        if (en[0])
+            __atomic_fetch_or(&e->host_int, 1u << q->num, __ATOMIC_RELAXED);
+        return 0;
+    case QPU_W_UNIF_ADDR:
+        if (en[0])
+            q->unif = v[0];
+        return 0;
+    case QPU_W_VPM:
+        return vpm_write(e, q, v, en);
+    case QPU_W_VPM_SETUP:
+        if (!en[0])
+            return 0;
+        if (file_b)
+        {
+            switch (v[0] >> 30)
+            {
+            case 0: return vpm_setup(e, q, &q->vpw, v[0], 0);
+            case 2: q->vdw_setup = v[0]; return 0;
+            case 3: q->vdw_stride = v[0] & 0xffff; return 0;
+            default: return fault(e, q, "bad vw_setup %x", v[0]);
+            }
+        }
+        if (!(v[0] >> 31))
+            return vpm_setup(e, q, &q->vpr, v[0], 1);
+        if ((v[0] >> 28) == 9)
+            q->vdr_stride = v[0] & 0x1fff;
+        else
+            q->vdr_setup = v[0];
+        return 0;
+    case QPU_W_VPM_ADDR:
+        if (!en[0])
+            return 0;
+        return file_b ? dma_store(e, q, v[0]) : dma_load(e, q, v[0]);
+    case QPU_W_SFU_RECIP:
+    case QPU_W_SFU_RECIPSQRT:
+    case QPU_W_SFU_EXP:
+    case QPU_W_SFU_LOG:
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+            q->acc[4][i] = sfu(waddr, v[i]);
+        return 0;
+    case QPU_W_TMU0_S:
+        return tmu_lookup(e, q, 0, v);
+    case QPU_W_TMU1_S:
+        return tmu_lookup(e, q, 1, v);
+    case QPU_W_TMU0_T:
+    case QPU_W_TMU0_R:
+    case QPU_W_TMU0_B:
+    case QPU_W_TMU1_T:
+    case QPU_W_TMU1_R:
+    case QPU_W_TMU1_B:
+        return fault(e, q, "texture lookups are not supported");
+    default:
+        return fault(e, q, "unsupported write to %c%d", file_b ? 'B' : 'A', waddr);
+    }
+}
+
+//
+// ALU.
+//
+
+static int cond_ok(qpu_t *q, uint32_t cond, int i)
+{
+    switch (cond)
+    {
+    case QPU_COND_NEVER: return 0;
+    case QPU_COND_ALWAYS: return 1;
+    case QPU_COND_ZS: return q->z[i];
+    case QPU_COND_ZC: return !q->z[i];
+    case QPU_COND_NS: return q->n[i];
+    case QPU_COND_NC: return !q->n[i];
+    case QPU_COND_CS: return q->c[i];
+    default: return !q->c[i];
+    }
+}
+
+static uint32_t bytewise(uint32_t a, uint32_t b, int op)
+{
+    uint32_t r = 0;
+    for (int s = 0; s < 32; s += 8)
+    {
+        int x = (a >> s) & 0xff, y = (b >> s) & 0xff, v;
+        switch (op)
+        {
+        case QPU_M_V8MULD: v = (x * y + 127) / 255; break;
+        case QPU_M_V8MIN: v = x < y ? x : y; break;
+        case QPU_M_V8MAX: v = x > y ? x : y; break;
+        case QPU_M_V8ADDS: v = x + y > 255 ? 255 : x + y; break;
+        default: v = x - y < 0 ? 0 : x - y; break;
+        }
+        r |= (uint32_t)v << s;
+    }
+    return r;
+}
+
+static int is_float_add(uint32_t op)
+{
+    return (op >= QPU_A_FADD && op <= QPU_A_FMAXABS) || op == QPU_A_ITOF;
+}
+
+// one lane of the add pipe; *c gets the carry flag.
+static uint32_t add_op(uint32_t op, uint32_t a, uint32_t b, uint8_t *c, int *bad)
+{
+    *c = 0;
+    switch (op)
+    {
+    case QPU_A_FADD: return u32(f32(a) + f32(b));
+    case QPU_A_FSUB: return u32(f32(a) - f32(b));
+    case QPU_A_FMIN: return u32(fminf(f32(a), f32(b)));
+    case QPU_A_FMAX: return u32(fmaxf(f32(a), f32(b)));
+    case QPU_A_FMINABS: return u32(fminf(fabsf(f32(a)), fabsf(f32(b))));
+    case QPU_A_FMAXABS: return u32(fmaxf(fabsf(f32(a)), fabsf(f32(b))));
+    case QPU_A_FTOI:
+    {
+        float f = f32(a);
+        return fabsf(f) < 2147483648.0f ? (uint32_t)(int32_t)f : 0;
+    }
+    case QPU_A_ITOF: return u32((float)(int32_t)a);
+    case QPU_A_ADD:
+        *c = (uint64_t)a + b > 0xffffffffu;
+        return a + b;
+    case QPU_A_SUB:
+        *c = a < b;
+        return a - b;
+    case QPU_A_SHR: return a >> (b & 31);
+    case QPU_A_ASR: return (uint32_t)((int32_t)a >> (b & 31));
+    case QPU_A_ROR: return b & 31 ? a >> (b & 31) | a << (32 - (b & 31)) : a;
+    case QPU_A_SHL: return a << (b & 31);
+    case QPU_A_MIN: return (int32_t)a < (int32_t)b ? a : b;
+    case QPU_A_MAX: return (int32_t)a > (int32_t)b ? a : b;
+    case QPU_A_AND: return a & b;
+    case QPU_A_OR: return a | b;
+    case QPU_A_XOR: return a ^ b;
+    case QPU_A_NOT: return ~a;
+    case QPU_A_CLZ: return a ? __builtin_clz(a) : 32;
+    case QPU_A_V8ADDS: return bytewise(a, b, QPU_M_V8ADDS);
+    case QPU_A_V8SUBS: return bytewise(a, b, QPU_M_V8SUBS);
+    default:
+        *bad = 1;
+        return 0;
+    }
+}
+
+static uint32_t mul_op(uint32_t op, uint32_t a, uint32_t b)
+{
+    switch (op)
+    {
+    case QPU_M_FMUL: return u32(f32(a) * f32(b));
+    case QPU_M_MUL24: return (a & 0xffffff) * (b & 0xffffff);
+    default: return bytewise(a, b, op);
+    }
+}
+
+uint32_t qpu_small_imm(uint32_t v)
+{
+    if (v < 16)
+        return v;
+    if (v < 32)
+        return v - 32;
+    if (v < 40)
+        return u32((float)(1 << (v - 32)));
+    return u32(1.0f / (1 << (48 - v)));
+}
+
+// regfile A unpack (pm = 0), integer forms only.
+static int unpack(uint32_t mode, uint32_t v[QPU_NUM_LANES])
+{
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        switch (mode)
+        {
+        case 1: v[i] = (uint32_t)(int16_t)v[i]; break;
+        case 2: v[i] = (uint32_t)(int16_t)(v[i] >> 16); break;
+        case 3: v[i] = (v[i] >> 24) * 0x01010101u; break;
+        case 4: case 5: case 6: case 7:
+            v[i] = (v[i] >> (8 * (mode - 4))) & 0xff;
+            break;
+        default: return -1;
+        }
+    return 0;
+}
+
+// regfile A pack (pm = 0), non-saturating forms only.
+static int pack(uint32_t mode, const uint32_t *old, uint32_t v[QPU_NUM_LANES])
+{
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        switch (mode)
+        {
+        case 1: v[i] = (old[i] & 0xffff0000) | (v[i] & 0xffff); break;
+        case 2: v[i] = (old[i] & 0x0000ffff) | v[i] << 16; break;
+        case 3: v[i] = (v[i] & 0xff) * 0x01010101u; break;
+        case 4: case 5: case 6: case 7:
+        {
+            int s = 8 * (mode - 4);
+            v[i] = (old[i] & ~(0xffu << s)) | (v[i] & 0xff) << s;
+            break;
+        }
+        default: return -1;
+        }
+    return 0;
+}
+
+static void set_flags(qpu_t *q, const uint32_t v[QPU_NUM_LANES], const uint8_t c[QPU_NUM_LANES], int is_float)
+{
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        q->z[i] = is_float ? !(v[i] & 0x7fffffff) : !v[i];
+        q->n[i] = v[i] >> 31;
+        q->c[i] = c ? c[i] : 0;
+    }
+}
+
+static void mux(qpu_t *q, uint32_t m, const uint32_t va[], const uint32_t vb[], uint32_t out[])
+{
+    const uint32_t *src = m == QPU_MUX_A ? va : m == QPU_MUX_B ? vb : q->acc[m];
+    memcpy(out, src, QPU_NUM_LANES * sizeof out[0]);
+}
+
+static void rotate(uint32_t v[QPU_NUM_LANES], unsigned n)
+{
+    uint32_t t[QPU_NUM_LANES];
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        t[i] = v[(i - n) & 15];
+    memcpy(v, t, sizeof t);
+}
+
+// write one pipe's result, packing it if it lands in regfile A.
+static int write_result(qpu_emu_t *e, qpu_t *q, uint64_t ins, int file_b, uint32_t waddr,
+    uint32_t v[QPU_NUM_LANES], const uint8_t en[QPU_NUM_LANES])
+{
+    if (QPU_PACK(ins) && !QPU_PM(ins) && !file_b && waddr < QPU_NUM_REGS
+        && pack(QPU_PACK(ins), q->ra[waddr], v) < 0)
+        return fault(e, q, "unsupported pack mode %d", QPU_PACK(ins));
+    return write_reg(e, q, file_b, waddr, v, en);
+}
+
+static int exec_alu(qpu_emu_t *e, qpu_t *q, uint64_t ins)
+{
+    uint32_t sig = QPU_SIG(ins);
+    uint32_t op_add = QPU_OP_ADD(ins), op_mul = QPU_OP_MUL(ins);
+    uint32_t raddr_b = QPU_RADDR_B(ins);
+    uint32_t va[QPU_NUM_LANES], vb[QPU_NUM_LANES];
+    uint32_t aa[QPU_NUM_LANES], ab[QPU_NUM_LANES], ma[QPU_NUM_LANES], mb[QPU_NUM_LANES];
+    uint32_t radd[QPU_NUM_LANES], rmul[QPU_NUM_LANES];
+    uint8_t cadd[QPU_NUM_LANES], ena[QPU_NUM_LANES], enm[QPU_NUM_LANES];
+    int bad = 0;
+
+    switch (sig)
+    {
+    case QPU_SIG_BREAK:
+        return fault(e, q, "breakpoint");
+    case QPU_SIG_COVERAGE_LOAD:
+    case QPU_SIG_COLOR_LOAD:
+    case QPU_SIG_COLOR_LOAD_END:
+    case QPU_SIG_ALPHA_LOAD:
+        return fault(e, q, "fragment shader signal %d", sig);
+    }
+
+    // taking the mutex is the only way to block, so it goes first.
+    if (QPU_RADDR_A(ins) == QPU_R_MUTEX || (sig != QPU_SIG_SMALL_IMM && raddr_b == QPU_R_MUTEX))
+    {
+        int free = 0;
+        if (__atomic_load_n(&e->mutex, __ATOMIC_RELAXED) == q->num + 1)
+            return fault(e, q, "mutex acquired twice");
+        if (!__atomic_compare_exchange_n(&e->mutex, &free, q->num + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return QPU_EMU_BLOCKED;
+    }
+
+    // operand reads all happen before any write.
+    if (read_reg(e, q, 0, QPU_RADDR_A(ins), va) < 0)
+        return QPU_EMU_FAULT;
+    if (sig == QPU_SIG_SMALL_IMM)
+        fill(vb, qpu_small_imm(raddr_b));
+    else if (read_reg(e, q, 1, raddr_b, vb) < 0)
+        return QPU_EMU_FAULT;
+    if (QPU_UNPACK(ins))
+    {
+        if (QPU_PM(ins) || is_float_add(op_add) || op_mul == QPU_M_FMUL
+            || unpack(QPU_UNPACK(ins), va) < 0)
+            return fault(e, q, "unsupported unpack mode %d", QPU_UNPACK(ins));
+    }
+
+    mux(q, QPU_ADD_A(ins), va, vb, aa);
+    mux(q, QPU_ADD_B(ins), va, vb, ab);
+    mux(q, QPU_MUL_A(ins), va, vb, ma);
+    mux(q, QPU_MUL_B(ins), va, vb, mb);
+    if (sig == QPU_SIG_SMALL_IMM && raddr_b >= 48)
+    {
+        unsigned n = raddr_b == 48 ? q->acc[5][0] & 15 : raddr_b - 48;
+        rotate(ma, n);
+        rotate(mb, n);
+    }
+
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        radd[i] = add_op(op_add, aa[i], ab[i], &cadd[i], &bad);
+        rmul[i] = mul_op(op_mul, ma[i], mb[i]);
+        ena[i] = cond_ok(q, QPU_COND_ADD(ins), i);
+        enm[i] = cond_ok(q, QPU_COND_MUL(ins), i);
+    }
+    if (op_add != QPU_A_NOP && bad)
+        return fault(e, q, "unsupported add op %d", op_add);
+
+    if (QPU_SF(ins))
+    {
+        if (op_add != QPU_A_NOP)
+            set_flags(q, radd, cadd, is_float_add(op_add));
+        else if (op_mul != QPU_M_NOP)
+            set_flags(q, rmul, NULL, op_mul == QPU_M_FMUL);
+    }
+
+    int ws = QPU_WS(ins);
+    if (op_add != QPU_A_NOP && write_result(e, q, ins, ws, QPU_WADDR_ADD(ins), radd, ena) < 0)
+        return QPU_EMU_FAULT;
+    if (op_mul != QPU_M_NOP && write_result(e, q, ins, !ws, QPU_WADDR_MUL(ins), rmul, enm) < 0)
+        return QPU_EMU_FAULT;
+
+    if (sig == QPU_SIG_LOAD_TMU0 || sig == QPU_SIG_LOAD_TMU1)
+    {
+        int t = sig - QPU_SIG_LOAD_TMU0;
+        if (!q->tmu_n[t])
+            return fault(e, q, "ldtmu%d with no TMU%d request", t, t);
+        memcpy(q->acc[4], q->tmu[t][q->tmu_head[t]], sizeof q->acc[4]);
+        q->tmu_head[t] = (q->tmu_head[t] + 1) % QPU_EMU_TMU_FIFO;
+        q->tmu_n[t]--;
+    }
+    if (sig == QPU_SIG_PROG_END)
+        q->end_in = QPU_END_DELAY + 1;
+    return 0;
+}
+
+static int exec_ldi(qpu_emu_t *e, qpu_t *q, uint64_t ins)
+{
+    uint32_t imm = QPU_IMM(ins), v[QPU_NUM_LANES];
+    uint8_t ena[QPU_NUM_LANES], enm[QPU_NUM_LANES];
+
+    switch (QPU_LDI_MODE(ins))
+    {
+    case QPU_LDI_32:
+        fill(v, imm);
+        break;
+    case QPU_LDI_EL_SIGNED:
+    case QPU_LDI_EL_UNSIGNED:
+        for (int i = 0; i < QPU_NUM_LANES; i++)
+        {
+            uint32_t x = ((imm >> (16 + i)) & 1) << 1 | ((imm >> i) & 1);
+            v[i] = QPU_LDI_MODE(ins) == QPU_LDI_EL_SIGNED && (x & 2) ? x - 4 : x;
+        }
+        break;
+    case QPU_LDI_SEMA:
+    {
+        // counts are 4 bits: acquiring 0 or releasing 15 waits.
+        int *sema = &e->sema[QPU_SEMA_NUM(ins)];
+        int n = __atomic_load_n(sema, __ATOMIC_RELAXED);
+        int acq = QPU_SEMA_ACQUIRE(ins);
+        if ((acq && n == 0) || (!acq && n == 15)
+            || !__atomic_compare_exchange_n(sema, &n, acq ? n - 1 : n + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return QPU_EMU_BLOCKED;
+        fill(v, imm);
+        break;
+    }
+    default:
+        return fault(e, q, "unsupported load immediate mode %d", QPU_LDI_MODE(ins));
+    }
+    if (QPU_PACK(ins))
+        return fault(e, q, "unsupported pack mode %d", QPU_PACK(ins));
+
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        ena[i] = cond_ok(q, QPU_COND_ADD(ins), i);
+        enm[i] = cond_ok(q, QPU_COND_MUL(ins), i);
+    }
+    if (QPU_SF(ins))
+        set_flags(q, v, NULL, 0);
+
+    int ws = QPU_WS(ins);
+    if (write_reg(e, q, ws, QPU_WADDR_ADD(ins), v, ena) < 0)
+        return QPU_EMU_FAULT;
+    return write_reg(e, q, !ws, QPU_WADDR_MUL(ins), v, enm);
+}
+
+static int branch_taken(qpu_t *q, uint32_t cond)
+{
+    if (cond == QPU_BR_ALWAYS)
+        return 1;
+    const uint8_t *f = cond < 4 ? q->z : cond < 8 ? q->n : q->c;
+    int want = !(cond & 1), n = 0;
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        n += f[i] == want;
+    return cond & 2 ? n > 0 : n == QPU_NUM_LANES;
+}
+
+static int exec_branch(qpu_emu_t *e, qpu_t *q, uint64_t ins, uint32_t pc)
+{
+    uint32_t cond = QPU_BR_COND(ins);
+    uint32_t link[QPU_NUM_LANES];
+    uint8_t all[QPU_NUM_LANES];
+
+    if (cond > QPU_BR_ANYNC && cond != QPU_BR_ALWAYS)
+        return fault(e, q, "bad branch condition %d", cond);
+    if (q->branch_in)
+        return fault(e, q, "branch in a branch delay slot");
+
+    // the link address and relative targets count from after the delay slots.
+    uint32_t after = pc + 8 * (QPU_BRANCH_DELAY + 1);
+    fill(link, after);
+    memset(all, 1, sizeof all);
+    int ws = QPU_WS(ins);
+    if (write_reg(e, q, ws, QPU_WADDR_ADD(ins), link, all) < 0
+        || write_reg(e, q, !ws, QPU_WADDR_MUL(ins), link, all) < 0)
+        return QPU_EMU_FAULT;
+
+    if (!branch_taken(q, cond))
+        return 0;
+    uint32_t target = QPU_IMM(ins);
+    if (QPU_BR_REL(ins))
+        target += after;
+    if (QPU_BR_REG(ins))
+        target += q->ra[QPU_BR_RADDR_A(ins)][0];
+    q->branch_pc = target;
+    q->branch_in = QPU_BRANCH_DELAY + 1;
+    return 0;
+}
+
+int qpu_emu_step(qpu_emu_t *e, int num)
+{
+    qpu_t *q = &e->qpu[num];
+
+    if (q->state != QPU_EMU_RUNNING)
+        return q->state;
+    if (q->ninstr >= e->max_instrs)
+        return fault(e, q, "no program end after %llu instructions", (unsigned long long)q->ninstr);
+
+    uint32_t pc = q->pc;
+    uint32_t *lo = word(e, q, pc), *hi = lo ? word(e, q, pc + 4) : NULL;
+    if (!hi)
+        return QPU_EMU_FAULT;
+    uint64_t ins = QPU_INS(*lo, *hi);
+    q->pc += 8;
+    q->ninstr++;
+
+    int r;
+    switch (QPU_SIG(ins))
+    {
+    case QPU_SIG_BRANCH: r = exec_branch(e, q, ins, pc); break;
+    case QPU_SIG_LOAD_IMM: r = exec_ldi(e, q, ins); break;
+    default: r = exec_alu(e, q, ins); break;
+    }
+    if (r < 0)
+        return QPU_EMU_FAULT;
+    if (r == QPU_EMU_BLOCKED)
+    {
+        // nothing happened: retry the same instruction later.
+        q->pc = pc;
+        q->ninstr--;
+        return QPU_EMU_BLOCKED;
+    }
+
+    if (q->branch_in && --q->branch_in == 0)
+        q->pc = q->branch_pc;
+    if (q->end_in && --q->end_in == 0)
+        q->state = QPU_EMU_DONE;
+    return q->state;
+}
+
+// run QPU 'num' for up to 'budget' instructions, translated if enabled.
+static int run_for(qpu_emu_t *e, int num, unsigned budget)
+{
+    int r = QPU_EMU_RUNNING;
+
+    if (e->xlate)
+        return qpu_xlate_run(e, num, budget);
+    while (budget-- && (r = qpu_emu_step(e, num)) == QPU_EMU_RUNNING)
+        ;
+    return r;
+}
+
+int qpu_emu_run(qpu_emu_t *e, int num, uint32_t code, uint32_t unif)
+{
+    int r;
+
+    qpu_emu_start(e, num, code, unif);
+    while ((r = run_for(e, num, -1)) == QPU_EMU_RUNNING)
+        ;
+    if (r == QPU_EMU_BLOCKED)
+        r = fault(e, &e->qpu[num], "blocked with no other program running");
+    __atomic_fetch_add(&e->ninstr, e->qpu[num].ninstr, __ATOMIC_RELAXED);
+    return r;
+}
+
+//
+// Running many programs at once.
+//
+
+#define DEADLOCK_PASSES 100000  // idle passes with no progress anywhere
+
+typedef struct pool
+{
+    qpu_emu_t *e;
+    const qpu_emu_req_t *reqs;
+    int n;
+    int nthreads;
+    int next;           // next request to start
+    int nfault;
+    uint64_t progress;  // bumped whenever any QPU retires instructions
+    int deadlock;
+} pool_t;
+
+typedef struct worker
+{
+    pool_t *p;
+    int id;
+    pthread_t thread;
+} worker_t;
+
+static void end_program(pool_t *p, qpu_t *q)
+{
+    __atomic_fetch_add(&p->e->ninstr, q->ninstr, __ATOMIC_RELAXED);
+    if (q->state == QPU_EMU_FAULT)
+        __atomic_fetch_add(&p->nfault, 1, __ATOMIC_RELAXED);
+}
+
+// thread 'id' owns QPUs id, id + nthreads, ... and round-robins over them.
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+    pool_t *p = w->p;
+    qpu_emu_t *e = p->e;
+    unsigned idle = 0;
+    uint64_t seen = 0;
+
+    for (;;)
+    {
+        int live = 0, moved = 0;
+
+        for (int num = w->id; num < QPU_EMU_NUM_QPUS; num += p->nthreads)
+        {
+            qpu_t *q = &e->qpu[num];
+            if (q->state != QPU_EMU_RUNNING)
+            {
+                int i = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED);
+                if (i >= p->n)
+                    continue;
+                qpu_emu_start(e, num, p->reqs[i].code, p->reqs[i].unif);
+            }
+            live = 1;
+            uint64_t before = q->ninstr;
+            int r = run_for(e, num, e->quantum ? e->quantum : 1);
+            if (q->ninstr != before)
+                moved = 1;
+            if (r != QPU_EMU_RUNNING && r != QPU_EMU_BLOCKED)
+                end_program(p, q);
+        }
+        if (!live || __atomic_load_n(&p->deadlock, __ATOMIC_RELAXED))
+            break;
+
+        if (moved)
+        {
+            __atomic_fetch_add(&p->progress, 1, __ATOMIC_RELAXED);
+            idle = 0;
+            continue;
+        }
+        // everything here is blocked: wait for another thread, unless
+        // nobody has moved for a long time.
+        uint64_t now = __atomic_load_n(&p->progress, __ATOMIC_RELAXED);
+        if (!idle++ || now != seen)
+        {
+            seen = now;
+            idle = 1;
+        }
+        else if (idle > DEADLOCK_PASSES)
+            __atomic_store_n(&p->deadlock, 1, __ATOMIC_RELAXED);
+        sched_yield();
+    }
+
+    // a deadlock strands whatever was blocked.
+    for (int num = w->id; num < QPU_EMU_NUM_QPUS; num += p->nthreads)
+        if (e->qpu[num].state == QPU_EMU_RUNNING)
+        {
+            fault(e, &e->qpu[num], "deadlocked on a semaphore or the mutex");
+            end_program(p, &e->qpu[num]);
+        }
+    return NULL;
+}
+
+int qpu_emu_run_all(qpu_emu_t *e, const qpu_emu_req_t *reqs, int n, int nthreads)
+{
+    worker_t w[QPU_EMU_NUM_QPUS];
+    pool_t p = { .e = e, .reqs = reqs, .n = n };
+
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > QPU_EMU_NUM_QPUS)
+        nthreads = QPU_EMU_NUM_QPUS;
+    p.nthreads = nthreads;
+    for (int num = 0; num < QPU_EMU_NUM_QPUS; num++)
+        e->qpu[num].state = QPU_EMU_DONE;
+
+    for (int i = 0; i < nthreads; i++)
+    {
+        w[i] = (worker_t){ .p = &p, .id = i };
+        // the caller's thread does the first share itself.
+        if (i && pthread_create(&w[i].thread, NULL, worker, &w[i]))
+            panic("pthread_create failed\n");
+    }
+    worker(&w[0]);
+    for (int i = 1; i < nthreads; i++)
+        pthread_join(w[i].thread, NULL);
+    return p.nfault;
+}
@@ -0,0 +1,137 @@
+#ifndef __QPU_EMU_H__
+#define __QPU_EMU_H__
+/*
+ * Host emulator for the VideoCore IV QPUs: runs the instruction arrays the
+ * kernels are assembled into (addshader, mulshader, ...) against simulated
+ * bus memory.
+ *
+ * Modelled: both register files, accumulators r0-r5, the uniform stream,
+ * element/QPU numbers, per-lane Z/N/C flags and condition codes, branches
+ * with their three delay slots, program end, small immediates (including
+ * mul-pipe rotation), load immediates, the SFU (r4), general-memory TMU
+ * lookups, the VPM (generic 32-bit block reads and writes) and VDR/VDW DMA.
+ * Results appear as soon as an instruction retires; timing is not modelled
+ * here.  Anything the hardware does that this does not (texture lookups,
+ * 8/16-bit VPM and DMA formats, most pack/unpack modes) faults with a
+ * message rather than silently doing the wrong thing.
+ *
+ * Flags: Z and N come from the result; C is the unsigned carry for add,
+ * the unsigned borrow for sub, and clear for everything else.
+ *
+ * Several programs can be started on different QPUs and stepped in any
+ * interleaving; they share the VPM, memory, the 16 semaphores and the VPM
+ * mutex.  An instruction that has to wait for a semaphore or the mutex
+ * does nothing and returns QPU_EMU_BLOCKED; stepping it again retries.
+ * qpu_emu_run_all() runs a whole batch of programs that way on a pool of
+ * host threads, each owning a fixed share of the QPUs and running each of
+ * them e->quantum instructions at a time.  The semaphores, the mutex and
+ * the counters are atomic; the VPM and memory are plain loads and stores.
+ * Like the hardware, nothing stops two programs racing on the same VPM
+ * rows or memory, but how often a race shows depends on the quantum: at
+ * the default, short programs run almost one after another, and a quantum
+ * of 1 interleaves the QPUs on a thread every instruction.
+ *
+ * With e->xlate set (qpu_xlate_enable), runs go through translated code
+ * instead of decoding every instruction; see qpu-xlate.h.
+ */
+#include <stdint.h>
+#include "qpu-isa.h"
+
+#define QPU_EMU_NUM_QPUS 16
+#define QPU_EMU_VPM_ROWS 64 // of 16 32-bit words
+#define QPU_EMU_TMU_FIFO 8
+#define QPU_EMU_QUANTUM 256 // default e->quantum
+
+enum
+{
+    QPU_EMU_FAULT = -1,
+    QPU_EMU_DONE = 0,
+    QPU_EMU_RUNNING = 1,
+    QPU_EMU_BLOCKED = 2,    // from qpu_emu_step only: still running
+};
+
+// a generic VPM block read or write stream
+typedef struct qpu_vpm_stream
+{
+    uint32_t addr;
+    int stride;
+    int left;           // reads still set up (reads only)
+    int horiz;
+} qpu_vpm_stream_t;
+
+typedef struct qpu
+{
+    int num;
+    int state;          // QPU_EMU_*
+    uint32_t code;      // bus address the program started at
+    uint32_t pc;        // bus address of the next instruction
+    uint32_t unif;      // bus address of the next uniform
+
+    uint32_t ra[QPU_NUM_REGS][QPU_NUM_LANES];
+    uint32_t rb[QPU_NUM_REGS][QPU_NUM_LANES];
+    uint32_t acc[6][QPU_NUM_LANES];
+    uint8_t z[QPU_NUM_LANES], n[QPU_NUM_LANES], c[QPU_NUM_LANES];
+
+    qpu_vpm_stream_t vpr, vpw;
+    uint32_t vdr_setup, vdr_stride;
+    uint32_t vdw_setup, vdw_stride;
+
+    uint32_t tmu[2][QPU_EMU_TMU_FIFO][QPU_NUM_LANES];
+    unsigned tmu_head[2], tmu_n[2];
+
+    int branch_in;      // instructions until a taken branch lands
+    uint32_t branch_pc;
+    int end_in;         // instructions until the program ends
+
+    uint64_t ninstr;
+    const void *xk;     // the program's translation, if any (qpu-xlate.c)
+} qpu_t;
+
+typedef struct qpu_emu
+{
+    // host pointer for the word at bus address 'bus', or NULL if unmapped.
+    void *(*mem)(uint32_t bus);
+
+    uint32_t vpm[QPU_EMU_VPM_ROWS][QPU_NUM_LANES];
+    qpu_t qpu[QPU_EMU_NUM_QPUS];
+    int sema[QPU_NUM_SEMAS];
+    int mutex;          // holder's QPU number + 1, or 0 if free
+    uint32_t host_int;  // QPUs that wrote host_int
+    uint64_t ninstr;    // instructions retired by finished programs
+    uint64_t max_instrs;    // per program; a runaway kernel faults
+    unsigned quantum;       // instructions qpu_emu_run_all runs a QPU before moving on
+    char err[160];          // the first fault
+
+    struct qpu_xlate *xlate;    // NULL: interpret every instruction
+} qpu_emu_t;
+
+void qpu_emu_init(qpu_emu_t *e, void *(*mem)(uint32_t bus));
+
+// Point QPU 'num' at a program and its uniforms.
+void qpu_emu_start(qpu_emu_t *e, int num, uint32_t code, uint32_t unif);
+
+// Run one instruction on QPU 'num'; returns its QPU_EMU_* state afterwards.
+int qpu_emu_step(qpu_emu_t *e, int num);
+
+// Start and run a program to its end; returns QPU_EMU_DONE or QPU_EMU_FAULT.
+int qpu_emu_run(qpu_emu_t *e, int num, uint32_t code, uint32_t unif);
+
+// value of small immediate 'v' (0-47; 48-63 are mul-pipe rotations).
+uint32_t qpu_small_imm(uint32_t v);
+
+typedef struct qpu_emu_req
+{
+    uint32_t code;
+    uint32_t unif;
+} qpu_emu_req_t;
+
+/*
+ * Run 'n' programs, up to QPU_EMU_NUM_QPUS at a time, on 'nthreads' host
+ * threads (the caller's included).  Like the QPU scheduler, each program
+ * starts on whichever QPU frees up first.  Returns how many faulted;
+ * programs still blocked once nothing can make progress fault as
+ * deadlocked.
+ */
+int qpu_emu_run_all(qpu_emu_t *e, const qpu_emu_req_t *reqs, int n, int nthreads);
+
+#endif
@@ -0,0 +1,1032 @@
+#include <stdarg.h>
+#include "rpi.h"
+#include "qpu-regalloc.h"
+
+#define MAX_LINES 4096
+#define MAX_LABELS 256
+#define MAX_PAIRS 4096
+#define MAX_NAME 32
+#define NACC 4          // r0-r3: r4 and r5 are not general purpose
+#define MAX_DEPTH 6     // loop nesting that still raises a weight
+#define NWORDS (QPU_RA_MAX_VREGS / 64)
+
+typedef struct set
+{
+    uint64_t w[NWORDS];
+} set_t;
+
+enum
+{
+    O_NONE = 0, // -
+    O_VREG,     // %name
+    O_A,        // raN
+    O_B,        // rbN
+    O_ACC,      // r0-r5
+    O_READ_A,   // other reads through file A (elem_num, ...)
+    O_READ_B,   // ... through file B (qpu_num, ...)
+    O_READ_ANY, // ... through either (unif, vpm, ...)
+    O_IMM,      // anything else read: a small immediate, or for mov an ldi
+    O_LABEL,    // :name
+    O_IO,       // anything else written (vw_setup, sfu_recip, ...)
+};
+
+enum
+{
+    OP_ALU = 0,
+    OP_LDI,
+    OP_BRANCH,
+    OP_OTHER,   // nop, signals, semaphores
+};
+
+typedef struct opd
+{
+    int kind, num;      // O_VREG: the vreg; O_A, O_B, O_ACC: the register
+    int off, len;       // where it is in the line
+    int fix;            // accumulator a mov put it in, or -1
+} opd_t;
+
+typedef struct op
+{
+    int kind;
+    int partial;        // conditional or packed write: the old value survives
+    opd_t dst, src[2];
+    int nsrc;
+} op_t;
+
+typedef struct ins
+{
+    int line;
+    op_t op[2];
+    int nop;
+    int branch, cond, target, end;
+    int slot;           // in the delay slots of a branch or thrend
+    int succ[2], nsucc;
+    int depth;
+    set_t rd, def, kill, in, out;
+    int nmov, mov_acc[4], mov_kind[4], mov_num[4];
+    int nop_before, nop_after;
+} ins_t;
+
+typedef struct vreg
+{
+    char name[MAX_NAME];
+    int line;           // first mention
+    int loc, num;       // O_ACC, O_A or O_B once allocated
+    uint64_t hazard;    // reads right after a write
+    uint64_t pairs;     // reads next to another vreg
+    uint64_t not_a, not_b, uses;
+    unsigned nlive;
+    set_t interf;
+} vreg_t;
+
+typedef struct pair
+{
+    int u, v;
+    uint64_t w;
+} pair_t;
+
+typedef struct ra
+{
+    char *text;                 // the source, split into lines
+    char *line[MAX_LINES];
+    int nlines;
+    int ins_at[MAX_LINES];      // instruction on each line, or -1
+    ins_t ins[QPU_RA_MAX_INS];
+    int nins;
+    struct
+    {
+        char name[MAX_NAME];
+        int at;
+    } label[MAX_LABELS];
+    int nlabels;
+    vreg_t v[QPU_RA_MAX_VREGS];
+    int nv;
+    pair_t pair[MAX_PAIRS];
+    int npairs;
+    uint8_t reserved[3][32];    // named by the source: accumulators, A, B
+    char *err;
+    size_t max_err;
+} ra_t;
+
+static const char *const alu2[] = {
+    "fadd", "fsub", "fmin", "fmax", "fminabs", "fmaxabs", "add", "sub", "shr", "asr",
+    "ror", "shl", "min", "max", "and", "or", "xor", "v8adds", "v8subs",
+    "fmul", "mul24", "v8muld", "v8min", "v8max", 0,
+};
+static const char *const alu1[] = { "mov", "ftoi", "itof", "not", "clz", 0 };
+static const char *const other[] = {
+    "nop", "thrend", "thrsw", "lthrsw", "sbwait", "sbdone", "ldtmu0", "ldtmu1",
+    "ldcend", "loadc", "loadcv", "loadam", "bkpt", "sacq", "srel", 0,
+};
+static const char *const branch_conds[] = {
+    "allz", "allnz", "anyz", "anynz", "alln", "allnn", "anyn", "anynn",
+    "allc", "allnc", "anyc", "anync", 0,
+};
+
+static const struct
+{
+    const char *name;
+    int kind;
+} reads[] = {
+    { "elem_num", O_READ_A }, { "x_coord", O_READ_A }, { "ms_mask", O_READ_A },
+    { "vr_wait", O_READ_A }, { "vr_busy", O_READ_A },
+    { "qpu_num", O_READ_B }, { "y_coord", O_READ_B }, { "rev_flag", O_READ_B },
+    { "vw_wait", O_READ_B }, { "vw_busy", O_READ_B },
+    { "unif", O_READ_ANY }, { "vpm", O_READ_ANY }, { "vary", O_READ_ANY },
+    { "varying", O_READ_ANY }, { "mutex", O_READ_ANY }, { "mutex_acq", O_READ_ANY },
+};
+
+static void set_add(set_t *s, int v)
+{
+    s->w[v / 64] |= 1ull << (v % 64);
+}
+
+static int set_has(const set_t *s, int v)
+{
+    return s->w[v / 64] >> (v % 64) & 1;
+}
+
+static int fail(ra_t *ra, int line, const char *fmt, ...)
+{
+    va_list ap;
+    int n = 0;
+
+    if (line >= 0)
+        n = snprintf(ra->err, ra->max_err, "line %d: ", line + 1);
+    if (n < 0 || (size_t)n >= ra->max_err)
+        return -1;
+    va_start(ap, fmt);
+    vsnprintf(ra->err + n, ra->max_err - n, fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+static int lookup(const char *const *tab, const char *s, int n)
+{
+    for (int i = 0; tab[i]; i++)
+        if ((int)strlen(tab[i]) == n && strncmp(tab[i], s, n) == 0)
+            return i;
+    return -1;
+}
+
+static int is_ident(int c)
+{
+    return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int is_space(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// "ra12" and the like: the register number, or -1.
+static int reg_num(const char *s, int n, const char *prefix, int max)
+{
+    int np = strlen(prefix), r = 0;
+
+    if (n <= np || n > np + 2 || strncmp(s, prefix, np) != 0)
+        return -1;
+    for (int i = np; i < n; i++)
+    {
+        if (s[i] < '0' || s[i] > '9')
+            return -1;
+        r = 10 * r + s[i] - '0';
+    }
+    return r <= max ? r : -1;
+}
+
+static int find_vreg(ra_t *ra, int ln, const char *s, int n)
+{
+    for (int i = 0; i < ra->nv; i++)
+        if ((int)strlen(ra->v[i].name) == n && strncmp(ra->v[i].name, s, n) == 0)
+            return i;
+    if (ra->nv == QPU_RA_MAX_VREGS)
+        return fail(ra, ln, "more than %d virtual registers\n", QPU_RA_MAX_VREGS);
+    if (n >= MAX_NAME)
+        return fail(ra, ln, "virtual register name too long\n");
+    vreg_t *v = &ra->v[ra->nv];
+    memcpy(v->name, s, n);
+    v->line = ln;
+    return ra->nv++;
+}
+
+static int parse_opd(ra_t *ra, int ln, int off, int len, int dst, opd_t *o)
+{
+    const char *s = ra->line[ln] + off;
+    int r;
+
+    memset(o, 0, sizeof *o);
+    o->off = off;
+    o->len = len;
+    o->fix = -1;
+    if (len == 1 && s[0] == '-')
+        o->kind = O_NONE;
+    else if (s[0] == '%')
+    {
+        for (int i = 1; i < len; i++)
+            if (!is_ident(s[i]))
+                return fail(ra, ln, "bad virtual register '%.*s'\n", len, s);
+        if (len == 1 || (o->num = find_vreg(ra, ln, s, len)) < 0)
+            return len == 1 ? fail(ra, ln, "bad virtual register\n") : -1;
+        o->kind = O_VREG;
+    }
+    else if (memchr(s, '%', len))
+        return fail(ra, ln, "virtual registers must be whole operands: '%.*s'\n", len, s);
+    else if ((r = reg_num(s, len, "ra", 31)) >= 0 || (r = reg_num(s, len, "rb", 31)) >= 0)
+    {
+        o->kind = s[1] == 'a' ? O_A : O_B;
+        o->num = r;
+        ra->reserved[o->kind == O_A ? 1 : 2][r] = 1;
+    }
+    else if ((r = reg_num(s, len, "r", 5)) >= 0)
+    {
+        o->kind = O_ACC;
+        o->num = r;
+        if (r < NACC)
+            ra->reserved[0][r] = 1;
+    }
+    else if (s[0] == ':')
+        o->kind = O_LABEL;
+    else
+    {
+        o->kind = dst ? O_IO : O_IMM;
+        for (int i = 0; !dst && i < sizeof reads / sizeof reads[0]; i++)
+            if ((int)strlen(reads[i].name) == len && strncmp(reads[i].name, s, len) == 0)
+                o->kind = reads[i].kind;
+    }
+    return 0;
+}
+
+// one operation, the text at [off, end) of line 'ln'.
+static int parse_op(ra_t *ra, int ln, int off, int end, ins_t *x, op_t *op)
+{
+    const char *l = ra->line[ln];
+    int opd_off[4], opd_len[4], nopd = 0;
+
+    while (off < end && is_space(l[off]))
+        off++;
+    int m = off;
+    while (m < end && !is_space(l[m]) && l[m] != '.')
+        m++;
+    const char *name = l + off;
+    int nname = m - off;
+
+    // modifiers: write conditions, pack modes, branch conditions, setf.
+    int partial = 0, cond = 0;
+    while (m < end && l[m] == '.')
+    {
+        int s = ++m;
+        while (m < end && !is_space(l[m]) && l[m] != '.')
+            m++;
+        if (lookup(branch_conds, l + s, m - s) >= 0)
+            cond = 1;
+        else if (!(m - s == 4 && strncmp(l + s, "setf", 4) == 0)
+            && !(m - s == 6 && strncmp(l + s, "always", 6) == 0))
+            partial = 1;
+    }
+
+    // operands, split at commas outside parentheses.
+    for (int p = m, depth = 0, s = m; p <= end; p++)
+    {
+        if (p < end && l[p] == '(')
+            depth++;
+        else if (p < end && l[p] == ')')
+            depth--;
+        else if (p == end || (l[p] == ',' && depth == 0))
+        {
+            int a = s, b = p;
+            while (a < b && is_space(l[a]))
+                a++;
+            while (b > a && is_space(l[b - 1]))
+                b--;
+            if (a < b || p < end || nopd > 0)
+            {
+                if (a == b)
+                    return fail(ra, ln, "missing operand\n");
+                if (nopd == 4)
+                    return fail(ra, ln, "too many operands\n");
+                opd_off[nopd] = a;
+                opd_len[nopd++] = b - a;
+            }
+            s = p + 1;
+        }
+    }
+
+    memset(op, 0, sizeof *op);
+    op->partial = partial;
+    if (lookup(alu2, name, nname) >= 0 || lookup(alu1, name, nname) >= 0
+        || (nname == 3 && strncmp(name, "ldi", 3) == 0))
+    {
+        int want = lookup(alu2, name, nname) >= 0 ? 3 : 2;
+        if (nopd != want)
+            return fail(ra, ln, "%.*s takes %d operands\n", nname, name, want);
+        if (parse_opd(ra, ln, opd_off[0], opd_len[0], 1, &op->dst) < 0)
+            return -1;
+        op->nsrc = want - 1;
+        for (int i = 0; i < op->nsrc; i++)
+            if (parse_opd(ra, ln, opd_off[i + 1], opd_len[i + 1], 0, &op->src[i]) < 0)
+                return -1;
+        op->kind = OP_ALU;
+        // ldi, or a mov of an immediate, which vc4asm makes a load immediate.
+        int ldi = nname == 3 && strncmp(name, "ldi", 3) == 0;
+        if (ldi && op->src[0].kind != O_IMM)
+            return fail(ra, ln, "ldi needs an immediate\n");
+        if ((ldi || (nname == 3 && strncmp(name, "mov", 3) == 0)) && op->src[0].kind == O_IMM)
+        {
+            op->kind = OP_LDI;
+            op->nsrc = 0;
+        }
+        if (op->dst.kind == O_LABEL)
+            return fail(ra, ln, "cannot write a label\n");
+        return 0;
+    }
+
+    int b = nname == 3 && (strncmp(name, "brr", 3) == 0 || strncmp(name, "bra", 3) == 0);
+    if (!b && lookup(other, name, nname) < 0)
+        return fail(ra, ln, "unknown instruction '%.*s'\n", nname, name);
+    op->kind = b ? OP_BRANCH : OP_OTHER;
+    for (int i = 0; i < nopd; i++)
+    {
+        opd_t o;
+        if (parse_opd(ra, ln, opd_off[i], opd_len[i], i == 0, &o) < 0)
+            return -1;
+        if (o.kind == O_VREG)
+            return fail(ra, ln, "%.*s cannot use virtual registers\n", nname, name);
+        if (b && i == 1)
+        {
+            if (o.kind != O_LABEL)
+                return fail(ra, ln, "branches must go to a label\n");
+            x->target = -1;
+            x->line = ln;
+            op->src[0] = o;
+        }
+    }
+    if (b)
+    {
+        if (nopd < 2)
+            return fail(ra, ln, "branch needs a target\n");
+        x->branch = 1;
+        x->cond = cond;
+    }
+    if (nname == 6 && strncmp(name, "thrend", 6) == 0)
+        x->end = 1;
+    return 0;
+}
+
+static int parse_line(ra_t *ra, int ln)
+{
+    char *l = ra->line[ln];
+    int end = strcspn(l, "#"), p = 0;
+
+    while (p < end && is_space(l[p]))
+        p++;
+    while (end > p && is_space(l[end - 1]))
+        end--;
+    if (p == end)
+        return 0;
+    if (l[p] == '.')
+    {
+        if (memchr(l + p, '%', end - p))
+            return fail(ra, ln, "virtual registers cannot be used in directives\n");
+        return 0;
+    }
+    if (l[p] == ':')
+    {
+        int e = p + 1;
+        while (e < end && is_ident(l[e]))
+            e++;
+        if (e != end || e == p + 1)
+            return fail(ra, ln, "a label goes on a line of its own\n");
+        if (ra->nlabels == MAX_LABELS || e - p - 1 >= MAX_NAME)
+            return fail(ra, ln, "too many labels, or the name is too long\n");
+        memcpy(ra->label[ra->nlabels].name, l + p + 1, e - p - 1);
+        ra->label[ra->nlabels++].at = ra->nins;
+        return 0;
+    }
+
+    if (ra->nins == QPU_RA_MAX_INS)
+        return fail(ra, ln, "more than %d instructions\n", QPU_RA_MAX_INS);
+    ins_t *x = &ra->ins[ra->nins];
+    x->line = ln;
+    int semi = p;
+    while (semi < end && l[semi] != ';')
+        semi++;
+    if (parse_op(ra, ln, p, semi, x, &x->op[0]) < 0)
+        return -1;
+    x->nop = 1;
+    if (semi < end)
+    {
+        if (memchr(l + semi + 1, ';', end - semi - 1))
+            return fail(ra, ln, "at most two operations per instruction\n");
+        if (parse_op(ra, ln, semi + 1, end, x, &x->op[1]) < 0)
+            return -1;
+        x->nop = 2;
+    }
+    ra->ins_at[ln] = ra->nins++;
+    return 0;
+}
+
+// control flow, loop depth, and the vregs each instruction reads and writes.
+static int flow(ra_t *ra)
+{
+    int n = ra->nins;
+
+    for (int i = 0; i < n; i++)
+    {
+        ins_t *x = &ra->ins[i];
+        if (x->branch)
+        {
+            const opd_t *t = &x->op[0].src[0];
+            if (x->op[0].kind != OP_BRANCH)
+                t = &x->op[1].src[0];
+            const char *name = ra->line[x->line] + t->off + 1;
+            for (int k = 0; k < ra->nlabels; k++)
+                if ((int)strlen(ra->label[k].name) == t->len - 1
+                    && strncmp(ra->label[k].name, name, t->len - 1) == 0)
+                    x->target = ra->label[k].at;
+            if (x->target < 0)
+                return fail(ra, x->line, "no label '%.*s'\n", t->len - 1, name);
+        }
+        if (x->branch || x->end)
+        {
+            int nslots = x->branch ? 3 : 2;
+            if (i + nslots >= n)
+                return fail(ra, x->line, "missing delay slots\n");
+            for (int k = 1; k <= nslots; k++)
+                if (ra->ins[i + k].branch || ra->ins[i + k].end)
+                    return fail(ra, ra->ins[i + k].line, "branch in a delay slot\n");
+                else
+                    ra->ins[i + k].slot = 1;
+        }
+
+        for (int k = 0; k < x->nop; k++)
+        {
+            op_t *op = &x->op[k];
+            for (int s = 0; s < op->nsrc; s++)
+                if (op->src[s].kind == O_VREG)
+                    set_add(&x->rd, op->src[s].num);
+            if (op->dst.kind == O_VREG)
+            {
+                set_add(&x->def, op->dst.num);
+                if (!op->partial)
+                    set_add(&x->kill, op->dst.num);
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        ins_t *x = &ra->ins[i];
+        x->nsucc = 0;
+        if (i >= 3 && ra->ins[i - 3].branch)
+        {
+            const ins_t *b = &ra->ins[i - 3];
+            x->succ[x->nsucc++] = b->target;
+            if (b->cond && i + 1 < n)
+                x->succ[x->nsucc++] = i + 1;
+            if (b->target < i + 1)
+                for (int k = b->target; k <= i; k++)
+                    ra->ins[k].depth++;
+        }
+        else if (!(i >= 2 && ra->ins[i - 2].end) && i + 1 < n)
+            x->succ[x->nsucc++] = i + 1;
+    }
+    return 0;
+}
+
+static uint64_t weight(const ins_t *x)
+{
+    return 1ull << 3 * (x->depth < MAX_DEPTH ? x->depth : MAX_DEPTH);
+}
+
+static void add_pair(ra_t *ra, int u, int v, uint64_t w)
+{
+    ra->v[u].pairs += w;
+    ra->v[v].pairs += w;
+    for (int i = 0; i < ra->npairs; i++)
+        if ((ra->pair[i].u == u && ra->pair[i].v == v) || (ra->pair[i].u == v && ra->pair[i].v == u))
+        {
+            ra->pair[i].w += w;
+            return;
+        }
+    if (ra->npairs < MAX_PAIRS)
+        ra->pair[ra->npairs++] = (pair_t){ u, v, w };
+}
+
+static int interferes(const ra_t *ra, int u, int v)
+{
+    return set_has(&ra->v[u].interf, v);
+}
+
+static int liveness(ra_t *ra)
+{
+    int n = ra->nins;
+
+    for (int changed = 1; changed;)
+    {
+        changed = 0;
+        for (int i = n - 1; i >= 0; i--)
+        {
+            ins_t *x = &ra->ins[i];
+            set_t out = { { 0 } };
+            for (int k = 0; k < x->nsucc; k++)
+                for (int w = 0; w < NWORDS; w++)
+                    out.w[w] |= ra->ins[x->succ[k]].in.w[w];
+            for (int w = 0; w < NWORDS; w++)
+            {
+                uint64_t in = x->rd.w[w] | (x->def.w[w] & ~x->kill.w[w]) | (out.w[w] & ~x->kill.w[w]);
+                changed |= in != x->in.w[w] || out.w[w] != x->out.w[w];
+                x->in.w[w] = in;
+                x->out.w[w] = out.w[w];
+            }
+        }
+    }
+    for (int v = 0; v < ra->nv; v++)
+        if (n > 0 && set_has(&ra->ins[0].in, v))
+            return fail(ra, ra->v[v].line, "%%%s may be read before it is written\n", ra->v[v].name + 1);
+
+    for (int i = 0; i < n; i++)
+    {
+        ins_t *x = &ra->ins[i];
+        for (int d = 0; d < ra->nv; d++)
+        {
+            if (set_has(&x->in, d))
+                ra->v[d].nlive++;
+            if (!set_has(&x->def, d))
+                continue;
+            for (int v = 0; v < ra->nv; v++)
+                if (v != d && (set_has(&x->out, v) || set_has(&x->def, v)))
+                {
+                    set_add(&ra->v[d].interf, v);
+                    set_add(&ra->v[v].interf, d);
+                }
+        }
+    }
+    return 0;
+}
+
+// what allocation has to get right: port conflicts and hazards.
+static void constraints(ra_t *ra)
+{
+    for (int i = 0; i < ra->nins; i++)
+    {
+        ins_t *x = &ra->ins[i];
+        uint64_t w = weight(x);
+        int fixed_a = 0, fixed_b = 0, vr[4], nvr = 0;
+
+        for (int k = 0; k < x->nop; k++)
+        {
+            const op_t *op = &x->op[k];
+            for (int s = 0; s < op->nsrc; s++)
+            {
+                const opd_t *o = &op->src[s];
+                fixed_a |= o->kind == O_A || o->kind == O_READ_A;
+                fixed_b |= o->kind == O_B || o->kind == O_READ_B || (o->kind == O_IMM && op->kind == OP_ALU);
+                int seen = 0;
+                for (int j = 0; j < nvr; j++)
+                    seen |= vr[j] == o->num;
+                if (o->kind == O_VREG && !seen)
+                    vr[nvr++] = o->num;
+            }
+        }
+        for (int j = 0; j < nvr; j++)
+        {
+            vreg_t *v = &ra->v[vr[j]];
+            v->uses += w;
+            v->not_a += fixed_a ? w : 0;
+            v->not_b += fixed_b ? w : 0;
+            for (int k = j + 1; k < nvr; k++)
+                add_pair(ra, vr[j], vr[k], w);
+        }
+
+        // both operations write: the two results go to different files.
+        if (x->nop == 2)
+        {
+            const opd_t *d0 = &x->op[0].dst, *d1 = &x->op[1].dst;
+            if (d0->kind == O_VREG && d1->kind == O_VREG)
+                add_pair(ra, d0->num, d1->num, w);
+            for (int k = 0; k < 2; k++)
+            {
+                const opd_t *d = &x->op[k].dst, *e = &x->op[!k].dst;
+                if (d->kind == O_VREG && e->kind == O_A)
+                    ra->v[d->num].not_a += w;
+                if (d->kind == O_VREG && e->kind == O_B)
+                    ra->v[d->num].not_b += w;
+            }
+        }
+
+        for (int k = 0; k < x->nsucc; k++)
+        {
+            const ins_t *y = &ra->ins[x->succ[k]];
+            for (int v = 0; v < ra->nv; v++)
+                if (set_has(&x->def, v) && set_has(&y->rd, v))
+                    ra->v[v].hazard += weight(y);
+        }
+    }
+}
+
+static uint64_t acc_cost(const vreg_t *v)
+{
+    uint64_t m = v->not_a < v->not_b ? v->not_a : v->not_b;
+    return 2 * v->hazard + v->pairs + 2 * m;
+}
+
+static int taken(const ra_t *ra, int v, int loc, int num)
+{
+    for (int u = 0; u < ra->nv; u++)
+        if (ra->v[u].loc == loc && ra->v[u].num == num && interferes(ra, u, v))
+            return 1;
+    return 0;
+}
+
+static int allocate(ra_t *ra, qpu_ra_stats_t *s)
+{
+    int order[QPU_RA_MAX_VREGS], n = ra->nv;
+
+    // accumulators: most expensive in a register file first, then shortest.
+    for (int i = 0; i < n; i++)
+    {
+        int j = i;
+        for (; j > 0; j--)
+        {
+            const vreg_t *a = &ra->v[order[j - 1]], *b = &ra->v[i];
+            if (acc_cost(a) > acc_cost(b) || (acc_cost(a) == acc_cost(b) && a->nlive <= b->nlive))
+                break;
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        vreg_t *v = &ra->v[order[i]];
+        if (acc_cost(v) == 0)
+            break;
+        for (int k = 0; k < NACC; k++)
+            if (!ra->reserved[0][k] && !taken(ra, order[i], O_ACC, k))
+            {
+                v->loc = O_ACC;
+                v->num = k;
+                s->nacc++;
+                break;
+            }
+    }
+
+    // the register files: most constrained first.
+    int nfile[2] = { 0, 0 };
+    for (int i = 0; i < n; i++)
+    {
+        int j = i;
+        for (; j > 0; j--)
+        {
+            const vreg_t *a = &ra->v[order[j - 1]], *b = &ra->v[i];
+            uint64_t ka = a->pairs + a->not_a + a->not_b, kb = b->pairs + b->not_a + b->not_b;
+            if (ka > kb || (ka == kb && a->uses >= b->uses))
+                break;
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        int vi = order[i];
+        vreg_t *v = &ra->v[vi];
+        if (v->loc == O_ACC)
+            continue;
+        uint64_t cost[2] = { v->not_a, v->not_b };
+        for (int p = 0; p < ra->npairs; p++)
+        {
+            const pair_t *q = &ra->pair[p];
+            int u = q->u == vi ? q->v : q->v == vi ? q->u : -1;
+            if (u >= 0 && ra->v[u].loc == O_A)
+                cost[0] += q->w;
+            if (u >= 0 && ra->v[u].loc == O_B)
+                cost[1] += q->w;
+        }
+        int f = cost[1] < cost[0] || (cost[1] == cost[0] && nfile[1] < nfile[0]);
+        for (int t = 0; t < 2 && !v->loc; t++, f = !f)
+            for (int r = 0; r < 32; r++)
+                if (!ra->reserved[1 + f][r] && !taken(ra, vi, f ? O_B : O_A, r))
+                {
+                    v->loc = f ? O_B : O_A;
+                    v->num = r;
+                    nfile[f]++;
+                    break;
+                }
+        if (!v->loc)
+            return fail(ra, v->line, "out of registers for %%%s\n", v->name + 1);
+    }
+    return 0;
+}
+
+// where an operand is after allocation.
+static void phys(const ra_t *ra, const opd_t *o, int *kind, int *num)
+{
+    *kind = o->kind;
+    *num = o->num;
+    if (o->kind == O_VREG)
+    {
+        *kind = ra->v[o->num].loc;
+        *num = ra->v[o->num].num;
+    }
+    if (o->fix >= 0)
+    {
+        *kind = O_ACC;
+        *num = o->fix;
+    }
+}
+
+// one read per file, two in all: move what does not fit to accumulators.
+static int fix_ports(ra_t *ra, ins_t *x, qpu_ra_stats_t *s)
+{
+    const char *l = ra->line[x->line];
+
+    for (;;)
+    {
+        int a[4], na = 0, b[4], nb = 0, nany = 0;
+        opd_t *victim_a = 0, *victim_b = 0;
+
+        for (int k = 0; k < x->nop; k++)
+        {
+            op_t *op = &x->op[k];
+            for (int i = 0; i < op->nsrc; i++)
+            {
+                opd_t *o = &op->src[i];
+                int kind, num, seen = 0;
+                phys(ra, o, &kind, &num);
+                int id = kind == O_A || kind == O_B ? num : kind == O_IMM ? 64 : 64 + o->off;
+                if (kind == O_IMM && op->kind != OP_ALU)
+                    continue;
+                if (kind == O_A || kind == O_READ_A)
+                {
+                    for (int j = 0; j < na; j++)
+                        seen |= a[j] == id;
+                    if (!seen)
+                        a[na++] = id;
+                    if (kind == O_A)
+                        victim_a = o;
+                }
+                else if (kind == O_B || kind == O_READ_B || kind == O_IMM)
+                {
+                    for (int j = 0; j < nb; j++)
+                        seen |= b[j] == id;
+                    if (!seen)
+                        b[nb++] = id;
+                    if (kind == O_B)
+                        victim_b = o;
+                }
+                else if (kind == O_READ_ANY)
+                {
+                    int dup = 0;
+                    for (int k2 = 0; k2 <= k; k2++)
+                        for (int j = 0; j < (k2 < k ? x->op[k2].nsrc : i); j++)
+                        {
+                            const opd_t *p = &x->op[k2].src[j];
+                            dup |= p->kind == O_READ_ANY && p->len == o->len && !strncmp(l + p->off, l + o->off, o->len);
+                        }
+                    nany += !dup;
+                }
+            }
+        }
+        if (na <= 1 && nb <= 1 && na + nb + nany <= 2)
+            return 0;
+
+        opd_t *victim = na > 1 ? victim_a : nb > 1 ? victim_b : victim_a ? victim_a : victim_b;
+        if (!victim)
+            return fail(ra, x->line, "these operands cannot be read in one instruction\n");
+        if (x->slot)
+            return fail(ra, x->line, "register file conflict in a delay slot\n");
+        int vk, vn;
+        phys(ra, victim, &vk, &vn);
+
+        int acc = -1;
+        for (int k = 0; k < NACC && acc < 0; k++)
+        {
+            int busy = ra->reserved[0][k];
+            for (int m = 0; m < x->nmov; m++)
+                busy |= x->mov_acc[m] == k;
+            for (int v = 0; v < ra->nv && !busy; v++)
+                busy = ra->v[v].loc == O_ACC && ra->v[v].num == k
+                    && (set_has(&x->in, v) || set_has(&x->out, v) || set_has(&x->def, v));
+            if (!busy)
+                acc = k;
+        }
+        if (acc < 0 || x->nmov == 4)
+            return fail(ra, x->line, "no free accumulator to resolve a register file conflict\n");
+        x->mov_acc[x->nmov] = acc;
+        x->mov_kind[x->nmov] = vk;
+        x->mov_num[x->nmov++] = vn;
+        s->nmovs++;
+        for (int k = 0; k < x->nop; k++)
+            for (int i = 0; i < x->op[k].nsrc; i++)
+            {
+                int kind, num;
+                phys(ra, &x->op[k].src[i], &kind, &num);
+                if (kind == vk && num == vn)
+                    x->op[k].src[i].fix = acc;
+            }
+    }
+}
+
+// does 'x' write a register file register that the first instruction
+// at 'y' (a fixing mov, or 'y' itself) reads?
+static int hazard(const ra_t *ra, const ins_t *x, const ins_t *y)
+{
+    for (int k = 0; k < x->nop; k++)
+    {
+        int wk, wn;
+        phys(ra, &x->op[k].dst, &wk, &wn);
+        if (wk != O_A && wk != O_B)
+            continue;
+        if (y->nmov)
+        {
+            if (y->mov_kind[0] == wk && y->mov_num[0] == wn)
+                return 1;
+            continue;
+        }
+        for (int j = 0; j < y->nop; j++)
+            for (int i = 0; i < y->op[j].nsrc; i++)
+            {
+                int rk, rn;
+                phys(ra, &y->op[j].src[i], &rk, &rn);
+                if (rk == wk && rn == wn)
+                    return 1;
+            }
+    }
+    return 0;
+}
+
+static int fix_hazards(ra_t *ra, qpu_ra_stats_t *s)
+{
+    for (int i = 0; i < ra->nins; i++)
+    {
+        ins_t *x = &ra->ins[i];
+        for (int k = 0; k < x->nsucc; k++)
+        {
+            int j = x->succ[k];
+            ins_t *y = &ra->ins[j];
+            if (!hazard(ra, x, y))
+                continue;
+            if (y->slot)
+                return fail(ra, y->line, "a delay slot reads a register written just before it\n");
+            if (j == i + 1 && !x->nop_after)
+            {
+                x->nop_after = 1;
+                s->nnops++;
+            }
+            else if (j != i + 1 && !y->nop_before)
+            {
+                y->nop_before = 1;
+                s->nnops++;
+            }
+        }
+    }
+    return 0;
+}
+
+typedef struct buf
+{
+    char *p;
+    size_t n, max;
+} buf_t;
+
+static void put(buf_t *b, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->p + b->n, b->n < b->max ? b->max - b->n : 0, fmt, ap);
+    va_end(ap);
+    b->n += n;
+}
+
+static const char *reg_name(int kind, int num, char *s)
+{
+    sprintf(s, "%s%d", kind == O_A ? "ra" : kind == O_B ? "rb" : "r", num);
+    return s;
+}
+
+static void emit(const ra_t *ra, buf_t *b)
+{
+    char name[8];
+
+    put(b, "# registers (host/regalloc):");
+    for (int v = 0, col = 80; v < ra->nv; v++, col++)
+    {
+        if (col >= 6)
+        {
+            put(b, "\n#  ");
+            col = 0;
+        }
+        put(b, " %s=%s", ra->v[v].name, reg_name(ra->v[v].loc, ra->v[v].num, name));
+    }
+    put(b, "\n");
+
+    for (int ln = 0; ln < ra->nlines; ln++)
+    {
+        const char *l = ra->line[ln];
+        int i = ra->ins_at[ln];
+        if (i < 0)
+        {
+            put(b, "%s\n", l);
+            continue;
+        }
+
+        const ins_t *x = &ra->ins[i];
+        int indent = 0;
+        while (is_space(l[indent]))
+            indent++;
+        if (x->nop_before)
+            put(b, "%.*snop # regalloc: regfile write read next\n", indent, l);
+        for (int m = 0; m < x->nmov; m++)
+            put(b, "%.*smov r%d, %s # regalloc: regfile conflict\n", indent, l, x->mov_acc[m],
+                reg_name(x->mov_kind[m], x->mov_num[m], name));
+
+        // the line with each operand that changed replaced, in order.
+        const opd_t *o[6];
+        int no = 0, at = 0;
+        for (int k = 0; k < x->nop; k++)
+        {
+            if (x->op[k].dst.kind == O_VREG)
+                o[no++] = &x->op[k].dst;
+            for (int j = 0; j < x->op[k].nsrc; j++)
+                if (x->op[k].src[j].kind == O_VREG || x->op[k].src[j].fix >= 0)
+                    o[no++] = &x->op[k].src[j];
+        }
+        for (int j = 0; j < no; j++)
+        {
+            int kind, num;
+            phys(ra, o[j], &kind, &num);
+            put(b, "%.*s%s", o[j]->off - at, l + at, reg_name(kind, num, name));
+            at = o[j]->off + o[j]->len;
+        }
+        put(b, "%s\n", l + at);
+
+        if (x->nop_after)
+            put(b, "%.*snop # regalloc: regfile write read next\n", indent, l);
+    }
+}
+
+int qpu_regalloc(const char *src, char *out, size_t max_out, qpu_ra_stats_t *s,
+    char *err, size_t max_err)
+{
+    ra_t *ra = calloc(1, sizeof *ra);
+    int r = -1;
+
+    memset(s, 0, sizeof *s);
+    if (max_err)
+        err[0] = 0;
+    if (!ra || !(ra->text = strdup(src)))
+    {
+        snprintf(err, max_err, "out of memory\n");
+        goto done;
+    }
+    ra->err = err;
+    ra->max_err = max_err;
+
+    for (char *p = ra->text; p;)
+    {
+        if (ra->nlines == MAX_LINES)
+        {
+            fail(ra, -1, "more than %d lines\n", MAX_LINES);
+            goto done;
+        }
+        char *nl = strchr(p, '\n');
+        if (nl)
+            *nl = 0;
+        // a final newline does not start another line.
+        if (nl || *p)
+        {
+            ra->ins_at[ra->nlines] = -1;
+            ra->line[ra->nlines++] = p;
+        }
+        p = nl ? nl + 1 : 0;
+    }
+    for (int ln = 0; ln < ra->nlines; ln++)
+        if (parse_line(ra, ln) < 0)
+            goto done;
+    if (flow(ra) < 0 || liveness(ra) < 0)
+        goto done;
+    constraints(ra);
+    if (allocate(ra, s) < 0)
+        goto done;
+    for (int i = 0; i < ra->nins; i++)
+        if (fix_ports(ra, &ra->ins[i], s) < 0)
+            goto done;
+    if (fix_hazards(ra, s) < 0)
+        goto done;
+
+    buf_t b = { out, 0, max_out };
+    emit(ra, &b);
+    if (b.n >= max_out)
+    {
+        fail(ra, -1, "output does not fit in %zu bytes\n", max_out);
+        goto done;
+    }
+    s->nins = ra->nins;
+    s->nvregs = ra->nv;
+    r = 0;
+done:
+    if (ra)
+        free(ra->text);
+    free(ra);
+    return r;
+}
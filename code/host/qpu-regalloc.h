@@ -0,0 +1,52 @@
+#ifndef __QPU_REGALLOC_H__
+#define __QPU_REGALLOC_H__
+/*
+ * Register allocator for QPU assembly written with virtual registers.
+ *
+ * The input is vc4asm source in which an operand may be a virtual register,
+ * %name, instead of r0-r3, raN or rbN.  The output is the same source with
+ * each one replaced by an accumulator or a register in file A or B, ready
+ * for vc4asm:
+ *
+ *   - liveness follows the control flow (a branch takes effect after its
+ *     three delay slots, thrend ends the program two instructions later);
+ *     values live at the same time get different registers, and a
+ *     conditional or packed write keeps the old value alive;
+ *   - accumulators go to the values that would cost most in a register
+ *     file, weighted by loop depth: those read by the very next
+ *     instruction (a regfile write is not visible there yet) and those
+ *     read together with other values;
+ *   - the rest are split between file A and B so that the values one
+ *     instruction reads, and a value read next to elem_num, qpu_num or a
+ *     small immediate, come from different files;
+ *   - an instruction that still reads two registers from one file gets a
+ *     mov through a free accumulator before it, and a regfile write read by
+ *     the next instruction gets a nop in between.  Physical registers the
+ *     source names are kept, and no value is allocated to them, but they
+ *     are covered by these two fixes as well.
+ *
+ * Labels, directives and comments are copied through, so the output
+ * lines up with the input.
+ */
+#include <stddef.h>
+
+#define QPU_RA_MAX_INS 1024     // instructions
+#define QPU_RA_MAX_VREGS 256    // virtual registers
+
+typedef struct qpu_ra_stats
+{
+    unsigned nins;              // instructions in the input
+    unsigned nvregs;            // virtual registers
+    unsigned nacc;              // ... given an accumulator
+    unsigned nmovs, nnops;      // instructions added
+} qpu_ra_stats_t;
+
+/*
+ * Allocate registers for the NUL-terminated source 'src' and write the
+ * result to 'out', which has room for 'max_out' bytes.  Returns 0, or -1
+ * with a message ("line N: ...") in 'err'.
+ */
+int qpu_regalloc(const char *src, char *out, size_t max_out, qpu_ra_stats_t *s,
+    char *err, size_t max_err);
+
+#endif
@@ -0,0 +1,146 @@
+#include "rpi.h"
+#include "host-mem.h"
+#include "qpu-replay.h"
+
+// the timing model's mem callback has no context: the replay being run.
+static qpu_replay_t *cur;
+
+static void *mem(uint32_t bus)
+{
+    uint32_t off = (bus & ~GPU_ALIAS_MASK) - (cur->h.bus & ~GPU_ALIAS_MASK);
+    return off < 4 * cur->h.nwords ? (uint8_t *)cur->mem + off : NULL;
+}
+
+// decode one copy of the memory from the runs at *p; 0 or -1.
+static int get_runs(const uint32_t **p, const uint32_t *end, uint32_t *w, uint32_t n)
+{
+    const uint32_t *in = *p;
+
+    for (uint32_t i = 0; i < n;)
+    {
+        if (end - in < 2)
+            return -1;
+        uint32_t z = in[0], lit = in[1];
+        in += 2;
+        if (z > n - i || lit > n - i - z || (uint32_t)(end - in) < lit)
+            return -1;
+        memset(w + i, 0, 4 * z);
+        memcpy(w + i + z, in, 4 * lit);
+        in += lit;
+        i += z + lit;
+    }
+    *p = in;
+    return 0;
+}
+
+static int bad(qpu_replay_t *r, const char *why)
+{
+    snprintf(r->err, sizeof r->err, "%s", why);
+    return -1;
+}
+
+static int load(qpu_replay_t *r, const void *buf, uint32_t len)
+{
+    gpu_capture_t *h = &r->h;
+
+    if (len < sizeof *h)
+        return bad(r, "truncated header");
+    memcpy(h, buf, sizeof *h);
+    if (h->magic != GPU_CAPTURE_MAGIC)
+        return bad(r, "not a capture");
+    if (h->version != GPU_CAPTURE_VERSION)
+        return bad(r, "unknown capture version");
+    if (h->num_qpus < 1 || h->num_qpus > V3D_NUM_QPUS || h->nwords > HOST_MEM_SIZE / 4)
+        return bad(r, "bad header");
+
+    const uint32_t *p = (const uint32_t *)((const uint8_t *)buf + sizeof *h);
+    const uint32_t *end = (const uint32_t *)((const uint8_t *)buf + (len & ~3u));
+    r->before = malloc(4 * h->nwords + 4);
+    r->mem = malloc(4 * h->nwords + 4);
+    if (!r->before || !r->mem)
+        return bad(r, "out of memory");
+    if (get_runs(&p, end, r->before, h->nwords) < 0)
+        return bad(r, "truncated memory");
+    if (h->has_result)
+    {
+        if (!(r->after = malloc(4 * h->nwords + 4)))
+            return bad(r, "out of memory");
+        if (get_runs(&p, end, r->after, h->nwords) < 0)
+            return bad(r, "truncated result");
+    }
+    if (p != end)
+        return bad(r, "trailing bytes");
+
+    cur = r;
+    if (!mem(h->code))
+        return bad(r, "code is not in the captured memory");
+    for (unsigned q = 0; q < h->num_qpus; q++)
+        if (!mem(h->unif[q]))
+            return bad(r, "uniforms are not in the captured memory");
+    return 0;
+}
+
+qpu_replay_t *qpu_replay_load(const void *buf, uint32_t len)
+{
+    qpu_replay_t *r = calloc(1, sizeof *r);
+    if (!r)
+        panic("out of memory\n");
+    load(r, buf, len);
+    return r;
+}
+
+int qpu_replay_run(qpu_replay_t *r)
+{
+    if (r->err[0])
+        return -1;
+    memcpy(r->mem, r->before, 4 * r->h.nwords);
+    cur = r;
+    qpu_timing_init(&r->t, mem);
+
+    // without its length the code may run to the end of the memory.
+    uint32_t nbytes = r->h.code_bytes;
+    if (!nbytes)
+        nbytes = 4 * r->h.nwords - ((r->h.code & ~GPU_ALIAS_MASK) - (r->h.bus & ~GPU_ALIAS_MASK));
+    if (qpu_timing_run(&r->t, r->h.code, nbytes, r->h.unif, r->h.num_qpus) < 0)
+        return bad(r, r->t.emu.err);
+
+    r->ndiff = r->first_diff = 0;
+    for (uint32_t i = 0; r->after && i < r->h.nwords; i++)
+        if (r->mem[i] != r->after[i] && !r->ndiff++)
+            r->first_diff = r->h.bus + 4 * i;
+    return 0;
+}
+
+void qpu_replay_report(qpu_replay_t *r)
+{
+    printk("%u QPUs, code at %x, %u words of memory at %x\n",
+        r->h.num_qpus, r->h.code, r->h.nwords, r->h.bus);
+    qpu_timing_report(&r->t);
+    if (!r->after)
+    {
+        printk("no result captured: nothing to compare\n");
+        return;
+    }
+    if (!r->ndiff)
+    {
+        printk("memory matches the capture\n");
+        return;
+    }
+    printk("%u words differ from the capture, the first at %x:\n", r->ndiff, r->first_diff);
+    for (uint32_t i = 0, n = 0; i < r->h.nwords && n < 8; i++)
+        if (r->mem[i] != r->after[i])
+        {
+            printk("  %x: replay %08x, captured %08x\n", r->h.bus + 4 * i, r->mem[i], r->after[i]);
+            n++;
+        }
+}
+
+void qpu_replay_free(qpu_replay_t *r)
+{
+    if (cur == r)
+        cur = NULL;
+    free(r->before);
+    free(r->after);
+    free(r->mem);
+    free(r);
+}
@@ -0,0 +1,45 @@
+#ifndef __QPU_REPLAY_H__
+#define __QPU_REPLAY_H__
+/*
+ * Replay of a launch captured on the Pi (gpu-capture.h): the captured
+ * memory is put back at its bus addresses, the program runs on the timing
+ * model (qpu-timing.h) with the captured uniforms, and what it leaves in
+ * memory is compared word for word with what the Pi's QPUs left.  The
+ * model is deterministic, so a capture replays to the same cycle counts
+ * every time and can be profiled and bisected off the Pi.
+ *
+ *	qpu_replay_t *r = qpu_replay_load(buf, len);
+ *	if (!r->err[0] && qpu_replay_run(r) == 0)
+ *	    qpu_replay_report(r);
+ *	qpu_replay_free(r);
+ */
+#include <stdint.h>
+#include "gpu-capture.h"
+#include "qpu-timing.h"
+
+typedef struct qpu_replay
+{
+    gpu_capture_t h;
+    uint32_t *before;       // h.nwords as captured before the launch
+    uint32_t *after;        // and after it, or NULL if not captured
+    uint32_t *mem;          // the replay's memory
+    qpu_timing_t t;
+
+    // results of the last run.
+    uint32_t ndiff;         // words that differ from 'after'
+    uint32_t first_diff;    // bus address of the first one
+    char err[160];          // why loading or running failed, or ""
+} qpu_replay_t;
+
+// Decode the capture in buf[0..len).  Never NULL; r->err says if it is bad.
+qpu_replay_t *qpu_replay_load(const void *buf, uint32_t len);
+
+// Run the captured launch from the captured memory; 0 or -1 (see r->err).
+int qpu_replay_run(qpu_replay_t *r);
+
+// Print the timing report (qpu_timing_report) and the differences.
+void qpu_replay_report(qpu_replay_t *r);
+
+void qpu_replay_free(qpu_replay_t *r);
+
+#endif
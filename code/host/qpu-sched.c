@@ -0,0 +1,661 @@
+#include "rpi.h"
+#include "qpu-isa.h"
+#include "qpu-sched.h"
+
+// registers, for dependences: ra0-31, rb0-31, r0-r5, the flags.
+#define RES_A 0
+#define RES_B 32
+#define RES_ACC 64
+#define RES_FLAGS 70
+#define NRES 71
+
+#define IO_SPACING 3    // original I/O spacing kept, up to this
+
+enum
+{
+    K_ALU = 0,  // plain ALU instruction: can be split and merged
+    K_LDI,      // load immediate: moved as a unit
+    K_FIXED,    // any other signal, pack/unpack, rotation: moved as a unit
+};
+
+// one pipe's operation
+typedef struct pipe_op
+{
+    uint8_t op;         // QPU_A_* / QPU_M_*; QPU_A_NOP: unused
+    uint8_t a, b;       // input muxes
+    uint8_t cond;
+    uint8_t waddr;
+    uint8_t file;       // regfile written: 0 A, 1 B
+} pipe_op_t;
+
+typedef struct ins
+{
+    int kind;
+    uint64_t raw;       // K_LDI, K_FIXED
+    uint8_t sig;        // K_ALU: QPU_SIG_NONE or QPU_SIG_SMALL_IMM
+    uint8_t raddr_a, raddr_b;
+    uint8_t sf;         // set by the add op if there is one, else the mul op
+    pipe_op_t add, mul;
+} ins_t;
+
+typedef struct node
+{
+    ins_t x;
+    int orig;           // index in the input
+    int io;
+    uint8_t rd[NRES], wr[NRES];
+    uint8_t lat[NRES];  // instructions until each write can be read
+    int earliest;       // first output instruction it may go in
+    int tail;           // instructions it needs before the block ends
+    int height;         // critical path to the end of the block
+    int pos;            // output instruction, or -1
+} node_t;
+
+typedef struct sched
+{
+    node_t n[QPU_SCHED_MAX_BLOCK];
+    int nn;
+    int8_t lat[QPU_SCHED_MAX_BLOCK][QPU_SCHED_MAX_BLOCK];  // -1: independent
+    ins_t out[2 * QPU_SCHED_MAX_BLOCK + 8];
+    int nops[2 * QPU_SCHED_MAX_BLOCK + 8];   // operations in each
+} sched_t;
+
+static const pipe_op_t unused = { QPU_A_NOP, 0, 0, QPU_COND_NEVER, QPU_W_NOP, 0 };
+
+// reads with side effects: uniforms, VPM, DMA waits, the mutex.
+static int io_read(uint32_t raddr)
+{
+    return raddr >= 32 && raddr != QPU_R_ELEM_QPU && raddr != QPU_R_NOP;
+}
+
+// write addresses that mean different things in regfile A and B.
+static int file_specific(uint32_t waddr)
+{
+    return waddr < 32 || waddr == QPU_W_R5 || waddr == 41 || waddr == 42
+        || waddr == QPU_W_VPM_SETUP || waddr == QPU_W_VPM_ADDR;
+}
+
+static int uses_mux(const ins_t *x, uint32_t mux)
+{
+    return (x->add.op && (x->add.a == mux || x->add.b == mux))
+        || (x->mul.op && (x->mul.a == mux || x->mul.b == mux));
+}
+
+static void decode(uint64_t raw, ins_t *x)
+{
+    uint32_t sig = QPU_SIG(raw);
+    int ws = QPU_WS(raw);
+
+    memset(x, 0, sizeof *x);
+    x->raw = raw;
+    x->sig = sig;
+    x->raddr_a = QPU_RADDR_A(raw);
+    x->raddr_b = QPU_RADDR_B(raw);
+    x->sf = QPU_SF(raw);
+    x->add = (pipe_op_t){ QPU_OP_ADD(raw), QPU_ADD_A(raw), QPU_ADD_B(raw), QPU_COND_ADD(raw), QPU_WADDR_ADD(raw), ws };
+    x->mul = (pipe_op_t){ QPU_OP_MUL(raw), QPU_MUL_A(raw), QPU_MUL_B(raw), QPU_COND_MUL(raw), QPU_WADDR_MUL(raw), !ws };
+
+    if (sig == QPU_SIG_LOAD_IMM)
+    {
+        x->kind = K_LDI;
+        return;
+    }
+    if ((sig != QPU_SIG_NONE && sig != QPU_SIG_SMALL_IMM) || QPU_UNPACK(raw) || QPU_PM(raw) || QPU_PACK(raw)
+        || (sig == QPU_SIG_SMALL_IMM && x->raddr_b >= 48))
+    {
+        x->kind = K_FIXED;
+        return;
+    }
+    x->kind = K_ALU;
+
+    // drop what has no effect, so it does not tie up a pipe or a read port.
+    if (x->add.op && x->add.waddr == QPU_W_NOP && !x->sf)
+        x->add.op = QPU_A_NOP;
+    if (x->mul.op && x->mul.waddr == QPU_W_NOP && !(x->sf && !x->add.op))
+        x->mul.op = QPU_M_NOP;
+    if (!x->add.op && !x->mul.op)
+        x->sf = 0;
+    if (!x->add.op)
+        x->add = unused;
+    if (!x->mul.op)
+        x->mul = unused;
+    if (!io_read(x->raddr_a) && !uses_mux(x, QPU_MUX_A))
+        x->raddr_a = QPU_R_NOP;
+    if (!uses_mux(x, QPU_MUX_B) && (sig == QPU_SIG_SMALL_IMM || !io_read(x->raddr_b)))
+    {
+        x->sig = QPU_SIG_NONE;
+        x->raddr_b = QPU_R_NOP;
+    }
+}
+
+static uint64_t encode(const ins_t *x)
+{
+    if (x->kind != K_ALU)
+        return x->raw;
+
+    int ws = x->add.op ? x->add.file : x->mul.op ? !x->mul.file : 0;
+    uint32_t hi = (uint32_t)x->sig << 28 | x->add.cond << 17 | x->mul.cond << 14 | x->sf << 13 | ws << 12
+        | x->add.waddr << 6 | x->mul.waddr;
+    uint32_t lo = (uint32_t)x->mul.op << 29 | x->add.op << 24 | x->raddr_a << 18 | x->raddr_b << 12
+        | x->add.a << 9 | x->add.b << 6 | x->mul.a << 3 | x->mul.b;
+    return QPU_INS(lo, hi);
+}
+
+static int is_nop(const ins_t *x)
+{
+    return x->kind == K_ALU && !x->add.op && !x->mul.op && x->sig == QPU_SIG_NONE
+        && x->raddr_a == QPU_R_NOP && x->raddr_b == QPU_R_NOP;
+}
+
+//
+// Dependences.
+//
+
+static void use_read(node_t *n, int file_b, uint32_t raddr)
+{
+    if (raddr < 32)
+        n->rd[(file_b ? RES_B : RES_A) + raddr] = 1;
+    else if (io_read(raddr))
+        n->io = 1;
+}
+
+static void use_write(node_t *n, int file_b, uint32_t waddr, uint32_t cond)
+{
+    int r = -1, lat = 1;
+
+    if (waddr < 32)
+    {
+        // the regfile result is not there for the next instruction.
+        r = (file_b ? RES_B : RES_A) + waddr;
+        lat = 2;
+    }
+    else if (waddr >= QPU_W_R0 && waddr <= QPU_W_R3)
+        r = RES_ACC + waddr - QPU_W_R0;
+    else if (waddr != QPU_W_NOP)
+    {
+        n->io = 1;
+        if (waddr == QPU_W_R5)
+            r = RES_ACC + 5;
+        else if (waddr >= QPU_W_SFU_RECIP && waddr <= QPU_W_SFU_LOG)
+        {
+            r = RES_ACC + 4;
+            lat = 3;
+        }
+    }
+    if (r < 0)
+        return;
+    n->wr[r] = 1;
+    n->lat[r] = lat;
+    // a conditional write keeps the old value in some lanes.
+    if (cond != QPU_COND_ALWAYS && cond != QPU_COND_NEVER)
+    {
+        n->rd[r] = 1;
+        n->rd[RES_FLAGS] = 1;
+    }
+}
+
+static void use_op(node_t *n, const pipe_op_t *p)
+{
+    if (!p->op)
+        return;
+    if (p->a < QPU_MUX_A)
+        n->rd[RES_ACC + p->a] = 1;
+    if (p->b < QPU_MUX_A)
+        n->rd[RES_ACC + p->b] = 1;
+    use_write(n, p->file, p->waddr, p->cond);
+}
+
+static void uses(node_t *n)
+{
+    const ins_t *x = &n->x;
+
+    memset(n->rd, 0, sizeof n->rd);
+    memset(n->wr, 0, sizeof n->wr);
+    n->io = x->kind == K_FIXED;
+    if (x->sf)
+    {
+        n->wr[RES_FLAGS] = 1;
+        n->lat[RES_FLAGS] = 1;
+    }
+
+    if (x->kind == K_LDI)
+    {
+        n->io |= QPU_LDI_MODE(x->raw) == QPU_LDI_SEMA || QPU_PACK(x->raw);
+        use_write(n, x->add.file, x->add.waddr, x->add.cond);
+        use_write(n, x->mul.file, x->mul.waddr, x->mul.cond);
+        return;
+    }
+    use_read(n, 0, x->raddr_a);
+    if (QPU_SIG(x->raw) != QPU_SIG_SMALL_IMM)
+        use_read(n, 1, x->raddr_b);
+    use_op(n, &x->add);
+    use_op(n, &x->mul);
+    if (QPU_SIG(x->raw) == QPU_SIG_LOAD_TMU0 || QPU_SIG(x->raw) == QPU_SIG_LOAD_TMU1)
+    {
+        n->wr[RES_ACC + 4] = 1;
+        n->lat[RES_ACC + 4] = 1;
+    }
+    if (x->kind != K_FIXED)
+        return;
+    // packs merge into the old value; pm unpacks r4.
+    for (int r = 0; r < NRES; r++)
+        n->rd[r] |= n->wr[r];
+    n->rd[RES_ACC + 4] |= QPU_PM(x->raw);
+}
+
+static int max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+static int min(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+static void dependences(sched_t *s)
+{
+    for (int i = 0; i < s->nn; i++)
+        for (int j = i + 1; j < s->nn; j++)
+        {
+            node_t *a = &s->n[i], *b = &s->n[j];
+            int l = -1;
+
+            for (int r = 0; r < NRES; r++)
+            {
+                if (a->wr[r] && b->rd[r])
+                    l = max(l, a->lat[r]);
+                // reads happen before writes in one instruction.
+                if (a->rd[r] && b->wr[r])
+                    l = max(l, 0);
+                if (a->wr[r] && b->wr[r])
+                    l = max(l, 1);
+            }
+            if (a->io && b->io)
+                l = max(l, min(b->orig - a->orig, IO_SPACING));
+            s->lat[i][j] = l;
+            s->lat[j][i] = -1;
+        }
+}
+
+//
+// Putting operations together.
+//
+
+// a mov on one pipe as the same mov on the other: or x, x <-> v8min x, x.
+static int swap_pipes(ins_t *x)
+{
+    if (x->sf)
+        return 0;
+    if (x->add.op == QPU_A_OR && x->add.a == x->add.b && !x->mul.op)
+    {
+        x->mul = x->add;
+        x->mul.op = QPU_M_V8MIN;
+        x->add = unused;
+        return 1;
+    }
+    if ((x->mul.op == QPU_M_V8MIN || x->mul.op == QPU_M_V8MAX) && x->mul.a == x->mul.b && !x->add.op)
+    {
+        x->add = x->mul;
+        x->add.op = QPU_A_OR;
+        x->mul = unused;
+        return 1;
+    }
+    return 0;
+}
+
+// what the B read port is used for: -1 nothing, else raddr or 0x100|immediate.
+static int b_port(const ins_t *x)
+{
+    if (x->sig == QPU_SIG_SMALL_IMM)
+        return 0x100 | x->raddr_b;
+    return x->raddr_b == QPU_R_NOP ? -1 : x->raddr_b;
+}
+
+static int merge2(const ins_t *a, const ins_t *b, ins_t *m)
+{
+    if ((a->add.op && b->add.op) || (a->mul.op && b->mul.op) || (a->sf && b->sf))
+        return 0;
+    *m = *a;
+    m->add = a->add.op ? a->add : b->add;
+    m->mul = a->mul.op ? a->mul : b->mul;
+    m->sf = a->sf | b->sf;
+    // flags come from the add op whenever there is one.
+    if (m->sf && m->add.op && !(a->sf ? a : b)->add.op)
+        return 0;
+
+    if (a->raddr_a != QPU_R_NOP && b->raddr_a != QPU_R_NOP
+        && (a->raddr_a != b->raddr_a || io_read(a->raddr_a)))
+        return 0;
+    m->raddr_a = a->raddr_a != QPU_R_NOP ? a->raddr_a : b->raddr_a;
+
+    int pa = b_port(a), pb = b_port(b);
+    if (pa >= 0 && pb >= 0 && (pa != pb || (pa < 0x100 && io_read(pa))))
+        return 0;
+    const ins_t *bsrc = pa >= 0 ? a : b;
+    m->sig = bsrc->sig;
+    m->raddr_b = bsrc->raddr_b;
+
+    // one ws bit: the two results go to different register files.
+    if (m->add.op && m->mul.op)
+    {
+        if (m->add.waddr == m->mul.waddr && m->add.waddr != QPU_W_NOP)
+            return 0;
+        if (m->add.file == m->mul.file)
+        {
+            if (!file_specific(m->add.waddr))
+                m->add.file = !m->add.file;
+            else if (!file_specific(m->mul.waddr))
+                m->mul.file = !m->mul.file;
+            else
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int merge(ins_t *cur, const ins_t *x)
+{
+    ins_t a[2] = { *cur, *cur }, b[2] = { *x, *x }, m;
+    int na = 1 + swap_pipes(&a[1]), nb = 1 + swap_pipes(&b[1]);
+
+    if (cur->kind != K_ALU || x->kind != K_ALU)
+        return 0;
+    for (int i = 0; i < na; i++)
+        for (int j = 0; j < nb; j++)
+            if (merge2(&a[i], &b[j], &m))
+            {
+                *cur = m;
+                return 1;
+            }
+    return 0;
+}
+
+//
+// Scheduling one block.
+//
+
+static int ready(sched_t *s, int j, int at)
+{
+    node_t *n = &s->n[j];
+
+    if (n->pos >= 0 || at < n->earliest)
+        return 0;
+    for (int i = 0; i < j; i++)
+        if (s->lat[i][j] >= 0 && (s->n[i].pos < 0 || s->n[i].pos + s->lat[i][j] > at))
+            return 0;
+    return 1;
+}
+
+// best ready node that fits in 'cur' (or any, if cur is NULL).
+static int pick(sched_t *s, int at, const ins_t *cur)
+{
+    int best = -1;
+
+    for (int j = 0; j < s->nn; j++)
+    {
+        ins_t m = cur ? *cur : s->n[j].x;
+        if (!ready(s, j, at) || (cur && !merge(&m, &s->n[j].x)))
+            continue;
+        if (best < 0 || s->n[j].height > s->n[best].height)
+            best = j;
+    }
+    return best;
+}
+
+static const ins_t nop_ins = {
+    .kind = K_ALU, .sig = QPU_SIG_NONE, .raddr_a = QPU_R_NOP, .raddr_b = QPU_R_NOP,
+    .add = { QPU_A_NOP, 0, 0, QPU_COND_NEVER, QPU_W_NOP, 0 },
+    .mul = { QPU_M_NOP, 0, 0, QPU_COND_NEVER, QPU_W_NOP, 0 },
+};
+
+// list-schedule the block's nodes into s->out; returns the instruction count.
+static int list_schedule(sched_t *s)
+{
+    int left = s->nn, len = 0;
+
+    while (left)
+    {
+        int j = pick(s, len, NULL);
+        s->out[len] = nop_ins;
+        s->nops[len] = 0;
+        if (j >= 0)
+        {
+            s->out[len] = s->n[j].x;
+            s->n[j].pos = len;
+            s->nops[len] = 1;
+            left--;
+            while ((j = pick(s, len, &s->out[len])) >= 0)
+            {
+                merge(&s->out[len], &s->n[j].x);
+                s->n[j].pos = len;
+                s->nops[len]++;
+                left--;
+            }
+        }
+        len++;
+    }
+    return len;
+}
+
+/*
+ * Schedule instructions [start, end) of 'in'; 'br' is the index of the
+ * branch ending the block, or -1.  Appends to 'out' at *nout, with the
+ * branch's input index in 'from' (-1 for everything else); returns 0,
+ * 1 if the block has to be copied as it is, -1 if 'out' is full.
+ */
+static int sched_block(sched_t *s, const uint64_t *in, int start, int end, int br,
+    uint64_t *out, int *from, unsigned *nout, unsigned max_out, qpu_sched_stats_t *st)
+{
+    int body_end = br >= 0 ? br : end;
+    int dropped = 0;
+
+    s->nn = 0;
+    for (int i = start; i < body_end; i++)
+    {
+        ins_t x;
+        decode(in[i], &x);
+        if (is_nop(&x))
+        {
+            dropped++;
+            continue;
+        }
+        if (s->nn == QPU_SCHED_MAX_BLOCK)
+            return 1;
+        node_t *n = &s->n[s->nn];
+        n->x = x;
+        n->orig = i;
+        n->pos = -1;
+        uses(n);
+        n->earliest = n->io ? min(i - start, IO_SPACING) : 0;
+        n->tail = n->io ? min(end - i, IO_SPACING) : 0;
+        for (int r = 0; r < NRES; r++)
+            if (n->wr[r])
+                n->tail = max(n->tail, n->lat[r]);
+        s->nn++;
+    }
+
+    // branches that link, and work already in the delay slots, stay put.
+    int br_flags = 0;
+    if (br >= 0)
+    {
+        if (QPU_WADDR_ADD(in[br]) != QPU_W_NOP || QPU_WADDR_MUL(in[br]) != QPU_W_NOP)
+            return 1;
+        for (int i = br + 1; i < end; i++)
+        {
+            ins_t x;
+            decode(in[i], &x);
+            if (!is_nop(&x))
+                return 1;
+            dropped++;
+        }
+        br_flags = QPU_BR_COND(in[br]) != QPU_BR_ALWAYS;
+    }
+
+    dependences(s);
+    for (int i = s->nn - 1; i >= 0; i--)
+    {
+        node_t *n = &s->n[i];
+        n->height = n->tail;
+        for (int j = i + 1; j < s->nn; j++)
+            if (s->lat[i][j] >= 0)
+                n->height = max(n->height, s->lat[i][j] + s->n[j].height);
+        // the branch and its delay slots wait for the flags.
+        if (br_flags && n->wr[RES_FLAGS])
+            n->height = max(n->height, 1 + 1 + QPU_BRANCH_DELAY);
+    }
+
+    int len = list_schedule(s);
+    int total = len, at = len;
+
+    if (br >= 0)
+    {
+        // the branch goes as early as its flags and the delay slots allow.
+        int ready_at = 0;
+        for (int i = 0; i < s->nn; i++)
+            if (br_flags && s->n[i].wr[RES_FLAGS])
+                ready_at = max(ready_at, s->n[i].pos + 1);
+        for (at = max(ready_at, max(len - QPU_BRANCH_DELAY, 0)); at < len; at++)
+        {
+            int ok = 1;
+            for (int i = 0; i < s->nn; i++)
+                if (s->n[i].pos + (s->n[i].pos >= at) + s->n[i].tail > at + 1 + QPU_BRANCH_DELAY)
+                    ok = 0;
+            if (ok)
+                break;
+        }
+        total = max(at, len) + 1 + QPU_BRANCH_DELAY;
+        st->nslots += max(len - at, 0);
+    }
+    else
+    {
+        // results are ready before the next block starts.
+        for (int i = 0; i < s->nn; i++)
+            total = max(total, s->n[i].pos + s->n[i].tail);
+    }
+    if (*nout + total > max_out)
+        return -1;
+
+    for (int i = 0; i < total; i++)
+    {
+        int k = br >= 0 && i > at ? i - 1 : i;
+        uint64_t w;
+        from[*nout] = -1;
+        if (br >= 0 && i == at)
+        {
+            w = in[br];
+            from[*nout] = br;
+        }
+        else if (k < len)
+        {
+            w = encode(&s->out[k]);
+            st->npaired += s->nops[k] > 1;
+        }
+        else
+            w = encode(&nop_ins);
+        out[(*nout)++] = w;
+    }
+    st->nnops += dropped;
+    return 0;
+}
+
+//
+// The whole program.
+//
+
+int qpu_sched(const uint32_t *in, unsigned n, uint32_t *out, unsigned max_out, qpu_sched_stats_t *st)
+{
+    static uint64_t ins[QPU_SCHED_MAX_INS + 1], res[QPU_SCHED_MAX_INS];
+    static int leader[QPU_SCHED_MAX_INS + 1], new_at[QPU_SCHED_MAX_INS + 1];
+    static int target[QPU_SCHED_MAX_INS], from[QPU_SCHED_MAX_INS];
+    static sched_t s;
+    unsigned nout = 0, end = n;
+
+    memset(st, 0, sizeof *st);
+    st->nin = n;
+    if (n > QPU_SCHED_MAX_INS)
+        goto verbatim;
+
+    memset(leader, 0, sizeof leader);
+    leader[0] = leader[n] = 1;
+    for (unsigned i = 0; i < n; i++)
+    {
+        ins[i] = QPU_INS(in[2 * i], in[2 * i + 1]);
+        target[i] = -1;
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        uint64_t x = ins[i];
+        if (QPU_SIG(x) == QPU_SIG_PROG_END && end == n)
+            end = i;
+        if (QPU_SIG(x) != QPU_SIG_BRANCH)
+            continue;
+        // code that jumps to a fixed or computed address cannot move.
+        if (!QPU_BR_REL(x) || QPU_BR_REG(x) || i + 1 + QPU_BRANCH_DELAY > n)
+            goto verbatim;
+        int32_t t = (int32_t)(i + 1 + QPU_BRANCH_DELAY) * 8 + (int32_t)QPU_IMM(x);
+        if (t < 0 || t > 8 * (int32_t)n || t % 8)
+            goto verbatim;
+        target[i] = t / 8;
+        leader[t / 8] = leader[i + 1 + QPU_BRANCH_DELAY] = 1;
+    }
+    leader[end] = 1;
+
+    for (unsigned start = 0; start < n; )
+    {
+        unsigned e = start + 1;
+        int br = -1;
+        while (!leader[e])
+            e++;
+        for (unsigned i = start; i < e; i++)
+            if (target[i] >= 0)
+            {
+                // a second branch, or a target, inside the delay slots.
+                if (br >= 0 || i + 1 + QPU_BRANCH_DELAY != e)
+                    goto verbatim;
+                br = i;
+            }
+
+        new_at[start] = nout;
+        st->nblocks++;
+        int r = start >= end ? 1 : sched_block(&s, ins, start, e, br, res, from, &nout, max_out, st);
+        if (r < 0)
+            return -1;
+        if (r > 0)
+        {
+            st->nverbatim++;
+            if (nout + (e - start) > max_out)
+                return -1;
+            for (unsigned i = start; i < e; i++)
+            {
+                from[nout] = i;
+                res[nout++] = ins[i];
+            }
+        }
+        start = e;
+    }
+    new_at[n] = nout;
+
+    // point the branches at where their targets went.
+    for (unsigned i = 0; i < nout; i++)
+        if (from[i] >= 0 && target[from[i]] >= 0)
+        {
+            int32_t imm = (new_at[target[from[i]]] - (int32_t)(i + 1 + QPU_BRANCH_DELAY)) * 8;
+            res[i] = (res[i] & ~0xffffffffull) | (uint32_t)imm;
+        }
+    for (unsigned i = 0; i < nout; i++)
+    {
+        out[2 * i] = res[i];
+        out[2 * i + 1] = res[i] >> 32;
+    }
+    st->nout = nout;
+    return nout;
+
+verbatim:
+    if (n > max_out)
+        return -1;
+    memcpy(out, in, 8 * n);
+    st->nout = n;
+    st->nblocks = st->nverbatim = 1;
+    return n;
+}
@@ -0,0 +1,54 @@
+#ifndef __QPU_SCHED_H__
+#define __QPU_SCHED_H__
+/*
+ * Post-assembly instruction scheduler for QPU programs (the arrays vc4asm
+ * emits into the *shader.c files).
+ *
+ * The program is split into basic blocks at branch targets, after branch
+ * delay slots and at the program-end signal.  Within each block nops are
+ * dropped, operations with no effect (mov -, vw_wait keeps only its
+ * read) are stripped, and what is left is list-scheduled again, longest
+ * critical path first:
+ *
+ *   - an add-pipe operation and a mul-pipe operation share an instruction
+ *     when their register reads, write files and signals fit in one; a
+ *     plain mov can switch pipes (or <-> v8min of a value with itself);
+ *   - a regfile result is never read by the next instruction (the
+ *     hardware does not interlock), an accumulator result can be, and r4
+ *     after an SFU write waits two instructions;
+ *   - the branch goes as early as its flags allow, and the work after it
+ *     fills its delay slots;
+ *   - uniform reads, VPM, DMA, SFU, TMU, semaphore, mutex and host
+ *     interrupt accesses ("I/O") keep their order and at least their
+ *     original spacing (up to three instructions), so setup-to-use
+ *     latencies the author relied on survive.
+ *
+ * Results must be complete by the end of a block, so blocks can follow
+ * each other in any order.  Blocks that do anything unusual (work in
+ * delay slots, branches that write a link register) and everything from
+ * the program-end signal on are copied unchanged; a program with
+ * absolute or register branches is copied unchanged as a whole, since
+ * its code cannot move.
+ */
+#include <stdint.h>
+
+#define QPU_SCHED_MAX_INS 1024  // program length
+#define QPU_SCHED_MAX_BLOCK 256 // operations per basic block
+
+typedef struct qpu_sched_stats
+{
+    unsigned nin, nout;     // instructions before and after
+    unsigned nnops;         // nops dropped
+    unsigned npaired;       // output instructions doing more than one thing
+    unsigned nslots;        // branch delay slots now doing work
+    unsigned nblocks, nverbatim;
+} qpu_sched_stats_t;
+
+/*
+ * Schedule the 'n' instructions at 'in' (two words each, low word first)
+ * into 'out', which has room for 'max_out' instructions.  Returns the
+ * number of instructions written, or -1 if they do not fit.
+ */
+int qpu_sched(const uint32_t *in, unsigned n, uint32_t *out, unsigned max_out, qpu_sched_stats_t *s);
+
+#endif
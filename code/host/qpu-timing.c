@@ -0,0 +1,358 @@
+#include "rpi.h"
+#include "qpu-timing.h"
+#include "qpu-disasm.h"
+
+static const char *stall_name[QPU_NUM_STALLS] = {
+    "regfile", "sfu", "tmu", "vpm", "dma_load", "dma_store", "branch",
+};
+
+// what one instruction reads, writes and starts, as far as timing goes.
+typedef struct use
+{
+    uint32_t read_a, read_b, write_a, write_b;
+    int r4, vpm, vr_wait, vw_wait, ldtmu;
+    int sfu, tmu[2], vr_setup, vr_addr, vw_addr;
+    int branch, nop;
+} use_t;
+
+static void use_read(use_t *u, int file_b, uint32_t raddr)
+{
+    if (raddr < QPU_NUM_REGS)
+        *(file_b ? &u->read_b : &u->read_a) |= 1u << raddr;
+    else if (raddr == QPU_R_VPM)
+        u->vpm = 1;
+    else if (raddr == QPU_R_VPM_WAIT)
+        *(file_b ? &u->vw_wait : &u->vr_wait) = 1;
+}
+
+static void use_write(use_t *u, int file_b, uint32_t waddr)
+{
+    if (waddr < QPU_NUM_REGS)
+        *(file_b ? &u->write_b : &u->write_a) |= 1u << waddr;
+    else if (waddr >= QPU_W_SFU_RECIP && waddr <= QPU_W_SFU_LOG)
+        u->sfu = 1;
+    else if (waddr == QPU_W_TMU0_S || waddr == QPU_W_TMU1_S)
+        u->tmu[waddr == QPU_W_TMU1_S] = 1;
+    else if (waddr == QPU_W_VPM_SETUP && !file_b)
+        u->vr_setup = 1;
+    else if (waddr == QPU_W_VPM_ADDR)
+        *(file_b ? &u->vw_addr : &u->vr_addr) = 1;
+}
+
+static void decode(uint64_t ins, use_t *u)
+{
+    uint32_t sig = QPU_SIG(ins);
+    int ws = QPU_WS(ins);
+
+    memset(u, 0, sizeof *u);
+    if (sig == QPU_SIG_BRANCH)
+    {
+        u->branch = 1;
+        if (QPU_BR_REG(ins))
+            use_read(u, 0, QPU_BR_RADDR_A(ins));
+        use_write(u, ws, QPU_WADDR_ADD(ins));
+        use_write(u, !ws, QPU_WADDR_MUL(ins));
+        return;
+    }
+    if (sig == QPU_SIG_LOAD_IMM)
+    {
+        use_write(u, ws, QPU_WADDR_ADD(ins));
+        use_write(u, !ws, QPU_WADDR_MUL(ins));
+        return;
+    }
+
+    int add = QPU_OP_ADD(ins) != QPU_A_NOP, mul = QPU_OP_MUL(ins) != QPU_M_NOP;
+    use_read(u, 0, QPU_RADDR_A(ins));
+    if (sig != QPU_SIG_SMALL_IMM)
+        use_read(u, 1, QPU_RADDR_B(ins));
+    u->r4 = (add && (QPU_ADD_A(ins) == QPU_MUX_R4 || QPU_ADD_B(ins) == QPU_MUX_R4))
+        || (mul && (QPU_MUL_A(ins) == QPU_MUX_R4 || QPU_MUL_B(ins) == QPU_MUX_R4));
+    if (add)
+        use_write(u, ws, QPU_WADDR_ADD(ins));
+    if (mul)
+        use_write(u, !ws, QPU_WADDR_MUL(ins));
+    u->ldtmu = sig == QPU_SIG_LOAD_TMU0 || sig == QPU_SIG_LOAD_TMU1;
+    u->nop = !add && !mul && !u->ldtmu;
+}
+
+static void wait(uint64_t *at, uint64_t stall[], int why, uint64_t ready)
+{
+    if (ready > *at)
+    {
+        stall[why] += ready - *at;
+        *at = ready;
+    }
+}
+
+// start a 'bytes' transfer on a shared engine; returns when it lands.
+static uint64_t dma(qpu_timing_t *t, uint64_t *engine, uint64_t at, uint32_t bytes)
+{
+    uint64_t start = at > *engine ? at : *engine;
+    *engine = start + (bytes + t->p.dma_bytes - 1) / t->p.dma_bytes;
+    return *engine + t->p.dma_latency;
+}
+
+static uint32_t vdr_bytes(uint32_t s)
+{
+    uint32_t rowlen = (s >> 20) & 0xf, nrows = (s >> 16) & 0xf;
+    return (rowlen ? rowlen : 16) * (nrows ? nrows : 16) * 4;
+}
+
+static uint32_t vdw_bytes(uint32_t s)
+{
+    uint32_t units = (s >> 23) & 0x7f, depth = (s >> 16) & 0x7f;
+    return (units ? units : 128) * (depth ? depth : 128) * 4;
+}
+
+static int holds(const qpu_t *q, uint32_t cond, int i)
+{
+    switch (cond)
+    {
+    case QPU_COND_ALWAYS: return 1;
+    case QPU_COND_ZS: return q->z[i];
+    case QPU_COND_ZC: return !q->z[i];
+    case QPU_COND_NS: return q->n[i];
+    case QPU_COND_NC: return !q->n[i];
+    case QPU_COND_CS: return q->c[i];
+    case QPU_COND_CC: return !q->c[i];
+    }
+    return 0;
+}
+
+// lanes 'ins' is active on, from the flags before it runs.
+static unsigned active_lanes(const qpu_t *q, uint64_t ins)
+{
+    uint32_t sig = QPU_SIG(ins), cond;
+    unsigned n = 0;
+
+    if (sig == QPU_SIG_BRANCH)
+    {
+        uint32_t br = QPU_BR_COND(ins);
+        if (br > QPU_BR_ANYNC)
+            return QPU_NUM_LANES;
+        // allz/anyz test Z set, allnz/anynz Z clear, and so on for N and C.
+        cond = QPU_COND_ZS + 2 * (br / 4) + (br & 1);
+    }
+    else if (sig == QPU_SIG_LOAD_IMM || QPU_OP_ADD(ins) != QPU_A_NOP)
+        cond = QPU_COND_ADD(ins);
+    else if (QPU_OP_MUL(ins) != QPU_M_NOP)
+        cond = QPU_COND_MUL(ins);
+    else
+        return QPU_NUM_LANES;
+    // nothing written (mov -, vw_wait): no lanes left out either.
+    if (cond == QPU_COND_NEVER)
+        return QPU_NUM_LANES;
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        n += holds(q, cond, i);
+    return n;
+}
+
+static int step(qpu_timing_t *t, int num)
+{
+    qpu_t *q = &t->emu.qpu[num];
+    qpu_timing_qpu_t *tq = &t->qpu[num];
+    uint32_t pc = q->pc;
+    uint32_t *lo = t->emu.mem(pc), *hi = t->emu.mem(pc + 4);
+    uint64_t stall[QPU_NUM_STALLS] = {0};
+    use_t u;
+
+    // let the emulator report a bad fetch.
+    if (!lo || !hi || (pc & 7))
+        return qpu_emu_step(&t->emu, num) == QPU_EMU_FAULT ? -1 : 0;
+    uint64_t ins = QPU_INS(*lo, *hi);
+    int tmu = QPU_SIG(ins) - QPU_SIG_LOAD_TMU0;
+    decode(ins, &u);
+
+    uint64_t at = tq->clock;
+    if ((u.read_a & tq->wrote_a) || (u.read_b & tq->wrote_b))
+    {
+        stall[QPU_STALL_REGFILE] += t->p.issue;
+        at += t->p.issue;
+    }
+    if (u.r4)
+        wait(&at, stall, tq->r4_stall, tq->r4_ready);
+    if (u.ldtmu && tq->tmu_n[tmu])
+        wait(&at, stall, QPU_STALL_TMU, tq->tmu_ready[tmu][tq->tmu_head[tmu]]);
+    if (u.vpm)
+        wait(&at, stall, QPU_STALL_VPM, tq->vpr_ready);
+    if (u.vr_wait || u.vr_addr)
+        wait(&at, stall, QPU_STALL_DMA_LOAD, tq->load_done);
+    if (u.vw_wait || u.vw_addr)
+        wait(&at, stall, QPU_STALL_DMA_STORE, tq->store_done);
+
+    int slot = tq->slots > 0;
+    if (slot)
+        tq->slots--;
+    unsigned lanes = active_lanes(q, ins);
+
+    int r = qpu_emu_step(&t->emu, num);
+    if (r == QPU_EMU_FAULT)
+        return -1;
+    if (r == QPU_EMU_BLOCKED)
+    {
+        // spin on the semaphore or mutex and retry later.
+        tq->slots += slot;
+        tq->clock += t->p.issue;
+        return 1;
+    }
+
+    tq->clock = at + t->p.issue;
+    if (slot && u.nop)
+        stall[QPU_STALL_BRANCH] += t->p.issue;
+    if (u.branch)
+        tq->slots = QPU_BRANCH_DELAY;
+    tq->wrote_a = u.write_a;
+    tq->wrote_b = u.write_b;
+    if (u.sfu)
+    {
+        tq->r4_ready = at + t->p.sfu_latency;
+        tq->r4_stall = QPU_STALL_SFU;
+    }
+    if (u.ldtmu)
+    {
+        tq->tmu_head[tmu] = (tq->tmu_head[tmu] + 1) % QPU_EMU_TMU_FIFO;
+        tq->tmu_n[tmu]--;
+    }
+    for (int i = 0; i < 2; i++)
+        if (u.tmu[i])
+            tq->tmu_ready[i][(tq->tmu_head[i] + tq->tmu_n[i]++) % QPU_EMU_TMU_FIFO] = at + t->p.tmu_latency;
+    if (u.vr_setup)
+        tq->vpr_ready = at + t->p.vpm_setup;
+    if (u.vr_addr)
+        tq->load_done = dma(t, &t->vdr_free, at, vdr_bytes(q->vdr_setup));
+    if (u.vw_addr)
+        tq->store_done = dma(t, &t->vdw_free, at, vdw_bytes(q->vdw_setup));
+
+    qpu_timing_ins_t *s = NULL;
+    if (pc >= t->code && (pc - t->code) / 8 < t->ncode)
+        s = &t->ins[(pc - t->code) / 8];
+    if (s)
+    {
+        s->count++;
+        s->lanes += lanes;
+    }
+    for (int i = 0; i < QPU_NUM_STALLS; i++)
+    {
+        t->stall[i] += stall[i];
+        if (s)
+            s->stall[i] += stall[i];
+    }
+    t->ninstr++;
+    return 0;
+}
+
+void qpu_timing_init(qpu_timing_t *t, void *(*mem)(uint32_t bus))
+{
+    memset(t, 0, sizeof *t);
+    qpu_emu_init(&t->emu, mem);
+    t->p = (qpu_timing_params_t){
+        .issue = 4,
+        .sfu_latency = 8,
+        .tmu_latency = 36,
+        .vpm_setup = 12,
+        .dma_latency = 200,
+        .dma_bytes = 4,
+    };
+}
+
+int qpu_timing_run(qpu_timing_t *t, uint32_t code, uint32_t nbytes, const uint32_t unifs[], int num_qpus)
+{
+    assert(num_qpus >= 1 && num_qpus <= QPU_EMU_NUM_QPUS);
+
+    memset(t->qpu, 0, sizeof t->qpu);
+    memset(t->ins, 0, sizeof t->ins);
+    memset(t->stall, 0, sizeof t->stall);
+    t->vdr_free = t->vdw_free = 0;
+    t->cycles = t->ninstr = 0;
+    t->code = code;
+    t->ncode = nbytes / 8 < QPU_TIMING_MAX_INS ? nbytes / 8 : QPU_TIMING_MAX_INS;
+    t->emu.err[0] = 0;
+
+    for (int q = 0; q < num_qpus; q++)
+        qpu_emu_start(&t->emu, q, code, unifs[q]);
+    unsigned blocked = 0;
+
+    for (;;)
+    {
+        // advance whichever running QPU is furthest behind.
+        int next = -1;
+        for (int q = 0; q < num_qpus; q++)
+            if (t->emu.qpu[q].state == QPU_EMU_RUNNING
+                && (next < 0 || t->qpu[q].clock < t->qpu[next].clock))
+                next = q;
+        if (next < 0)
+            break;
+        int r = step(t, next);
+        if (r < 0)
+            return -1;
+        // nothing left running can release it.
+        if (r > 0 && ++blocked > QPU_EMU_NUM_QPUS * 1000000)
+        {
+            snprintf(t->emu.err, sizeof t->emu.err, "qpu %d: deadlocked", next);
+            return -1;
+        }
+        if (r == 0)
+            blocked = 0;
+    }
+
+    for (int q = 0; q < num_qpus; q++)
+    {
+        uint64_t end = t->qpu[q].clock;
+        // a DMA store still in flight holds the job open.
+        if (t->qpu[q].store_done > end)
+            end = t->qpu[q].store_done;
+        if (end > t->cycles)
+            t->cycles = end;
+    }
+    return 0;
+}
+
+// QPU clocks spent on instruction 'n': its issue slots and its stalls.
+static uint64_t ins_clocks(qpu_timing_t *t, unsigned n)
+{
+    uint64_t c = t->ins[n].count * t->p.issue;
+    for (int i = 0; i < QPU_NUM_STALLS; i++)
+        c += t->ins[n].stall[i];
+    return c;
+}
+
+void qpu_timing_report(qpu_timing_t *t)
+{
+    uint64_t total = 0, clocks = 0, hottest = 1;
+    char text[160];
+
+    for (int i = 0; i < QPU_NUM_STALLS; i++)
+        total += t->stall[i];
+    printk("%llu cycles, %llu instructions, %llu stall cycles:",
+        (unsigned long long)t->cycles, (unsigned long long)t->ninstr, (unsigned long long)total);
+    for (int i = 0; i < QPU_NUM_STALLS; i++)
+        printk(" %s %llu", stall_name[i], (unsigned long long)t->stall[i]);
+    printk("\n");
+
+    for (unsigned n = 0; n < t->ncode; n++)
+    {
+        uint64_t c = ins_clocks(t, n);
+        clocks += c;
+        if (c > hottest)
+            hottest = c;
+    }
+    printk("  addr  share heat          count lanes");
+    for (int i = 0; i < QPU_NUM_STALLS; i++)
+        printk(" %9s", stall_name[i]);
+    printk("  instruction\n");
+    for (unsigned n = 0; n < t->ncode; n++)
+    {
+        qpu_timing_ins_t *s = &t->ins[n];
+        uint32_t *w = t->emu.mem(t->code + 8 * n);
+        if (!s->count)
+            continue;
+        uint64_t c = ins_clocks(t, n);
+        int bar = (int)((c * 8 + hottest / 2) / hottest);
+        qpu_disasm(QPU_INS(w[0], w[1]), 8 * n, text, sizeof text);
+        printk("  %4x %5.1f%% %-8.*s %10llu %5.1f", 8 * n, clocks ? 100.0 * c / clocks : 0.0,
+            bar, "########", (unsigned long long)s->count, (double)s->lanes / s->count);
+        for (int i = 0; i < QPU_NUM_STALLS; i++)
+            printk(" %9llu", (unsigned long long)s->stall[i]);
+        printk("  %s\n", text);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef __QPU_TIMING_H__
+#define __QPU_TIMING_H__
+/*
+ * Cycle-approximate timing model for QPU kernels, on top of the emulator
+ * (qpu-emu.h): the emulator decides what each instruction does, this
+ * decides when it issues.
+ *
+ * Each QPU issues one instruction every 'issue' clocks (16 lanes over a
+ * 4-wide pipeline) unless it has to wait for something:
+ *
+ *   regfile    reading a regfile register the previous instruction wrote.
+ *              The hardware does not interlock (it reads the stale value,
+ *              see the lab README); the model charges the instruction slot
+ *              the fix would cost so the hazard shows up in the report.
+ *   sfu, tmu   reading r4 before an SFU result or a ldtmu is ready, and
+ *              ldtmu before its lookup has come back.
+ *   vpm        a VPM read too soon after vr_setup.
+ *   dma_load   vr_wait (or a new vr_addr) before this QPU's last VDR is
+ *              done.  The VDR and VDW engines are each shared by all
+ *              QPUs: a transfer starts once the engine is free and
+ *              occupies it for bytes / dma_bytes, then lands dma_latency
+ *              clocks later.
+ *   dma_store  the same for vw_wait / vw_addr and the VDW.
+ *   branch     nops in branch delay slots: issue slots the branch wasted.
+ *
+ * QPUs run concurrently; the model always advances the QPU that is
+ * furthest behind, so the shared engines see requests in clock order.  The
+ * default latencies are rough figures, not measurements; the model is for
+ * comparing kernels and catching regressions, not for absolute numbers.
+ */
+#include <stdint.h>
+#include "qpu-emu.h"
+
+#define QPU_TIMING_MAX_INS 1024 // per-instruction stats kept for this many
+
+enum
+{
+    QPU_STALL_REGFILE = 0,
+    QPU_STALL_SFU,
+    QPU_STALL_TMU,
+    QPU_STALL_VPM,
+    QPU_STALL_DMA_LOAD,
+    QPU_STALL_DMA_STORE,
+    QPU_STALL_BRANCH,
+    QPU_NUM_STALLS,
+};
+
+// all in QPU clocks.
+typedef struct qpu_timing_params
+{
+    unsigned issue;         // clocks per instruction
+    unsigned sfu_latency;   // SFU write to r4 ready
+    unsigned tmu_latency;   // TMU request to data ready for ldtmu
+    unsigned vpm_setup;     // vr_setup to first VPM read
+    unsigned dma_latency;   // DMA start to data in place
+    unsigned dma_bytes;     // DMA bytes per clock, per engine
+} qpu_timing_params_t;
+
+typedef struct qpu_timing_ins
+{
+    uint64_t count;         // times executed, all QPUs
+    uint64_t lanes;         // lanes active, summed over those times
+    uint64_t stall[QPU_NUM_STALLS];
+} qpu_timing_ins_t;
+
+// per-QPU timing state
+typedef struct qpu_timing_qpu
+{
+    uint64_t clock;         // when the next instruction can issue
+    uint32_t wrote_a, wrote_b;  // regfile registers the last instruction wrote
+    uint64_t r4_ready;
+    int r4_stall;           // QPU_STALL_* for waiting on r4
+    uint64_t tmu_ready[2][QPU_EMU_TMU_FIFO];
+    unsigned tmu_head[2], tmu_n[2];
+    uint64_t vpr_ready;
+    uint64_t load_done, store_done;
+    int slots;              // branch delay slots still to come
+} qpu_timing_qpu_t;
+
+typedef struct qpu_timing
+{
+    qpu_emu_t emu;
+    qpu_timing_params_t p;
+    qpu_timing_qpu_t qpu[QPU_EMU_NUM_QPUS];
+    uint64_t vdr_free, vdw_free;    // when each DMA engine can start another
+
+    // results of the last run.
+    uint32_t code;
+    unsigned ncode;         // instructions with per-instruction stats
+    qpu_timing_ins_t ins[QPU_TIMING_MAX_INS];
+    uint64_t cycles;        // until the last QPU ended
+    uint64_t ninstr;
+    uint64_t stall[QPU_NUM_STALLS];
+} qpu_timing_t;
+
+// 'mem' as for qpu_emu_init; the parameters start at their defaults.
+void qpu_timing_init(qpu_timing_t *t, void *(*mem)(uint32_t bus));
+
+/*
+ * Run 'code' (nbytes long) on 'num_qpus' QPUs at once, QPU q reading its
+ * uniforms from unifs[q], and record the timing.  Returns 0, or -1 if a
+ * program faulted (the message is in t->emu.err).
+ */
+int qpu_timing_run(qpu_timing_t *t, uint32_t code, uint32_t nbytes, const uint32_t unifs[], int num_qpus);
+
+/*
+ * Print the totals, then the program annotated with each instruction's
+ * share of the QPU clocks (its issue slots and stalls, as a heat bar),
+ * execution count, lanes active on average and stall breakdown.  A lane
+ * is active if the instruction's condition lets it write (the add pipe's,
+ * or the mul pipe's if the add pipe does nothing) or, for a branch, if it
+ * meets the branch condition; lanes of a divergent loop show up as fewer
+ * than 16.
+ */
+void qpu_timing_report(qpu_timing_t *t);
+
+#endif
@@ -0,0 +1,623 @@
+#include <pthread.h>
+#include "rpi.h"
+#include "qpu-xlate.h"
+
+typedef uint32_t v16u __attribute__((vector_size(64)));
+typedef int32_t v16i __attribute__((vector_size(64)));
+typedef float v16f __attribute__((vector_size(64)));
+typedef uint8_t v16b __attribute__((vector_size(16)));
+
+enum
+{
+    X_SLOW = 0, // interpret
+    X_ALU,
+    X_LDI,
+    X_BRANCH,
+};
+
+// where an ALU operand comes from
+enum
+{
+    SRC_REG = 0,
+    SRC_ELEM,   // element number (A) or QPU number (B)
+    SRC_UNIF,
+    SRC_ZERO,
+    SRC_IMM,
+};
+
+#define DST_NONE 0xff   // else 0-31 ra, 32-63 rb, 64-67 r0-r3
+
+typedef struct xins
+{
+    uint64_t raw;       // what was translated
+    uint8_t kind;
+    uint8_t end;        // program end signal
+    uint8_t src_a, src_b, raddr_a, raddr_b;
+    uint8_t mux[4];     // add a, add b, mul a, mul b
+    uint8_t op_add, op_mul, cond_add, cond_mul, sf;
+    uint8_t dst_add, dst_mul;
+    uint32_t imm;       // small immediate, or branch target
+    uint32_t lanes[QPU_NUM_LANES];  // load immediate value
+} xins_t;
+
+typedef struct xkernel
+{
+    uint32_t code;
+    unsigned n;
+    xins_t *ins;
+} xkernel_t;
+
+struct qpu_xlate
+{
+    pthread_mutex_t lock;
+    xkernel_t k[QPU_XLATE_MAX_KERNELS];
+    unsigned nk;
+    // replaced translations: a QPU may still be running one.
+    xins_t **retired;
+    unsigned nretired;
+    qpu_xlate_stats_t stats;
+};
+
+//
+// Translation.
+//
+
+static int src(uint32_t raddr, int file_b, uint8_t *kind)
+{
+    if (raddr < QPU_NUM_REGS)
+        *kind = SRC_REG;
+    else if (raddr == QPU_R_ELEM_QPU)
+        *kind = SRC_ELEM;
+    else if (raddr == QPU_R_UNIF)
+        *kind = SRC_UNIF;
+    else if (raddr == QPU_R_NOP)
+        *kind = SRC_ZERO;
+    else
+        return -1;
+    return 0;
+}
+
+static int dst(uint32_t waddr, int file_b, uint8_t *d)
+{
+    if (waddr < QPU_NUM_REGS)
+        *d = waddr + (file_b ? 32 : 0);
+    else if (waddr >= QPU_W_R0 && waddr <= QPU_W_R3)
+        *d = 64 + waddr - QPU_W_R0;
+    else if (waddr == QPU_W_NOP)
+        *d = DST_NONE;
+    else
+        return -1;
+    return 0;
+}
+
+static int fast_add(uint32_t op)
+{
+    switch (op)
+    {
+    case QPU_A_NOP: case QPU_A_FADD: case QPU_A_FSUB: case QPU_A_FTOI: case QPU_A_ITOF:
+    case QPU_A_ADD: case QPU_A_SUB: case QPU_A_SHR: case QPU_A_ASR: case QPU_A_ROR:
+    case QPU_A_SHL: case QPU_A_MIN: case QPU_A_MAX: case QPU_A_AND: case QPU_A_OR:
+    case QPU_A_XOR: case QPU_A_NOT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int xlate_alu(xins_t *x, uint64_t ins)
+{
+    uint32_t sig = QPU_SIG(ins);
+    int ws = QPU_WS(ins);
+
+    switch (sig)
+    {
+    case QPU_SIG_NONE:
+    case QPU_SIG_THREAD_SWITCH:
+    case QPU_SIG_LAST_THREAD_SWITCH:
+    case QPU_SIG_PROG_END:
+    case QPU_SIG_WAIT_SCORE:
+    case QPU_SIG_UNLOCK_SCORE:
+    case QPU_SIG_SMALL_IMM:
+        break;
+    default:
+        return -1;
+    }
+    if (QPU_UNPACK(ins) || QPU_PACK(ins))
+        return -1;
+
+    x->end = sig == QPU_SIG_PROG_END;
+    x->raddr_a = QPU_RADDR_A(ins);
+    x->raddr_b = QPU_RADDR_B(ins);
+    if (src(x->raddr_a, 0, &x->src_a) < 0)
+        return -1;
+    if (sig == QPU_SIG_SMALL_IMM)
+    {
+        if (x->raddr_b >= 48)
+            return -1;
+        x->src_b = SRC_IMM;
+        x->imm = qpu_small_imm(x->raddr_b);
+    }
+    else if (src(x->raddr_b, 1, &x->src_b) < 0)
+        return -1;
+
+    x->mux[0] = QPU_ADD_A(ins);
+    x->mux[1] = QPU_ADD_B(ins);
+    x->mux[2] = QPU_MUL_A(ins);
+    x->mux[3] = QPU_MUL_B(ins);
+    x->op_add = QPU_OP_ADD(ins);
+    x->op_mul = QPU_OP_MUL(ins);
+    if (!fast_add(x->op_add) || x->op_mul > QPU_M_MUL24)
+        return -1;
+    x->cond_add = QPU_COND_ADD(ins);
+    x->cond_mul = QPU_COND_MUL(ins);
+    x->sf = QPU_SF(ins);
+
+    x->dst_add = x->dst_mul = DST_NONE;
+    if (x->op_add != QPU_A_NOP && dst(QPU_WADDR_ADD(ins), ws, &x->dst_add) < 0)
+        return -1;
+    if (x->op_mul != QPU_M_NOP && dst(QPU_WADDR_MUL(ins), !ws, &x->dst_mul) < 0)
+        return -1;
+    return X_ALU;
+}
+
+static int xlate_ldi(xins_t *x, uint64_t ins)
+{
+    uint32_t imm = QPU_IMM(ins), mode = QPU_LDI_MODE(ins);
+    int ws = QPU_WS(ins);
+
+    if (QPU_PACK(ins))
+        return -1;
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+    {
+        uint32_t e = ((imm >> (16 + i)) & 1) << 1 | ((imm >> i) & 1);
+        if (mode == QPU_LDI_32)
+            x->lanes[i] = imm;
+        else if (mode == QPU_LDI_EL_SIGNED)
+            x->lanes[i] = e & 2 ? e - 4 : e;
+        else if (mode == QPU_LDI_EL_UNSIGNED)
+            x->lanes[i] = e;
+        else
+            return -1;
+    }
+    x->cond_add = QPU_COND_ADD(ins);
+    x->cond_mul = QPU_COND_MUL(ins);
+    x->sf = QPU_SF(ins);
+    if (dst(QPU_WADDR_ADD(ins), ws, &x->dst_add) < 0 || dst(QPU_WADDR_MUL(ins), !ws, &x->dst_mul) < 0)
+        return -1;
+    return X_LDI;
+}
+
+static int xlate_branch(xins_t *x, uint64_t ins, uint32_t pc)
+{
+    uint32_t cond = QPU_BR_COND(ins);
+
+    // link writes and register targets are rare: leave them to the interpreter.
+    if (QPU_BR_REG(ins) || QPU_WADDR_ADD(ins) != QPU_W_NOP || QPU_WADDR_MUL(ins) != QPU_W_NOP)
+        return -1;
+    if (cond > QPU_BR_ANYNC && cond != QPU_BR_ALWAYS)
+        return -1;
+    x->cond_add = cond;
+    x->imm = QPU_IMM(ins);
+    if (QPU_BR_REL(ins))
+        x->imm += pc + 8 * (QPU_BRANCH_DELAY + 1);
+    return X_BRANCH;
+}
+
+static void xlate_one(xins_t *x, uint64_t ins, uint32_t pc)
+{
+    int kind;
+
+    memset(x, 0, sizeof *x);
+    x->raw = ins;
+    switch (QPU_SIG(ins))
+    {
+    case QPU_SIG_BRANCH: kind = xlate_branch(x, ins, pc); break;
+    case QPU_SIG_LOAD_IMM: kind = xlate_ldi(x, ins); break;
+    default: kind = xlate_alu(x, ins); break;
+    }
+    x->kind = kind < 0 ? X_SLOW : kind;
+}
+
+static uint64_t fetch(qpu_emu_t *e, uint32_t pc, int *ok)
+{
+    uint32_t *lo = e->mem(pc), *hi = e->mem(pc + 4);
+    *ok = lo && hi;
+    return *ok ? QPU_INS(*lo, *hi) : 0;
+}
+
+// translate from 'code' through the end signal and its delay slots.
+static int xlate_kernel(qpu_emu_t *e, xkernel_t *k, uint32_t code)
+{
+    struct qpu_xlate *c = e->xlate;
+    xins_t *ins = malloc(QPU_XLATE_MAX_INS * sizeof *ins);
+    unsigned n = 0, left = -1;
+    int ok;
+
+    if (!ins)
+        return -1;
+    if (k->ins)
+    {
+        xins_t **r = realloc(c->retired, (c->nretired + 1) * sizeof *r);
+        if (!r)
+        {
+            free(ins);
+            return -1;
+        }
+        c->retired = r;
+        c->retired[c->nretired++] = k->ins;
+    }
+    while (n < QPU_XLATE_MAX_INS && left)
+    {
+        uint64_t raw = fetch(e, code + 8 * n, &ok);
+        if (!ok)
+            break;
+        xlate_one(&ins[n], raw, code + 8 * n);
+        if (left != -1u)
+            left--;
+        else if (QPU_SIG(raw) == QPU_SIG_PROG_END)
+            left = QPU_END_DELAY;
+        n++;
+    }
+    k->code = code;
+    k->n = n;
+    k->ins = ins;
+    return 0;
+}
+
+static int still_valid(qpu_emu_t *e, xkernel_t *k)
+{
+    int ok;
+
+    for (unsigned i = 0; i < k->n; i++)
+        if (fetch(e, k->code + 8 * i, &ok) != k->ins[i].raw || !ok)
+            return 0;
+    return 1;
+}
+
+static xkernel_t *lookup(qpu_emu_t *e, uint32_t code)
+{
+    struct qpu_xlate *c = e->xlate;
+    xkernel_t *k = NULL;
+
+    pthread_mutex_lock(&c->lock);
+    for (unsigned i = 0; i < c->nk; i++)
+        if (c->k[i].code == code)
+            k = &c->k[i];
+    if (k && !still_valid(e, k))
+    {
+        if (xlate_kernel(e, k, code) < 0)
+            k = NULL;
+        else
+            c->stats.nkernels++;
+    }
+    else if (!k && c->nk < QPU_XLATE_MAX_KERNELS)
+    {
+        k = &c->k[c->nk];
+        if (xlate_kernel(e, k, code) < 0)
+            k = NULL;
+        else
+        {
+            c->nk++;
+            c->stats.nkernels++;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return k;
+}
+
+//
+// Execution.
+//
+
+static v16u ld(const uint32_t *p)
+{
+    v16u v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static void st(uint32_t *p, v16u v)
+{
+    memcpy(p, &v, sizeof v);
+}
+
+static v16u splat(uint32_t x)
+{
+    return (v16u){0} + x;
+}
+
+// denormals flush to zero, keeping the sign.
+static v16f f32(v16u x)
+{
+    v16u den = (v16u)((x & 0x7f800000) == 0);
+    return (v16f)(x & ~(den & 0x7fffffff));
+}
+
+static v16u u32(v16f f)
+{
+    v16u x = (v16u)f;
+    v16u den = (v16u)((x & 0x7f800000) == 0);
+    return x & ~(den & 0x7fffffff);
+}
+
+static v16u flag(const uint8_t f[QPU_NUM_LANES])
+{
+    v16b b;
+    memcpy(&b, f, sizeof b);
+    return (v16u)(__builtin_convertvector(b, v16u) != 0);
+}
+
+static void set_flag(uint8_t f[QPU_NUM_LANES], v16u mask)
+{
+    v16b b = __builtin_convertvector(mask & 1, v16b);
+    memcpy(f, &b, sizeof b);
+}
+
+static v16u cond_mask(qpu_t *q, uint32_t cond)
+{
+    switch (cond)
+    {
+    case QPU_COND_NEVER: return splat(0);
+    case QPU_COND_ALWAYS: return splat(-1);
+    case QPU_COND_ZS: return flag(q->z);
+    case QPU_COND_ZC: return ~flag(q->z);
+    case QPU_COND_NS: return flag(q->n);
+    case QPU_COND_NC: return ~flag(q->n);
+    case QPU_COND_CS: return flag(q->c);
+    default: return ~flag(q->c);
+    }
+}
+
+static void set_flags(qpu_t *q, v16u v, v16u carry, int is_float)
+{
+    set_flag(q->z, (v16u)((is_float ? v & 0x7fffffff : v) == 0));
+    set_flag(q->n, v >> 31);
+    set_flag(q->c, carry);
+}
+
+static uint32_t *dst_ptr(qpu_t *q, uint8_t d)
+{
+    if (d < 32)
+        return q->ra[d];
+    if (d < 64)
+        return q->rb[d - 32];
+    return q->acc[d - 64];
+}
+
+static void write(qpu_t *q, uint8_t d, v16u v, v16u en)
+{
+    if (d == DST_NONE)
+        return;
+    uint32_t *p = dst_ptr(q, d);
+    st(p, (ld(p) & ~en) | (v & en));
+}
+
+static const v16u elem_num = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+// an operand; returns -1 if a uniform cannot be read.
+static int operand(qpu_emu_t *e, qpu_t *q, uint8_t kind, int file_b, uint8_t raddr, uint32_t imm, v16u *v)
+{
+    switch (kind)
+    {
+    case SRC_REG:
+        *v = ld(file_b ? q->rb[raddr] : q->ra[raddr]);
+        return 0;
+    case SRC_ELEM:
+        *v = file_b ? splat(q->num) : elem_num;
+        return 0;
+    case SRC_UNIF:
+    {
+        uint32_t *p = (q->unif & 3) ? NULL : e->mem(q->unif);
+        if (!p)
+            return -1;
+        q->unif += 4;
+        *v = splat(*p);
+        return 0;
+    }
+    case SRC_IMM:
+        *v = splat(imm);
+        return 0;
+    default:
+        *v = splat(0);
+        return 0;
+    }
+}
+
+static v16u mux(qpu_t *q, uint8_t m, v16u a, v16u b)
+{
+    return m == QPU_MUX_A ? a : m == QPU_MUX_B ? b : ld(q->acc[m]);
+}
+
+static v16u add_op(uint32_t op, v16u a, v16u b, v16u *carry)
+{
+    *carry = splat(0);
+    switch (op)
+    {
+    case QPU_A_FADD: return u32(f32(a) + f32(b));
+    case QPU_A_FSUB: return u32(f32(a) - f32(b));
+    case QPU_A_FTOI:
+    {
+        v16f f = f32(a);
+        v16u in_range = (v16u)((v16f)((v16u)f & 0x7fffffff) < 2147483648.0f);
+        return (v16u)__builtin_convertvector(f, v16i) & in_range;
+    }
+    case QPU_A_ITOF: return u32(__builtin_convertvector((v16i)a, v16f));
+    case QPU_A_ADD:
+        *carry = (v16u)(a + b < a);
+        return a + b;
+    case QPU_A_SUB:
+        *carry = (v16u)(a < b);
+        return a - b;
+    case QPU_A_SHR: return a >> (b & 31);
+    case QPU_A_ASR: return (v16u)((v16i)a >> (v16i)(b & 31));
+    case QPU_A_ROR: return a >> (b & 31) | a << ((32 - (b & 31)) & 31);
+    case QPU_A_SHL: return a << (b & 31);
+    case QPU_A_MIN:
+    {
+        v16u lt = (v16u)((v16i)a < (v16i)b);
+        return (a & lt) | (b & ~lt);
+    }
+    case QPU_A_MAX:
+    {
+        v16u gt = (v16u)((v16i)a > (v16i)b);
+        return (a & gt) | (b & ~gt);
+    }
+    case QPU_A_AND: return a & b;
+    case QPU_A_OR: return a | b;
+    case QPU_A_XOR: return a ^ b;
+    default: return ~a;
+    }
+}
+
+static int is_float_add(uint32_t op)
+{
+    return op == QPU_A_FADD || op == QPU_A_FSUB || op == QPU_A_ITOF;
+}
+
+// returns -1 to hand the instruction to the interpreter instead.
+static int exec_alu(qpu_emu_t *e, qpu_t *q, const xins_t *x)
+{
+    uint32_t unif = q->unif;
+    v16u va, vb, radd = {0}, rmul = {0}, carry;
+
+    if (operand(e, q, x->src_a, 0, x->raddr_a, 0, &va) < 0
+        || operand(e, q, x->src_b, 1, x->raddr_b, x->imm, &vb) < 0)
+    {
+        q->unif = unif;
+        return -1;
+    }
+
+    if (x->op_add != QPU_A_NOP)
+        radd = add_op(x->op_add, mux(q, x->mux[0], va, vb), mux(q, x->mux[1], va, vb), &carry);
+    if (x->op_mul == QPU_M_FMUL)
+        rmul = u32(f32(mux(q, x->mux[2], va, vb)) * f32(mux(q, x->mux[3], va, vb)));
+    else if (x->op_mul == QPU_M_MUL24)
+        rmul = (mux(q, x->mux[2], va, vb) & 0xffffff) * (mux(q, x->mux[3], va, vb) & 0xffffff);
+
+    v16u ena = cond_mask(q, x->cond_add), enm = cond_mask(q, x->cond_mul);
+    if (x->sf)
+    {
+        if (x->op_add != QPU_A_NOP)
+            set_flags(q, radd, carry, is_float_add(x->op_add));
+        else if (x->op_mul != QPU_M_NOP)
+            set_flags(q, rmul, splat(0), x->op_mul == QPU_M_FMUL);
+    }
+    write(q, x->dst_add, radd, ena);
+    write(q, x->dst_mul, rmul, enm);
+    if (x->end)
+        q->end_in = QPU_END_DELAY + 1;
+    return 0;
+}
+
+static void exec_ldi(qpu_t *q, const xins_t *x)
+{
+    v16u v = ld(x->lanes);
+    v16u ena = cond_mask(q, x->cond_add), enm = cond_mask(q, x->cond_mul);
+
+    if (x->sf)
+        set_flags(q, v, splat(0), 0);
+    write(q, x->dst_add, v, ena);
+    write(q, x->dst_mul, v, enm);
+}
+
+static int branch_taken(qpu_t *q, uint32_t cond)
+{
+    if (cond == QPU_BR_ALWAYS)
+        return 1;
+    v16u f = flag(cond < 4 ? q->z : cond < 8 ? q->n : q->c);
+    if (cond & 1)
+        f = ~f;
+    // any: some lane matches; all: no lane fails to.
+    for (int i = 0; i < QPU_NUM_LANES; i++)
+        if (cond & 2 ? f[i] != 0 : f[i] == 0)
+            return cond & 2 ? 1 : 0;
+    return cond & 2 ? 0 : 1;
+}
+
+int qpu_xlate_run(qpu_emu_t *e, int num, unsigned budget)
+{
+    qpu_t *q = &e->qpu[num];
+    const xkernel_t *k = q->xk;
+    uint64_t nfast = 0, nslow = 0;
+    int r = q->state;
+
+    if (!k && q->state == QPU_EMU_RUNNING)
+        k = q->xk = lookup(e, q->code);
+
+    for (; budget && q->state == QPU_EMU_RUNNING; budget--)
+    {
+        uint32_t i = (q->pc - q->code) / 8;
+        const xins_t *x = k && !((q->pc - q->code) & 7) && i < k->n ? &k->ins[i] : NULL;
+
+        // the interpreter handles everything else, including the
+        // instruction-limit and branch-in-delay-slot faults.
+        if (!x || x->kind == X_SLOW || q->ninstr >= e->max_instrs
+            || (x->kind == X_BRANCH && q->branch_in)
+            || (x->kind == X_ALU && exec_alu(e, q, x) < 0))
+        {
+            nslow++;
+            if ((r = qpu_emu_step(e, num)) == QPU_EMU_BLOCKED)
+            {
+                nslow--;
+                break;
+            }
+            continue;
+        }
+
+        if (x->kind == X_LDI)
+            exec_ldi(q, x);
+        else if (x->kind == X_BRANCH && branch_taken(q, x->cond_add))
+        {
+            q->branch_pc = x->imm;
+            q->branch_in = QPU_BRANCH_DELAY + 1;
+        }
+        nfast++;
+        q->pc += 8;
+        q->ninstr++;
+        if (q->branch_in && --q->branch_in == 0)
+            q->pc = q->branch_pc;
+        if (q->end_in && --q->end_in == 0)
+            q->state = QPU_EMU_DONE;
+        r = q->state;
+    }
+
+    __atomic_fetch_add(&e->xlate->stats.nfast, nfast, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&e->xlate->stats.nslow, nslow, __ATOMIC_RELAXED);
+    return r == QPU_EMU_BLOCKED ? r : q->state;
+}
+
+int qpu_xlate_enable(qpu_emu_t *e)
+{
+    if (e->xlate)
+        return 0;
+    e->xlate = calloc(1, sizeof *e->xlate);
+    if (!e->xlate)
+        return -1;
+    pthread_mutex_init(&e->xlate->lock, NULL);
+    return 0;
+}
+
+void qpu_xlate_disable(qpu_emu_t *e)
+{
+    struct qpu_xlate *c = e->xlate;
+
+    if (!c)
+        return;
+    for (unsigned i = 0; i < c->nk; i++)
+        free(c->k[i].ins);
+    for (unsigned i = 0; i < c->nretired; i++)
+        free(c->retired[i]);
+    free(c->retired);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+    e->xlate = NULL;
+    for (int i = 0; i < QPU_EMU_NUM_QPUS; i++)
+        e->qpu[i].xk = NULL;
+}
+
+void qpu_xlate_stats(qpu_emu_t *e, qpu_xlate_stats_t *s)
+{
+    memset(s, 0, sizeof *s);
+    if (e->xlate)
+        *s = e->xlate->stats;
+}
@@ -0,0 +1,47 @@
+#ifndef __QPU_XLATE_H__
+#define __QPU_XLATE_H__
+/*
+ * Translation of QPU programs for the emulator (qpu-emu.h).
+ *
+ * The first time a program is started, its instructions are decoded once
+ * into a table of pre-resolved operations (operand sources, ops,
+ * conditions, destinations, branch targets), and runs then execute that
+ * table with host vector code: each 16-lane operation is one GCC vector
+ * expression, which the compiler maps onto SSE/AVX/NEON.  The ALU pairs,
+ * conditional writes, flags, load immediates and branches are translated;
+ * anything touching a peripheral (VPM, DMA, SFU, TMU, semaphores, the
+ * mutex) or using pack/unpack is left to the interpreter, one instruction
+ * at a time, so behaviour is the interpreter's exactly.
+ *
+ * Translations are cached per program start address, and checked against
+ * memory each time the program starts, so rewritten code is translated
+ * again.
+ */
+#include "qpu-emu.h"
+
+#define QPU_XLATE_MAX_KERNELS 64
+#define QPU_XLATE_MAX_INS 4096 // per program
+
+struct qpu_xlate;
+
+// Turn translation on for 'e'.  Returns 0, or -1 if out of memory.
+int qpu_xlate_enable(qpu_emu_t *e);
+// Turn it off and free the cache.
+void qpu_xlate_disable(qpu_emu_t *e);
+
+/*
+ * Run QPU 'num' (started with qpu_emu_start) for up to 'budget'
+ * instructions.  Returns its state as qpu_emu_step does.
+ */
+int qpu_xlate_run(qpu_emu_t *e, int num, unsigned budget);
+
+typedef struct qpu_xlate_stats
+{
+    unsigned nkernels;      // translations made
+    uint64_t nfast;         // instructions run translated
+    uint64_t nslow;         // instructions handed to the interpreter
+} qpu_xlate_stats_t;
+
+void qpu_xlate_stats(qpu_emu_t *e, qpu_xlate_stats_t *s);
+
+#endif
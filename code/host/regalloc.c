@@ -0,0 +1,38 @@
+// allocate registers for a kernel written with virtual registers
+// (qpu-regalloc.h) and write plain vc4asm source.
+//
+//   usage: regalloc in.vqasm out.qasm
+#include "rpi.h"
+#include "qpu-regalloc.h"
+
+static char src[1 << 20], out[1 << 20];
+
+int main(int argc, char *argv[])
+{
+    char err[256];
+    qpu_ra_stats_t s;
+
+    if (argc != 3)
+        panic("usage: regalloc in.vqasm out.qasm\n");
+    FILE *f = fopen(argv[1], "r");
+    if (!f)
+        panic("cannot open %s\n", argv[1]);
+    size_t n = fread(src, 1, sizeof src - 1, f);
+    fclose(f);
+    src[n] = 0;
+
+    if (qpu_regalloc(src, out, sizeof out, &s, err, sizeof err) < 0)
+    {
+        fprintf(stderr, "%s:%s", argv[1], err);
+        return 1;
+    }
+    if (!(f = fopen(argv[2], "w")))
+        panic("cannot create %s\n", argv[2]);
+    const char *name = strrchr(argv[1], '/');
+    fprintf(f, "# generated from %s by host/regalloc: edit that instead.\n", name ? name + 1 : argv[1]);
+    fputs(out, f);
+    fclose(f);
+    printf("%s: %u instructions, %u virtual registers (%u in accumulators), %u movs and %u nops added\n",
+        argv[2], s.nins, s.nvregs, s.nacc, s.nmovs, s.nnops);
+    return 0;
+}
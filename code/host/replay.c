@@ -0,0 +1,32 @@
+// replay a launch captured on the Pi (gpu-capture.h) on the timing model
+// and compare the memory it leaves with what the Pi's QPUs left.
+//
+//   usage: replay file.qcap
+//
+// exits 1 if the capture is bad or the kernel faults, 2 if memory differs.
+#include "rpi.h"
+#include "qpu-replay.h"
+
+static uint32_t buf[(64 << 20) / 4];
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+        panic("usage: replay file.qcap\n");
+    FILE *f = fopen(argv[1], "rb");
+    if (!f)
+        panic("cannot open %s\n", argv[1]);
+    size_t n = fread(buf, 1, sizeof buf, f);
+    fclose(f);
+
+    qpu_replay_t *r = qpu_replay_load(buf, n);
+    if (qpu_replay_run(r) < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], r->err);
+        return 1;
+    }
+    qpu_replay_report(r);
+    int ret = r->ndiff ? 2 : 0;
+    qpu_replay_free(r);
+    return ret;
+}
@@ -0,0 +1,39 @@
+#ifndef __HOST_RPI_H__
+#define __HOST_RPI_H__
+/*
+ * Host stand-in for libpi's rpi.h: just enough of the libpi interface for
+ * the GPU runtime sources in ../ to build and run on Linux.  MMIO is not
+ * available here, so anything that reaches GET32/PUT32 panics --- host
+ * builds must install a backend (e.g. v3d_set_backend) first.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define printk printf
+#define output printf
+
+#define panic(fmt, args...) do {                                    \
+    printf("PANIC:%s:%s:%d:" fmt, __FILE__, __func__, __LINE__, ##args);  \
+    exit(1);                                                        \
+} while(0)
+
+// like libpi: never compiled out, so side effects in 'x' always happen.
+#define assert(x) do {                                              \
+    if(!(x))                                                        \
+        panic("ERROR: assertion `%s` failed\n", #x);                \
+} while(0)
+
+#define trace(fmt, args...) printk("TRACE:%s:" fmt, __func__, ##args)
+
+uint32_t GET32(uint32_t addr);
+void PUT32(uint32_t addr, uint32_t v);
+
+unsigned timer_get_usec(void);
+void delay_ms(unsigned ms);
+
+void kmalloc_init(unsigned mb);
+void *kmalloc(unsigned nbytes);
+
+#endif
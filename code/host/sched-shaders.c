@@ -0,0 +1,74 @@
+// run the QPU scheduler (qpu-sched.h) over the assembled shaders and write
+// the results next to them, as <name>-sched.c and .h in vc4asm's layout,
+// with a before/after report on stdout.  Nothing launches the copies on
+// the Pi yet; they are there to compare with the originals.
+//
+//   usage: sched-shaders [dir]     (default ..)
+#include "rpi.h"
+#include "qpu-sched.h"
+#include "addshader.h"
+#include "mulshader.h"
+#include "simpleshader.h"
+#include "mandelbrotshader.h"
+
+static const struct
+{
+    const char *name;
+    const uint32_t *code;
+    unsigned nwords;
+} shaders[] = {
+    { "addshader", addshader, sizeof addshader / 4 },
+    { "mulshader", mulshader, sizeof mulshader / 4 },
+    { "simpleshader", simpleshader, sizeof simpleshader / 4 },
+    { "mandelbrotshader", mandelbrotshader, sizeof mandelbrotshader / 4 },
+};
+
+static FILE *create(const char *dir, const char *name, const char *ext)
+{
+    char path[512];
+    snprintf(path, sizeof path, "%s/%s-sched.%s", dir, name, ext);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        panic("cannot create %s\n", path);
+    return f;
+}
+
+static void write_shader(const char *dir, const char *name, const uint32_t *w, int n)
+{
+    FILE *f = create(dir, name, "h");
+    fprintf(f, "#ifndef %s_sched_H\n#define %s_sched_H\n\n#include <inttypes.h>\n\n", name, name);
+    fprintf(f, "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n");
+    fprintf(f, "// %s after host/sched-shaders; regenerate with \"make -C host shaders\".\n", name);
+    fprintf(f, "extern uint32_t %s_sched[%d];\n\n\n", name, 2 * n);
+    fprintf(f, "#ifdef __cplusplus\n}\n#endif\n#endif\n");
+    fclose(f);
+
+    f = create(dir, name, "c");
+    fprintf(f, "#include \"%s-sched.h\"\n\n#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n", name);
+    fprintf(f, "#ifdef _MSC_VER\n__declspec(align(8))\n#elif defined(__GNUC__)\n__attribute__((aligned(8)))\n#endif\n");
+    fprintf(f, "uint32_t %s_sched[%d] = {\n", name, 2 * n);
+    for (int i = 0; i < n; i++)
+        fprintf(f, "0x%08x, 0x%08x%s\n", w[2 * i], w[2 * i + 1], i + 1 < n ? "," : "");
+    fprintf(f, "};\n#ifdef __HIGHC__\n#pragma Align_to(8, %s_sched)\n#endif\n", name);
+    fprintf(f, "#ifdef __cplusplus\n}\n#endif\n");
+    fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    static uint32_t out[2 * QPU_SCHED_MAX_INS];
+    const char *dir = argc > 1 ? argv[1] : "..";
+
+    printf("%-18s %6s %6s %6s %6s %6s %9s\n", "shader", "before", "after", "nops", "paired", "slots", "verbatim");
+    for (int i = 0; i < sizeof shaders / sizeof shaders[0]; i++)
+    {
+        qpu_sched_stats_t s;
+        int n = qpu_sched(shaders[i].code, shaders[i].nwords / 2, out, QPU_SCHED_MAX_INS, &s);
+        if (n < 0)
+            panic("%s: does not fit\n", shaders[i].name);
+        write_shader(dir, shaders[i].name, out, n);
+        printf("%-18s %6u %6u %6u %6u %6u %5u of %u\n", shaders[i].name, s.nin, s.nout,
+            s.nnops, s.npaired, s.nslots, s.nverbatim, s.nblocks);
+    }
+    return 0;
+}
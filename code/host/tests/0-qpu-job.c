@@ -0,0 +1,251 @@
+// exercise the qpu_job submit/poll/wait state machine against the V3D mock.
+#include "rpi.h"
+#include "v3d.h"
+#include "v3d-mock.h"
+
+static uint32_t unifs[4] = { 0x40001000, 0x40001100, 0x40001200, 0x40001300 };
+
+static void test_poll(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    assert(qpu_job_wait(&job) < 0);
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, 0) == 0);
+
+    // one request per QPU, each with its own uniforms.
+    assert(v3d_mock.nreq == 4);
+    for (int q = 0; q < 4; q++)
+    {
+        assert(v3d_mock.req[q].code == 0x40000000);
+        assert(v3d_mock.req[q].unif == unifs[q]);
+    }
+    assert(v3d_mock.dbqite == 0);
+
+    // only one job may own the scheduler.
+    qpu_job_t other = {0};
+    assert(qpu_job_submit(&other, 0x40000000, unifs, 4, 0) < 0);
+
+    assert(!qpu_job_is_done(&job));
+    v3d_mock_complete(3);
+    assert(!qpu_job_is_done(&job));
+    assert(job.state == QPU_JOB_RUNNING);
+    v3d_mock_complete(1);
+    assert(qpu_job_is_done(&job));
+    assert(job.state == QPU_JOB_DONE);
+
+    // done is sticky and does not touch the hardware again.
+    unsigned reads = v3d_mock.srqcs_reads;
+    assert(qpu_job_is_done(&job));
+    assert(v3d_mock.srqcs_reads == reads);
+
+    // a job is at most one FIFO of requests.
+    static uint32_t many[V3D_SRQ_DEPTH + 1];
+    assert(qpu_job_submit(&other, 0x40000000, many, V3D_SRQ_DEPTH + 1, 0) < 0);
+
+    // the scheduler is free again.
+    assert(qpu_job_submit(&other, 0x40000000, unifs, 2, 0) == 0);
+    v3d_mock_complete(2);
+    assert(qpu_job_wait(&other) == 0);
+    printk("poll: ok\n");
+}
+
+static void test_wait(void)
+{
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+
+    // the synchronous wrapper still works on top of submit+wait.
+    assert(gpu_fft_base_exec_direct(0x40000000, unifs, 4) == 0);
+    assert(v3d_mock.ndone == 4);
+    assert(v3d_mock.srqcs_reads >= 4);
+    printk("wait: ok\n");
+}
+
+static void test_irq(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_IRQ) == 0);
+    assert(v3d_mock.dbqite == V3D_QPU_IRQ_MASK);
+
+    // the interrupt retires the job.
+    v3d_mock_complete(4);
+    assert(v3d_mock.dbqitc);
+    v3d_irq_handler();
+    assert(v3d_mock.dbqitc == 0);
+    assert(job.state == QPU_JOB_DONE);
+    assert(qpu_job_is_done(&job));
+    assert(qpu_job_wait(&job) == 0);
+
+    // a spurious interrupt is harmless.
+    v3d_irq_handler();
+    printk("irq: ok\n");
+}
+
+static void test_irq_partial(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_IRQ) == 0);
+    v3d_mock_complete(2);
+    v3d_irq_handler();
+    assert(!qpu_job_is_done(&job));
+    v3d_mock_complete(2);
+    v3d_irq_handler();
+    assert(qpu_job_is_done(&job));
+    printk("irq partial: ok\n");
+}
+
+// the last QPU's interrupt arrives before the scheduler counts its program:
+// no interrupt follows, and waiting finishes the job from the count.
+static void test_irq_early(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_IRQ) == 0);
+    v3d_mock_complete(3);
+    v3d_mock.dbqitc |= 1 << 3;
+    v3d_irq_handler();
+    assert(job.state == QPU_JOB_RUNNING && v3d_mock.dbqitc == 0);
+
+    v3d_mock.dbqite = 0;
+    v3d_mock_complete(1);
+    assert(!v3d_mock.dbqitc);
+    assert(qpu_job_wait(&job) == 0 && job.state == QPU_JOB_DONE);
+    printk("irq early: ok\n");
+}
+
+static void test_resident(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+
+    // first launch takes the full path even when asked for the fast one.
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_RESIDENT) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    unsigned full = v3d_mock.nwrites;
+    assert(v3d_mock.slcactl == 0xffffffff);
+
+    // relaunching it skips the setup, keeps the instruction cache, and
+    // the completed count keeps running past its 8-bit wrap.
+    for (int i = 0; i < 100; i++)
+    {
+        unsigned before = v3d_mock.nwrites;
+        v3d_mock.slcactl = 0;
+        assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_RESIDENT) == 0);
+        assert(v3d_mock.nwrites - before < full);
+        assert(!(v3d_mock.slcactl & V3D_SLCACTL_ICC));
+        assert(qpu_job_wait(&job) == 0);
+        assert(v3d_mock.ndone == 4 * (i + 2));
+    }
+
+    // different uniforms: full path again (less the first launch's two
+    // cache clears, since nothing was reported dirty).
+    uint32_t other[4] = { 1, 2, 3, 4 };
+    unsigned before = v3d_mock.nwrites;
+    assert(qpu_job_submit(&job, 0x40000000, other, 4, QPU_JOB_RESIDENT) == 0);
+    assert(v3d_mock.nwrites - before == full - 2);
+    assert(qpu_job_wait(&job) == 0);
+
+    // so does an invalidated kernel.
+    v3d_invalidate();
+    before = v3d_mock.nwrites;
+    assert(qpu_job_submit(&job, 0x40000000, other, 4, QPU_JOB_RESIDENT) == 0);
+    assert(v3d_mock.nwrites - before == full - 2);
+    assert(qpu_job_wait(&job) == 0);
+    printk("resident: ok\n");
+}
+
+static void test_cache_policy(void)
+{
+    qpu_job_t job = {0};
+
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+
+    // nothing is known after boot, so the first launch clears everything.
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, 0) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    assert(v3d_mock.nl2clear == 1 && v3d_mock.slcclear == 0xffffffff);
+
+    // then only what was reported dirty.
+    v3d_mock.slcclear = 0;
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, 0) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    assert(v3d_mock.nl2clear == 1 && v3d_mock.slcclear == 0);
+
+    v3d_cache_dirty(V3D_CACHE_UNIF);
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_RESIDENT) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    assert(v3d_mock.nl2clear == 1 && v3d_mock.slcclear == V3D_SLCACTL_UCC);
+
+    v3d_mock.slcclear = 0;
+    v3d_cache_dirty(V3D_CACHE_L2 | V3D_CACHE_INSN | V3D_CACHE_TMU);
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_RESIDENT) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    assert(v3d_mock.nl2clear == 2);
+    assert(v3d_mock.slcclear == (V3D_SLCACTL_ICC | V3D_SLCACTL_T0CC | V3D_SLCACTL_T1CC));
+
+    // the flush-all policy ignores the tracking.
+    v3d_cache_policy(V3D_CACHE_FLUSH_ALL);
+    v3d_mock.slcclear = 0;
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, QPU_JOB_RESIDENT) == 0);
+    assert(qpu_job_wait(&job) == 0);
+    assert(v3d_mock.nl2clear == 3 && v3d_mock.slcclear == 0xffffffff);
+    v3d_cache_policy(V3D_CACHE_TRACKED);
+    printk("cache policy: ok\n");
+}
+
+static void test_batch(void)
+{
+    enum { NREQ = 1000 };
+    static qpu_req_t reqs[NREQ];
+
+    // heterogeneous requests: a few kernels, distinct uniforms each.
+    for (int i = 0; i < NREQ; i++)
+        reqs[i] = (qpu_req_t){ .code = 0x40000000 + (i % 3) * 0x100, .unif = 0x40100000 + i * 16 };
+
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+    assert(qpu_batch_run(reqs, NREQ) == 0);
+
+    // every request went out, in order, without overflowing the FIFO,
+    // and the FIFO was actually kept busy.
+    assert(v3d_mock.nreq == NREQ && v3d_mock.ndone == NREQ);
+    assert(!v3d_mock.overflow);
+    assert(v3d_mock.max_qlen == V3D_SRQ_DEPTH);
+    for (int i = NREQ - V3D_MOCK_MAXREQ; i < NREQ; i++)
+    {
+        assert(v3d_mock.req[i % V3D_MOCK_MAXREQ].code == reqs[i].code);
+        assert(v3d_mock.req[i % V3D_MOCK_MAXREQ].unif == reqs[i].unif);
+    }
+
+    // a batch cannot start while a job owns the scheduler.
+    qpu_job_t job = {0};
+    v3d_mock.auto_complete = 0;
+    assert(qpu_job_submit(&job, 0x40000000, unifs, 4, 0) == 0);
+    assert(qpu_batch_run(reqs, 4) < 0);
+    v3d_mock_complete(4);
+    assert(qpu_job_wait(&job) == 0);
+    printk("batch: ok\n");
+}
+
+int main(void)
+{
+    test_poll();
+    test_wait();
+    test_irq();
+    test_irq_partial();
+    test_irq_early();
+    test_resident();
+    test_cache_policy();
+    test_batch();
+    printk("SUCCESS: qpu job state machine\n");
+    return 0;
+}
@@ -0,0 +1,313 @@
+// gpu context sub-allocation, address translation and kernel launch,
+// against host memory and the V3D mock.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-mock.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+#include "addshader.h"
+
+static void test_alloc(void)
+{
+    gpu_ctx_t ctx;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 64 * 1024) == 0);
+    assert(host_mem_stats.qpu_enabled);
+    assert(host_mem_stats.nalloc == 1 && host_mem_stats.nlock == 1);
+
+    // the cached flags give the 0x4 alias, like the firmware does.
+    assert((ctx.bus & GPU_ALIAS_MASK) == GPU_BASE);
+
+    volatile uint8_t *a = gpu_alloc(&ctx, 3, 1);
+    volatile uint8_t *b = gpu_alloc(&ctx, 100, 4096);
+    assert(a && b);
+    assert(((uintptr_t)a & 3) == 0);
+    assert((gpu_bus(&ctx, b) & 4095) == 0);
+    assert(b - a == 4096);
+
+    // bus <-> cpu round trips.
+    assert(gpu_bus_to_cpu(gpu_bus(&ctx, b)) == b);
+    b[7] = 0x5a;
+    assert(((volatile uint8_t *)host_mem_ptr(gpu_bus(&ctx, b)))[7] == 0x5a);
+
+    // too big fails without disturbing the heap.
+    uint32_t used = ctx.used;
+    assert(!gpu_alloc(&ctx, 64 * 1024, 4));
+    assert(ctx.used == used);
+
+    // LIFO free.
+    volatile uint8_t *c = gpu_alloc(&ctx, 16, 16);
+    assert(c > b);
+    gpu_free(&ctx, b);
+    assert(gpu_alloc(&ctx, 16, 16) == b);
+
+    // two contexts share one qpu_enable, and the last release disables.
+    gpu_ctx_t ctx2;
+    assert(gpu_init(&ctx2, 4096) == 0);
+    assert(host_mem_stats.nenable == 1);
+    gpu_release(&ctx);
+    assert(host_mem_stats.qpu_enabled);
+    gpu_release(&ctx2);
+    assert(!host_mem_stats.qpu_enabled);
+    assert(host_mem_stats.nfree == 2 && host_mem_stats.nunlock == 2);
+    assert(host_mem_stats.bytes_live == 0);
+    printk("alloc: ok\n");
+}
+
+static void test_kernel(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+
+    host_mem_reset();
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+
+    assert(gpu_init(&ctx, 64 * 1024) == 0);
+    assert(gpu_kernel_init(&ctx, &k, addshader, sizeof addshader, 17) < 0);
+    assert(gpu_kernel_init(&ctx, &k, addshader, sizeof addshader, 4) == 0);
+    assert((k.code & 7) == 0);
+    assert(memcmp((void *)gpu_bus_to_cpu(k.code), addshader, sizeof addshader) == 0);
+
+    volatile uint32_t *u = gpu_kernel_unifs(&ctx, &k, 3);
+    assert(u);
+    for (int q = 0; q < 4; q++)
+        assert(gpu_bus_to_cpu(k.unif[q]) == &u[q * 3]);
+
+    assert(gpu_launch(&k) == 0);
+    assert(v3d_mock.nreq == 4);
+    for (int q = 0; q < 4; q++)
+    {
+        assert(v3d_mock.req[q].code == k.code);
+        assert(v3d_mock.req[q].unif == k.unif[q]);
+    }
+
+    qpu_job_t job = {0};
+    v3d_mock.auto_complete = 0;
+    assert(gpu_launch_async(&k, &job, 0) == 0);
+    assert(!qpu_job_is_done(&job));
+    v3d_mock_complete(4);
+    assert(qpu_job_wait(&job) == 0);
+
+    gpu_release(&ctx);
+    printk("kernel: ok\n");
+}
+
+static void test_vec_add(void)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *add;
+
+    host_mem_reset();
+    v3d_mock_init();
+
+    // a 64-element add costs a few KB, not the 12MB of a fixed 1M array.
+    assert(vec_add_size(64) < 4096);
+    assert(gpu_init(&ctx, vec_add_size(64)) == 0);
+    vec_add_init(&ctx, &add, 64, NUM_QPUS);
+    assert(add->n == 64);
+
+    // each QPU covers its own contiguous slice; together they cover n.
+    uint32_t covered = 0;
+    for (int q = 0; q < add->kernel.num_qpus; q++)
+    {
+        volatile uint32_t *u = gpu_bus_to_cpu(add->kernel.unif[q]);
+        assert(u[4] == q);
+        assert(gpu_bus_to_cpu(u[1]) == &add->A[covered]);
+        assert(gpu_bus_to_cpu(u[2]) == &add->B[covered]);
+        assert(gpu_bus_to_cpu(u[3]) == &add->C[covered]);
+        covered += u[0] * ADD_BLOCK;
+    }
+    assert(covered >= 64);
+    assert((gpu_bus(&ctx, add->A) & 63) == 0);
+
+    // release hands the whole region back.
+    uint32_t used = ctx.used;
+    vec_add_release(add);
+    assert(ctx.used < used);
+    gpu_release(&ctx);
+    printk("vec add: ok\n");
+}
+
+static void test_partition(void)
+{
+    uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+
+    // every split covers [0, nblocks) in order, is balanced to within one
+    // block, and never hands a QPU zero blocks.
+    for (uint32_t nblocks = 0; nblocks < 200; nblocks++)
+        for (int q = 1; q <= V3D_NUM_QPUS; q++)
+        {
+            int used = gpu_partition(nblocks, q, first, count);
+            assert(used == (nblocks < q ? nblocks : q));
+            uint32_t next = 0, lo = -1, hi = 0;
+            for (int i = 0; i < used; i++)
+            {
+                assert(first[i] == next);
+                assert(count[i] > 0);
+                next += count[i];
+                lo = count[i] < lo ? count[i] : lo;
+                hi = count[i] > hi ? count[i] : hi;
+            }
+            assert(next == nblocks);
+            assert(!used || hi - lo <= 1);
+        }
+    assert(gpu_partition(10, 0, first, count) == 0);
+
+    // odd sizes: the tail block is padded, not dropped or overrun.
+    gpu_ctx_t ctx;
+    struct mulGPU *mul;
+    host_mem_reset();
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+    assert(gpu_init(&ctx, vec_mul_size(1000)) == 0);
+    vec_mul_init(&ctx, &mul, 1000, 3);
+    assert(mul->kernel.num_qpus == 3);
+    uint32_t blocks = 0;
+    for (int q = 0; q < 3; q++)
+    {
+        volatile uint32_t *u = gpu_bus_to_cpu(mul->kernel.unif[q]);
+        assert(gpu_bus_to_cpu(u[1]) == &mul->A[blocks * MUL_BLOCK]);
+        blocks += u[0];
+    }
+    assert(blocks * MUL_BLOCK >= 1000 && (blocks - 1) * MUL_BLOCK < 1000);
+
+    // re-splitting reuses the same uniforms and launches that many QPUs.
+    uint32_t used = ctx.used;
+    assert(vec_mul_set_qpus(mul, V3D_NUM_QPUS) == V3D_NUM_QPUS);
+    assert(ctx.used == used);
+    assert(vec_mul_exec(mul) >= 0);
+    assert(v3d_mock.nreq == V3D_NUM_QPUS);
+    assert(vec_mul_set_qpus(mul, 1) == 1);
+    assert(*(volatile uint32_t *)gpu_bus_to_cpu(mul->kernel.unif[0]) == blocks);
+    gpu_release(&ctx);
+    printk("partition: ok\n");
+}
+
+static void test_cache(void)
+{
+    static const uint32_t mems[] = { GPU_MEM_CACHED, GPU_MEM_COHERENT, GPU_MEM_DIRECT };
+    static const uint32_t aliases[] = { 0x40000000, 0x80000000, 0xC0000000 };
+
+    for (int m = 0; m < 3; m++)
+    {
+        gpu_ctx_t ctx;
+        struct addGPU *add;
+
+        host_mem_reset();
+        v3d_mock_init();
+        v3d_mock.auto_complete = 1;
+        assert(gpu_init_mem(&ctx, vec_add_size(256), mems[m]) == 0);
+        assert(ctx.mem == mems[m]);
+        assert((ctx.bus & GPU_ALIAS_MASK) == aliases[m]);
+        vec_add_init(&ctx, &add, 256, 4);
+        assert(vec_add_exec(add) >= 0);
+
+        // rewriting the DMA'd vectors needs no cache maintenance.
+        unsigned l2 = v3d_mock.nl2clear;
+        v3d_mock.slcclear = 0;
+        for (int i = 0; i < 256; i++)
+            add->A[i] = i;
+        assert(vec_add_exec(add) >= 0);
+        assert(v3d_mock.nl2clear == l2 && v3d_mock.slcclear == 0);
+
+        // new uniforms clear the uniforms cache and the V3D L2, whatever
+        // the memory's alias.
+        vec_add_set_qpus(add, 2);
+        assert(vec_add_exec(add) >= 0);
+        assert(v3d_mock.slcclear == V3D_SLCACTL_UCC);
+        assert(v3d_mock.nl2clear == l2 + 1);
+
+        v3d_mock.slcclear = 0;
+        gpu_dirty(GPU_DIRTY_CODE | GPU_DIRTY_TEX);
+        assert(vec_add_exec(add) >= 0);
+        assert(v3d_mock.slcclear == (V3D_SLCACTL_ICC | V3D_SLCACTL_T0CC | V3D_SLCACTL_T1CC));
+        gpu_release(&ctx);
+    }
+    printk("cache: ok\n");
+}
+
+static void test_many_small(void)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *add[32];
+    struct mulGPU *mul[32];
+
+    host_mem_reset();
+    v3d_mock_init();
+    assert(gpu_init(&ctx, 32 * (vec_add_size(100) + vec_mul_size(100))) == 0);
+    for (int i = 0; i < 32; i++)
+    {
+        add[i] = 0;
+        mul[i] = 0;
+        vec_add_init(&ctx, &add[i], 100, NUM_QPUS);
+        vec_mul_init(&ctx, &mul[i], 100, NUM_QPUS);
+        assert(add[i] && mul[i]);
+    }
+
+    // none of the vectors overlap.
+    for (int i = 1; i < 32; i++)
+    {
+        assert(add[i]->A >= mul[i - 1]->C + 100);
+        assert(mul[i]->A >= add[i]->C + 100);
+    }
+    for (int i = 31; i >= 0; i--)
+    {
+        vec_mul_release(mul[i]);
+        vec_add_release(add[i]);
+    }
+    assert(ctx.used == 0);
+    gpu_release(&ctx);
+    printk("many small: ok\n");
+}
+
+static void test_batch(void)
+{
+    gpu_ctx_t ctx;
+    struct mulGPU *mul[8];
+    qpu_req_t reqs[8];
+    gpu_batch_t b;
+
+    host_mem_reset();
+    v3d_mock_init();
+    v3d_mock.auto_complete = 1;
+    assert(gpu_init(&ctx, 8 * vec_mul_size(64)) == 0);
+
+    gpu_batch_init(&b, reqs, 8);
+    for (int i = 0; i < 8; i++)
+    {
+        vec_mul_init(&ctx, &mul[i], 64, NUM_QPUS);
+        // mulshader's rows are fixed: it would share them with the others.
+        assert(mul[i]->kernel.code == mul[i]->generic && !mul[i]->kernel.any_qpu);
+        assert(gpu_batch_add(&b, &mul[i]->kernel) < 0 && b.n == i);
+        mul[i]->batch = 1;
+        assert(vec_mul_set_qpus(mul[i], 1) == 1 && mul[i]->kernel.any_qpu);
+        assert(gpu_batch_add(&b, &mul[i]->kernel) == 0);
+    }
+    assert(gpu_batch_add(&b, &mul[0]->kernel) < 0);
+    assert(b.n == 8 * mul[0]->kernel.num_qpus);
+
+    assert(gpu_batch_run(&b) == 0);
+    assert(b.n == 0);
+    assert(v3d_mock.ndone == 8 * mul[0]->kernel.num_qpus);
+    for (int i = 0; i < 8; i++)
+        for (int q = 0; q < mul[i]->kernel.num_qpus; q++)
+            assert(v3d_mock.req[i * mul[i]->kernel.num_qpus + q].unif == mul[i]->kernel.unif[q]);
+    gpu_release(&ctx);
+    printk("batch: ok\n");
+}
+
+int main(void)
+{
+    test_alloc();
+    test_kernel();
+    test_vec_add();
+    test_partition();
+    test_cache();
+    test_many_small();
+    test_batch();
+    printk("SUCCESS: gpu runtime\n");
+    return 0;
+}
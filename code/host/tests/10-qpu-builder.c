@@ -0,0 +1,196 @@
+// the run-time kernel builder: the fixes it makes on a small program, and
+// the ready-made map and fold kernels, generic and specialized, run on the
+// emulator against the CPU.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-builder.h"
+
+#define N (16 * 8 * 5 * 12)  // elements: whole blocks at every row count used
+
+static gpu_ctx_t ctx;
+static volatile uint32_t *A, *B, *C;
+
+static float f(uint32_t u)
+{
+    float x;
+    memcpy(&x, &u, 4);
+    return x;
+}
+
+static uint32_t u(float x)
+{
+    uint32_t v;
+    memcpy(&v, &x, 4);
+    return v;
+}
+
+static void setup(void)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, 1024 * 1024) == 0);
+    A = gpu_alloc(&ctx, 4 * N, 64);
+    B = gpu_alloc(&ctx, 4 * N, 64);
+    C = gpu_alloc(&ctx, 4 * N, 64);
+    assert(A && B && C);
+}
+
+static void test_small(void)
+{
+    uint32_t code[2 * 16];
+    qb_t b;
+
+    qb_init(&b, code, 16);
+    qb_var_t x = qb_var(&b), y = qb_var(&b), z = qb_var(&b);
+    assert(x == QB_A(0) && y == QB_B(0) && z == QB_A(1));
+
+    // x is read right after it is written: a nop in between.
+    qb_mov(&b, x, QB_UNIF);
+    qb_op(&b, QPU_A_ADD, 0, y, x, QB_IMM(3));
+    assert(b.n == 3 && code[2] == 0x009e7000);
+    assert(QPU_SIG(QPU_INS(code[4], code[5])) == QPU_SIG_SMALL_IMM);
+
+    // x and z are both in file A: z goes through r3 first.
+    qb_op(&b, QB_FMUL, QB_SETF, QB_R(0), x, z);
+    uint64_t mov = QPU_INS(code[6], code[7]), mul = QPU_INS(code[8], code[9]);
+    assert(b.n == 5);
+    assert(QPU_OP_ADD(mov) == QPU_A_OR && QPU_WADDR_ADD(mov) == QPU_W_R3 && QPU_RADDR_A(mov) == 1);
+    assert(QPU_OP_MUL(mul) == QPU_M_FMUL && QPU_WADDR_MUL(mul) == QPU_W_R0 && QPU_SF(mul));
+    assert(QPU_RADDR_A(mul) == 0 && QPU_MUL_A(mul) == QPU_MUX_A && QPU_MUL_B(mul) == QPU_MUX_R3);
+    assert(QPU_COND_ADD(mul) == QPU_COND_NEVER);
+
+    // a write to file A from the mul pipe swaps the files.
+    qb_op(&b, QB_MUL24, 0, z, QB_R(0), QB_R(0));
+    assert(QPU_WS(QPU_INS(code[10], code[11])) && QPU_WADDR_MUL(QPU_INS(code[10], code[11])) == 1);
+
+    // out of space is sticky.
+    for (int i = 0; i < 16; i++)
+        qb_mov(&b, QB_R(0), QB_R(1));
+    assert(b.err && b.n == 16);
+    gpu_kernel_t k;
+    assert(qb_kernel_init(&b, &ctx, &k, 1) < 0);
+    printk("small: ok\n");
+}
+
+static uint32_t expect(int op, uint32_t a, uint32_t b)
+{
+    switch (op)
+    {
+    case QPU_A_ADD:
+        return a + b;
+    case QB_FMUL:
+        return u(f(a) * f(b));
+    case QB_MUL24:
+        return (a & 0xffffff) * (b & 0xffffff);
+    }
+    panic("bad op %d\n", op);
+}
+
+// C = A op B on 'nq' QPUs; 'special' builds the block count into the code.
+static void run_map2(int op, int nq, int special)
+{
+    uint32_t rows = qb_map2_rows(nq), nblocks = N / (16 * rows), first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+    gpu_kernel_t k;
+    qb_t b;
+
+    setup();
+    for (int i = 0; i < N; i++)
+    {
+        A[i] = op == QB_FMUL ? u(i * 0.25f - 100) : i * 0x10101u;
+        B[i] = op == QB_FMUL ? u(3.5f - i * 0.125f) : 0x123457u * (i + 1);
+        C[i] = 0xdeadbeef;
+    }
+    int used = gpu_partition(nblocks, nq, first, count);
+    assert(used == nq && (!special || nblocks % nq == 0));
+
+    assert(qb_init_gpu(&b, &ctx, 512) == 0);
+    qb_map2(&b, op, rows, special ? nblocks / nq : 0);
+    assert(!b.err && b.nunifs == (special ? 4 : 5));
+    assert(qb_kernel_init(&b, &ctx, &k, nq) == 0);
+
+    volatile uint32_t *un = gpu_kernel_unifs(&ctx, &k, b.nunifs);
+    for (int q = 0; q < nq; q++, un += b.nunifs)
+    {
+        int i = 0;
+        uint32_t off = 64 * rows * first[q];
+        if (!special)
+            un[i++] = count[q];
+        un[i++] = gpu_bus(&ctx, A) + off;
+        un[i++] = gpu_bus(&ctx, B) + off;
+        un[i++] = gpu_bus(&ctx, C) + off;
+        un[i++] = q;
+    }
+    assert(gpu_launch(&k) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+    for (int i = 0; i < N; i++)
+        if (C[i] != expect(op, A[i], B[i]))
+            panic("op %d on %d QPUs: C[%d] = %x, want %x\n", op, nq, i, C[i], expect(op, A[i], B[i]));
+    printk("map2 op %d, %d QPUs, %d rows%s: %d instructions, ok\n",
+        op, nq, rows, special ? ", specialized" : "", b.n);
+}
+
+// each QPU's blocks of A folded to one row of C.
+static void run_fold(int op, int nq, int special)
+{
+    uint32_t nblocks = N / 16, first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+    gpu_kernel_t k;
+    qb_t b;
+
+    setup();
+    for (int i = 0; i < N; i++)
+        A[i] = op == QPU_A_FMAX ? u((i * 37 % 1001) * 0.5f - 17) : i * 7u + 1;
+    int used = gpu_partition(nblocks, nq, first, count);
+    assert(used == nq);
+
+    assert(qb_init_gpu(&b, &ctx, 512) == 0);
+    qb_fold(&b, op, special ? count[0] : 0);
+    assert(qb_kernel_init(&b, &ctx, &k, nq) == 0);
+    volatile uint32_t *un = gpu_kernel_unifs(&ctx, &k, b.nunifs);
+    for (int q = 0; q < nq; q++, un += b.nunifs)
+    {
+        int i = 0;
+        if (!special)
+            un[i++] = count[q];
+        un[i++] = gpu_bus(&ctx, A) + 64 * first[q];
+        un[i++] = gpu_bus(&ctx, C) + 64 * q;
+        un[i++] = q;
+    }
+    assert(gpu_launch(&k) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+
+    for (int q = 0; q < nq; q++)
+    {
+        uint32_t want = A[16 * first[q]];
+        for (uint32_t i = 16 * first[q] + 1; i < 16 * (first[q] + count[q]); i++)
+            want = op == QPU_A_FMAX ? (f(A[i]) > f(want) ? A[i] : want) : want + A[i];
+        for (int l = 0; l < 16; l++)
+            if (C[16 * q + l] != want)
+                panic("fold op %d QPU %d lane %d: %x, want %x\n", op, q, l, C[16 * q + l], want);
+    }
+    printk("fold op %d, %d QPUs%s: %d instructions, ok\n", op, nq, special ? ", specialized" : "", b.n);
+}
+
+int main(void)
+{
+    setup();
+    test_small();
+
+    int ops[] = { QPU_A_ADD, QB_FMUL, QB_MUL24 };
+    for (int i = 0; i < 3; i++)
+    {
+        run_map2(ops[i], 1, 0);
+        run_map2(ops[i], 6, 0);
+        run_map2(ops[i], 4, 1);
+        run_map2(ops[i], 12, 1);
+    }
+    run_map2(QPU_A_ADD, 8, 1);
+    run_fold(QPU_A_ADD, 1, 0);
+    run_fold(QPU_A_ADD, 12, 0);
+    run_fold(QPU_A_FMAX, 4, 1);
+    printk("SUCCESS: qpu builder\n");
+    return 0;
+}
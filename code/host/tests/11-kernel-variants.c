@@ -0,0 +1,199 @@
+// kernels specialized to fixed sizes: the checked-in table against the
+// builder, and add, mul and mandelbrot through their runtimes picking a
+// variant, against the CPU and the generic shaders on the emulator.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-builder.h"
+#include "kernel-variants.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+#include "mandelbrot.h"
+#include "mandelbrotshader.h"
+#include "kernel-abi.h"
+
+#define LEN 4096
+#define RES 64
+#define ITERS 100
+
+static gpu_ctx_t ctx;
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+// instructions the emulator ran for one launch.
+static uint64_t run(gpu_kernel_t *k)
+{
+    uint64_t before = v3d_emu.qpu.ninstr;
+    assert(gpu_launch(k) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+    return v3d_emu.qpu.ninstr - before;
+}
+
+static void test_table(void)
+{
+    static uint32_t code[2 * 1024];
+    qb_t b;
+    int n = 0;
+
+    // every entry is what the builder makes now.
+    for (const kernel_variant_t *v = add_variants; v->code; v++, n++)
+    {
+        qb_init(&b, code, 1024);
+        qb_map2(&b, QPU_A_ADD, v->rows, v->size / (16 * v->rows * v->num_qpus));
+        if (8 * b.n != v->nbytes || memcmp(code, v->code, v->nbytes) != 0)
+            panic("kernel-variants-table.c is out of date: make -C host variants\n");
+    }
+    for (const kernel_variant_t *v = mandelbrot_variants; v->code; v++, n++)
+    {
+        qb_init(&b, code, 1024);
+        qb_mandelbrot(&b, v->size, mandelbrot_step(v->size), v->iters, v->num_qpus);
+        if (8 * b.n != v->nbytes || memcmp(code, v->code, v->nbytes) != 0)
+            panic("kernel-variants-table.c is out of date: make -C host variants\n");
+    }
+    assert(n > 0);
+    assert(kernel_variant(add_variants, LEN, 0, 4) && !kernel_variant(add_variants, LEN + 16, 0, 4));
+    assert(!kernel_variant(add_variants, LEN, 0, 3));
+    printk("table: ok\n");
+}
+
+static void test_add(void)
+{
+    struct addGPU *add;
+
+    setup(vec_add_size(LEN));
+    vec_add_init(&ctx, &add, LEN, 4);
+    assert(add->kernel.code == add->special[4] && add->special[4] != add->generic);
+    for (int i = 0; i < LEN; i++)
+    {
+        add->A[i] = i * 3;
+        add->B[i] = 0x10000 - i;
+    }
+    uint64_t special = run(&add->kernel);
+    for (int i = 0; i < LEN; i++)
+        assert(add->C[i] == 0x10000 + 2 * i);
+
+    // the generic shader on the same QPUs.
+    add->special[4] = 0;
+    assert(vec_add_set_qpus(add, 4) == 4 && add->kernel.code == add->generic);
+    memset((void *)add->C, 0, 4 * LEN);
+    uint64_t generic = run(&add->kernel);
+    for (int i = 0; i < LEN; i++)
+        assert(add->C[i] == 0x10000 + 2 * i);
+
+    // a QPU count without a variant.
+    assert(vec_add_set_qpus(add, 3) == 3 && add->kernel.code == add->generic);
+    printk("add %d on 4 QPUs: %llu instructions specialized, %llu generic\n",
+        LEN, (unsigned long long)special, (unsigned long long)generic);
+    assert(2 * special < generic);
+    vec_add_release(add);
+}
+
+static void test_mul(void)
+{
+    struct mulGPU *mul;
+
+    // one QPU: mulshader's VPM rows do not depend on the QPU.
+    setup(vec_mul_size(LEN));
+    vec_mul_init(&ctx, &mul, LEN, 1);
+    assert(mul->kernel.code == mul->special[1]);
+    for (int i = 0; i < LEN; i++)
+    {
+        mul->A[i] = i + 7;
+        mul->B[i] = 3 * i + 1;
+    }
+    uint64_t special = run(&mul->kernel);
+    for (int i = 0; i < LEN; i++)
+        assert(mul->C[i] == (i + 7) * (3 * i + 1));
+
+    mul->special[1] = 0;
+    vec_mul_set_qpus(mul, 1);
+    memset((void *)mul->C, 0, 4 * LEN);
+    uint64_t generic = run(&mul->kernel);
+    for (int i = 0; i < LEN; i++)
+        assert(mul->C[i] == (i + 7) * (3 * i + 1));
+    printk("mul %d on 1 QPU: %llu instructions specialized, %llu generic\n",
+        LEN, (unsigned long long)special, (unsigned long long)generic);
+    assert(2 * special < generic);
+
+    // the variant on several QPUs.
+    assert(vec_mul_set_qpus(mul, 8) == 8 && mul->kernel.code == mul->special[8]);
+    memset((void *)mul->C, 0, 4 * LEN);
+    run(&mul->kernel);
+    for (int i = 0; i < LEN; i++)
+        assert(mul->C[i] == (i + 7) * (3 * i + 1));
+    vec_mul_release(mul);
+}
+
+static uint64_t mandelbrot(int num_qpus, uint32_t *out, int *special)
+{
+    gpu_kernel_t k;
+
+    setup(4 * RES * RES * sizeof(uint32_t) + 8192);
+    volatile uint32_t *img = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(mandelbrot_init(&ctx, &k, RES, ITERS, num_qpus, img) == 0);
+    *special = kernel_variant(mandelbrot_variants, RES, ITERS, num_qpus) != NULL;
+    uint64_t n = run(&k);
+    for (int i = 0; i < 4 * RES * RES; i++)
+        out[i] = img[i];
+    return n;
+}
+
+static void test_mandelbrot(void)
+{
+    static uint32_t want[4 * RES * RES], got[4 * RES * RES];
+    int special;
+
+    // the variant, then the generic shader, on 4 QPUs.
+    const kernel_variant_t *v = kernel_variant(mandelbrot_variants, RES, ITERS, 4);
+    assert(v);
+    uint64_t ngot = mandelbrot(4, got, &special);
+    assert(special);
+
+    gpu_kernel_t k;
+    setup(4 * RES * RES * sizeof(uint32_t) + 8192);
+    volatile uint32_t *img = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(gpu_kernel_init(&ctx, &k, mandelbrotshader, sizeof mandelbrotshader, 4) == 0);
+    volatile uint32_t *u = gpu_kernel_unifs(&ctx, &k, KERNEL_NUNIFS(mandelbrotshader));
+    for (int q = 0; q < 4; q++, u += KERNEL_NUNIFS(mandelbrotshader))
+    {
+        u[0] = RES;
+        u[1] = mandelbrot_step(RES);
+        u[2] = ITERS;
+        u[3] = 4;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, img);
+    }
+    uint64_t nwant = run(&k);
+    int inside = 0;
+    for (int i = 0; i < 4 * RES * RES; i++)
+    {
+        want[i] = img[i];
+        inside += !want[i];
+    }
+    assert(inside > 0 && inside < 4 * RES * RES);
+    assert(memcmp(want, got, sizeof want) == 0);
+
+    // no variant for 3 QPUs: the generic shader, the same picture.
+    mandelbrot(3, got, &special);
+    assert(!special && memcmp(want, got, sizeof want) == 0);
+    printk("mandelbrot %dx%d on 4 QPUs: %llu instructions specialized, %llu generic\n",
+        2 * RES, 2 * RES, (unsigned long long)ngot, (unsigned long long)nwant);
+    assert(ngot < nwant);
+}
+
+int main(void)
+{
+    test_table();
+    test_add();
+    test_mul();
+    test_mandelbrot();
+    printk("SUCCESS: kernel variants\n");
+    return 0;
+}
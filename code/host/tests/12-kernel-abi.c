@@ -0,0 +1,116 @@
+// the uniform manifests (kernel-abi.h): each against the uniforms its
+// kernel reads, the layouts, and the one-pass write through the runtime.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-mock.h"
+#include "qpu-builder.h"
+#include "kernel-abi.h"
+#include "addshader.h"
+
+// word indices are constants.
+_Static_assert(KERNEL_UNIF(addshader, qpu) == 4, "addshader qpu");
+_Static_assert(KERNEL_UNIF(mandelbrotshader, out) == 5, "mandelbrotshader out");
+_Static_assert(KERNEL_NUNIFS(qb_map2) == 4, "qb_map2");
+
+static char src[1 << 16];
+
+// 'mov x, unif' instructions in a qasm file, which must all come first.
+static unsigned qasm_unifs(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        panic("cannot open %s\n", path);
+    size_t n = fread(src, 1, sizeof src - 1, f);
+    fclose(f);
+    src[n] = 0;
+
+    unsigned nunifs = 0, preamble = 1;
+    for (char *l = src; *l; l = strchr(l, '\n') + 1)
+    {
+        char line[256];
+        snprintf(line, sizeof line, "%.*s", (int)strcspn(l, "#\n"), l);
+        char *p = line + strspn(line, " \t");
+        int ins = *p && *p != '.' && *p != ':';
+        int unif = ins && strstr(p, ", unif") != NULL;
+
+        if (unif && !preamble)
+            panic("%s: uniform read after the preamble\n", path);
+        nunifs += unif;
+        preamble &= !ins || unif;
+        if (!strchr(l, '\n'))
+            break;
+    }
+    return nunifs;
+}
+
+static void test_manifests(void)
+{
+    assert(qasm_unifs("../parallel-add.qasm") == KERNEL_NUNIFS(addshader));
+    assert(qasm_unifs("../vector-multiply.qasm") == KERNEL_NUNIFS(mulshader));
+    assert(qasm_unifs("../mandelbrot.qasm") == KERNEL_NUNIFS(mandelbrotshader));
+
+    static uint32_t code[2 * 1024];
+    qb_t b;
+    qb_init(&b, code, 1024);
+    qb_map2(&b, QPU_A_ADD, 2, 3);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_map2));
+    qb_init(&b, code, 1024);
+    qb_map2_tmu(&b, QPU_A_ADD, 4, 0);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_map2_tmu));
+    qb_init(&b, code, 1024);
+    qb_map2_pipe(&b, QPU_A_ADD, 4, 0);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_map2_pipe));
+    qb_init(&b, code, 1024);
+    qb_map1s(&b, QPU_A_FADD, 4, 0);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_map1s));
+    qb_init(&b, code, 1024);
+    qb_fma(&b, 4, 0);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_fma));
+    qb_init(&b, code, 1024);
+    qb_fold(&b, QPU_A_ADD, 3);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_fold));
+    qb_init(&b, code, 1024);
+    qb_mandelbrot(&b, 16, 0x3d800000, 10, 2);
+    assert(b.nunifs == KERNEL_NUNIFS(qb_mandelbrot));
+    printk("manifests: ok\n");
+}
+
+static void test_write(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    struct addshader_unifs u[3];
+    struct qb_map2_unifs m[3];
+
+    host_mem_reset();
+    v3d_mock_init();
+    assert(gpu_init(&ctx, 4096) == 0);
+    assert(KERNEL_INIT(addshader, &ctx, &k, addshader, sizeof addshader, 3) == 0);
+    for (int q = 0; q < 3; q++)
+        u[q] = (struct addshader_unifs){ .blocks = 10 + q, .a = 0x100 * q, .b = 0x200 * q, .c = 0x300 * q, .qpu = q };
+
+    KERNEL_SET_UNIFS(addshader, &ctx, &k, u, 3);
+    volatile uint32_t *w = gpu_bus_to_cpu(k.unif[0]);
+    for (int q = 0; q < 3; q++, w += KERNEL_NUNIFS(addshader))
+        assert(w[0] == 10 + q && w[1] == 0x100 * q && w[3] == 0x300 * q && w[KERNEL_UNIF(addshader, qpu)] == q);
+
+    // a smaller layout into the same blocks: each QPU's stays at its unif[].
+    for (int q = 0; q < 3; q++)
+        m[q] = (struct qb_map2_unifs){ .a = 1, .b = 2, .c = 3, .qpu = 7 + q };
+    KERNEL_SET_UNIFS(qb_map2, &ctx, &k, m, 2);
+    w = gpu_bus_to_cpu(k.unif[1]);
+    assert(w[0] == 1 && w[3] == 8 && w[4] == 1);
+    w = gpu_bus_to_cpu(k.unif[2]);
+    assert(w[0] == 12 && w[1] == 0x200 && w[4] == 2);
+    gpu_release(&ctx);
+    printk("write: ok\n");
+}
+
+int main(void)
+{
+    test_manifests();
+    test_write();
+    printk("SUCCESS: kernel abi\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+// launch capture and replay: a capture of vec_add on the emulator replays
+// on the timing model to the same memory, a corrupted result shows up as a
+// difference, bad captures are refused, and replays are deterministic.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "gpu-capture.h"
+#include "qpu-replay.h"
+#include "parallel-add.h"
+#include "mandelbrot.h"
+#include "addshader.h"
+
+#define LEN 4096
+#define RES 16
+
+static gpu_ctx_t ctx;
+static uint32_t cap[(1 << 20) / 4];
+static uint32_t c_bus;  // where capture_add's C is
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+// capture one vec_add on 4 QPUs; 'corrupt' changes C before the result is taken.
+static int capture_add(int generic, int corrupt)
+{
+    struct addGPU *add;
+
+    setup(vec_add_size(LEN));
+    vec_add_init(&ctx, &add, LEN, 4);
+    if (generic)
+    {
+        add->special[4] = 0;
+        vec_add_set_qpus(add, 4);
+    }
+    for (int i = 0; i < LEN; i++)
+    {
+        add->A[i] = i * 3;
+        add->B[i] = 0x10000 - i;
+        add->C[i] = 0;
+    }
+    c_bus = gpu_bus(&ctx, add->C);
+    assert(gpu_capture_size(&ctx) <= sizeof cap);
+    int n = gpu_capture(&ctx, &add->kernel, generic ? sizeof addshader : 0, cap, sizeof cap);
+    assert(n > 0);
+    // C and the padding are zero: stored as runs.
+    assert(n < sizeof(gpu_capture_t) + ctx.used * 3 / 4);
+    assert(gpu_launch(&add->kernel) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+    for (int i = 0; i < LEN; i++)
+        assert(add->C[i] == 0x10000 + 2 * i);
+    if (corrupt)
+        add->C[corrupt] ^= 1;
+    n = gpu_capture_result(&ctx, cap, n, sizeof cap);
+    assert(n > 0 && n < sizeof(gpu_capture_t) + 2 * ctx.used);
+    printk("add %s: %u bytes of memory captured in %d\n", generic ? "generic" : "variant", ctx.used, n);
+    return n;
+}
+
+static void test_add(void)
+{
+    for (int generic = 0; generic < 2; generic++)
+    {
+        int n = capture_add(generic, 0);
+        qpu_replay_t *r = qpu_replay_load(cap, n);
+        assert(!r->err[0] && r->h.num_qpus == 4 && r->h.has_result);
+        assert(qpu_replay_run(r) == 0);
+        assert(r->ndiff == 0 && r->t.ninstr > 0);
+        if (generic)
+            qpu_replay_report(r);
+        qpu_replay_free(r);
+    }
+
+    // what the replay makes is not what was captured.
+    int n = capture_add(1, 100);
+    qpu_replay_t *r = qpu_replay_load(cap, n);
+    assert(qpu_replay_run(r) == 0);
+    assert(r->ndiff == 1 && r->first_diff == c_bus + 4 * 100);
+    qpu_replay_free(r);
+    printk("add: ok\n");
+}
+
+static void test_bad(void)
+{
+    int n = capture_add(1, 0);
+    qpu_replay_t *r;
+
+    // truncated anywhere, or with bytes left over.
+    for (int len = 0; len < n; len += len < 64 ? 4 : 1024)
+    {
+        r = qpu_replay_load(cap, len);
+        assert(r->err[0] && qpu_replay_run(r) < 0);
+        qpu_replay_free(r);
+    }
+    r = qpu_replay_load(cap, n + 4);
+    assert(r->err[0]);
+    qpu_replay_free(r);
+
+    cap[0] ^= 1;
+    r = qpu_replay_load(cap, n);
+    assert(strcmp(r->err, "not a capture") == 0);
+    qpu_replay_free(r);
+    cap[0] ^= 1;
+
+    // the code somewhere else.
+    ((gpu_capture_t *)cap)->code = 0x1000;
+    r = qpu_replay_load(cap, n);
+    assert(r->err[0]);
+    qpu_replay_free(r);
+    printk("bad captures: ok\n");
+}
+
+static void test_mandelbrot(void)
+{
+    gpu_kernel_t k;
+
+    setup(4 * RES * RES * sizeof(uint32_t) + 8192);
+    volatile uint32_t *img = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(mandelbrot_init(&ctx, &k, RES, 50, 3, img) == 0);
+    int n = gpu_launch_captured(&ctx, &k, 0, cap, sizeof cap);
+    assert(n > 0);
+    assert(gpu_capture_result(&ctx, cap, n, sizeof cap) < 0);
+
+    qpu_replay_t *r = qpu_replay_load(cap, n);
+    assert(qpu_replay_run(r) == 0 && r->ndiff == 0);
+    uint64_t cycles = r->t.cycles, ninstr = r->t.ninstr, count = r->t.ins[0].count;
+    assert(qpu_replay_run(r) == 0 && r->ndiff == 0);
+    assert(r->t.cycles == cycles && r->t.ninstr == ninstr && r->t.ins[0].count == count);
+    printk("mandelbrot %dx%d on 3 QPUs: %llu cycles, %llu instructions, twice\n",
+        2 * RES, 2 * RES, (unsigned long long)cycles, (unsigned long long)ninstr);
+    qpu_replay_free(r);
+}
+
+int main(void)
+{
+    test_add();
+    test_bad();
+    test_mandelbrot();
+    printk("SUCCESS: gpu capture\n");
+    return 0;
+}
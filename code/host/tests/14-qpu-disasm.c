@@ -0,0 +1,129 @@
+// the disassembler on known instructions and on every shipped kernel, and
+// the annotated profile of the specialized mandelbrot: counts, lanes
+// active where the lanes diverge, and where the cycles go.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "qpu-timing.h"
+#include "qpu-disasm.h"
+#include "kernel-variants.h"
+#include "mandelbrot.h"
+#include "addshader.h"
+#include "mulshader.h"
+#include "simpleshader.h"
+#include "mandelbrotshader.h"
+#include "addshader-sched.h"
+#include "mandelbrotshader-sched.h"
+
+#define RES 64
+#define ITERS 100
+
+static qpu_timing_t t;
+
+static void expect(uint32_t lo, uint32_t hi, uint32_t pc, const char *want)
+{
+    char buf[160];
+    qpu_disasm(QPU_INS(lo, hi), pc, buf, sizeof buf);
+    if (strcmp(buf, want) != 0)
+        panic("%08x %08x: \"%s\", want \"%s\"\n", hi, lo, buf, want);
+}
+
+static void test_text(void)
+{
+    expect(0x15827d80, 0x10020027, 0, "mov ra0, unif");
+    expect(0x15ca7d80, 0x100009e7, 0, "mov -, vr_wait");
+    expect(0x11105dc0, 0xd0020867, 0, "shl r1, ra4, 5");
+    expect(0x0d281dc0, 0xd00222a7, 0, "sub.setf ra10, ra10, 1");
+    expect(0xffffffa0, 0xf03809e7, 0x108, "brr.anynz -, 0xc8");
+    expect(0x90000040, 0xe0020c67, 0, "ldi vr_setup, 0x90000040");
+    expect(0x409e700a, 0x100049e1, 0, "mul24 r1, r1, r2");
+    expect(0x089c2fc0, 0xd0020867, 0, "itof r1, 2");
+    expect(0x029e7280, 0x100228e7, 0, "fsub.setf r3, r1, r2");
+    expect(0x00000001, 0xe00811e7, 0, "ldi.ifn rb7, 0x1");
+    expect(0x009e7000, 0x300009e7, 0, "thrend");
+    expect(0x009e7000, 0x100009e7, 0, "nop");
+    // fadd ra1, r0, r1; fmul rb2, r2, r3 (the mul pipe writes file B)
+    expect(QPU_A_FADD << 24 | QPU_M_FMUL << 29 | 39 << 18 | 39 << 12 | 0 << 9 | 1 << 6 | 2 << 3 | 3,
+        QPU_SIG_NONE << 28 | 1 << 17 | 1 << 14 | 1 << 6 | 2, 0, "fadd ra1, r0, r1; fmul rb2, r2, r3");
+    // sacq -, 3
+    expect(1 << 4 | 3, QPU_SIG_LOAD_IMM << 28 | QPU_LDI_SEMA << 25 | 39 << 6 | 39, 0, "sacq -, 3");
+    printk("text: ok\n");
+}
+
+// nothing in any kernel we ship is beyond the disassembler.
+static int known(const uint32_t *code, uint32_t nbytes)
+{
+    char buf[160];
+
+    for (uint32_t i = 0; i + 8 <= nbytes; i += 8)
+    {
+        int n = qpu_disasm(QPU_INS(code[i / 4], code[i / 4 + 1]), i, buf, sizeof buf);
+        if (n <= 0 || strchr(buf, '?'))
+            panic("%x: %s\n", i, buf);
+    }
+    return nbytes / 8;
+}
+
+static void test_kernels(void)
+{
+    int n = known(addshader, sizeof addshader) + known(mulshader, sizeof mulshader)
+        + known(simpleshader, sizeof simpleshader) + known(mandelbrotshader, sizeof mandelbrotshader)
+        + known(addshader_sched, sizeof addshader_sched)
+        + known(mandelbrotshader_sched, sizeof mandelbrotshader_sched);
+    for (const kernel_variant_t *v = add_variants; v->code; v++)
+        n += known(v->code, v->nbytes);
+    for (const kernel_variant_t *v = mul_variants; v->code; v++)
+        n += known(v->code, v->nbytes);
+    for (const kernel_variant_t *v = mandelbrot_variants; v->code; v++)
+        n += known(v->code, v->nbytes);
+    printk("kernels: %d instructions, ok\n", n);
+}
+
+static void test_profile(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    char buf[160];
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 8192) == 0);
+    volatile uint32_t *img = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    const kernel_variant_t *v = kernel_variant(mandelbrot_variants, RES, ITERS, 4);
+    assert(v && mandelbrot_init(&ctx, &k, RES, ITERS, 4, img) == 0);
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, k.code, v->nbytes, k.unif, 4) == 0);
+    qpu_timing_report(&t);
+
+    // the counts add up, and the hottest instruction is in the inner loop.
+    uint64_t n = 0;
+    unsigned hot = 0, diverged = 0;
+    for (unsigned i = 0; i < t.ncode; i++)
+    {
+        n += t.ins[i].count;
+        assert(t.ins[i].lanes <= QPU_NUM_LANES * t.ins[i].count);
+        if (t.ins[i].count > t.ins[hot].count)
+            hot = i;
+        // the loop branch: some lanes are done before others.
+        uint32_t *w = host_mem_ptr(k.code + 8 * i);
+        if (QPU_SIG(QPU_INS(w[0], w[1])) == QPU_SIG_BRANCH && t.ins[i].count
+            && t.ins[i].lanes < QPU_NUM_LANES * t.ins[i].count && t.ins[i].lanes > 0)
+            diverged++;
+    }
+    assert(n == t.ninstr);
+    assert(t.ins[hot].count > 4 * RES * RES / 16);
+    assert(diverged > 0);
+    qpu_disasm(QPU_INS(((uint32_t *)host_mem_ptr(k.code))[2 * hot], ((uint32_t *)host_mem_ptr(k.code))[2 * hot + 1]),
+        8 * hot, buf, sizeof buf);
+    printk("profile: hottest %x \"%s\" ran %llu times, %.1f lanes\n", 8 * hot, buf,
+        (unsigned long long)t.ins[hot].count, (double)t.ins[hot].lanes / t.ins[hot].count);
+    gpu_release(&ctx);
+}
+
+int main(void)
+{
+    test_text();
+    test_kernels();
+    test_profile();
+    printk("SUCCESS: qpu disassembler\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+// the TMU load path: qb_map2_tmu against the CPU on the emulator, the add
+// and mul launchers switching to it and back, and its bandwidth against
+// the VPM DMA path in the timing model.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-timing.h"
+#include "qpu-builder.h"
+#include "kernel-abi.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+
+#define LEN (64 * 4 * 3 * 5)  // elements: whole blocks at 1, 4 and 16 rows
+
+static gpu_ctx_t ctx;
+static qpu_timing_t t;
+
+static uint32_t u(float x)
+{
+    uint32_t v;
+    memcpy(&v, &x, 4);
+    return v;
+}
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+static void launch(gpu_kernel_t *k)
+{
+    assert(gpu_launch(k) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+}
+
+// C = A * B in floats on 'nq' QPUs, 'rows' rows each; 'special' builds the
+// block count into the code.
+static void run_fmul(int nq, int rows, int special)
+{
+    uint32_t nblocks = LEN / (16 * rows), first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+    gpu_kernel_t k;
+    qb_t b;
+
+    setup(64 * 1024);
+    volatile uint32_t *A = gpu_alloc(&ctx, 4 * LEN, 64), *B = gpu_alloc(&ctx, 4 * LEN, 64), *C = gpu_alloc(&ctx, 4 * LEN, 64);
+    for (int i = 0; i < LEN; i++)
+    {
+        A[i] = u(i * 0.25f - 100);
+        B[i] = u(3.5f - i * 0.125f);
+        C[i] = 0xdeadbeef;
+    }
+    int used = gpu_partition(nblocks, nq, first, count);
+    assert(used == nq && (!special || nblocks % nq == 0));
+
+    assert(qb_init_gpu(&b, &ctx, QB_MAP2_TMU_MAX) == 0);
+    qb_map2_tmu(&b, QB_FMUL, rows, special ? nblocks / nq : 0);
+    assert(!b.err && b.nunifs == (special ? 4 : 5));
+    assert(qb_kernel_init(&b, &ctx, &k, nq) == 0);
+    volatile uint32_t *un = gpu_kernel_unifs(&ctx, &k, b.nunifs);
+    for (int q = 0; q < nq; q++, un += b.nunifs)
+    {
+        int i = 0;
+        uint32_t off = 64 * rows * first[q];
+        if (!special)
+            un[i++] = count[q];
+        un[i++] = gpu_bus(&ctx, A) + off;
+        un[i++] = gpu_bus(&ctx, B) + off;
+        un[i++] = gpu_bus(&ctx, C) + off;
+        un[i++] = q;
+    }
+    launch(&k);
+    for (int i = 0; i < LEN; i++)
+        if (C[i] != u((i * 0.25f - 100) * (3.5f - i * 0.125f)))
+            panic("fmul on %d QPUs, %d rows: C[%d] = %x\n", nq, rows, i, C[i]);
+    printk("fmul %d QPUs, %d rows%s: %d instructions, ok\n", nq, rows, special ? ", specialized" : "", b.n);
+}
+
+static void test_builder(void)
+{
+    static uint32_t code[2 * QB_MAP2_TMU_MAX];
+    qb_t b;
+
+    // the largest kernel fits, and nothing is left in the FIFOs.
+    assert(qb_map2_tmu_rows(1) == 16 && qb_map2_tmu_rows(16) == 4 && qb_map2_tmu_rows(12) == 5);
+    qb_init(&b, code, QB_MAP2_TMU_MAX);
+    qb_map2_tmu(&b, QB_MUL24, 16, 0);
+    assert(!b.err);
+    int loads = 0, lookups = 0;
+    for (int i = 0; i < b.n; i++)
+    {
+        uint64_t ins = QPU_INS(code[2 * i], code[2 * i + 1]);
+        loads += QPU_SIG(ins) == QPU_SIG_LOAD_TMU0 || QPU_SIG(ins) == QPU_SIG_LOAD_TMU1;
+        lookups += QPU_SIG(ins) != QPU_SIG_BRANCH && QPU_SIG(ins) != QPU_SIG_LOAD_IMM
+            && (QPU_WADDR_ADD(ins) == QPU_W_TMU0_S || QPU_WADDR_ADD(ins) == QPU_W_TMU1_S);
+    }
+    assert(loads == lookups && loads == 2 * 17);
+
+    run_fmul(1, 16, 0);
+    run_fmul(5, 4, 0);
+    run_fmul(3, 1, 1);
+    run_fmul(15, 4, 1);
+    run_fmul(4, 15, 1);
+}
+
+static void test_add(void)
+{
+    struct addGPU *add;
+    int n = 1000;   // not a whole TMU block
+
+    setup(vec_add_size(n));
+    vec_add_init(&ctx, &add, n, 4);
+    assert(add->built && add->kernel.code != add->built);
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq += 5)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            add->A[i] = i * 3 + nq;
+            add->B[i] = 0x10000 - i;
+            add->C[i] = 0;
+        }
+        add->load = QB_LOAD_TMU;
+        assert(vec_add_set_qpus(add, nq) == nq && add->kernel.code == add->built);
+        vec_add_exec(add);
+        if (v3d_emu.nfault)
+            panic("%s\n", v3d_emu.qpu.err);
+        for (int i = 0; i < n; i++)
+            assert(add->C[i] == 0x10000 + 2 * i + nq);
+    }
+
+    // and back to the VPM path.
+    add->load = QB_LOAD_VPM;
+    assert(vec_add_set_qpus(add, 3) == 3 && add->kernel.code == add->generic);
+    memset((void *)add->C, 0, 4 * n);
+    launch(&add->kernel);
+    for (int i = 0; i < n; i++)
+        assert(add->C[i] == 0x10000 + 2 * i + 16);
+    vec_add_release(add);
+    printk("add: ok\n");
+}
+
+static void test_mul(void)
+{
+    struct mulGPU *mul;
+    int n = 3000;
+
+    setup(vec_mul_size(n));
+    vec_mul_init(&ctx, &mul, n, 1);
+    for (int i = 0; i < n; i++)
+    {
+        mul->A[i] = i + 7;
+        mul->B[i] = 3 * i + 1;
+    }
+    mul->load = QB_LOAD_TMU;
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq *= 4)
+    {
+        memset((void *)mul->C, 0, 4 * n);
+        assert(vec_mul_set_qpus(mul, nq) == nq && mul->kernel.code == mul->built);
+        vec_mul_exec(mul);
+        if (v3d_emu.nfault)
+            panic("%s\n", v3d_emu.qpu.err);
+        for (int i = 0; i < n; i++)
+            assert(mul->C[i] == (i + 7) * (3 * i + 1));
+    }
+    mul->load = QB_LOAD_VPM;
+    assert(vec_mul_set_qpus(mul, 1) == 1 && mul->kernel.code != mul->built);
+    vec_mul_release(mul);
+    printk("mul: ok\n");
+}
+
+// bytes of the kernel the launcher built at 'code': up to thrend and its
+// delay slots.
+static uint32_t built_bytes(uint32_t code)
+{
+    volatile uint32_t *p = gpu_bus_to_cpu(code);
+    uint32_t n = 0;
+    while (QPU_SIG(QPU_INS(p[2 * n], p[2 * n + 1])) != QPU_SIG_PROG_END)
+        n++;
+    return 8 * (n + 1 + QPU_END_DELAY);
+}
+
+// bytes of A, B and C per clock for an n-element add on 'nq' QPUs.
+static double add_bandwidth(int n, int nq, int load)
+{
+    struct addGPU *add;
+
+    setup(vec_add_size(n));
+    vec_add_init(&ctx, &add, n, nq);
+    for (int i = 0; i < n; i++)
+    {
+        add->A[i] = i;
+        add->B[i] = 3 * i;
+    }
+    add->load = load;
+    vec_add_set_qpus(add, nq);
+
+    uint32_t nbytes = load == QB_LOAD_TMU ? built_bytes(add->built) : sizeof addshader;
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, add->kernel.code, nbytes, add->kernel.unif, add->kernel.num_qpus) == 0);
+    for (int i = 0; i < n; i++)
+        assert(add->C[i] == 4 * i);
+    return 12.0 * n / t.cycles;
+}
+
+static void test_bandwidth(void)
+{
+    int n = 1 << 20;
+
+    // the model queues DMA on the two shared engines but gives every QPU
+    // its own TMU bandwidth, so it only says the TMU path is not slower.
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq *= 4)
+    {
+        double vpm = add_bandwidth(n, nq, QB_LOAD_VPM), tmu = add_bandwidth(n, nq, QB_LOAD_TMU);
+        printk("add %d on %2d QPUs: %.2f bytes/clock through the VPM, %.2f through the TMUs\n", n, nq, vpm, tmu);
+        assert(tmu >= vpm);
+    }
+    qpu_timing_report(&t);
+    printk("bandwidth: ok\n");
+}
+
+int main(void)
+{
+    test_builder();
+    test_add();
+    test_mul();
+    test_bandwidth();
+    printk("SUCCESS: tmu load\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+// the pipelined map kernel: qb_map2_pipe against the CPU on the emulator,
+// the add and mul launchers using it, and its bandwidth against the
+// unpipelined kernels and the DMA limit in the timing model.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-timing.h"
+#include "qpu-builder.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+
+#define LEN (16 * 8 * 3 * 5)  // elements: whole blocks at 1 to 5 and 8 rows
+
+static gpu_ctx_t ctx;
+static qpu_timing_t t;
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+static uint32_t expect(int op, uint32_t a, uint32_t b)
+{
+    return op == QPU_A_ADD ? a + b : (a & 0xffffff) * (b & 0xffffff);
+}
+
+// C = A op B for the first n elements on 'nq' QPUs, 'rows' rows each;
+// 'special' builds the block count into the code.
+static void run_map2(int op, int n, int nq, int rows, int special)
+{
+    uint32_t nblocks = n / (16 * rows), first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+    gpu_kernel_t k;
+    qb_t b;
+
+    setup(64 * 1024);
+    volatile uint32_t *A = gpu_alloc(&ctx, 4 * LEN, 64), *B = gpu_alloc(&ctx, 4 * LEN, 64), *C = gpu_alloc(&ctx, 4 * LEN, 64);
+    for (int i = 0; i < LEN; i++)
+    {
+        A[i] = i * 0x10101u;
+        B[i] = 0x123457u * (i + 1);
+        C[i] = 0xdeadbeef;
+    }
+    int used = gpu_partition(nblocks, nq, first, count);
+    assert(used == nq && (!special || nblocks % nq == 0));
+
+    assert(qb_init_gpu(&b, &ctx, QB_MAP2_PIPE_MAX) == 0);
+    qb_map2_pipe(&b, op, rows, special ? nblocks / nq : 0);
+    assert(!b.err && b.nunifs == (special ? 4 : 5));
+    assert(qb_kernel_init(&b, &ctx, &k, nq) == 0);
+    volatile uint32_t *un = gpu_kernel_unifs(&ctx, &k, b.nunifs);
+    for (int q = 0; q < nq; q++, un += b.nunifs)
+    {
+        int i = 0;
+        uint32_t off = 64 * rows * first[q];
+        if (!special)
+            un[i++] = count[q];
+        un[i++] = gpu_bus(&ctx, A) + off;
+        un[i++] = gpu_bus(&ctx, B) + off;
+        un[i++] = gpu_bus(&ctx, C) + off;
+        un[i++] = q;
+    }
+    assert(gpu_launch(&k) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+    for (int i = 0; i < n; i++)
+        if (C[i] != expect(op, A[i], B[i]))
+            panic("op %d on %d QPUs, %d rows: C[%d] = %x, want %x\n", op, nq, rows, i, C[i], expect(op, A[i], B[i]));
+    printk("pipe op %d, %d QPUs, %d rows%s: %d instructions, ok\n", op, nq, rows, special ? ", specialized" : "", b.n);
+}
+
+static void test_builder(void)
+{
+    static uint32_t code[2 * QB_MAP2_PIPE_MAX];
+    qb_t b;
+
+    // the largest kernel fits; two buffers of A and B for every QPU.
+    assert(qb_map2_pipe_rows(1) == 8 && qb_map2_pipe_rows(3) == 5 && qb_map2_pipe_rows(16) == 1);
+    qb_init(&b, code, QB_MAP2_PIPE_MAX);
+    qb_map2_pipe(&b, QB_MUL24, 8, 0);
+    assert(!b.err);
+
+    run_map2(QPU_A_ADD, LEN, 1, 8, 0);
+    run_map2(QPU_A_ADD, LEN, 3, 5, 0);
+    run_map2(QB_MUL24, LEN, 16, 1, 0);
+    run_map2(QB_MUL24, LEN, 3, 4, 1);
+    run_map2(QPU_A_ADD, LEN, 5, 3, 1);
+    run_map2(QPU_A_ADD, LEN, 15, 1, 1);
+    run_map2(QB_MUL24, LEN, 8, 2, 0);
+    // one block each: nothing to overlap.
+    run_map2(QPU_A_ADD, 256, 4, 4, 1);
+}
+
+static void test_launchers(void)
+{
+    struct addGPU *add;
+    struct mulGPU *mul;
+    int n = 5000;   // not a whole block
+
+    setup(vec_add_size(n) + vec_mul_size(n));
+    vec_add_init(&ctx, &add, n, 1);
+    vec_mul_init(&ctx, &mul, n, 1);
+    add->load = mul->load = QB_LOAD_PIPE;
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq += 3)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            add->A[i] = mul->A[i] = i + nq;
+            add->B[i] = mul->B[i] = 3 * i + 1;
+            add->C[i] = mul->C[i] = 0;
+        }
+        assert(vec_add_set_qpus(add, nq) == nq && add->kernel.code == add->built);
+        assert(vec_mul_set_qpus(mul, nq) == nq && mul->kernel.code == mul->built);
+        vec_add_exec(add);
+        vec_mul_exec(mul);
+        if (v3d_emu.nfault)
+            panic("%s\n", v3d_emu.qpu.err);
+        for (int i = 0; i < n; i++)
+            assert(add->C[i] == 4 * i + 1 + nq && mul->C[i] == (i + nq) * (3 * i + 1));
+    }
+    add->load = QB_LOAD_VPM;
+    assert(vec_add_set_qpus(add, 4) == 4 && add->kernel.code != add->built);
+    vec_mul_release(mul);
+    vec_add_release(add);
+    printk("launchers: ok\n");
+}
+
+// bytes of the kernel the launcher built at 'code': up to thrend and its
+// delay slots.
+static uint32_t built_bytes(uint32_t code)
+{
+    volatile uint32_t *p = gpu_bus_to_cpu(code);
+    uint32_t n = 0;
+    while (QPU_SIG(QPU_INS(p[2 * n], p[2 * n + 1])) != QPU_SIG_PROG_END)
+        n++;
+    return 8 * (n + 1 + QPU_END_DELAY);
+}
+
+// clocks for an n-element add on 'nq' QPUs.
+static uint64_t add_cycles(int n, int nq, int load)
+{
+    struct addGPU *add;
+
+    setup(vec_add_size(n));
+    vec_add_init(&ctx, &add, n, nq);
+    for (int i = 0; i < n; i++)
+    {
+        add->A[i] = i;
+        add->B[i] = 3 * i;
+    }
+    add->load = load;
+    vec_add_set_qpus(add, nq);
+
+    qpu_timing_init(&t, host_mem_ptr);
+    uint32_t nbytes = load == QB_LOAD_PIPE ? built_bytes(add->built) : sizeof addshader;
+    assert(qpu_timing_run(&t, add->kernel.code, nbytes, add->kernel.unif, add->kernel.num_qpus) == 0);
+    for (int i = 0; i < n; i++)
+        assert(add->C[i] == 4 * i);
+    return t.cycles;
+}
+
+static void test_bandwidth(void)
+{
+    int n = 1 << 18;
+
+    // A and B take the VDR 8 bytes an element at dma_bytes a clock.
+    qpu_timing_init(&t, host_mem_ptr);
+    double limit = 12.0 * t.p.dma_bytes / 8;
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq *= 4)
+    {
+        double vpm = 12.0 * n / add_cycles(n, nq, QB_LOAD_VPM);
+        double pipe = 12.0 * n / add_cycles(n, nq, QB_LOAD_PIPE);
+        printk("add %d on %2d QPUs: %.2f bytes/clock unpipelined, %.2f pipelined, DMA limit %.2f\n",
+            n, nq, vpm, pipe, limit);
+        assert(pipe > vpm && pipe <= limit);
+        if (nq == V3D_NUM_QPUS)
+            assert(pipe > 0.9 * limit);
+    }
+    qpu_timing_report(&t);
+    printk("bandwidth: ok\n");
+}
+
+int main(void)
+{
+    test_builder();
+    test_launchers();
+    test_bandwidth();
+    printk("SUCCESS: dma pipelining\n");
+    return 0;
+}
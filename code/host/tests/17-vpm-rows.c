@@ -0,0 +1,207 @@
+// rows per DMA transfer in the built kernels: add and mul correct at every
+// row count the VPM has room for, mul on several QPUs and in a batch no
+// longer sharing VPM rows, and a sweep of the timing model for the best rows per QPU
+// count.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-timing.h"
+#include "qpu-builder.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+
+static gpu_ctx_t ctx;
+static qpu_timing_t t;
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+// bytes of the kernel the launcher built at 'code': up to thrend and its
+// delay slots.
+static uint32_t built_bytes(uint32_t code)
+{
+    volatile uint32_t *p = gpu_bus_to_cpu(code);
+    uint32_t n = 0;
+    while (QPU_SIG(QPU_INS(p[2 * n], p[2 * n + 1])) != QPU_SIG_PROG_END)
+        n++;
+    return 8 * (n + 1 + QPU_END_DELAY);
+}
+
+static void test_rows(void)
+{
+    struct addGPU *add;
+    struct mulGPU *mul;
+    int n = 16 * 8 * 9;  // whole blocks at 1, 2, 3, 4, 6 and 8 rows
+
+    setup(vec_add_size(n) + vec_mul_size(n));
+    vec_add_init(&ctx, &add, n, 1);
+    vec_mul_init(&ctx, &mul, n, 1);
+    for (int i = 0; i < n; i++)
+    {
+        add->A[i] = mul->A[i] = i + 5;
+        add->B[i] = mul->B[i] = 7 * i;
+    }
+
+    // every row count on 1 and 3 QPUs; more than fit is the most that fit.
+    add->load = QB_LOAD_DMA;
+    for (int nq = 1; nq <= 3; nq += 2)
+        for (int rows = 1; rows <= 9; rows++)
+        {
+            add->rows = rows;
+            memset((void *)add->C, 0, 4 * n);
+            assert(vec_add_set_qpus(add, nq) == nq && add->kernel.code == add->built);
+            vec_add_exec(add);
+            if (v3d_emu.nfault)
+                panic("%s\n", v3d_emu.qpu.err);
+            for (int i = 0; i < n; i++)
+                if (add->C[i] != 8 * i + 5)
+                    panic("%d rows on %d QPUs: C[%d] = %d\n", rows, nq, i, add->C[i]);
+        }
+
+    // mulshader on several QPUs would share VPM rows: the built kernel
+    // runs instead, each QPU in its own rows.
+    for (int nq = 2; nq <= V3D_NUM_QPUS; nq += 7)
+    {
+        memset((void *)mul->C, 0, 4 * n);
+        assert(vec_mul_set_qpus(mul, nq) == nq && mul->kernel.code == mul->built);
+        vec_mul_exec(mul);
+        if (v3d_emu.nfault)
+            panic("%s\n", v3d_emu.qpu.err);
+        for (int i = 0; i < n; i++)
+            assert(mul->C[i] == (i + 5) * 7 * i);
+    }
+    assert(vec_mul_set_qpus(mul, 1) == 1 && mul->kernel.code == mul->generic);
+    vec_mul_release(mul);
+    vec_add_release(add);
+    printk("rows: ok\n");
+}
+
+// a row of the matmul test: 64 one-QPU multiplies in a batch, the QPUs
+// switching every instruction.
+static int batch_wrong(struct mulGPU **mul, int nmul, int raw)
+{
+    static qpu_req_t reqs[64];
+    gpu_batch_t b;
+    int wrong = 0;
+
+    gpu_batch_init(&b, reqs, 64);
+    for (int j = 0; j < nmul; j++)
+    {
+        memset((void *)mul[j]->C, 0, 4 * mul[j]->n);
+        // bypass gpu_batch_add's check to show what it keeps out.
+        if (raw)
+            reqs[b.n++] = (qpu_req_t){ .code = mul[j]->kernel.code, .unif = mul[j]->kernel.unif[0] };
+        else
+            assert(gpu_batch_add(&b, &mul[j]->kernel) == 0);
+    }
+    assert(gpu_batch_run(&b) == 0);
+    if (v3d_emu.nfault)
+        panic("%s\n", v3d_emu.qpu.err);
+    for (int j = 0; j < nmul; j++)
+        for (int i = 0; i < mul[j]->n; i++)
+            wrong += mul[j]->C[i] != mul[j]->A[i] * mul[j]->B[i];
+    return wrong;
+}
+
+static void test_batch(void)
+{
+    struct mulGPU *mul[64];
+    int n = 64;
+
+    setup(64 * vec_mul_size(n));
+    v3d_emu.qpu.quantum = 1;
+    v3d_emu.nthreads = 1;
+    for (int j = 0; j < 64; j++)
+    {
+        vec_mul_init(&ctx, &mul[j], n, 1);
+        for (int i = 0; i < n; i++)
+        {
+            mul[j]->A[i] = i + j;
+            mul[j]->B[i] = 3 * j + 1;
+        }
+    }
+
+    // mulshader's rows are the same on every QPU.
+    assert(mul[0]->kernel.code == mul[0]->generic && mul[0]->kernel.num_qpus == 1);
+    int shared = batch_wrong(mul, 64, 1);
+    assert(shared > 0);
+
+    // built for a batch, each lands in its own QPU's rows.
+    for (int j = 0; j < 64; j++)
+    {
+        mul[j]->batch = 1;
+        assert(vec_mul_set_qpus(mul[j], 1) == 1 && mul[j]->kernel.any_qpu);
+    }
+    assert(batch_wrong(mul, 64, 0) == 0);
+    for (int j = 63; j >= 0; j--)
+        vec_mul_release(mul[j]);
+    printk("batch: ok (%d of %d wrong with shared rows)\n", shared, 64 * n);
+}
+
+// bytes of A, B and C per clock for an n-element add.
+static double add_bandwidth(int n, int nq, int load, int rows)
+{
+    struct addGPU *add;
+
+    setup(vec_add_size(n));
+    vec_add_init(&ctx, &add, n, nq);
+    for (int i = 0; i < n; i++)
+    {
+        add->A[i] = i;
+        add->B[i] = 3 * i;
+    }
+    add->load = load;
+    add->rows = rows;
+    vec_add_set_qpus(add, nq);
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, add->kernel.code, built_bytes(add->built), add->kernel.unif, add->kernel.num_qpus) == 0);
+    for (int i = 0; i < n; i++)
+        assert(add->C[i] == 4 * i);
+    return 12.0 * n / t.cycles;
+}
+
+static void test_sweep(void)
+{
+    static const int loads[] = { QB_LOAD_DMA, QB_LOAD_PIPE };
+    static const char *names[] = { "dma", "pipe" };
+    int n = 1 << 16;
+
+    printk("add %d, bytes/clock by rows a transfer\n", n);
+    for (int l = 0; l < 2; l++)
+        for (int nq = 1; nq <= V3D_NUM_QPUS; nq *= 2)
+        {
+            int max = loads[l] == QB_LOAD_PIPE ? qb_map2_pipe_rows(nq) : qb_map2_rows(nq);
+            double bw[9] = { 0 };
+            int best = 1;
+
+            printk("%s %2d QPUs:", names[l], nq);
+            // rows that do not divide the vectors would round down.
+            for (int rows = 1; rows <= max; rows *= 2)
+            {
+                bw[rows] = add_bandwidth(n, nq, loads[l], rows);
+                best = bw[rows] > bw[best] ? rows : best;
+                printk(" %d: %.2f", rows, bw[rows]);
+            }
+            printk("; best %d\n", best);
+
+            // one QPU waits out the DMA latency on every transfer.
+            if (nq == 1 && loads[l] == QB_LOAD_DMA)
+                assert(best == max && bw[max] > 4 * bw[1]);
+        }
+    printk("sweep: ok\n");
+}
+
+int main(void)
+{
+    test_rows();
+    test_batch();
+    test_sweep();
+    printk("SUCCESS: vpm rows\n");
+    return 0;
+}
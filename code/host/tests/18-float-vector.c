@@ -0,0 +1,121 @@
+// the float vectors (float-vector.h): every op on vectors and scalars and
+// the multiply-add against the CPU on the emulator, bit for bit, over
+// sizes that are not whole blocks and on several QPU counts.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-builder.h"
+#include "float-vector.h"
+
+static gpu_ctx_t ctx;
+
+static const int ops[] = { FVEC_ADD, FVEC_SUB, FVEC_MUL, FVEC_MIN, FVEC_MAX };
+static const char *op_names[] = { "add", "sub", "mul", "min", "max" };
+
+static float cpu_op(int op, float a, float b)
+{
+    switch (op)
+    {
+    case FVEC_ADD: return a + b;
+    case FVEC_SUB: return a - b;
+    case FVEC_MUL: return a * b;
+    case FVEC_MIN: return a < b ? a : b;
+    default: return a > b ? a : b;
+    }
+}
+
+static void same(const char *what, int i, float got, float want)
+{
+    if (memcmp(&got, &want, 4))
+        panic("%s: [%d] = %g, expected %g\n", what, i, got, want);
+    if (v3d_emu.nfault)
+        panic("%s: %s\n", what, v3d_emu.qpu.err);
+}
+
+static void setup(int n)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, fvec_gpu_size() + 4 * fvec_size(n)) == 0);
+}
+
+static void test_ops(int n, int nq)
+{
+    fvec_gpu_t g;
+    fvec_t a, b, c, d;
+
+    setup(n);
+    assert(fvec_gpu_init(&ctx, &g, nq) == 0);
+    assert(fvec_alloc(&ctx, &a, n) == 0 && fvec_alloc(&ctx, &b, n) == 0);
+    assert(fvec_alloc(&ctx, &c, n) == 0 && fvec_alloc(&ctx, &d, n) == 0);
+    for (int i = 0; i < n; i++)
+    {
+        a.v[i] = i * 0.375f - 200;
+        b.v[i] = 150 - i * 0.0625f;
+    }
+
+    for (int o = 0; o < 5; o++)
+    {
+        assert(fvec_map(&g, ops[o], &c, &a, &b) == 0);
+        for (int i = 0; i < n; i++)
+            same(op_names[o], i, c.v[i], cpu_op(ops[o], a.v[i], b.v[i]));
+        assert(fvec_map_scalar(&g, ops[o], &c, &a, -3.25f) == 0);
+        for (int i = 0; i < n; i++)
+            same(op_names[o], i, c.v[i], cpu_op(ops[o], a.v[i], -3.25f));
+    }
+
+    // the macros, in place.
+    assert(fvec_mul(&g, &c, &a, &b) == 0 && fvec_add(&g, &c, &c, 1.5f) == 0);
+    for (int i = 0; i < n; i++)
+        same("mul then add", i, c.v[i], a.v[i] * b.v[i] + 1.5f);
+
+    for (int i = 0; i < n; i++)
+        c.v[i] = i * 0.5f;
+    assert(fvec_fma(&g, &d, &a, &b, &c) == 0);
+    for (int i = 0; i < n; i++)
+    {
+        float p = a.v[i] * b.v[i];
+        same("fma", i, d.v[i], p + c.v[i]);
+    }
+    printk("%d elements on %d QPUs (%d rows): ok\n", n, nq, g.rows);
+    gpu_release(&ctx);
+}
+
+static void test_errors(void)
+{
+    fvec_gpu_t g;
+    fvec_t a, b, c;
+
+    setup(256);
+    assert(fvec_gpu_init(&ctx, &g, 4) == 0);
+    assert(fvec_alloc(&ctx, &a, 100) == 0 && fvec_alloc(&ctx, &b, 99) == 0 && fvec_alloc(&ctx, &c, 100) == 0);
+    assert(fvec_add(&g, &c, &a, &b) == -1);
+    assert(fvec_fma(&g, &c, &a, &a, &b) == -1);
+    assert(fvec_map(&g, QPU_A_ADD, &c, &a, &a) == -1);
+    assert(fvec_map_scalar(&g, QPU_A_AND, &c, &a, 1) == -1);
+    assert(!v3d_emu.nfault);
+    gpu_release(&ctx);
+
+    // the largest kernels fit the code space.
+    static uint32_t code[2 * QB_MAP2_MAX];
+    qb_t q;
+    qb_init(&q, code, QB_MAP2_MAX);
+    qb_map1s(&q, QPU_A_FADD, qb_map1s_rows(1), 0);
+    assert(!q.err && qb_map1s_rows(1) == 16);
+    qb_init(&q, code, QB_MAP2_MAX);
+    qb_fma(&q, qb_fma_rows(1), 0);
+    assert(!q.err && qb_fma_rows(1) == 5);
+    printk("errors: ok\n");
+}
+
+int main(void)
+{
+    test_ops(1000, 1);
+    test_ops(64 * 5 * 3, 3);
+    test_ops(777, 16);
+    test_ops(4096, 7);
+    test_errors();
+    printk("SUCCESS: float vector\n");
+    return 0;
+}
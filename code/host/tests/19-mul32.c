@@ -0,0 +1,226 @@
+// the full 32-bit multiply: QB_MUL32 against the CPU on every map kernel,
+// the multiply launcher using it when told the inputs are wide (or when
+// set_qpus or vec_mul_fill finds they are), and its cost against mul24 in
+// the timing model.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-timing.h"
+#include "qpu-builder.h"
+#include "vector-multiply.h"
+
+static gpu_ctx_t ctx;
+static qpu_timing_t t;
+
+static void setup(uint32_t size)
+{
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, size) == 0);
+}
+
+static uint32_t rnd(void)
+{
+    static uint32_t x = 0x2545f491;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// the corners first, then random words.
+static void fill(struct mulGPU *mul)
+{
+    static const uint32_t edge[] = { 0, 1, 0xffffffff, 0x80000000, 0xffffff, 0x1000000, 0x7fffffff, 0xdeadbeef };
+    for (int i = 0; i < mul->n; i++)
+    {
+        mul->A[i] = i < 64 ? edge[i % 8] : rnd();
+        mul->B[i] = i < 64 ? edge[i / 8] : rnd();
+    }
+}
+
+static void check(struct mulGPU *mul, const char *what)
+{
+    if (v3d_emu.nfault)
+        panic("%s: %s\n", what, v3d_emu.qpu.err);
+    for (int i = 0; i < mul->n; i++)
+        if (mul->C[i] != mul->A[i] * mul->B[i])
+            panic("%s: %x * %x gave %x\n", what, mul->A[i], mul->B[i], mul->C[i]);
+}
+
+static void test_builder(void)
+{
+    static uint32_t code[2 * QB_MAP2_TMU_MAX];
+    qb_t b;
+
+    // the largest of each fits the launchers' code space.
+    qb_init(&b, code, QB_MAP2_TMU_MAX);
+    qb_map2_tmu(&b, QB_MUL32, QB_MUL32_ROWS, 0);
+    assert(!b.err);
+    qb_init(&b, code, QB_MAP2_TMU_MAX);
+    qb_map2_pipe(&b, QB_MUL32, QB_MUL32_ROWS, 0);
+    assert(!b.err);
+    qb_init(&b, code, QB_MAP2_TMU_MAX);
+    qb_map2(&b, QB_MUL32, QB_MUL32_ROWS, 0);
+    assert(!b.err);
+
+    // QB_MUL32 is eight instructions, the last one taking the flags.
+    qb_init(&b, code, QB_MAP2_TMU_MAX);
+    qb_op(&b, QB_MUL32, QB_IF(QPU_COND_ZS), QB_R(0), QB_A(0), QB_R(1));
+    assert(!b.err && b.n == 8);
+    assert(QPU_COND_ADD(QPU_INS(code[14], code[15])) == QPU_COND_ZS);
+    printk("builder: ok\n");
+}
+
+// every load path, on 1, 6 and 16 QPUs, with inputs past 24 bits.
+static void test_paths(void)
+{
+    static const char *names[] = { "vpm", "tmu", "pipe", "dma" };
+    struct mulGPU *mul;
+    int n = 3000;
+
+    setup(vec_mul_size(n));
+    vec_mul_init(&ctx, &mul, n, 1);
+    assert(mul->wide == 0 && mul->op == QB_MUL24);
+    fill(mul);
+    mul->wide = 1;
+    for (int load = QB_LOAD_VPM; load <= QB_LOAD_DMA; load++)
+        for (int nq = 1; nq <= V3D_NUM_QPUS; nq += nq == 1 ? 5 : 10)
+        {
+            char what[32];
+            mul->load = load;
+            memset((void *)mul->C, 0, 4 * n);
+            assert(vec_mul_set_qpus(mul, nq) == nq);
+            assert(mul->op == QB_MUL32 && mul->kernel.code == mul->built);
+            vec_mul_exec(mul);
+            snprintf(what, sizeof what, "%s on %d QPUs", names[load], nq);
+            check(mul, what);
+        }
+
+    // told the inputs fit, it keeps mul24, which drops the high bits.
+    mul->wide = 0;
+    mul->load = QB_LOAD_VPM;
+    assert(vec_mul_set_qpus(mul, 1) == 1 && mul->op == QB_MUL24 && mul->kernel.code == mul->generic);
+    vec_mul_exec(mul);
+    assert(mul->A[21] * mul->B[21] == 0xff000000 && mul->C[21] == 0);
+    vec_mul_release(mul);
+    printk("paths: ok\n");
+}
+
+// wide at -1: set_qpus looks at the inputs, the launches do not; what
+// vec_mul_fill copies in it checks as it goes, and the next launch
+// switches.
+static void test_switch(void)
+{
+    static uint32_t a[1000], b[1000];
+    struct mulGPU *mul;
+    int n = 1000;
+
+    setup(vec_mul_size(n));
+    vec_mul_init(&ctx, &mul, n, 4);
+    for (int i = 0; i < n; i++)
+    {
+        mul->A[i] = i;
+        mul->B[i] = 3 * i + 1;
+    }
+    mul->wide = -1;
+    assert(vec_mul_set_qpus(mul, 4) == 4 && mul->op == QB_MUL24);
+    vec_mul_exec(mul);
+    check(mul, "narrow");
+
+    // the launch keeps mul24 ...
+    mul->A[n - 1] = 0x12345678;
+    vec_mul_exec(mul);
+    assert(mul->op == QB_MUL24 && mul->C[n - 1] != mul->A[n - 1] * mul->B[n - 1]);
+    // ... until set_qpus looks again.
+    assert(vec_mul_set_qpus(mul, 4) == 4 && mul->op == QB_MUL32);
+    vec_mul_exec(mul);
+    check(mul, "wide at set_qpus");
+
+    // narrow through vec_mul_fill: mul24.
+    for (int i = 0; i < n; i++)
+    {
+        a[i] = 5 * i;
+        b[i] = i + 7;
+    }
+    mul->wide = 0;
+    assert(vec_mul_set_qpus(mul, 4) == 4 && mul->op == QB_MUL24);
+    vec_mul_fill(mul, a, b);
+    assert(mul->wide == 0);
+    vec_mul_exec(mul);
+    check(mul, "narrow fill");
+    // one wide element: the launch re-splits on the same QPUs with mul32.
+    b[n / 2] = 0x87654321;
+    vec_mul_fill(mul, a, b);
+    assert(mul->wide == 1 && mul->op == QB_MUL24);
+    assert(vec_mul_exec(mul) >= 0 && mul->op == QB_MUL32 && mul->kernel.num_qpus == 4);
+    check(mul, "wide fill");
+
+    // no room for a built kernel: nothing can multiply wide inputs.
+    mul->built = 0;
+    assert(vec_mul_set_qpus(mul, 4) == -1 && vec_mul_exec(mul) == -1);
+    mul->wide = 0;
+    assert(vec_mul_set_qpus(mul, 1) == 1 && mul->op == QB_MUL24 && vec_mul_exec(mul) >= 0);
+    vec_mul_release(mul);
+    printk("switch: ok\n");
+}
+
+// bytes of the kernel the launcher built at 'code': up to thrend and its
+// delay slots.
+static uint32_t built_bytes(uint32_t code)
+{
+    volatile uint32_t *p = gpu_bus_to_cpu(code);
+    uint32_t n = 0;
+    while (QPU_SIG(QPU_INS(p[2 * n], p[2 * n + 1])) != QPU_SIG_PROG_END)
+        n++;
+    return 8 * (n + 1 + QPU_END_DELAY);
+}
+
+// bytes of A, B and C per clock for an n-element multiply on 'nq' QPUs.
+static double mul_bandwidth(int n, int nq, int load, int wide)
+{
+    struct mulGPU *mul;
+
+    setup(vec_mul_size(n));
+    vec_mul_init(&ctx, &mul, n, 1);
+    fill(mul);
+    mul->load = load;
+    mul->wide = wide;
+    if (!wide)
+        for (int i = 0; i < n; i++)
+            mul->A[i] &= 0xffffff, mul->B[i] &= 0xffffff;
+    vec_mul_set_qpus(mul, nq);
+    assert(mul->kernel.code == mul->built);
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, mul->kernel.code, built_bytes(mul->built), mul->kernel.unif, mul->kernel.num_qpus) == 0);
+    check(mul, "timed");
+    return 12.0 * n / t.cycles;
+}
+
+static void test_bandwidth(void)
+{
+    int n = 1 << 18;
+
+    // ten instructions a row instead of two: on enough QPUs the DMA, not
+    // the arithmetic, sets the pace.
+    for (int nq = 1; nq <= V3D_NUM_QPUS; nq *= 4)
+    {
+        double m24 = mul_bandwidth(n, nq, QB_LOAD_PIPE, 0), m32 = mul_bandwidth(n, nq, QB_LOAD_PIPE, 1);
+        printk("mul %d on %2d QPUs: %.2f bytes/clock with mul24, %.2f with QB_MUL32\n", n, nq, m24, m32);
+        if (nq == V3D_NUM_QPUS)
+            assert(m32 > 0.9 * m24);
+    }
+    printk("bandwidth: ok\n");
+}
+
+int main(void)
+{
+    test_builder();
+    test_paths();
+    test_switch();
+    test_bandwidth();
+    printk("SUCCESS: mul32\n");
+    return 0;
+}
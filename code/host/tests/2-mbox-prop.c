@@ -0,0 +1,132 @@
+// mailbox property message encoding, response parsing and bring-up round
+// trips, against the fake firmware in host-mem.c.
+#include "rpi.h"
+#include "mbox-prop.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+
+static void test_encode(void)
+{
+    uint32_t buf[32] __attribute__((aligned(16)));
+    mbox_msg_t m;
+
+    memset(buf, 0xff, sizeof buf);
+    mbox_msg_init(&m, buf, 32);
+    int qpu = mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1);
+    int vc = mbox_msg_add(&m, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+    int alloc = mbox_msg_add(&m, MBOX_TAG_ALLOCATE_MEMORY, (uint32_t[]){ 4096, 16, 0xC }, 3, 1);
+    mbox_msg_end(&m);
+
+    // the same words the old one-tag calls wrote, back to back.
+    static const uint32_t want[] = {
+        18 * 4, MBOX_REQUEST,
+        MBOX_TAG_ENABLE_QPU, 4, 4, 1,
+        MBOX_TAG_GET_VC_MEMORY, 8, 0, 0, 0,
+        MBOX_TAG_ALLOCATE_MEMORY, 12, 12, 4096, 16, 0xC,
+        0,
+    };
+    assert(buf[0] == sizeof want);
+    assert(memcmp(buf, want, sizeof want) == 0);
+    assert(qpu == 5 && vc == 9 && alloc == 14);
+
+    // nothing answered before it is sent.
+    assert(!mbox_msg_resp(&m, qpu, NULL));
+
+    // a tag that does not fit (with its end tag) is refused.
+    mbox_msg_init(&m, buf, 8);
+    assert(mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1) == 5);
+    assert(mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1) < 0);
+    assert(m.n == 6);
+    printk("encode: ok\n");
+}
+
+static void test_responses(void)
+{
+    uint32_t buf[32] __attribute__((aligned(16)));
+    mbox_msg_t m;
+    unsigned nbytes;
+
+    host_mem_reset();
+    mbox_msg_init(&m, buf, 32);
+    int arm = mbox_msg_add(&m, MBOX_TAG_GET_ARM_MEMORY, NULL, 0, 2);
+    int vc = mbox_msg_add(&m, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+    int qpu = mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1);
+    int bogus = mbox_msg_add(&m, 0x12345, (uint32_t[]){ 7 }, 1, 1);
+    int alloc = mbox_msg_add(&m, MBOX_TAG_ALLOCATE_MEMORY, (uint32_t[]){ 8192, 4096, 0xC }, 3, 1);
+    assert(mbox_msg_send(&m) == 0);
+    assert(buf[1] == MBOX_RESPONSE_OK);
+
+    // every tag was answered in the same round trip.
+    assert(host_mem_stats.nmbox == 1 && host_mem_stats.ntags == 5);
+    uint32_t *r = mbox_msg_resp(&m, arm, &nbytes);
+    assert(r && nbytes == 8 && r[0] == 0 && r[1] == HOST_MEM_PHYS);
+    r = mbox_msg_resp(&m, vc, &nbytes);
+    assert(r && nbytes == 8 && r[0] == HOST_MEM_PHYS && r[1] == HOST_MEM_SIZE);
+    r = mbox_msg_resp(&m, qpu, &nbytes);
+    assert(r && nbytes == 4 && r[0] == 0);
+    assert(host_mem_stats.qpu_enabled);
+    r = mbox_msg_resp(&m, alloc, NULL);
+    assert(r && r[0] != 0);
+    assert(host_mem_stats.nalloc == 1);
+
+    // an unknown tag is skipped, not fatal.
+    assert(!mbox_msg_resp(&m, bogus, NULL));
+    assert(!mbox_msg_resp(&m, 3, NULL));
+
+    // a bad size word makes the firmware reject the whole message.
+    mbox_msg_init(&m, buf, 32);
+    qpu = mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 0 }, 1, 1);
+    mbox_msg_end(&m);
+    buf[0] += 8;
+    assert(!mbox_property(buf));
+    assert(buf[1] != MBOX_RESPONSE_OK);
+    assert(host_mem_stats.qpu_enabled);
+    printk("responses: ok\n");
+}
+
+static void test_bringup(void)
+{
+    mbox_gpu_mem_t g;
+
+    // enable, split and allocate in one round trip, lock in a second.
+    host_mem_reset();
+    assert(mbox_gpu_mem_open(&g, 1 << 20, 4096, GPU_MEM_DIRECT, 1) == 0);
+    assert(host_mem_stats.nmbox == 2);
+    assert(host_mem_stats.qpu_enabled && host_mem_stats.nlock == 1);
+    assert(g.handle && (g.bus & GPU_ALIAS_MASK) == 0xC0000000);
+    assert(g.vc_base == HOST_MEM_PHYS && g.vc_size == HOST_MEM_SIZE);
+    assert(g.arm_size == HOST_MEM_PHYS);
+
+    // a failed step undoes the earlier ones.
+    host_mem_reset();
+    host_mem_fail_tag = MBOX_TAG_LOCK_MEMORY;
+    assert(mbox_gpu_mem_open(&g, 4096, 4096, GPU_MEM_FLG, 1) == -4);
+    assert(host_mem_stats.bytes_live == 0 && !host_mem_stats.qpu_enabled);
+
+    host_mem_reset();
+    assert(mbox_gpu_mem_open(&g, HOST_MEM_SIZE + 1, 4096, GPU_MEM_FLG, 1) == -3);
+    assert(!host_mem_stats.qpu_enabled);
+
+    host_mem_reset();
+    host_mem_fail_tag = MBOX_TAG_ENABLE_QPU;
+    assert(mbox_gpu_mem_open(&g, 4096, 4096, GPU_MEM_FLG, 1) == -2);
+    assert(host_mem_stats.bytes_live == 0);
+
+    // gpu_init: two round trips where it used to take three.
+    gpu_ctx_t ctx;
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    assert(host_mem_stats.nmbox == 2 && host_mem_stats.nenable == 1);
+    gpu_release(&ctx);
+    assert(!host_mem_stats.qpu_enabled && host_mem_stats.bytes_live == 0);
+    printk("bring-up: ok\n");
+}
+
+int main(void)
+{
+    test_encode();
+    test_responses();
+    test_bringup();
+    printk("SUCCESS: mailbox property messages\n");
+    return 0;
+}
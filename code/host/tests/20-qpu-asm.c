@@ -0,0 +1,88 @@
+// the assembler: every shipped .qasm against the vc4asm array checked in
+// next to it, and sources it has to refuse.
+#include "rpi.h"
+#include "qpu-isa.h"
+#include "qpu-asm.h"
+#include "addshader.h"
+#include "mulshader.h"
+#include "simpleshader.h"
+#include "mandelbrotshader.h"
+
+static char src[1 << 16], err[256];
+static uint32_t code[2 * 1024];
+
+static void read_file(const char *path, char *buf, size_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        panic("cannot open %s\n", path);
+    size_t n = fread(buf, 1, max - 1, f);
+    fclose(f);
+    buf[n] = 0;
+}
+
+static int as(const char *text)
+{
+    return qpu_asm(text, code, sizeof code / 8, err, sizeof err);
+}
+
+static int same(const char *path, const uint32_t *want, uint32_t nbytes)
+{
+    read_file(path, src, sizeof src);
+    int n = as(src);
+    if (n < 0)
+        panic("%s: %s\n", path, err);
+    if ((uint32_t)n != nbytes / 8)
+        panic("%s: %d instructions, want %u\n", path, n, nbytes / 8);
+    for (int i = 0; i < n; i++)
+        if (code[2 * i] != want[2 * i] || code[2 * i + 1] != want[2 * i + 1])
+            panic("%s: %x: %08x %08x, want %08x %08x\n", path, 8 * i,
+                code[2 * i + 1], code[2 * i], want[2 * i + 1], want[2 * i]);
+    return n;
+}
+
+static void test_kernels(void)
+{
+    int n = same("../parallel-add.qasm", addshader, sizeof addshader)
+        + same("../vector-multiply.qasm", mulshader, sizeof mulshader)
+        + same("../deadbeef.qasm", simpleshader, sizeof simpleshader)
+        + same("../mandelbrot.qasm", mandelbrotshader, sizeof mandelbrotshader);
+    printk("kernels: %d instructions, same as vc4asm\n", n);
+}
+
+static void test_encodings(void)
+{
+    // add of 16 only fits as sub of -16.
+    assert(as("add ra11, ra11, 16\n") == 1 && code[0] == 0x0d2d0dc0 && code[1] == 0xd00202e7);
+    // file A reads go to raddr_a, either-file reads take what is left.
+    assert(as("add r0, ra1, unif\n") == 1 && QPU_RADDR_A(QPU_INS(code[0], code[1])) == 1
+        && QPU_RADDR_B(QPU_INS(code[0], code[1])) == QPU_R_UNIF);
+    // the mul pipe writes file B with ws clear.
+    assert(as("fmul rb2, r0, r1\n") == 1 && QPU_WS(QPU_INS(code[0], code[1])) == 0
+        && QPU_WADDR_MUL(QPU_INS(code[0], code[1])) == 2);
+    // a branch back over itself and its delay slots.
+    assert(as(":x\nnop\nbrr.anyc -, :x\nnop\nnop\nnop\n") == 5 && code[2] == (uint32_t)-40
+        && QPU_BR_COND(QPU_INS(code[2], code[3])) == QPU_BR_ANYC);
+    printk("encodings: ok\n");
+}
+
+static void test_errors(void)
+{
+    assert(as("mov r0, 1\nfrob r0, r0\n") < 0 && strstr(err, "line 2: unknown instruction"));
+    assert(as("add r0, ra1, ra2\n") < 0 && strstr(err, "line 1: two reads from register file A"));
+    assert(as("add r0, rb1, 3\n") < 0 && strstr(err, "small immediate"));
+    assert(as("add r0, r1, 100\n") < 0 && strstr(err, "does not fit"));
+    assert(as("brr -, :nowhere\n") < 0 && strstr(err, "no label 'nowhere'"));
+    assert(as("mov r4, 1\n") < 0 && strstr(err, "cannot write r4"));
+    assert(as(".align 8\n") < 0 && strstr(err, "unsupported directive"));
+    printk("errors: ok\n");
+}
+
+int main(void)
+{
+    test_kernels();
+    test_encodings();
+    test_errors();
+    printk("SUCCESS: qpu assembler\n");
+    return 0;
+}
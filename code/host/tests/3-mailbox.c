@@ -0,0 +1,112 @@
+// mailbox channel demultiplexing, non-blocking reads and overlapping
+// property calls, against the memory-backed mailbox in mbox-mock.c.
+#include "rpi.h"
+#include "mailbox.h"
+#include "mbox-prop.h"
+#include "host-mem.h"
+#include "mbox-mock.h"
+
+static void test_demux(void)
+{
+    uint32_t data;
+
+    host_mem_reset();
+    assert(!mailbox_poll(1, &data));
+
+    // interleaved channels: each reader sees only its own, in order.
+    mbox_mock_push(1, 0x100);
+    mbox_mock_push(9, 0x900);
+    mbox_mock_push(1, 0x110);
+    mbox_mock_push(9, 0x910);
+    assert(mailbox_poll(9, &data) && data == 0x900);
+    assert(mbox_mock.in_n == 0);
+    assert(mailbox_read(9) == 0x910);
+    assert(!mailbox_poll(9, &data));
+    assert(mailbox_poll(1, &data) && data == 0x100);
+    assert(mailbox_read_timeout(1, &data, 1000) == 0 && data == 0x110);
+
+    // nothing there: the timeout expires instead of spinning forever.
+    unsigned start = timer_get_usec();
+    assert(mailbox_read_timeout(1, &data, 2000) < 0);
+    assert(timer_get_usec() - start >= 2000);
+
+    // a channel nobody reads overflows on its own.
+    for (int i = 0; i < MBOX_QUEUE_LEN + 3; i++)
+        mbox_mock_push(5, i << 4);
+    mbox_mock_push(2, 0x200);
+    assert(mailbox_poll(2, &data) && data == 0x200);
+    assert(mailbox_dropped() == 3);
+    for (int i = 0; i < MBOX_QUEUE_LEN; i++)
+        assert(mailbox_poll(5, &data) && data == i << 4);
+    printk("demux: ok\n");
+}
+
+static void test_writes(void)
+{
+    host_mem_reset();
+    mbox_mock.auto_reply = 0;
+
+    for (int i = 0; i < MBOX_MOCK_FIFO; i++)
+        assert(mailbox_try_write(3, i << 4) == 0);
+    assert(mailbox_try_write(3, 0x80) < 0);
+    assert(mbox_mock.overflow == 0);
+    assert(mbox_mock.out[1] == (1 << 4 | 3));
+
+    // the VC drains one: there is room again.
+    assert(mbox_mock_reply(1) == 1);
+    assert(mailbox_try_write(3, 0x80) == 0);
+    printk("writes: ok\n");
+}
+
+static void test_overlap(void)
+{
+    uint32_t a[16] __attribute__((aligned(16)));
+    uint32_t b[16] __attribute__((aligned(16)));
+    mbox_msg_t ma, mb;
+
+    host_mem_reset();
+    mbox_mock.auto_reply = 0;
+
+    mbox_msg_init(&ma, a, 16);
+    int vc = mbox_msg_add(&ma, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+    mbox_msg_init(&mb, b, 16);
+    int qpu = mbox_msg_add(&mb, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1);
+
+    // both in flight at once; the CPU is free until the replies come.
+    assert(mbox_msg_start(&ma) == 0);
+    assert(mbox_msg_start(&mb) == 0);
+    assert(!mbox_msg_done(&ma) && !mbox_msg_done(&mb));
+    assert(host_mem_stats.nmbox == 0);
+
+    // replies are matched by buffer, whatever order they are collected in.
+    assert(mbox_mock_reply(2) == 2);
+    assert(mbox_msg_done(&mb));
+    assert(!mbox_msg_done(&mb));
+    assert(mbox_msg_done(&ma));
+    assert(mbox_msg_resp(&ma, vc, NULL)[1] == HOST_MEM_SIZE);
+    assert(mbox_msg_resp(&mb, qpu, NULL)[0] == 0);
+    assert(host_mem_stats.qpu_enabled);
+
+    // an unanswered call times out; the late reply is still collected.
+    mbox_msg_init(&ma, a, 16);
+    mbox_msg_add(&ma, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+    assert(mbox_msg_start(&ma) == 0);
+    assert(mbox_property_wait(a, 1000) < 0);
+    mbox_mock_reply(1);
+    assert(mbox_property_wait(a, 1000) == 1);
+
+    // misaligned buffers are refused before they reach the mailbox.
+    assert(mbox_property_start(a + 1) < 0);
+    assert(!mbox_property(a + 1));
+    assert(mbox_mock.nwrites == 3);
+    printk("overlap: ok\n");
+}
+
+int main(void)
+{
+    test_demux();
+    test_writes();
+    test_overlap();
+    printk("SUCCESS: mailbox\n");
+    return 0;
+}
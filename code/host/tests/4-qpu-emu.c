@@ -0,0 +1,195 @@
+// the checked-in shader binaries, run through the gpu runtime on the QPU
+// emulator and checked against the CPU.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+#include "simpleshader.h"
+#include "mandelbrotshader.h"
+
+static void emu_reset(void)
+{
+    host_mem_reset();
+    v3d_emu_init();
+}
+
+static void check_no_faults(void)
+{
+    if (v3d_emu.nfault)
+        panic("%d faults: %s\n", v3d_emu.nfault, v3d_emu.qpu.err);
+}
+
+static void test_deadbeef(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+
+    emu_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    volatile uint32_t *out = gpu_alloc(&ctx, 8 * sizeof(uint32_t), 16);
+    assert(out);
+    memset((void *)out, 0, 8 * sizeof(uint32_t));
+    assert(gpu_kernel_init(&ctx, &k, simpleshader, sizeof simpleshader, 1) == 0);
+    volatile uint32_t *u = gpu_kernel_unifs(&ctx, &k, 1);
+    u[0] = gpu_bus(&ctx, out);
+
+    assert(gpu_launch(&k) == 0);
+    check_no_faults();
+    // one 4-word VDW row; nothing past it.
+    for (int i = 0; i < 4; i++)
+        assert(out[i] == 0xfaded070);
+    assert(out[4] == 0);
+    gpu_release(&ctx);
+    printk("deadbeef: ok\n");
+}
+
+static void test_add(void)
+{
+    static const int sizes[] = { 1, 16, 17, 100, 1000 };
+
+    for (int s = 0; s < sizeof sizes / sizeof sizes[0]; s++)
+    {
+        int n = sizes[s];
+        gpu_ctx_t ctx;
+        struct addGPU *gpu;
+
+        emu_reset();
+        assert(gpu_init(&ctx, vec_add_size(n)) == 0);
+        vec_add_init(&ctx, &gpu, n, 1);
+        for (int q = 1; q <= V3D_NUM_QPUS; q++)
+        {
+            vec_add_set_qpus(gpu, q);
+            for (int i = 0; i < n; i++)
+            {
+                gpu->A[i] = i * 7 + q;
+                gpu->B[i] = 0x10000 - i;
+                gpu->C[i] = 0xdeadbeef;
+            }
+            vec_add_exec(gpu);
+            check_no_faults();
+            for (int i = 0; i < n; i++)
+                assert(gpu->C[i] == (uint32_t)(i * 7 + q) + 0x10000 - i);
+        }
+        vec_add_release(gpu);
+        gpu_release(&ctx);
+    }
+    printk("add: ok\n");
+}
+
+static void test_mul(void)
+{
+    static const int sizes[] = { 1, 64, 65, 1000 };
+
+    for (int s = 0; s < sizeof sizes / sizeof sizes[0]; s++)
+    {
+        int n = sizes[s];
+        gpu_ctx_t ctx;
+        struct mulGPU *gpu;
+
+        emu_reset();
+        assert(gpu_init(&ctx, vec_mul_size(n)) == 0);
+        // one QPU: the kernel's VPM rows are shared by every QPU.
+        vec_mul_init(&ctx, &gpu, n, 1);
+        for (int i = 0; i < n; i++)
+        {
+            gpu->A[i] = i + 3;
+            gpu->B[i] = (i * 37) & 0xffffff;
+        }
+        vec_mul_exec(gpu);
+        check_no_faults();
+        // mul24: the low 32 bits of the 24x24-bit product.
+        for (int i = 0; i < n; i++)
+            assert(gpu->C[i] == (uint32_t)(i + 3) * ((i * 37) & 0xffffff));
+        vec_mul_release(gpu);
+        gpu_release(&ctx);
+    }
+    printk("mul: ok\n");
+}
+
+#define RES 16
+#define MAX_ITERS 100
+#define MANDEL_QPUS 8
+
+static void test_mandelbrot(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    union { float f; uint32_t i; } step = { .f = 1.0f / RES };
+
+    emu_reset();
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+    volatile uint32_t (*out)[2 * RES] = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(out);
+    assert(gpu_kernel_init(&ctx, &k, mandelbrotshader, sizeof mandelbrotshader, MANDEL_QPUS) == 0);
+    volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+    for (int q = 0; q < MANDEL_QPUS; q++)
+    {
+        volatile uint32_t *u = &unif[q * 6];
+        u[0] = RES;
+        u[1] = step.i;
+        u[2] = MAX_ITERS;
+        u[3] = MANDEL_QPUS;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, out);
+    }
+
+    assert(gpu_launch(&k) == 0);
+    check_no_faults();
+
+    // the kernel's arithmetic, in the kernel's order: 1 = escaped.
+    int escaped = 0;
+    for (int i = 0; i < 2 * RES; i++)
+        for (int j = 0; j < 2 * RES; j++)
+        {
+            float y = (float)i * step.f + -1.0f, x = (float)j * step.f + -1.0f;
+            float u = 0, v = 0, u2 = 0, v2 = 0;
+            uint32_t want = 0;
+            for (int it = 0; it < MAX_ITERS; it++)
+            {
+                v = v * 2.0f * u + y;
+                u = u2 + x - v2;
+                u2 = u * u;
+                v2 = v * v;
+                if (4.0f - (u2 + v2) < 0)
+                    want = 1;
+            }
+            assert(out[i][j] == want);
+            escaped += want;
+        }
+    // both colours show up.
+    assert(escaped > 0 && escaped < 4 * RES * RES);
+    gpu_release(&ctx);
+    printk("mandelbrot: ok (%d instructions)\n", (int)v3d_emu.qpu.ninstr);
+}
+
+static void test_faults(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+
+    // uniforms pointing outside the arena: the DMA faults, the launch
+    // still completes.
+    emu_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    assert(gpu_kernel_init(&ctx, &k, simpleshader, sizeof simpleshader, 1) == 0);
+    volatile uint32_t *u = gpu_kernel_unifs(&ctx, &k, 1);
+    u[0] = 0x1000;
+    assert(gpu_launch(&k) == 0);
+    assert(v3d_emu.nfault == 1);
+    assert(strstr(v3d_emu.qpu.err, "bad bus address 1000"));
+    gpu_release(&ctx);
+    printk("faults: ok\n");
+}
+
+int main(void)
+{
+    test_deadbeef();
+    test_add();
+    test_mul();
+    test_mandelbrot();
+    test_faults();
+    printk("SUCCESS: qpu emulator\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+// the timing model: stall accounting on a hand-assembled program, and
+// the add and mandelbrot kernels on one and several QPUs.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "qpu-timing.h"
+#include "parallel-add.h"
+#include "addshader.h"
+#include "mandelbrotshader.h"
+
+static qpu_timing_t t;
+
+// ALU instruction halves: hi is bits 63:32, lo bits 31:0.
+#define HI(sig, cond_add, waddr_add, waddr_mul) \
+    ((uint32_t)(sig) << 28 | (cond_add) << 17 | (waddr_add) << 6 | (waddr_mul))
+#define LO(op_add, raddr_a, raddr_b, add_a, add_b) \
+    ((op_add) << 24 | (raddr_a) << 18 | (raddr_b) << 12 | (add_a) << 9 | (add_b) << 6)
+#define NOP(sig) LO(QPU_A_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0), HI(sig, 0, QPU_W_NOP, QPU_W_NOP)
+
+static void check_totals(void)
+{
+    uint64_t n = 0, stall[QPU_NUM_STALLS] = {0};
+
+    for (unsigned i = 0; i < t.ncode; i++)
+    {
+        n += t.ins[i].count;
+        for (int s = 0; s < QPU_NUM_STALLS; s++)
+            stall[s] += t.ins[i].stall[s];
+    }
+    assert(n == t.ninstr);
+    assert(memcmp(stall, t.stall, sizeof stall) == 0);
+}
+
+static void test_stalls(void)
+{
+    static const uint32_t prog[] = {
+        // ldi ra0, 5.0f
+        0x40a00000, HI(QPU_SIG_LOAD_IMM, QPU_COND_ALWAYS, 0, QPU_W_NOP),
+        // or ra1, ra0, ra0: reads ra0 straight after the write
+        LO(QPU_A_OR, 0, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A), HI(QPU_SIG_NONE, QPU_COND_ALWAYS, 1, QPU_W_NOP),
+        // or sfu_recip, ra0, ra0
+        LO(QPU_A_OR, 0, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A),
+        HI(QPU_SIG_NONE, QPU_COND_ALWAYS, QPU_W_SFU_RECIP, QPU_W_NOP),
+        // or r0, r4, r4: one instruction too early
+        LO(QPU_A_OR, QPU_R_NOP, QPU_R_NOP, QPU_MUX_R4, QPU_MUX_R4),
+        HI(QPU_SIG_NONE, QPU_COND_ALWAYS, QPU_W_R0, QPU_W_NOP),
+        NOP(QPU_SIG_PROG_END),
+        NOP(QPU_SIG_NONE),
+        NOP(QPU_SIG_NONE),
+    };
+    gpu_ctx_t ctx;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    uint32_t code = gpu_load_code(&ctx, prog, sizeof prog);
+    uint32_t unif = 0;
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, code, sizeof prog, &unif, 1) == 0);
+    qpu_timing_report(&t);
+    check_totals();
+
+    assert(t.ninstr == 7);
+    assert(t.stall[QPU_STALL_REGFILE] == t.p.issue);
+    assert(t.ins[1].stall[QPU_STALL_REGFILE] == t.p.issue);
+    assert(t.stall[QPU_STALL_SFU] == t.p.sfu_latency - t.p.issue);
+    assert(t.ins[3].stall[QPU_STALL_SFU] == t.stall[QPU_STALL_SFU]);
+    assert(t.cycles == 7 * t.p.issue + t.p.issue + t.p.sfu_latency - t.p.issue);
+
+    // the answer is still right: timing does not change what runs.
+    union { uint32_t u; float f; } r = { .u = t.emu.qpu[0].acc[0][0] };
+    assert(r.f > 0.19f && r.f < 0.21f);
+    gpu_release(&ctx);
+    printk("stalls: ok\n");
+}
+
+static uint64_t time_add(int n, int num_qpus, uint64_t *dma)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *gpu;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, vec_add_size(n)) == 0);
+    vec_add_init(&ctx, &gpu, n, num_qpus);
+    for (int i = 0; i < n; i++)
+    {
+        gpu->A[i] = i;
+        gpu->B[i] = 3 * i;
+    }
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, gpu->kernel.code, sizeof addshader, gpu->kernel.unif, gpu->kernel.num_qpus) == 0);
+    check_totals();
+    for (int i = 0; i < n; i++)
+        assert(gpu->C[i] == 4 * i);
+    *dma = t.stall[QPU_STALL_DMA_LOAD] + t.stall[QPU_STALL_DMA_STORE];
+
+    // the loop branches back with nops in its delay slots.
+    assert(t.stall[QPU_STALL_BRANCH] > 0);
+    gpu_release(&ctx);
+    return t.cycles;
+}
+
+static void test_add(void)
+{
+    uint64_t dma1, dma8;
+    uint64_t one = time_add(16 * 64, 1, &dma1);
+    uint64_t eight = time_add(16 * 64, 8, &dma8);
+
+    printk("add: %llu cycles on 1 QPU, %llu on 8\n", (unsigned long long)one, (unsigned long long)eight);
+    qpu_timing_report(&t);
+
+    // more QPUs help, but they queue on the shared DMA engines.
+    assert(eight < one);
+    assert(eight * 8 > one);
+    assert(dma8 > dma1);
+    printk("add: ok\n");
+}
+
+#define RES 16
+
+static void test_mandelbrot(void)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    union { float f; uint32_t i; } step = { .f = 1.0f / RES };
+    uint64_t cycles[2];
+
+    for (int run = 0; run < 2; run++)
+    {
+        int nq = run ? 8 : 1;
+        host_mem_reset();
+        assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+        volatile uint32_t *out = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+        assert(gpu_kernel_init(&ctx, &k, mandelbrotshader, sizeof mandelbrotshader, nq) == 0);
+        volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+        for (int q = 0; q < nq; q++)
+        {
+            volatile uint32_t *u = &unif[q * 6];
+            u[0] = RES;
+            u[1] = step.i;
+            u[2] = 100;
+            u[3] = nq;
+            u[4] = q;
+            u[5] = gpu_bus(&ctx, out);
+        }
+        qpu_timing_init(&t, host_mem_ptr);
+        assert(qpu_timing_run(&t, k.code, sizeof mandelbrotshader, k.unif, nq) == 0);
+        check_totals();
+        cycles[run] = t.cycles;
+        gpu_release(&ctx);
+    }
+    printk("mandelbrot: %llu cycles on 1 QPU, %llu on 8\n",
+        (unsigned long long)cycles[0], (unsigned long long)cycles[1]);
+    qpu_timing_report(&t);
+
+    // compute bound: eight QPUs get close to eight times faster.
+    assert(cycles[1] * 7 < cycles[0]);
+    printk("mandelbrot: ok\n");
+}
+
+int main(void)
+{
+    test_stalls();
+    test_add();
+    test_mandelbrot();
+    printk("SUCCESS: qpu timing model\n");
+    return 0;
+}
@@ -0,0 +1,188 @@
+// running many programs at once on the emulator's thread pool: the VPM
+// mutex, semaphores, deadlock detection, and full-size kernels through
+// the runtime on several threads.
+#include <unistd.h>
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "parallel-add.h"
+#include "mandelbrotshader.h"
+
+// instruction halves: hi is bits 63:32, lo bits 31:0.
+#define HI(sig, ws, waddr_add) \
+    ((uint32_t)(sig) << 28 | QPU_COND_ALWAYS << 17 | (ws) << 12 | (waddr_add) << 6 | QPU_W_NOP)
+#define LO(op_add, raddr_a, raddr_b, add_a, add_b) \
+    ((op_add) << 24 | (raddr_a) << 18 | (raddr_b) << 12 | (add_a) << 9 | (add_b) << 6)
+#define NOP(sig) LO(QPU_A_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0), HI(sig, 0, QPU_W_NOP) & ~(QPU_COND_ALWAYS << 17)
+#define LDI(ws, waddr, imm) (imm), HI(QPU_SIG_LOAD_IMM, ws, waddr)
+#define SEMA(acquire, n) ((acquire) << 4 | (n)), (HI(QPU_SIG_LOAD_IMM, 0, QPU_W_NOP) | QPU_LDI_SEMA << 25)
+#define END NOP(QPU_SIG_PROG_END), NOP(QPU_SIG_NONE), NOP(QPU_SIG_NONE)
+
+// counter += 1 through the TMU and VDW, with VPM row 0 shared under the
+// mutex.  The uniform is the counter's address.
+static const uint32_t incr[] = {
+    LO(QPU_A_OR, QPU_R_UNIF, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A), HI(QPU_SIG_NONE, 0, 0),         // mov ra0, unif
+    LO(QPU_A_OR, QPU_R_MUTEX, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A), HI(QPU_SIG_NONE, 0, QPU_W_NOP), // mov -, mutex
+    LO(QPU_A_OR, 0, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A), HI(QPU_SIG_NONE, 0, QPU_W_TMU0_S),      // mov tmu0_s, ra0
+    NOP(QPU_SIG_LOAD_TMU0),                                                                     // ldtmu0
+    LDI(1, QPU_W_VPM_SETUP, 0x00001a00),                                                        // vw_setup h32(0)
+    LO(QPU_A_ADD, QPU_R_NOP, 1, QPU_MUX_R4, QPU_MUX_B), HI(QPU_SIG_SMALL_IMM, 0, QPU_W_R1),   // add r1, r4, 1
+    LO(QPU_A_OR, QPU_R_NOP, QPU_R_NOP, QPU_MUX_R1, QPU_MUX_R1), HI(QPU_SIG_NONE, 0, QPU_W_VPM), // mov vpm, r1
+    LDI(1, QPU_W_VPM_SETUP, 0x80814000),                                                        // 1 row of 1 word
+    LO(QPU_A_OR, 0, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A), HI(QPU_SIG_NONE, 1, QPU_W_VPM_ADDR),    // mov vw_addr, ra0
+    LO(QPU_A_OR, QPU_R_NOP, QPU_R_VPM_WAIT, QPU_MUX_B, QPU_MUX_B), HI(QPU_SIG_NONE, 0, QPU_W_NOP), // mov -, vw_wait
+    LO(QPU_A_OR, QPU_R_NOP, QPU_R_NOP, QPU_MUX_R0, QPU_MUX_R0), HI(QPU_SIG_NONE, 0, QPU_W_MUTEX), // mov mutex, r0
+    END,
+};
+
+static const uint32_t wait0[] = { SEMA(1, 0), END };
+static const uint32_t post0x4[] = { SEMA(0, 0), SEMA(0, 0), SEMA(0, 0), SEMA(0, 0), END };
+
+static qpu_emu_t e;
+
+static void test_mutex(void)
+{
+    gpu_ctx_t ctx;
+    qpu_emu_req_t reqs[200];
+
+    for (int nthreads = 1; nthreads <= 8; nthreads *= 2)
+    {
+        host_mem_reset();
+        assert(gpu_init(&ctx, 4096) == 0);
+        uint32_t code = gpu_load_code(&ctx, incr, sizeof incr);
+        volatile uint32_t *counter = gpu_alloc(&ctx, 4, 16);
+        volatile uint32_t *unif = gpu_alloc(&ctx, 4, 4);
+        *counter = 0;
+        *unif = gpu_bus(&ctx, counter);
+        for (int i = 0; i < 200; i++)
+            reqs[i] = (qpu_emu_req_t){ .code = code, .unif = gpu_bus(&ctx, unif) };
+
+        qpu_emu_init(&e, host_mem_ptr);
+        assert(qpu_emu_run_all(&e, reqs, 200, nthreads) == 0);
+        assert(*counter == 200);
+        assert(e.mutex == 0);
+        assert(e.ninstr == 200 * (sizeof incr / 8));
+        gpu_release(&ctx);
+    }
+    printk("mutex: ok\n");
+}
+
+static void test_semaphores(void)
+{
+    gpu_ctx_t ctx;
+    qpu_emu_req_t reqs[16];
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    uint32_t wait = gpu_load_code(&ctx, wait0, sizeof wait0);
+    uint32_t post = gpu_load_code(&ctx, post0x4, sizeof post0x4);
+
+    // twelve waiters start first; three posters let them all through.
+    for (int i = 0; i < 15; i++)
+        reqs[i] = (qpu_emu_req_t){ .code = i < 12 ? wait : post };
+    for (int nthreads = 1; nthreads <= 4; nthreads++)
+    {
+        qpu_emu_init(&e, host_mem_ptr);
+        assert(qpu_emu_run_all(&e, reqs, 15, nthreads) == 0);
+        assert(e.sema[0] == 0);
+    }
+
+    // a poster short: five waiters are stuck, and say so.
+    reqs[12].code = wait;
+    qpu_emu_init(&e, host_mem_ptr);
+    assert(qpu_emu_run_all(&e, reqs, 15, 2) == 5);
+    assert(strstr(e.err, "deadlocked"));
+
+    // on its own, a waiter can never finish.
+    qpu_emu_init(&e, host_mem_ptr);
+    assert(qpu_emu_run(&e, 0, wait, 0) == QPU_EMU_FAULT);
+    gpu_release(&ctx);
+    printk("semaphores: ok\n");
+}
+
+#define RES 64
+
+static unsigned mandelbrot(int nthreads, uint32_t *sum)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    union { float f; uint32_t i; } step = { .f = 1.0f / RES };
+
+    host_mem_reset();
+    v3d_emu_init();
+    v3d_emu.nthreads = nthreads;
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+    volatile uint32_t *out = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(gpu_kernel_init(&ctx, &k, mandelbrotshader, sizeof mandelbrotshader, V3D_NUM_QPUS) == 0);
+    volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+    for (int q = 0; q < V3D_NUM_QPUS; q++)
+    {
+        volatile uint32_t *u = &unif[q * 6];
+        u[0] = RES;
+        u[1] = step.i;
+        u[2] = 100;
+        u[3] = V3D_NUM_QPUS;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, out);
+    }
+
+    unsigned start = timer_get_usec();
+    assert(gpu_launch(&k) == 0);
+    unsigned t = timer_get_usec() - start;
+    assert(v3d_emu.nfault == 0);
+
+    *sum = 0;
+    for (int i = 0; i < 4 * RES * RES; i++)
+        *sum = *sum * 31 + out[i];
+    gpu_release(&ctx);
+    return t;
+}
+
+static void test_scaling(void)
+{
+    uint32_t want, got;
+    unsigned one = mandelbrot(1, &want);
+
+    printk("mandelbrot %dx%d on 16 QPUs: %d usec on 1 thread\n", 2 * RES, 2 * RES, one);
+    for (int n = 4; n <= 16; n *= 4)
+    {
+        unsigned t = mandelbrot(n, &got);
+        printk("  %d usec on %d threads\n", t, n);
+        assert(got == want);
+
+        // four threads on four free cores: well under the one-thread time.
+        if (n == 4 && sysconf(_SC_NPROCESSORS_ONLN) >= 4)
+            assert(t < one * 3 / 4);
+    }
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 4)
+        printk("  fewer than 4 CPUs: speedup not checked\n");
+
+    // the 1M-element add through the runtime, on every core.
+    gpu_ctx_t ctx;
+    struct addGPU *gpu;
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, vec_add_size(N)) == 0);
+    vec_add_init(&ctx, &gpu, N, V3D_NUM_QPUS);
+    for (int i = 0; i < N; i++)
+    {
+        gpu->A[i] = i;
+        gpu->B[i] = 2 * i;
+    }
+    printk("add of %d on 16 QPUs: %d usec on %d threads\n", N, vec_add_exec(gpu), v3d_emu.nthreads);
+    assert(v3d_emu.nfault == 0);
+    for (int i = 0; i < N; i++)
+        assert(gpu->C[i] == 3 * i);
+    gpu_release(&ctx);
+    printk("scaling: ok\n");
+}
+
+int main(void)
+{
+    test_mutex();
+    test_semaphores();
+    test_scaling();
+    printk("SUCCESS: threaded qpu emulator\n");
+    return 0;
+}
@@ -0,0 +1,254 @@
+// translated emulation against the interpreter: a program exercising every
+// translated op, condition and branch form, the shipped kernels, and code
+// rewritten between runs.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-xlate.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+#include "mandelbrotshader.h"
+
+static uint32_t prog[2 * 256];
+static int np;
+
+static void alu(uint32_t sig, int sf, int cond_add, int cond_mul, int ws, int waddr_add, int waddr_mul,
+    int op_add, int op_mul, int raddr_a, int raddr_b, int add_a, int add_b, int mul_a, int mul_b)
+{
+    prog[2 * np] = op_mul << 29 | op_add << 24 | raddr_a << 18 | raddr_b << 12
+        | add_a << 9 | add_b << 6 | mul_a << 3 | mul_b;
+    prog[2 * np + 1] = sig << 28 | cond_add << 17 | cond_mul << 14 | sf << 13 | ws << 12 | waddr_add << 6 | waddr_mul;
+    np++;
+}
+
+// op dst, a, b on the add pipe only.
+static void add(int op, int sig, int sf, int ws, int waddr, int raddr_a, int raddr_b, int add_a, int add_b)
+{
+    alu(sig, sf, QPU_COND_ALWAYS, QPU_COND_NEVER, ws, waddr, QPU_W_NOP, op, QPU_M_NOP,
+        raddr_a, raddr_b, add_a, add_b, 0, 0);
+}
+
+static void ldi(int mode, int ws, int waddr, uint32_t imm)
+{
+    prog[2 * np] = imm;
+    prog[2 * np + 1] = QPU_SIG_LOAD_IMM << 28 | mode << 25 | QPU_COND_ALWAYS << 17 | ws << 12 | waddr << 6 | QPU_W_NOP;
+    np++;
+}
+
+// relative branch to instruction 'to', then its delay slots.
+static void brr(int cond, int to)
+{
+    prog[2 * np] = 8 * (to - (np + 4));
+    prog[2 * np + 1] = QPU_SIG_BRANCH << 28 | cond << 20 | 1 << 19 | QPU_W_NOP << 6 | QPU_W_NOP;
+    np++;
+    for (int i = 0; i < 3; i++)
+        add(QPU_A_NOP, QPU_SIG_NONE, 0, 0, QPU_W_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0);
+}
+
+static const int ops[] = {
+    QPU_A_FADD, QPU_A_FSUB, QPU_A_FTOI, QPU_A_ITOF, QPU_A_ADD, QPU_A_SUB, QPU_A_SHR, QPU_A_ASR,
+    QPU_A_ROR, QPU_A_SHL, QPU_A_MIN, QPU_A_MAX, QPU_A_AND, QPU_A_OR, QPU_A_XOR, QPU_A_NOT,
+};
+static const int conds[] = { QPU_COND_ALWAYS, QPU_COND_ZS, QPU_COND_NC, QPU_COND_CS, QPU_COND_NS, QPU_COND_ZC };
+
+#define ITERS 10
+
+static void build(void)
+{
+    np = 0;
+    ldi(QPU_LDI_32, 0, QPU_W_R0, 0x3fc00000);                   // r0 = 1.5
+    ldi(QPU_LDI_EL_SIGNED, 0, 1, 0x5a5a3c3c);                   // ra1 = per-lane -2..1
+    add(QPU_A_OR, QPU_SIG_NONE, 0, 0, 2, QPU_R_ELEM_QPU, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A);  // ra2 = elem
+    add(QPU_A_ITOF, QPU_SIG_NONE, 0, 1, 2, 2, QPU_R_NOP, QPU_MUX_A, QPU_MUX_A);            // rb2 = float(elem)
+    ldi(QPU_LDI_32, 0, QPU_W_R3, ITERS);
+    ldi(QPU_LDI_EL_UNSIGNED, 0, QPU_W_R2, 0x1234f00f);
+
+    int loop = np;
+    for (int i = 0; i < 16; i++)
+    {
+        int fop = ops[i] == QPU_A_FADD || ops[i] == QPU_A_FSUB || ops[i] == QPU_A_FTOI;
+        // floats stay finite so NaN payloads cannot differ.
+        alu(QPU_SIG_NONE, i & 1, conds[i % 6], conds[(i + 2) % 6], 0, 10 + i, 10 + i,
+            ops[i], i & 1 ? QPU_M_FMUL : QPU_M_MUL24, i & 1 ? 1 : 2, 2,
+            fop ? QPU_MUX_R0 : QPU_MUX_R2, QPU_MUX_B, i & 1 ? QPU_MUX_R0 : QPU_MUX_R2, i & 1 ? QPU_MUX_B : QPU_MUX_A);
+        add(QPU_A_XOR, QPU_SIG_NONE, 0, 0, QPU_W_R2, 10 + i, QPU_R_NOP, QPU_MUX_R2, QPU_MUX_A);
+        add(QPU_A_ROR, QPU_SIG_SMALL_IMM, 0, 0, QPU_W_R2, QPU_R_NOP, 3, QPU_MUX_R2, QPU_MUX_B);
+    }
+    add(QPU_A_ADD, QPU_SIG_NONE, 0, 0, QPU_W_R1, QPU_R_UNIF, QPU_R_NOP, QPU_MUX_R1, QPU_MUX_A);
+    add(QPU_A_SUB, QPU_SIG_SMALL_IMM, 1, 0, QPU_W_R3, QPU_R_NOP, 1, QPU_MUX_R3, QPU_MUX_B);
+    brr(QPU_BR_ANYNZ, loop);
+
+    // carry set in lanes 0-6 only: allc falls through, anyc is taken.
+    add(QPU_A_SUB, QPU_SIG_SMALL_IMM, 1, 0, QPU_W_NOP, 2, 7, QPU_MUX_A, QPU_MUX_B);
+    int allc = np;
+    brr(QPU_BR_ALLC, 0);
+    ldi(QPU_LDI_32, 0, 5, 0x111);
+    int anyc = np;
+    brr(QPU_BR_ANYC, 0);
+    ldi(QPU_LDI_32, 0, 6, 0x222);
+    prog[2 * allc] = 8 * (np - (allc + 4));
+    prog[2 * anyc] = 8 * (np - (anyc + 4));
+
+    // not translated: the interpreter steps in mid-program.
+    add(QPU_A_FMIN, QPU_SIG_NONE, 1, 0, 7, QPU_R_NOP, 2, QPU_MUX_R0, QPU_MUX_B);
+    add(QPU_A_NOP, QPU_SIG_PROG_END, 0, 0, QPU_W_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0);
+    add(QPU_A_NOP, QPU_SIG_NONE, 0, 0, QPU_W_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0);
+    add(QPU_A_NOP, QPU_SIG_NONE, 0, 0, QPU_W_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0);
+}
+
+static qpu_emu_t slow, fast;
+
+static void same_state(qpu_t *a, qpu_t *b)
+{
+    assert(a->state == QPU_EMU_DONE && b->state == QPU_EMU_DONE);
+    assert(memcmp(a->ra, b->ra, sizeof a->ra) == 0);
+    assert(memcmp(a->rb, b->rb, sizeof a->rb) == 0);
+    assert(memcmp(a->acc, b->acc, sizeof a->acc) == 0);
+    assert(memcmp(a->z, b->z, sizeof a->z) == 0);
+    assert(memcmp(a->n, b->n, sizeof a->n) == 0);
+    assert(memcmp(a->c, b->c, sizeof a->c) == 0);
+    assert(a->unif == b->unif && a->ninstr == b->ninstr);
+}
+
+static void test_ops(void)
+{
+    gpu_ctx_t ctx;
+    qpu_xlate_stats_t s;
+
+    build();
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    uint32_t code = gpu_load_code(&ctx, prog, 8 * np);
+    volatile uint32_t *unif = gpu_alloc(&ctx, ITERS * 4, 4);
+    for (int i = 0; i < ITERS; i++)
+        unif[i] = 0x01000193 * (i + 1);
+
+    qpu_emu_init(&slow, host_mem_ptr);
+    qpu_emu_init(&fast, host_mem_ptr);
+    assert(qpu_xlate_enable(&fast) == 0);
+    assert(qpu_emu_run(&slow, 0, code, gpu_bus(&ctx, unif)) == QPU_EMU_DONE);
+    assert(qpu_emu_run(&fast, 0, code, gpu_bus(&ctx, unif)) == QPU_EMU_DONE);
+    same_state(&slow.qpu[0], &fast.qpu[0]);
+    // the branches went the right way.
+    assert(fast.qpu[0].ra[5][0] == 0x111 && fast.qpu[0].ra[6][0] == 0);
+
+    qpu_xlate_stats(&fast, &s);
+    assert(s.nkernels == 1 && s.nslow == 1);
+    assert(s.nfast + s.nslow == fast.qpu[0].ninstr);
+
+    // rewrite the first immediate: the next start translates again.
+    volatile uint32_t *w = (volatile uint32_t *)host_mem_ptr(code);
+    w[0] = 0x40000000;
+    qpu_emu_run(&slow, 0, code, gpu_bus(&ctx, unif));
+    qpu_emu_run(&fast, 0, code, gpu_bus(&ctx, unif));
+    same_state(&slow.qpu[0], &fast.qpu[0]);
+    assert(fast.qpu[0].acc[0][0] == 0x40000000);
+    qpu_xlate_stats(&fast, &s);
+    assert(s.nkernels == 2);
+
+    qpu_xlate_disable(&fast);
+    gpu_release(&ctx);
+    printk("ops: ok (%d instructions)\n", (int)slow.qpu[0].ninstr);
+}
+
+#define RES 64
+
+static unsigned mandelbrot(int xlate, uint32_t *sum, uint64_t *ninstr)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    union { float f; uint32_t i; } step = { .f = 1.0f / RES };
+
+    host_mem_reset();
+    v3d_emu_init();
+    if (!xlate)
+        qpu_xlate_disable(&v3d_emu.qpu);
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+    volatile uint32_t *out = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(gpu_kernel_init(&ctx, &k, mandelbrotshader, sizeof mandelbrotshader, V3D_NUM_QPUS) == 0);
+    volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+    for (int q = 0; q < V3D_NUM_QPUS; q++)
+    {
+        volatile uint32_t *u = &unif[q * 6];
+        u[0] = RES;
+        u[1] = step.i;
+        u[2] = 100;
+        u[3] = V3D_NUM_QPUS;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, out);
+    }
+
+    unsigned start = timer_get_usec();
+    assert(gpu_launch(&k) == 0);
+    unsigned t = timer_get_usec() - start;
+    assert(v3d_emu.nfault == 0);
+
+    *sum = 0;
+    for (int i = 0; i < 4 * RES * RES; i++)
+        *sum = *sum * 31 + out[i];
+    *ninstr = v3d_emu.qpu.ninstr;
+    gpu_release(&ctx);
+    return t;
+}
+
+static void test_mandelbrot(void)
+{
+    uint32_t want, got;
+    uint64_t nwant, ngot;
+    qpu_xlate_stats_t s;
+
+    unsigned slow_t = mandelbrot(0, &want, &nwant);
+    unsigned fast_t = mandelbrot(1, &got, &ngot);
+    assert(got == want && ngot == nwant);
+    qpu_xlate_stats(&v3d_emu.qpu, &s);
+    // the inner loop is all ALU work.
+    assert(s.nfast > 10 * s.nslow);
+    printk("mandelbrot %dx%d: %d usec interpreted, %d usec translated (%llu fast, %llu slow)\n",
+        2 * RES, 2 * RES, slow_t, fast_t, (unsigned long long)s.nfast, (unsigned long long)s.nslow);
+}
+
+// the add and mul kernels are mostly VPM and DMA: correct, if not faster.
+static void test_kernels(void)
+{
+    enum { n = 1000 };
+    gpu_ctx_t ctx;
+    struct addGPU *a;
+    struct mulGPU *m;
+    qpu_xlate_stats_t s;
+
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, vec_add_size(n) + vec_mul_size(n)) == 0);
+    vec_add_init(&ctx, &a, n, V3D_NUM_QPUS);
+    // one QPU: the kernel's VPM rows are shared by every QPU.
+    vec_mul_init(&ctx, &m, n, 1);
+    for (int i = 0; i < n; i++)
+    {
+        a->A[i] = m->A[i] = i * 7 + 1;
+        a->B[i] = m->B[i] = 0x10000 - i;
+    }
+    vec_add_exec(a);
+    vec_mul_exec(m);
+    assert(v3d_emu.nfault == 0);
+    for (int i = 0; i < n; i++)
+    {
+        assert(a->C[i] == (uint32_t)(i * 7 + 1) + 0x10000 - i);
+        assert(m->C[i] == (uint32_t)(i * 7 + 1) * (0x10000 - i));
+    }
+    qpu_xlate_stats(&v3d_emu.qpu, &s);
+    assert(s.nkernels == 2 && s.nfast > 0);
+    vec_mul_release(m);
+    vec_add_release(a);
+    gpu_release(&ctx);
+    printk("kernels: ok\n");
+}
+
+int main(void)
+{
+    test_ops();
+    test_mandelbrot();
+    test_kernels();
+    printk("SUCCESS: translated qpu emulator\n");
+    return 0;
+}
@@ -0,0 +1,246 @@
+// the post-assembly scheduler: pairing and hazards on a small program,
+// the checked-in scheduled shaders against the originals on the timing
+// model, and programs it has to leave alone.
+#include "rpi.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "qpu-timing.h"
+#include "qpu-sched.h"
+#include "parallel-add.h"
+#include "vector-multiply.h"
+#include "addshader.h"
+#include "addshader-sched.h"
+#include "mulshader.h"
+#include "mulshader-sched.h"
+#include "simpleshader.h"
+#include "simpleshader-sched.h"
+#include "mandelbrotshader.h"
+#include "mandelbrotshader-sched.h"
+
+// ALU instruction halves: hi is bits 63:32, lo bits 31:0.
+#define HI(sig, waddr_add, waddr_mul) \
+    ((uint32_t)(sig) << 28 | QPU_COND_ALWAYS << 17 | QPU_COND_ALWAYS << 14 | (waddr_add) << 6 | (waddr_mul))
+#define LO(op_mul, op_add, raddr_a, raddr_b, add_a, add_b, mul_a, mul_b) \
+    ((op_mul) << 29 | (op_add) << 24 | (raddr_a) << 18 | (raddr_b) << 12 | (add_a) << 9 | (add_b) << 6 | (mul_a) << 3 | (mul_b))
+#define NOP(sig) 0x009e7000, ((uint32_t)(sig) << 28 | QPU_W_NOP << 6 | QPU_W_NOP)
+#define LDI(waddr, imm) (imm), HI(QPU_SIG_LOAD_IMM, waddr, QPU_W_NOP)
+
+static qpu_timing_t t;
+static qpu_emu_t e;
+static uint32_t out[2 * QPU_SCHED_MAX_INS];
+
+static void test_small(void)
+{
+    static const uint32_t prog[] = {
+        LDI(0, 3),                                                  // ldi ra0, 3
+        LDI(QPU_W_R3, 0x40000000),                                  // ldi r3, 2.0
+        NOP(QPU_SIG_NONE),
+        // add r1, ra0, 1: two instructions after ra0 is written
+        LO(QPU_M_NOP, QPU_A_ADD, 0, 1, QPU_MUX_A, QPU_MUX_B, 0, 0), HI(QPU_SIG_SMALL_IMM, QPU_W_R1, QPU_W_NOP),
+        // fmul r2, r3, r3: independent, on the other pipe
+        LO(QPU_M_FMUL, QPU_A_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0, QPU_MUX_R3, QPU_MUX_R3), HI(QPU_SIG_NONE, QPU_W_NOP, QPU_W_R2),
+        NOP(QPU_SIG_PROG_END),
+        NOP(QPU_SIG_NONE),
+        NOP(QPU_SIG_NONE),
+    };
+    qpu_sched_stats_t s;
+    gpu_ctx_t ctx;
+
+    int n = qpu_sched(prog, sizeof prog / 8, out, QPU_SCHED_MAX_INS, &s);
+    // ldi ra0; ldi r3; add + fmul; the end stays as it was.
+    assert(n == 6 && s.nnops == 1 && s.npaired == 1);
+    assert(out[0] == prog[0] && out[2] == prog[2]);
+    assert(QPU_OP_ADD(QPU_INS(out[4], out[5])) == QPU_A_ADD);
+    assert(QPU_OP_MUL(QPU_INS(out[4], out[5])) == QPU_M_FMUL);
+    assert(memcmp(&out[6], &prog[10], 6 * sizeof out[0]) == 0);
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4096) == 0);
+    uint32_t code = gpu_load_code(&ctx, out, 8 * n);
+    qpu_emu_init(&e, host_mem_ptr);
+    assert(qpu_emu_run(&e, 0, code, 0) == QPU_EMU_DONE);
+    assert(e.qpu[0].acc[1][5] == 4 && e.qpu[0].acc[2][5] == 0x40800000);
+    gpu_release(&ctx);
+
+    // with nothing to put between the ldi and the add, a nop stays.
+    static const uint32_t chain[] = {
+        LDI(0, 3),
+        LO(QPU_M_NOP, QPU_A_ADD, 0, 1, QPU_MUX_A, QPU_MUX_B, 0, 0), HI(QPU_SIG_SMALL_IMM, QPU_W_R1, QPU_W_NOP),
+        // fmul r2, r1, r1: needs the add
+        LO(QPU_M_FMUL, QPU_A_NOP, QPU_R_NOP, QPU_R_NOP, 0, 0, QPU_MUX_R1, QPU_MUX_R1), HI(QPU_SIG_NONE, QPU_W_NOP, QPU_W_R2),
+        NOP(QPU_SIG_PROG_END),
+        NOP(QPU_SIG_NONE),
+        NOP(QPU_SIG_NONE),
+    };
+    n = qpu_sched(chain, sizeof chain / 8, out, QPU_SCHED_MAX_INS, &s);
+    assert(n == 7 && s.npaired == 0);
+    assert(QPU_INS(out[2], out[3]) == QPU_INS(0x009e7000, 0x100009e7));
+    assert(QPU_OP_ADD(QPU_INS(out[4], out[5])) == QPU_A_ADD);
+    assert(QPU_OP_MUL(QPU_INS(out[6], out[7])) == QPU_M_FMUL);
+    printk("small: ok\n");
+}
+
+static void test_verbatim(void)
+{
+    // an absolute branch: the code cannot move.
+    static const uint32_t prog[] = {
+        NOP(QPU_SIG_NONE),
+        0x00000000, (uint32_t)QPU_SIG_BRANCH << 28 | QPU_BR_ALWAYS << 20 | QPU_W_NOP << 6 | QPU_W_NOP,
+        NOP(QPU_SIG_NONE), NOP(QPU_SIG_NONE), NOP(QPU_SIG_NONE),
+        NOP(QPU_SIG_PROG_END), NOP(QPU_SIG_NONE), NOP(QPU_SIG_NONE),
+    };
+    qpu_sched_stats_t s;
+
+    assert(qpu_sched(prog, sizeof prog / 8, out, QPU_SCHED_MAX_INS, &s) == sizeof prog / 8);
+    assert(memcmp(out, prog, sizeof prog) == 0);
+    assert(s.nverbatim == 1);
+    assert(qpu_sched(prog, sizeof prog / 8, out, 2, &s) < 0);
+    printk("verbatim: ok\n");
+}
+
+// the checked-in copies are what the scheduler makes now.
+static void check_current(const char *name, const uint32_t *orig, unsigned norig,
+    const uint32_t *sched, unsigned nsched, qpu_sched_stats_t *s)
+{
+    int n = qpu_sched(orig, norig / 2, out, QPU_SCHED_MAX_INS, s);
+    if (2 * n != nsched || memcmp(out, sched, 4 * nsched) != 0)
+        panic("%s-sched.c is out of date: make -C host shaders\n", name);
+    assert(s->nout <= s->nin);
+}
+
+static void test_current(void)
+{
+    qpu_sched_stats_t s;
+
+    check_current("addshader", addshader, sizeof addshader / 4, addshader_sched, sizeof addshader_sched / 4, &s);
+    assert(s.nout < s.nin && s.nslots > 0);
+    check_current("mulshader", mulshader, sizeof mulshader / 4, mulshader_sched, sizeof mulshader_sched / 4, &s);
+    assert(s.nout < s.nin && s.nslots > 0);
+    check_current("simpleshader", simpleshader, sizeof simpleshader / 4,
+        simpleshader_sched, sizeof simpleshader_sched / 4, &s);
+    check_current("mandelbrotshader", mandelbrotshader, sizeof mandelbrotshader / 4,
+        mandelbrotshader_sched, sizeof mandelbrotshader_sched / 4, &s);
+    assert(s.nout < s.nin && s.npaired > 0);
+    printk("current: ok\n");
+}
+
+static uint64_t time_add(const uint32_t *code, unsigned nbytes, int n)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *gpu;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, vec_add_size(n) + nbytes) == 0);
+    vec_add_init(&ctx, &gpu, n, 4);
+    // addshader's uniforms, not those of a variant specialized to n.
+    gpu->special[4] = 0;
+    vec_add_set_qpus(gpu, 4);
+    for (int i = 0; i < n; i++)
+    {
+        gpu->A[i] = i;
+        gpu->B[i] = 5 * i;
+        gpu->C[i] = 0;
+    }
+    uint32_t bus = gpu_load_code(&ctx, code, nbytes);
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, bus, nbytes, gpu->kernel.unif, gpu->kernel.num_qpus) == 0);
+    for (int i = 0; i < n; i++)
+        assert(gpu->C[i] == 6 * i);
+    gpu_release(&ctx);
+    return t.cycles;
+}
+
+static uint64_t time_mul(const uint32_t *code, unsigned nbytes, int n)
+{
+    gpu_ctx_t ctx;
+    struct mulGPU *gpu;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, vec_mul_size(n) + nbytes) == 0);
+    // one QPU: the kernel's VPM rows are shared by every QPU.
+    vec_mul_init(&ctx, &gpu, n, 1);
+    for (int i = 0; i < n; i++)
+    {
+        gpu->A[i] = i + 1;
+        gpu->B[i] = 3 * i;
+        gpu->C[i] = 0;
+    }
+    uint32_t bus = gpu_load_code(&ctx, code, nbytes);
+
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, bus, nbytes, gpu->kernel.unif, gpu->kernel.num_qpus) == 0);
+    for (int i = 0; i < n; i++)
+        assert(gpu->C[i] == (uint32_t)(i + 1) * (3 * i));
+    gpu_release(&ctx);
+    return t.cycles;
+}
+
+#define RES 16
+
+static uint64_t time_mandelbrot(const uint32_t *code, unsigned nbytes, uint32_t *sum)
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+    union { float f; uint32_t i; } step = { .f = 1.0f / RES };
+    int nq = 4;
+
+    host_mem_reset();
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+    volatile uint32_t *o = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(gpu_kernel_init(&ctx, &k, code, nbytes, nq) == 0);
+    volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+    for (int q = 0; q < nq; q++)
+    {
+        volatile uint32_t *u = &unif[q * 6];
+        u[0] = RES;
+        u[1] = step.i;
+        u[2] = 100;
+        u[3] = nq;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, o);
+    }
+    qpu_timing_init(&t, host_mem_ptr);
+    assert(qpu_timing_run(&t, k.code, nbytes, k.unif, nq) == 0);
+
+    *sum = 0;
+    for (int i = 0; i < 4 * RES * RES; i++)
+        *sum = *sum * 31 + o[i];
+    gpu_release(&ctx);
+    return t.cycles;
+}
+
+static void test_timing(void)
+{
+    uint32_t want, got;
+
+    uint64_t before = time_add(addshader, sizeof addshader, 4096);
+    uint64_t after = time_add(addshader_sched, sizeof addshader_sched, 4096);
+    assert(t.stall[QPU_STALL_REGFILE] == 0);
+    printk("add: %llu cycles before, %llu after\n", (unsigned long long)before, (unsigned long long)after);
+    assert(after < before);
+
+    before = time_mul(mulshader, sizeof mulshader, 1024);
+    after = time_mul(mulshader_sched, sizeof mulshader_sched, 1024);
+    assert(t.stall[QPU_STALL_REGFILE] == 0);
+    printk("mul: %llu cycles before, %llu after\n", (unsigned long long)before, (unsigned long long)after);
+    assert(after < before);
+
+    before = time_mandelbrot(mandelbrotshader, sizeof mandelbrotshader, &want);
+    after = time_mandelbrot(mandelbrotshader_sched, sizeof mandelbrotshader_sched, &got);
+    assert(t.stall[QPU_STALL_REGFILE] == 0);
+    assert(got == want);
+    printk("mandelbrot: %llu cycles before, %llu after\n", (unsigned long long)before, (unsigned long long)after);
+    assert(after < before);
+    printk("timing: ok\n");
+}
+
+int main(void)
+{
+    test_small();
+    test_verbatim();
+    test_current();
+    test_timing();
+    printk("SUCCESS: qpu scheduler\n");
+    return 0;
+}
@@ -0,0 +1,212 @@
+// the register allocator: the virtual-register mandelbrot against the
+// hand-allocated one, assembled and run side by side on the emulator, the
+// fixes it makes for port conflicts and hazards, and sources it has to
+// refuse.
+#include "rpi.h"
+#include "qpu-isa.h"
+#include "qpu-regalloc.h"
+#include "qpu-asm.h"
+#include "gpu-runtime.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "mandelbrot.h"
+
+#define RES 16
+#define MAX_ITERS 100
+#define MANDEL_QPUS 8
+
+static char src[1 << 16], out[1 << 16], err[256];
+static qpu_ra_stats_t s;
+
+static void read_file(const char *path, char *buf, size_t max)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        panic("cannot open %s\n", path);
+    size_t n = fread(buf, 1, max - 1, f);
+    fclose(f);
+    buf[n] = 0;
+}
+
+static int alloc(const char *text)
+{
+    return qpu_regalloc(text, out, sizeof out, &s, err, sizeof err);
+}
+
+// instructions a pass of the first loop runs: from the branch target to
+// the end of the branch's delay slots.
+static int inner_loop(const uint32_t *code, int n)
+{
+    for (int i = 0; i < n; i++)
+        if (QPU_SIG(QPU_INS(code[2 * i], code[2 * i + 1])) == QPU_SIG_BRANCH)
+            return -(int32_t)code[2 * i] / 8;
+    panic("no loop\n");
+}
+
+// 'code' on the emulator: the mandelbrot in 'img', the instructions run.
+static uint64_t run(const uint32_t *code, int n, uint32_t img[2 * RES][2 * RES])
+{
+    gpu_ctx_t ctx;
+    gpu_kernel_t k;
+
+    host_mem_reset();
+    v3d_emu_init();
+    assert(gpu_init(&ctx, 4 * RES * RES * sizeof(uint32_t) + 4096) == 0);
+    volatile uint32_t *out = gpu_alloc(&ctx, 4 * RES * RES * sizeof(uint32_t), 16);
+    assert(out);
+    assert(gpu_kernel_init(&ctx, &k, code, 8 * n, MANDEL_QPUS) == 0);
+    volatile uint32_t *unif = gpu_kernel_unifs(&ctx, &k, 6);
+    for (int q = 0; q < MANDEL_QPUS; q++)
+    {
+        volatile uint32_t *u = &unif[q * 6];
+        u[0] = RES;
+        u[1] = mandelbrot_step(RES);
+        u[2] = MAX_ITERS;
+        u[3] = MANDEL_QPUS;
+        u[4] = q;
+        u[5] = gpu_bus(&ctx, out);
+    }
+    assert(gpu_launch(&k) == 0);
+    if (v3d_emu.nfault)
+        panic("%d faults: %s\n", v3d_emu.nfault, v3d_emu.qpu.err);
+    memcpy(img, (const void *)out, 4 * RES * RES * sizeof(uint32_t));
+    gpu_release(&ctx);
+    return v3d_emu.qpu.ninstr;
+}
+
+// the allocated mandelbrot, one instruction per line: no instruction reads
+// two registers of one file, and none reads the regfile register the one
+// before it wrote.
+static void check_ports(const char *text)
+{
+    char prev[8] = "";
+
+    for (const char *l = text; *l; l = strchr(l, '\n') + 1)
+    {
+        int n = strcspn(l, "#\n"), na = 0, nb = 0, a = -1, b = -1;
+        char dst[8] = "";
+        const char *p = l + strspn(l, " \t");
+
+        if (p >= l + n || *p == ':' || *p == '.')
+            continue;
+        const char *comma = memchr(p, ',', l + n - p);
+        for (const char *q = p; q < l + n; q++)
+        {
+            if (q[0] != 'r' || (q[1] != 'a' && q[1] != 'b') || q[2] < '0' || q[2] > '9')
+                continue;
+            int r = atoi(q + 2);
+            if (!comma || q < comma)
+            {
+                snprintf(dst, sizeof dst, "r%c%d", q[1], r);
+                continue;
+            }
+            if (prev[0] && strncmp(q, prev, strlen(prev)) == 0 && (q[strlen(prev)] < '0' || q[strlen(prev)] > '9'))
+                panic("hazard at '%.*s'\n", n, l);
+            if (q[1] == 'a' && r != a)
+                na++, a = r;
+            if (q[1] == 'b' && r != b)
+                nb++, b = r;
+        }
+        if (na > 1 || nb > 1)
+            panic("port conflict at '%.*s'\n", n, l);
+        strcpy(prev, dst);
+    }
+}
+
+static void test_mandelbrot(void)
+{
+    static char hand[1 << 16], ra[1 << 16];
+
+    read_file("../mandelbrot.vqasm", src, sizeof src);
+    read_file("../mandelbrot.qasm", hand, sizeof hand);
+    read_file("../mandelbrot-ra.qasm", ra, sizeof ra);
+    if (alloc(src) < 0)
+        panic("%s", err);
+    if (strcmp(strchr(ra, '\n') + 1, out) != 0)
+        panic("mandelbrot-ra.qasm is out of date: make -C host regalloc\n");
+
+    for (const char *l = out; *l; l = strchr(l, '\n') + 1)
+        assert(!memchr(l, '%', strcspn(l, "#\n")));
+    check_ports(out);
+
+    // both assembled and run on the same uniforms: the same picture.
+    static uint32_t hand_code[2 * 256], ra_code[2 * 256], hand_img[2 * RES][2 * RES], ra_img[2 * RES][2 * RES];
+    int nhand = qpu_asm(hand, hand_code, 256, err, sizeof err);
+    if (nhand < 0)
+        panic("mandelbrot.qasm: %s\n", err);
+    int nra = qpu_asm(ra, ra_code, 256, err, sizeof err);
+    if (nra < 0)
+        panic("mandelbrot-ra.qasm: %s\n", err);
+    uint64_t run_hand = run(hand_code, nhand, hand_img), run_ra = run(ra_code, nra, ra_img);
+    assert(memcmp(hand_img, ra_img, sizeof hand_img) == 0);
+
+    int before = inner_loop(hand_code, nhand), after = inner_loop(ra_code, nra);
+    printk("mandelbrot: %u vregs, %u in accumulators, %u movs and %u nops added\n",
+        s.nvregs, s.nacc, s.nmovs, s.nnops);
+    printk("mandelbrot: hand-allocated %d instructions, inner loop %d, %llu run; allocated %d, %d, %llu\n",
+        nhand, before, (unsigned long long)run_hand, nra, after, (unsigned long long)run_ra);
+    assert(s.nacc >= 4 && after < before && run_ra < run_hand);
+    printk("mandelbrot: ok\n");
+}
+
+static void test_fixes(void)
+{
+    // the accumulators are the author's: the values go to the files, the
+    // add gets one from each, and each result read next costs a nop.
+    assert(alloc("mov r0, 1\nmov r1, 1\nmov r2, 1\nmov r3, 1\n"
+                 "mov %a, unif\nmov %b, unif\nadd %c, %a, %b\nshl %d, %c, 1\n"
+                 "mov vpm, %d\nadd r0, r0, r1\nadd r2, r2, r3\n") == 0);
+    assert(s.nvregs == 4 && s.nacc == 0 && s.nmovs == 0 && s.nnops == 3);
+    assert(strstr(out, "mov rb0, unif\nnop # regalloc: regfile write read next\nadd ra0, ra0, rb0\nnop"));
+
+    // a value read right after it is written goes to an accumulator.
+    assert(alloc("mov %a, unif\nadd %b, %a, 1\nmov vpm, %b\n") == 0);
+    assert(s.nacc == 2 && s.nnops == 0);
+
+    // two registers of file A named by the author: one moves.
+    assert(alloc("fadd r1, ra1, ra2\n") == 0);
+    assert(s.nmovs == 1 && strstr(out, "mov r0, ra2 # regalloc") && strstr(out, "fadd r1, ra1, r0\n"));
+
+    // a conditional write keeps the old value: %a and %b cannot share.
+    assert(alloc("mov r0, 1\nmov r1, 1\nmov r2, 1\nmov r3, 1\n"
+                 "mov %a, unif\nmov %b, unif\nsub.setf -, %b, 3\nmov.ifz %a, %b\nmov vpm, %a\n"
+                 "add r0, r0, r1\nadd r2, r2, r3\n") == 0);
+    assert(strstr(out, "mov ra0, unif\nmov rb0, unif") || strstr(out, "mov rb0, unif\nmov ra0, unif"));
+
+    // a value live across a loop does not share with the loop's values.
+    assert(alloc("mov %k, unif\nmov %n, 4\n:again\nsub.setf %n, %n, 1\nbrr.anynz -, :again\nnop\nnop\nnop\n"
+                 "mov vpm, %k\nthrend\nnop\nnop\n") == 0);
+    assert(s.nins == 11 && s.nvregs == 2);
+    const char *k = strstr(out, "%k="), *n = strstr(out, "%n=");
+    assert(k && n && strncmp(k + 3, n + 3, 3) != 0);
+    printk("fixes: ok\n");
+}
+
+static void test_errors(void)
+{
+    assert(alloc("mov vpm, %a\n") < 0 && strstr(err, "line 1: %a may be read before it is written"));
+    assert(alloc("mov %a, 1\nmov.ifz %b, %a\nmov vpm, %b\n") < 0 && strstr(err, "%b may be read"));
+    assert(alloc("mov %a, 1\nfrob %a, %a\n") < 0 && strstr(err, "line 2: unknown instruction"));
+    assert(alloc("mov %a, 1\nbrr %a, :x\nnop\nnop\nnop\n:x\nnop\n") < 0 && strstr(err, "cannot use virtual registers"));
+    assert(alloc("brr -, :nowhere\nnop\nnop\nnop\n") < 0 && strstr(err, "no label 'nowhere'"));
+    assert(alloc("brr -, :x\nnop\nfadd r1, ra1, ra2\nnop\n:x\nnop\n") < 0 && strstr(err, "line 3: register file conflict in a delay slot"));
+    assert(alloc("add %a, 1, 2\nmov vpm, 1+%a\n") < 0 && strstr(err, "must be whole operands"));
+
+    // more values live at once than there are registers.
+    int n = 0;
+    for (int i = 0; i < 70; i++)
+        n += sprintf(src + n, "mov %%v%d, unif\n", i);
+    for (int i = 0; i < 70; i++)
+        n += sprintf(src + n, "mov vpm, %%v%d\n", i);
+    assert(alloc(src) < 0 && strstr(err, "out of registers"));
+    printk("errors: ok\n");
+}
+
+int main(void)
+{
+    test_mandelbrot();
+    test_fixes();
+    test_errors();
+    printk("SUCCESS: qpu register allocator\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "rpi.h"
+#include "host-mem.h"
+#include "v3d-emu.h"
+#include "qpu-xlate.h"
+
+v3d_emu_t v3d_emu;
+
+// run everything queued since the last poll.
+static void run_pending(void)
+{
+    v3d_emu_t *m = &v3d_emu;
+
+    if (!m->npending)
+        return;
+    m->nfault += qpu_emu_run_all(&m->qpu, m->pending, m->npending, m->nthreads);
+    m->nreq += m->npending;
+    m->ncompleted = (m->ncompleted + m->npending) & 0xff;
+    m->npending = 0;
+
+    m->dbqitc |= m->qpu.host_int & m->dbqite;
+    m->qpu.host_int = 0;
+}
+
+static uint32_t emu_get32(uint32_t addr)
+{
+    v3d_emu_t *m = &v3d_emu;
+
+    switch (addr)
+    {
+    case V3D_SRQCS:
+        // every request has run by the time anyone looks: the FIFO is empty.
+        run_pending();
+        return m->ncompleted << 16 | (m->nreq & 0xff) << 8;
+    case V3D_DBQITE:
+        return m->dbqite;
+    case V3D_DBQITC:
+        run_pending();
+        return m->dbqitc;
+    default:
+        return 0;
+    }
+}
+
+static void emu_put32(uint32_t addr, uint32_t v)
+{
+    v3d_emu_t *m = &v3d_emu;
+
+    switch (addr)
+    {
+    case V3D_SRQUA:
+        m->srqua = v;
+        break;
+    case V3D_SRQPC:
+        if (m->npending == V3D_EMU_MAXREQ)
+            panic("more than %d requests queued without a poll\n", V3D_EMU_MAXREQ);
+        m->pending[m->npending++] = (qpu_emu_req_t){ .code = v, .unif = m->srqua };
+        break;
+    case V3D_SRQCS:
+        if (v & (1 << 16))
+            m->ncompleted = 0;
+        break;
+    case V3D_DBQITE:
+        m->dbqite = v;
+        break;
+    case V3D_DBQITC:
+        m->dbqitc &= ~v; // write-1-to-clear
+        break;
+    default:
+        // nothing is cached, so cache clears have nothing to do.
+        break;
+    }
+}
+
+static const v3d_backend_t emu_backend = {
+    .get32 = emu_get32,
+    .put32 = emu_put32,
+};
+
+void v3d_emu_init(void)
+{
+    qpu_xlate_disable(&v3d_emu.qpu);
+    memset(&v3d_emu, 0, sizeof v3d_emu);
+    qpu_emu_init(&v3d_emu.qpu, host_mem_ptr);
+    v3d_emu.nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *quantum = getenv("QPU_EMU_QUANTUM");
+    if (quantum)
+        v3d_emu.qpu.quantum = atoi(quantum);
+    // host_mem_reset() reuses addresses, but the cache checks the code.
+    if (qpu_xlate_enable(&v3d_emu.qpu) < 0)
+        panic("out of memory for the QPU translation cache\n");
+    v3d_set_backend(&emu_backend);
+}
@@ -0,0 +1,44 @@
+#ifndef __V3D_EMU_H__
+#define __V3D_EMU_H__
+/*
+ * V3D backend that runs the programs it is given on the QPU emulator
+ * (qpu-emu.h), against the fake firmware's memory (host-mem.h).
+ *
+ * SRQPC writes queue requests; the next SRQCS or DBQITC read runs
+ * everything queued together with qpu_emu_run_all() on 'nthreads' host
+ * threads, so the programs of one job run concurrently and can
+ * synchronise through semaphores.  The runtime's job and batch code then
+ * sees them complete on that read.  Programs that write host_int raise
+ * their QPU's DBQITC bit if it is enabled in DBQITE.  A faulting program
+ * still counts as completed (so callers do not hang); the fault is
+ * counted and the first one's message kept in v3d_emu.qpu.err.
+ * Programs run translated (qpu-xlate.h), qpu.quantum instructions a QPU
+ * at a time; QPU_EMU_QUANTUM in the environment sets it at init.
+ */
+#include "v3d.h"
+#include "qpu-emu.h"
+
+#define V3D_EMU_MAXREQ 256 // queued between polls
+
+typedef struct v3d_emu
+{
+    qpu_emu_t qpu;
+    int nthreads;           // host threads per run; defaults to the CPU count
+
+    qpu_emu_req_t pending[V3D_EMU_MAXREQ];
+    unsigned npending;
+
+    uint32_t srqua;         // latched uniforms address
+    uint32_t ncompleted;    // SRQCS[23:16]
+    uint32_t dbqite, dbqitc;
+
+    unsigned nreq;          // programs run
+    unsigned nfault;        // programs that faulted
+} v3d_emu_t;
+
+extern v3d_emu_t v3d_emu;
+
+// reset the emulator and install it as the V3D backend.
+void v3d_emu_init(void);
+
+#endif
@@ -0,0 +1,102 @@
+#include "rpi.h"
+#include "v3d-mock.h"
+
+v3d_mock_t v3d_mock;
+
+static unsigned qlen(void)
+{
+    unsigned pending = v3d_mock.nreq - v3d_mock.ndone;
+    return pending > V3D_NUM_QPUS ? pending - V3D_NUM_QPUS : 0;
+}
+
+unsigned v3d_mock_complete(unsigned n)
+{
+    v3d_mock_t *m = &v3d_mock;
+    unsigned i;
+
+    for (i = 0; i < n && m->ndone < m->nreq; i++)
+    {
+        // requests are dispatched round-robin over the QPUs.
+        unsigned qpu = m->ndone++ % V3D_NUM_QPUS;
+        m->ncompleted = (m->ncompleted + 1) & 0xff;
+        if (m->dbqite & (1 << qpu))
+            m->dbqitc |= 1 << qpu;
+    }
+    return i;
+}
+
+static uint32_t mock_get32(uint32_t addr)
+{
+    v3d_mock_t *m = &v3d_mock;
+
+    switch (addr)
+    {
+    case V3D_SRQCS:
+        m->srqcs_reads++;
+        if (m->auto_complete)
+            v3d_mock_complete(1);
+        return m->ncompleted << 16 | (m->nreq & 0xff) << 8 | (qlen() & 0x3f);
+    case V3D_DBQITE:
+        return m->dbqite;
+    case V3D_DBQITC:
+        return m->dbqitc;
+    case V3D_L2CACTL:
+        return m->l2cactl;
+    case V3D_SLCACTL:
+        return m->slcactl;
+    default:
+        return 0;
+    }
+}
+
+static void mock_put32(uint32_t addr, uint32_t v)
+{
+    v3d_mock_t *m = &v3d_mock;
+
+    m->nwrites++;
+    switch (addr)
+    {
+    case V3D_SRQUA:
+        m->srqua = v;
+        break;
+    case V3D_SRQPC:
+        if (qlen() >= V3D_SRQ_DEPTH)
+            m->overflow++;
+        m->req[m->nreq++ % V3D_MOCK_MAXREQ] = (v3d_mock_req_t){ .code = v, .unif = m->srqua };
+        if (qlen() > m->max_qlen)
+            m->max_qlen = qlen();
+        break;
+    case V3D_SRQCS:
+        if (v & (1 << 16))
+            m->ncompleted = 0;
+        break;
+    case V3D_DBQITE:
+        m->dbqite = v;
+        break;
+    case V3D_DBQITC:
+        m->dbqitc &= ~v; // write-1-to-clear
+        break;
+    case V3D_L2CACTL:
+        m->l2cactl = v;
+        if (v & V3D_L2CACTL_L2CCLR)
+            m->nl2clear++;
+        break;
+    case V3D_SLCACTL:
+        m->slcactl = v;
+        m->slcclear |= v;
+        break;
+    default:
+        break;
+    }
+}
+
+static const v3d_backend_t mock_backend = {
+    .get32 = mock_get32,
+    .put32 = mock_put32,
+};
+
+void v3d_mock_init(void)
+{
+    memset(&v3d_mock, 0, sizeof v3d_mock);
+    v3d_set_backend(&mock_backend);
+}
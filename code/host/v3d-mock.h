@@ -0,0 +1,57 @@
+#ifndef __V3D_MOCK_H__
+#define __V3D_MOCK_H__
+/*
+ * Host mock of the V3D QPU scheduler registers.
+ *
+ * Models the user-program request FIFO: every SRQPC write queues a request
+ * with the uniforms address last written to SRQUA.  Up to V3D_NUM_QPUS
+ * outstanding requests are running on QPUs; the rest sit in the
+ * V3D_SRQ_DEPTH-entry FIFO, and overflowing it is recorded.  Requests only complete
+ * when the test says so (v3d_mock_complete), or --- if auto_complete is set
+ * --- one per SRQCS read, which models the QPUs making progress while the
+ * CPU polls.  Completing a request bumps SRQCS[23:16] and, if the QPU's
+ * DBQITE bit is set, raises its DBQITC bit.  Cache clears are counted so
+ * tests can check the cache maintenance policy.
+ */
+#include "v3d.h"
+
+#define V3D_MOCK_MAXREQ 256
+
+typedef struct v3d_mock_req
+{
+    uint32_t code;
+    uint32_t unif;
+} v3d_mock_req_t;
+
+typedef struct v3d_mock
+{
+    // the last V3D_MOCK_MAXREQ requests queued, indexed by nreq mod
+    // V3D_MOCK_MAXREQ.
+    v3d_mock_req_t req[V3D_MOCK_MAXREQ];
+    unsigned nreq;
+    unsigned ndone;         // requests completed so far (index into req)
+
+    uint32_t srqua;         // latched uniforms address
+    uint32_t ncompleted;    // SRQCS[23:16]
+    uint32_t dbqite, dbqitc;
+    uint32_t l2cactl, slcactl;
+    unsigned nl2clear;      // L2CACTL clears
+    uint32_t slcclear;      // every SLCACTL bit written since init
+
+    unsigned max_qlen;      // FIFO high-water mark
+    unsigned overflow;      // requests written to a full FIFO
+
+    unsigned auto_complete;
+    unsigned srqcs_reads;   // how often the CPU polled
+    unsigned nwrites;       // total register writes
+} v3d_mock_t;
+
+extern v3d_mock_t v3d_mock;
+
+// reset the mock and install it as the V3D backend.
+void v3d_mock_init(void);
+
+// complete up to 'n' queued requests; returns how many completed.
+unsigned v3d_mock_complete(unsigned n);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef KERNEL_ABI_H
+#define KERNEL_ABI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gpu-runtime.h"
+
+/*
+ * Uniform layouts of the kernels.  Each kernel has a manifest, X(type,
+ * name) for each uniform in the order its preamble reads them, and
+ * KERNEL_ABI() turns it into
+ *
+ *	struct <kernel>_unifs		one QPU's uniforms, a word per field
+ *	KERNEL_UNIF(kernel, name)	a field's word index, a constant
+ *	KERNEL_NUNIFS(kernel)		words per QPU
+ *
+ * Launchers fill an array of the struct, one per QPU, and write it with
+ * KERNEL_SET_UNIFS:
+ *
+ *	struct addshader_unifs u[V3D_NUM_QPUS];
+ *	    ...
+ *	KERNEL_INIT(addshader, ctx, &k, addshader, sizeof addshader, num_qpus);
+ *	KERNEL_SET_UNIFS(addshader, ctx, &k, u, num_qpus);
+ *
+ * Types: u32, f32 (a float), bus (a bus address, from gpu_bus()).
+ * host/tests checks the manifests against the kernels.
+ */
+#define KABI_u32 uint32_t
+#define KABI_f32 float
+#define KABI_bus uint32_t
+
+#define KABI_FIELD(type, name) KABI_##type name;
+#define KABI_COUNT(type, name) + 1
+
+#define KERNEL_ABI(kernel, MANIFEST) \
+	struct kernel##_unifs { MANIFEST(KABI_FIELD) }; \
+	_Static_assert(sizeof(struct kernel##_unifs) == 4 * (0 MANIFEST(KABI_COUNT)), #kernel " uniforms are words"); \
+	_Static_assert(sizeof(struct kernel##_unifs) <= 4 * GPU_MAX_UNIFS, #kernel " has too many uniforms")
+
+#define KERNEL_NUNIFS(kernel) (sizeof(struct kernel##_unifs) / sizeof(uint32_t))
+#define KERNEL_UNIF(kernel, name) (offsetof(struct kernel##_unifs, name) / sizeof(uint32_t))
+
+// gpu_kernel_init, then room for the kernel's uniforms on each QPU; 0 or -1.
+#define KERNEL_INIT(kernel, ctx, k, code, nbytes, num_qpus) \
+	(gpu_kernel_init(ctx, k, code, nbytes, num_qpus) < 0 \
+		|| !gpu_kernel_unifs(ctx, k, KERNEL_NUNIFS(kernel)) ? -1 : 0)
+
+// gpu_kernel_set_unifs from an array of struct <kernel>_unifs (checked).
+#define KERNEL_SET_UNIFS(kernel, ctx, k, u, num_qpus) \
+	gpu_kernel_set_unifs(ctx, k, 1 ? (u) : (const struct kernel##_unifs *)0, \
+		sizeof(struct kernel##_unifs), num_qpus)
+
+// parallel-add.qasm
+#define ADDSHADER_ABI(X) \
+	X(u32, blocks) \
+	X(bus, a) \
+	X(bus, b) \
+	X(bus, c) \
+	X(u32, qpu)
+KERNEL_ABI(addshader, ADDSHADER_ABI);
+
+// vector-multiply.qasm
+#define MULSHADER_ABI(X) \
+	X(u32, blocks) \
+	X(bus, a) \
+	X(bus, b) \
+	X(bus, c)
+KERNEL_ABI(mulshader, MULSHADER_ABI);
+
+// mandelbrot.qasm
+#define MANDELBROTSHADER_ABI(X) \
+	X(u32, res) \
+	X(f32, step) \
+	X(u32, max_iter) \
+	X(u32, num_qpus) \
+	X(u32, qpu) \
+	X(bus, out)
+KERNEL_ABI(mandelbrotshader, MANDELBROTSHADER_ABI);
+
+// qb_map2 and qb_fold (qpu-builder.h) with the block count built in, and
+// so the variants of add and mul (kernel-variants.h).
+#define QB_MAP2_ABI(X) \
+	X(bus, a) \
+	X(bus, b) \
+	X(bus, c) \
+	X(u32, qpu)
+KERNEL_ABI(qb_map2, QB_MAP2_ABI);
+
+// qb_map2_tmu and qb_map2_pipe, as the add and mul launchers build them.
+#define QB_MAP2_TMU_ABI(X) \
+	X(u32, blocks) \
+	X(bus, a) \
+	X(bus, b) \
+	X(bus, c) \
+	X(u32, qpu)
+KERNEL_ABI(qb_map2_tmu, QB_MAP2_TMU_ABI);
+KERNEL_ABI(qb_map2_pipe, QB_MAP2_TMU_ABI);
+
+// qb_map1s and qb_fma as the float vectors (float-vector.h) build them.
+#define QB_MAP1S_ABI(X) \
+	X(u32, blocks) \
+	X(bus, a) \
+	X(f32, s) \
+	X(bus, c) \
+	X(u32, qpu)
+KERNEL_ABI(qb_map1s, QB_MAP1S_ABI);
+
+#define QB_FMA_ABI(X) \
+	X(u32, blocks) \
+	X(bus, a) \
+	X(bus, b) \
+	X(bus, c) \
+	X(bus, d) \
+	X(u32, qpu)
+KERNEL_ABI(qb_fma, QB_FMA_ABI);
+
+#define QB_FOLD_ABI(X) \
+	X(bus, a) \
+	X(bus, out) \
+	X(u32, qpu)
+KERNEL_ABI(qb_fold, QB_FOLD_ABI);
+
+#define QB_MANDELBROT_ABI(X) \
+	X(u32, qpu) \
+	X(bus, out)
+KERNEL_ABI(qb_mandelbrot, QB_MANDELBROT_ABI);
+
+#endif /* KERNEL_ABI_H */
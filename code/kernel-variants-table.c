@@ -0,0 +1,1491 @@
+// kernels specialized to fixed sizes, from host/gen-variants; regenerate
+// with "make -C host variants".
+#include "kernel-variants.h"
+
+static const uint32_t add_4096_1[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000020, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_4096_2[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_4096_4[116] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x0000000c, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c8fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000100, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00801a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00401a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x82104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffea8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_4096_8[108] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x00000006, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c4fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000080, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00401a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00201a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x81104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffec8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_65536_1[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000200, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_65536_2[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_65536_4[116] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x0000000c, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c8fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000100, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00801a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00401a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x82104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffea8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t add_65536_8[108] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x00000006, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c4fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000080, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00401a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00201a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x15c27d80, 0x10020827,
+0x0cc27180, 0x10020c27,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x81104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffec8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+const kernel_variant_t add_variants[] = {
+	{ add_4096_1, sizeof add_4096_1, 4096, 0, 1, 8 },
+	{ add_4096_2, sizeof add_4096_2, 4096, 0, 2, 8 },
+	{ add_4096_4, sizeof add_4096_4, 4096, 0, 4, 4 },
+	{ add_4096_8, sizeof add_4096_8, 4096, 0, 8, 2 },
+	{ add_65536_1, sizeof add_65536_1, 65536, 0, 1, 8 },
+	{ add_65536_2, sizeof add_65536_2, 65536, 0, 2, 8 },
+	{ add_65536_4, sizeof add_65536_4, 65536, 0, 4, 4 },
+	{ add_65536_8, sizeof add_65536_8, 65536, 0, 8, 2 },
+	{ 0 },
+};
+
+static const uint32_t mul_4096_1[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000020, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_4096_2[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_4096_4[116] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x0000000c, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c8fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000100, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00801a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00401a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x82104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffea8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_4096_8[108] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000010, 0xe0020027,
+0x00000006, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c4fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000080, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00401a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00201a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x81104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffec8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_65536_1[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000200, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_65536_2[132] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x00000018, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x00000010, 0xe00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80082000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000200, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00001a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00801a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x84104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000200, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffe68, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_65536_4[116] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x0000000c, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c8fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80042000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000100, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00801a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00401a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x82104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000100, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffea8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mul_65536_8[108] __attribute__((aligned(8))) = {
+0x15827d80, 0x10021027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x10021067,
+0x15827d80, 0x100200a7,
+0x00000100, 0xe0020027,
+0x00000006, 0xe00208e7,
+0x400a7033, 0x100049c2,
+0x159c1fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100200e7,
+0x159c4fc0, 0xd00208e7,
+0x0c9c2ec0, 0x100210e7,
+0x90000040, 0xe0020c67,
+0x159c4fc0, 0xd00208e7,
+0x119c2ec0, 0x100208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x159c0fc0, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x90000040, 0xe0020c67,
+0x110c4dc0, 0xd00208a7,
+0x80022000, 0xe00208e7,
+0x0c9e74c0, 0x10020c67,
+0x15067d80, 0x10020ca7,
+0x15ca7d80, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c0ec0, 0x10021027,
+0x00000080, 0xe00208e7,
+0x0c067cc0, 0x10020067,
+0x00401a00, 0xe00208e7,
+0x0c9c2ec0, 0x10020c67,
+0x00201a00, 0xe00208e7,
+0x0c9c3ec0, 0x10021c67,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x15c27d80, 0x10020827,
+0x40c27006, 0x100049f0,
+0x159c7fc0, 0xd00208e7,
+0x119c3ec0, 0x100208a7,
+0x81104000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c1fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000080, 0xe00208e7,
+0x0c9c1ec0, 0x10021067,
+0x0d001dc0, 0xd0022027,
+0xfffffec8, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+const kernel_variant_t mul_variants[] = {
+	{ mul_4096_1, sizeof mul_4096_1, 4096, 0, 1, 8 },
+	{ mul_4096_2, sizeof mul_4096_2, 4096, 0, 2, 8 },
+	{ mul_4096_4, sizeof mul_4096_4, 4096, 0, 4, 4 },
+	{ mul_4096_8, sizeof mul_4096_8, 4096, 0, 8, 2 },
+	{ mul_65536_1, sizeof mul_65536_1, 65536, 0, 1, 8 },
+	{ mul_65536_2, sizeof mul_65536_2, 65536, 0, 2, 8 },
+	{ mul_65536_4, sizeof mul_65536_4, 65536, 0, 4, 4 },
+	{ mul_65536_8, sizeof mul_65536_8, 65536, 0, 8, 2 },
+	{ 0 },
+};
+
+static const uint32_t mandelbrot_64_100_1[210] __attribute__((aligned(8))) = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10021027,
+0x3c800000, 0xe0020067,
+0xbf800000, 0xe0021067,
+0x40800000, 0xe00200a7,
+0x40000000, 0xe00210a7,
+0x15027d80, 0x100200e7,
+0x009e7000, 0x100009e7,
+0x080e7d80, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x10020127,
+0x00000200, 0xe00208e7,
+0x400e7033, 0x100049e0,
+0x0c9c0e00, 0x10021127,
+0x159c0fc0, 0xd00210e7,
+0x009e7000, 0x100009e7,
+0x0c983f80, 0x10020827,
+0x089e7000, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x100211a7,
+0x159c0fc0, 0xd0020827,
+0x159c0fc0, 0xd0020867,
+0x159c0fc0, 0xd0020167,
+0x159c0fc0, 0xd0021167,
+0x159c0fc0, 0xd00201a7,
+0x00000019, 0xe00201e7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x0d1c1dc0, 0xd00221e7,
+0xfffffe78, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x00101a00, 0xe00208e7,
+0x0c027cc0, 0x10021c67,
+0x151a7d80, 0x10020c27,
+0x159c2fc0, 0xd00208e7,
+0x119c3ec0, 0x10020827,
+0x0c9c4e00, 0x100211e7,
+0x11007dc0, 0xd00208a7,
+0x80904000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c7fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000010, 0xe00208e7,
+0x0c9c3ec0, 0x100210e7,
+0x00000080, 0xe00208e7,
+0x0d9c3ec0, 0x100229e7,
+0xfffffd88, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x0c0c1dc0, 0xd00200e7,
+0x00000080, 0xe00208e7,
+0x0d0e7cc0, 0x100229e7,
+0xfffffd10, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mandelbrot_64_100_4[210] __attribute__((aligned(8))) = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10021027,
+0x3c800000, 0xe0020067,
+0xbf800000, 0xe0021067,
+0x40800000, 0xe00200a7,
+0x40000000, 0xe00210a7,
+0x15027d80, 0x100200e7,
+0x009e7000, 0x100009e7,
+0x080e7d80, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x10020127,
+0x00000200, 0xe00208e7,
+0x400e7033, 0x100049e0,
+0x0c9c0e00, 0x10021127,
+0x159c0fc0, 0xd00210e7,
+0x009e7000, 0x100009e7,
+0x0c983f80, 0x10020827,
+0x089e7000, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x100211a7,
+0x159c0fc0, 0xd0020827,
+0x159c0fc0, 0xd0020867,
+0x159c0fc0, 0xd0020167,
+0x159c0fc0, 0xd0021167,
+0x159c0fc0, 0xd00201a7,
+0x00000019, 0xe00201e7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x0d1c1dc0, 0xd00221e7,
+0xfffffe78, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x00101a00, 0xe00208e7,
+0x0c027cc0, 0x10021c67,
+0x151a7d80, 0x10020c27,
+0x159c2fc0, 0xd00208e7,
+0x119c3ec0, 0x10020827,
+0x0c9c4e00, 0x100211e7,
+0x11007dc0, 0xd00208a7,
+0x80904000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c7fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000010, 0xe00208e7,
+0x0c9c3ec0, 0x100210e7,
+0x00000080, 0xe00208e7,
+0x0d9c3ec0, 0x100229e7,
+0xfffffd88, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x0c0c4dc0, 0xd00200e7,
+0x00000080, 0xe00208e7,
+0x0d0e7cc0, 0x100229e7,
+0xfffffd10, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mandelbrot_64_100_8[210] __attribute__((aligned(8))) = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10021027,
+0x3c800000, 0xe0020067,
+0xbf800000, 0xe0021067,
+0x40800000, 0xe00200a7,
+0x40000000, 0xe00210a7,
+0x15027d80, 0x100200e7,
+0x009e7000, 0x100009e7,
+0x080e7d80, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x10020127,
+0x00000200, 0xe00208e7,
+0x400e7033, 0x100049e0,
+0x0c9c0e00, 0x10021127,
+0x159c0fc0, 0xd00210e7,
+0x009e7000, 0x100009e7,
+0x0c983f80, 0x10020827,
+0x089e7000, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x100211a7,
+0x159c0fc0, 0xd0020827,
+0x159c0fc0, 0xd0020867,
+0x159c0fc0, 0xd0020167,
+0x159c0fc0, 0xd0021167,
+0x159c0fc0, 0xd00201a7,
+0x00000019, 0xe00201e7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x0d1c1dc0, 0xd00221e7,
+0xfffffe78, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x00101a00, 0xe00208e7,
+0x0c027cc0, 0x10021c67,
+0x151a7d80, 0x10020c27,
+0x159c2fc0, 0xd00208e7,
+0x119c3ec0, 0x10020827,
+0x0c9c4e00, 0x100211e7,
+0x11007dc0, 0xd00208a7,
+0x80904000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c7fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000010, 0xe00208e7,
+0x0c9c3ec0, 0x100210e7,
+0x00000080, 0xe00208e7,
+0x0d9c3ec0, 0x100229e7,
+0xfffffd88, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x0c0c8dc0, 0xd00200e7,
+0x00000080, 0xe00208e7,
+0x0d0e7cc0, 0x100229e7,
+0xfffffd10, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+static const uint32_t mandelbrot_64_100_12[210] __attribute__((aligned(8))) = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10021027,
+0x3c800000, 0xe0020067,
+0xbf800000, 0xe0021067,
+0x40800000, 0xe00200a7,
+0x40000000, 0xe00210a7,
+0x15027d80, 0x100200e7,
+0x009e7000, 0x100009e7,
+0x080e7d80, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x10020127,
+0x00000200, 0xe00208e7,
+0x400e7033, 0x100049e0,
+0x0c9c0e00, 0x10021127,
+0x159c0fc0, 0xd00210e7,
+0x009e7000, 0x100009e7,
+0x0c983f80, 0x10020827,
+0x089e7000, 0x10020827,
+0x20067006, 0x100049e0,
+0x019c11c0, 0x100211a7,
+0x159c0fc0, 0xd0020827,
+0x159c0fc0, 0xd0020867,
+0x159c0fc0, 0xd0020167,
+0x159c0fc0, 0xd0021167,
+0x159c0fc0, 0xd00201a7,
+0x00000019, 0xe00201e7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x209c200f, 0x100049e1,
+0x209e7008, 0x100049e1,
+0x01127380, 0x10020867,
+0x01146dc0, 0x10020827,
+0x029c51c0, 0x10020827,
+0x209e7000, 0x100059c5,
+0x209e7009, 0x100049c5,
+0x009e7000, 0x100009e7,
+0x01145dc0, 0x100208a7,
+0x020a7c80, 0x100229e7,
+0x159c1fc0, 0xd00801a7,
+0x0d1c1dc0, 0xd00221e7,
+0xfffffe78, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x00101a00, 0xe00208e7,
+0x0c027cc0, 0x10021c67,
+0x151a7d80, 0x10020c27,
+0x159c2fc0, 0xd00208e7,
+0x119c3ec0, 0x10020827,
+0x0c9c4e00, 0x100211e7,
+0x11007dc0, 0xd00208a7,
+0x80904000, 0xe00208e7,
+0x0c9e74c0, 0x10021c67,
+0x159c7fc0, 0x10021ca7,
+0x159f2fc0, 0x100209e7,
+0x00000010, 0xe00208e7,
+0x0c9c3ec0, 0x100210e7,
+0x00000080, 0xe00208e7,
+0x0d9c3ec0, 0x100229e7,
+0xfffffd88, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x0c0ccdc0, 0xd00200e7,
+0x00000080, 0xe00208e7,
+0x0d0e7cc0, 0x100229e7,
+0xfffffd10, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x159c1fc0, 0xd00209a7,
+0x009e7000, 0x300009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7
+};
+
+const kernel_variant_t mandelbrot_variants[] = {
+	{ mandelbrot_64_100_1, sizeof mandelbrot_64_100_1, 64, 100, 1, 0 },
+	{ mandelbrot_64_100_4, sizeof mandelbrot_64_100_4, 64, 100, 4, 0 },
+	{ mandelbrot_64_100_8, sizeof mandelbrot_64_100_8, 64, 100, 8, 0 },
+	{ mandelbrot_64_100_12, sizeof mandelbrot_64_100_12, 64, 100, 12, 0 },
+	{ 0 },
+};
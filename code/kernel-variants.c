@@ -0,0 +1,30 @@
+#include "rpi.h"
+#include <string.h>
+#include "kernel-variants.h"
+
+const kernel_variant_t *kernel_variant(const kernel_variant_t *v, uint32_t size, uint32_t iters, int num_qpus)
+{
+	for (; v->code; v++)
+		if (v->size == size && v->iters == iters && v->num_qpus == num_qpus)
+			return v;
+	return NULL;
+}
+
+uint32_t kernel_variants_size(const kernel_variant_t *v, uint32_t size)
+{
+	uint32_t n = 0;
+
+	for (; v->code; v++)
+		if (v->size == size)
+			n += v->nbytes + 8;	// and its alignment
+	return n;
+}
+
+int kernel_variants_load(gpu_ctx_t *ctx, const kernel_variant_t *v, uint32_t size, uint32_t code[V3D_NUM_QPUS + 1])
+{
+	memset(code, 0, (V3D_NUM_QPUS + 1) * sizeof code[0]);
+	for (; v->code; v++)
+		if (v->size == size && !(code[v->num_qpus] = gpu_load_code(ctx, v->code, v->nbytes)))
+			return -1;
+	return 0;
+}
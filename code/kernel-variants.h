@@ -0,0 +1,44 @@
+#ifndef KERNEL_VARIANTS_H
+#define KERNEL_VARIANTS_H
+
+#include <stdint.h>
+#include "gpu-runtime.h"
+
+/*
+ * Kernels specialized at build time to fixed problem sizes: the block
+ * count and sizes are immediates instead of uniforms, and the inner loops
+ * are unrolled.  host/gen-variants builds them with qpu-builder.h into
+ * kernel-variants-table.c ("make -C host variants"); the runtimes pick one
+ * when the size and QPU count they are asked for match, and fall back to
+ * the generic shader otherwise.
+ *
+ * Uniforms per QPU: add and mul take A, B, C and the QPU's index, each QPU
+ * doing size / num_qpus elements; mandelbrot takes the index and the
+ * output address.
+ */
+typedef struct kernel_variant
+{
+	const uint32_t *code;	// NULL ends a table
+	uint32_t nbytes;
+	uint32_t size;		// add/mul: elements; mandelbrot: resolution
+	uint32_t iters;		// mandelbrot: iterations
+	int num_qpus;
+	int rows;		// add/mul: VPM rows per block
+} kernel_variant_t;
+
+extern const kernel_variant_t add_variants[];
+extern const kernel_variant_t mul_variants[];
+extern const kernel_variant_t mandelbrot_variants[];
+
+// The variant in table 'v' for these sizes on 'num_qpus' QPUs, or NULL.
+const kernel_variant_t *kernel_variant(const kernel_variant_t *v, uint32_t size, uint32_t iters, int num_qpus);
+
+// Context bytes kernel_variants_load needs for the variants of 'size'.
+uint32_t kernel_variants_size(const kernel_variant_t *v, uint32_t size);
+/*
+ * Load every variant of 'size' (any iters) into 'ctx': code[q] is the bus
+ * address of the one for q QPUs, or 0.  Returns 0, or -1 if out of memory.
+ */
+int kernel_variants_load(gpu_ctx_t *ctx, const kernel_variant_t *v, uint32_t size, uint32_t code[V3D_NUM_QPUS + 1]);
+
+#endif /* KERNEL_VARIANTS_H */
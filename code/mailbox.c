@@ -1,181 +1,180 @@
 #include <stdint.h>
+#include <string.h>
 #include "rpi.h"
+#include "mailbox.h"
 
 #define MAILBOX_BASE 0x2000B880
-#define MAILBOX_READ (*(volatile uint32_t *)(MAILBOX_BASE + 0x0))
-#define MAILBOX_STATUS (*(volatile uint32_t *)(MAILBOX_BASE + 0x18))
-#define MAILBOX_WRITE (*(volatile uint32_t *)(MAILBOX_BASE + 0x20))
+#define MAILBOX_READ (MAILBOX_BASE + 0x0)
+#define MAILBOX_STATUS (MAILBOX_BASE + 0x18)
+#define MAILBOX_WRITE (MAILBOX_BASE + 0x20)
 
 #define MAILBOX_FULL 0x80000000
 #define MAILBOX_EMPTY 0x40000000
 
-#define V3D_BASE 0x20C00000
-#define V3D_SRQSC (V3D_BASE + 0x418)
-#define V3D_L2CACTL (V3D_BASE + 0x020)
-#define V3D_SLCACTL (V3D_BASE + 0x024)
-#define V3D_SRQPC (V3D_BASE + 0x0430)
-#define V3D_SRQUA (V3D_BASE + 0x0434)
-#define V3D_SRQCS (V3D_BASE + 0x043c)
-#define V3D_DBCFG (V3D_BASE + 0x0e00)
-#define V3D_DBQITE (V3D_BASE + 0x0e2c)
-#define V3D_DBQITC (V3D_BASE + 0x0e30)
-//
-// Basic mailbox I/O routines
-//
+static uint32_t hw_get32(uint32_t addr) { return GET32(addr); }
+static void hw_put32(uint32_t addr, uint32_t val) { PUT32(addr, val); }
 
-// Write 'data' to the mailbox on the specified channel.
-void mailbox_write(uint8_t channel, uint32_t data)
+static const mbox_backend_t hw_backend = {
+	.get32 = hw_get32,
+	.put32 = hw_put32,
+};
+
+static const mbox_backend_t *backend = &hw_backend;
+
+// Messages read off the hardware FIFO, waiting for their channel's reader.
+static struct mbox_queue
 {
-	// Wait until mailbox is not full.
-	while (MAILBOX_STATUS & MAILBOX_FULL)
-	{
-	}
-	// Lower 4 bits are used for channel.
-	MAILBOX_WRITE = (data & ~0xF) | (channel & 0xF);
-}
+	uint32_t data[MBOX_QUEUE_LEN];
+	unsigned head, n;
+} queues[MBOX_NCHANNELS];
 
-// Read from the mailbox on the specified channel.
-uint32_t mailbox_read(uint8_t channel)
+static unsigned ndropped;
+
+void mbox_set_backend(const mbox_backend_t *b)
 {
-	uint32_t data;
-	while (1)
-	{
-		data = MAILBOX_READ;
-		if ((data & 0xF) == channel)
-			return data & ~0xF;
-	}
+	backend = b ? b : &hw_backend;
+	memset(queues, 0, sizeof queues);
+	ndropped = 0;
 }
 
-// Perform a mailbox property call.
-// The message buffer 'msg' must be 16-byte aligned.
-// Returns nonzero if the call succeeded.
-int mbox_property(uint32_t *msg)
+unsigned mailbox_dropped(void)
 {
-	// Check alignment.
-	if ((uint32_t)msg & 0xF) return 0;
-	mailbox_write(8, (uint32_t)msg);
-	while (mailbox_read(8) != (uint32_t)msg);
+	return ndropped;
+}
 
-	return (msg[1] == 0x80000000);
+__attribute__((weak)) uint32_t mbox_bus_addr(volatile void *p)
+{
+	return (uint32_t)(uintptr_t)p;
 }
 
 //
-// Mailbox property calls for GPU memory and QPU control.
-// All property messages are sent on mailbox channel 8.
+// Basic mailbox I/O routines
 //
 
-uint32_t mem_alloc(uint32_t size, uint32_t align, uint32_t flags)
+int mailbox_try_write(uint8_t channel, uint32_t data)
 {
-
-	uint32_t p[9] __attribute__((aligned(16))) =
-		{
-			9 * sizeof(uint32_t), // size
-			0x00000000,			  // process request
-			0x3000c,			  // (the tag id)
-			3 * sizeof(uint32_t), // (size of the buffer)
-			3 * sizeof(uint32_t), // (size of the data)
-			size,				  // (num bytes)
-			align,				  // (alignment)
-			flags,				  // (MEM_FLAG_L1_NONALLOCATING)
-			0					  // end tag
-		};
-	assert(mbox_property(p));
-	return p[5];
+	if (backend->get32(MAILBOX_STATUS) & MAILBOX_FULL)
+		return -1;
+	// Lower 4 bits are used for channel.
+	backend->put32(MAILBOX_WRITE, (data & ~0xF) | (channel & 0xF));
+	return 0;
 }
 
-uint32_t mem_free(uint32_t handle)
+// Write 'data' to the mailbox on the specified channel.
+void mailbox_write(uint8_t channel, uint32_t data)
 {
-
-	uint32_t p[7] __attribute__((aligned(16))) =
-		{
-			7 * sizeof(uint32_t), // size
-			0x00000000,			  // process request
-			0x3000f,			  // (the tag id)
-			1 * sizeof(uint32_t), // (size of the buffer)
-			1 * sizeof(uint32_t), // (size of the data)
-			handle,				  // (handle)
-			0					  // end tag
-		};
-	assert(mbox_property(p));
-	return p[5];
+	// Wait until mailbox is not full.
+	while (mailbox_try_write(channel, data) < 0)
+	{
+	}
 }
 
-uint32_t mem_lock(uint32_t handle)
+// Sort everything in the hardware read FIFO into the per-channel queues.
+static void mailbox_drain(void)
 {
+	while (!(backend->get32(MAILBOX_STATUS) & MAILBOX_EMPTY))
+	{
+		uint32_t data = backend->get32(MAILBOX_READ);
+		struct mbox_queue *q = &queues[data & 0xF];
 
-	uint32_t p[7] __attribute__((aligned(16))) =
+		// a reader that never comes must not wedge the other channels.
+		if (q->n == MBOX_QUEUE_LEN)
 		{
-			7 * sizeof(uint32_t), // size
-			0x00000000,			  // process request
-			0x3000d,			  // (the tag id)
-			1 * sizeof(uint32_t), // (size of the buffer)
-			1 * sizeof(uint32_t), // (size of the data)
-			handle,				  // (handle)
-			0					  // end tag
-		};
-	assert(mbox_property(p));
-	return p[5];
+			ndropped++;
+			continue;
+		}
+		q->data[(q->head + q->n++) % MBOX_QUEUE_LEN] = data & ~0xF;
+	}
 }
 
-uint32_t mem_unlock(uint32_t handle)
+int mailbox_poll(uint8_t channel, uint32_t *data)
 {
-	uint32_t p[7] __attribute__((aligned(16))) =
-		{
-			7 * sizeof(uint32_t), // size
-			0x00000000,			  // process request
-			0x3000e,			  // (the tag id)
-			1 * sizeof(uint32_t), // (size of the buffer)
-			1 * sizeof(uint32_t), // (size of the data)
-			handle,				  // (handle)
-			0					  // end tag
-		};
-	assert(mbox_property(p));
-	return p[5];
+	struct mbox_queue *q = &queues[channel & 0xF];
+
+	mailbox_drain();
+	if (!q->n)
+		return 0;
+	*data = q->data[q->head];
+	q->head = (q->head + 1) % MBOX_QUEUE_LEN;
+	q->n--;
+	return 1;
 }
 
-uint32_t qpu_enable(uint32_t enable)
+int mailbox_take(uint8_t channel, uint32_t data)
 {
+	struct mbox_queue *q = &queues[channel & 0xF];
 
-	uint32_t p[7] __attribute__((aligned(16))) =
-		{
-			7 * sizeof(uint32_t), // size
-			0x00000000,			  // process request
-			0x30012,			  // (the tag id)
-			1 * sizeof(uint32_t), // (size of the buffer)
-			1 * sizeof(uint32_t), // (size of the data)
-			enable,				  // (enable QPU)
-			0					  // end tag
-		};
-	assert(mbox_property(p));
-	return p[5];
+	mailbox_drain();
+	for (unsigned i = 0; i < q->n; i++)
+	{
+		if (q->data[(q->head + i) % MBOX_QUEUE_LEN] != data)
+			continue;
+		// close the gap, keeping the rest in arrival order.
+		for (; i + 1 < q->n; i++)
+			q->data[(q->head + i) % MBOX_QUEUE_LEN] = q->data[(q->head + i + 1) % MBOX_QUEUE_LEN];
+		q->n--;
+		return 1;
+	}
+	return 0;
 }
 
-unsigned gpu_fft_base_exec_direct(
-	uint32_t code,
-	uint32_t unifs[],
-	int num_qpus)
+int mailbox_read_timeout(uint8_t channel, uint32_t *data, unsigned usec)
 {
-	//printk("RUNNING WITH %d\n QPUS", num_qpus);
-	PUT32(V3D_DBCFG, 0); // Disallow IRQ
-
-	PUT32(V3D_DBQITE, 0);  // Disable IRQ
-	PUT32(V3D_DBQITC, -1); // Resets IRQ flags
+	unsigned start = timer_get_usec();
+	while (!mailbox_poll(channel, data))
+		if (timer_get_usec() - start >= usec)
+			return -1;
+	return 0;
+}
 
-	PUT32(V3D_L2CACTL, 1 << 2); // Clear L2 cache
-	PUT32(V3D_SLCACTL, -1);		// Clear other caches
+// Read from the mailbox on the specified channel.
+uint32_t mailbox_read(uint8_t channel)
+{
+	uint32_t data;
+	while (!mailbox_poll(channel, &data))
+	{
+	}
+	return data;
+}
 
-	PUT32(V3D_SRQCS, (1 << 7) | (1 << 8) | (1 << 16)); // Reset error bit and counts
+//
+// Property calls (channel 8).
+//
 
-	for (unsigned q = 0; q < num_qpus; q++)
-	{ // Launch shader(s)
+int mbox_property_start(uint32_t *msg)
+{
+	// Check alignment.
+	uint32_t addr = mbox_bus_addr(msg);
+	if (addr & 0xF)
+		return -1;
+	return mailbox_try_write(MBOX_CH_PROP, addr);
+}
 
-		PUT32(V3D_SRQUA, (uint32_t)unifs[q]); // Set the uniforms address
-		PUT32(V3D_SRQPC, (uint32_t)code); // Set the program counter
-	}
+int mbox_property_done(uint32_t *msg)
+{
+	return mailbox_take(MBOX_CH_PROP, mbox_bus_addr(msg));
+}
 
+int mbox_property_wait(uint32_t *msg, unsigned usec)
+{
+	unsigned start = timer_get_usec();
+	while (!mbox_property_done(msg))
+		if (timer_get_usec() - start >= usec)
+			return -1;
+	return msg[1] == 0x80000000;
+}
 
-	// Busy wait polling
-	while (((GET32(V3D_SRQCS) >> 16) & 0xff) != num_qpus);
+// Perform a mailbox property call.
+// The message buffer 'msg' must be 16-byte aligned.
+// Returns nonzero if the call succeeded.
+int mbox_property(uint32_t *msg)
+{
+	// Check alignment.
+	if (mbox_bus_addr(msg) & 0xF)
+		return 0;
+	mailbox_write(MBOX_CH_PROP, mbox_bus_addr(msg));
+	while (!mbox_property_done(msg))
+		;
 
-	return 0;
+	return (msg[1] == 0x80000000);
 }
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "v3d.h"
 
 /*
  * Bare-metal Mailbox Interface for Raspberry Pi
@@ -13,7 +14,14 @@
  * Functions:
  *   - mailbox_write(): Write a message to the mailbox.
  *   - mailbox_read():  Read a message from the mailbox.
- *   - mailbox_call():  Send a property message and wait for the response.
+ *   - mbox_property(): Send a property message and wait for the response.
+ *
+ * Reads never discard messages for other channels: everything read off
+ * the hardware FIFO is sorted into a small per-channel queue, so callers
+ * can poll one channel (mailbox_poll, mailbox_read_timeout) while replies
+ * for others wait their turn.  Property calls can be split into
+ * mbox_property_start() and mbox_property_done(), with several messages
+ * in flight at once; each reply is matched to its buffer by address.
  *
  *   - mem_alloc():     Allocate GPU memory.
  *   - mem_free():      Free GPU memory.
@@ -21,16 +29,48 @@
  *   - mem_unlock():    Unlock GPU memory.
  *
  *   - qpu_enable():    Enable (or disable) the QPU.
- *   - execute_qpu():   Execute QPU code.
+ *
+ * The memory and QPU calls are one-tag messages built with mbox-prop.h,
+ * which can also pack several tags into one round trip.  QPU job
+ * submission lives in v3d.h.
  *
  * All property messages are sent on mailbox channel 8.
  *
  * Note: Ensure that the mailbox message buffers are 16-byte aligned.
  */
 
+#define MBOX_NCHANNELS 16
+#define MBOX_QUEUE_LEN 8 // messages buffered per channel
+#define MBOX_CH_PROP 8	 // property channel (ARM to VC)
+
+/*
+ * Register backend, as for the V3D (see v3d.h): the default uses
+ * GET32/PUT32, host builds install a fake mailbox.  Also clears the queues.
+ */
+typedef struct mbox_backend
+{
+	uint32_t (*get32)(uint32_t addr);
+	void (*put32)(uint32_t addr, uint32_t val);
+} mbox_backend_t;
+
+void mbox_set_backend(const mbox_backend_t *b);
+
+// Address the VC sees for a message buffer.  Host builds override this.
+uint32_t mbox_bus_addr(volatile void *p);
+
 /* Basic mailbox I/O routines */
 void mailbox_write(uint8_t channel, uint32_t data);
+// mailbox_write without waiting: returns -1 if the mailbox is full.
+int mailbox_try_write(uint8_t channel, uint32_t data);
 uint32_t mailbox_read(uint8_t channel);
+// Non-blocking read: returns 1 and sets *data if a message was waiting.
+int mailbox_poll(uint8_t channel, uint32_t *data);
+// mailbox_read giving up after 'usec': returns 0, or -1 on timeout.
+int mailbox_read_timeout(uint8_t channel, uint32_t *data, unsigned usec);
+// Remove the message 'data' from the channel's queue; returns 1 if it was there.
+int mailbox_take(uint8_t channel, uint32_t data);
+// Messages dropped because their channel's queue was full.
+unsigned mailbox_dropped(void);
 
 /* Mailbox property call.
  * 'msg' must be 16-byte aligned.
@@ -38,6 +78,18 @@ uint32_t mailbox_read(uint8_t channel);
  */
 int mbox_property(uint32_t *msg);
 
+/* Asynchronous property calls.
+ *
+ * mbox_property_start: Send 'msg' without waiting; returns 0, or -1 if it is
+ *                      misaligned or the mailbox is full.
+ * mbox_property_done:  1 once the reply to 'msg' has arrived, else 0.
+ * mbox_property_wait:  Wait up to 'usec' for the reply; returns -1 on
+ *                      timeout, otherwise what mbox_property would.
+ */
+int mbox_property_start(uint32_t *msg);
+int mbox_property_done(uint32_t *msg);
+int mbox_property_wait(uint32_t *msg, unsigned usec);
+
 /* GPU memory allocation and management functions.
  *
  * mem_alloc:  Allocates 'size' bytes of GPU memory, with the given 'align'
@@ -60,6 +112,4 @@ uint32_t mem_unlock(uint32_t handle);
  * qpu_enable: Enable (or disable) the QPU. Pass 1 to enable, 0 to disable. */
 uint32_t qpu_enable(uint32_t enable);
 
-unsigned gpu_fft_base_exec_direct(uint32_t code, uint32_t unifs[], int num_qpus);
-
 #endif /* BARE_MBOX_H */
@@ -0,0 +1,106 @@
+# generated from mandelbrot.vqasm by host/regalloc: edit that instead.
+# registers (host/regalloc):
+#   %res=ra6 %step=rb1 %max_iter=rb6 %num_qpus=rb5 %qpu=ra4 %out=rb3
+#   %i=ra5 %m=rb2 %j=ra3 %t=r0 %row=rb4 %y=rb0
+#   %x=ra1 %u=r2 %v=ra0 %u2=r3 %v2=r1 %n=ra2
+#   %esc=ra7 %t2=r1
+.include "../share/vc4inc/vc4.qinc"
+
+# mandelbrot.qasm with virtual registers (%name) in place of r1/r2 and
+# hand-picked ra/rb registers.  "make -C host regalloc" assigns them and
+# writes mandelbrot-ra.qasm for vc4asm.
+
+# Read uniforms into registers
+mov ra6, unif          # RESOLUTION
+mov rb1, unif         # 1/RESOLUTION
+mov rb6, unif     # MAX_ITER
+mov rb5, unif     # NUM_QPU
+mov ra4, unif          # QPU_NUM
+mov rb3, unif          # ADDRESS
+
+mov ra5, ra4            # i = QPU_NUM
+shl rb2, ra6, 1         # m = 2*RESOLUTION
+
+:row_loop
+
+mov ra3, 0
+shl r0, ra6, 3         # bytes_per_row = 8*RESOLUTION
+mul24 rb4, r0, ra5      # Array_idx = i * bytes_per_row
+
+itof r0, ra5             # (float) i
+fmul r0, r0, rb1      # i * 1/RESOLUTION
+fsub rb0, r0, 1.0        # y = -1 + i*1/RESOLUTION
+
+:column_loop
+
+    mov r1, ra3 # regalloc: regfile conflict
+    add r0, r1, elem_num    # j + elem_num
+    itof r0, r0
+    fmul r0, r0, rb1      # j * 1/RESOLUTION
+    fsub ra1, r0, 1.0        # x = -1 + j*1/RESOLUTION
+
+    mov r2, 0               # 0.0
+    mov ra0, 0
+    mov r3, 0
+    mov r1, 0
+    mov ra2, rb6
+    mov ra7, 0
+
+:inner_loop
+
+    fmul r0, ra0, 2.0        # v *= 2
+    fmul r0, r0, r2         # v *= u
+    fadd ra0, r0, rb0         # v += y
+
+    fadd r0, r3, ra1        # u = u^2 + x
+    fsub r2, r0, r1        # u -= v^2
+
+    fmul r3, r2, r2        # u^2 = u*u
+    fmul r1, ra0, ra0        # v^2 = v*v
+
+    fadd r0, r3, r1
+    fsub.setf -, 4.0, r0    # escaped if u^2 + v^2 > 4
+    mov.ifn ra7, 1
+
+    sub.setf ra2, ra2, 1
+    brr.anynz -, :inner_loop
+    nop
+    nop
+    nop
+
+    mov r0, vpm_setup(1, 1, h32(0))
+    add vw_setup, ra4, r0
+
+    mov vpm, ra7           # VPM WRITE
+    mov -, vw_wait
+
+    shl r0, ra4, 7
+    mov r1, vdw_setup_0(1, 16, dma_h32(0,0))
+    add vw_setup, r0, r1
+
+    shl r0, ra3, 2
+    add r0, rb4, r0
+    add vw_addr, rb3, r0
+    mov -, vw_wait
+
+    add ra3, ra3, 16
+    nop # regalloc: regfile write read next
+    sub.setf -, ra3, rb2
+    brr.anyc -, :column_loop
+    nop
+    nop
+    nop
+
+    add ra5, ra5, rb5   # i += NUM_QPU
+    nop # regalloc: regfile write read next
+    sub.setf -, ra5, rb2      # if i < 2*RESOLUTION
+    brr.anyc -, :row_loop
+    nop
+    nop
+    nop
+
+# End of kernel
+:end
+thrend
+mov interrupt, 1
+nop
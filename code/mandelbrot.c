@@ -0,0 +1,54 @@
+#include "rpi.h"
+#include <string.h>
+#include "mandelbrot.h"
+#include "mandelbrotshader.h"
+#include "kernel-variants.h"
+#include "kernel-abi.h"
+
+uint32_t mandelbrot_step(int res)
+{
+	union
+	{
+		float f;
+		uint32_t i;
+	} pun;
+	float x = (float)res;
+
+	pun.f = x;
+	pun.i = 0x7EF127EA - pun.i;
+	float r = pun.f;
+	r = r * (2.0f - x * r);
+	r = r * (2.0f - x * r);
+	r = r * (2.0f - x * r);
+	pun.f = r;
+	return pun.i;
+}
+
+int mandelbrot_init(gpu_ctx_t *ctx, gpu_kernel_t *k, int res, int max_iter, int num_qpus, volatile uint32_t *out)
+{
+	const kernel_variant_t *v = kernel_variant(mandelbrot_variants, res, max_iter, num_qpus);
+
+	if (v)
+	{
+		struct qb_mandelbrot_unifs u[V3D_NUM_QPUS];
+		if (KERNEL_INIT(qb_mandelbrot, ctx, k, v->code, v->nbytes, num_qpus) < 0)
+			return -1;
+		for (int q = 0; q < num_qpus; q++)
+			u[q] = (struct qb_mandelbrot_unifs){ .qpu = q, .out = gpu_bus(ctx, out) };
+		KERNEL_SET_UNIFS(qb_mandelbrot, ctx, k, u, num_qpus);
+		return 0;
+	}
+
+	struct mandelbrotshader_unifs u[V3D_NUM_QPUS];
+	uint32_t step = mandelbrot_step(res);
+	if (KERNEL_INIT(mandelbrotshader, ctx, k, mandelbrotshader, sizeof mandelbrotshader, num_qpus) < 0)
+		return -1;
+	for (int q = 0; q < num_qpus; q++)
+	{
+		u[q] = (struct mandelbrotshader_unifs){ .res = res, .max_iter = max_iter, .num_qpus = num_qpus,
+			.qpu = q, .out = gpu_bus(ctx, out) };
+		memcpy(&u[q].step, &step, sizeof step);
+	}
+	KERNEL_SET_UNIFS(mandelbrotshader, ctx, k, u, num_qpus);
+	return 0;
+}
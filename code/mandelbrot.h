@@ -0,0 +1,18 @@
+#ifndef MANDELBROT_H
+#define MANDELBROT_H
+
+#include <stdint.h>
+#include "gpu-runtime.h"
+
+// float bits of 1/res as the kernels take it (three Newton steps).
+uint32_t mandelbrot_step(int res);
+
+/*
+ * Set up 'k' to draw the 2res x 2res set, one word per point (1 if it
+ * escapes within max_iter iterations), into 'out' on num_qpus QPUs.  Uses
+ * the kernel specialized to these sizes if there is one (kernel-variants.h),
+ * else mandelbrotshader.  Returns 0, or -1 if out of memory.
+ */
+int mandelbrot_init(gpu_ctx_t *ctx, gpu_kernel_t *k, int res, int max_iter, int num_qpus, volatile uint32_t *out);
+
+#endif /* MANDELBROT_H */
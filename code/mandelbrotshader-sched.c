@@ -0,0 +1,100 @@
+#include "mandelbrotshader-sched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+__declspec(align(8))
+#elif defined(__GNUC__)
+__attribute__((aligned(8)))
+#endif
+uint32_t mandelbrotshader_sched[162] = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x100200a7,
+0x15827d80, 0x100200e7,
+0x15827d80, 0x10020127,
+0x15827d80, 0x10020167,
+0x15127d80, 0x100202a7,
+0x009e7000, 0x100009e7,
+0x11003dc0, 0xd0020867,
+0x482a7d8e, 0x1002584c,
+0x2805ffce, 0xd00248a1,
+0x11001dc0, 0xd00201a7,
+0x00000000, 0xe00202e7,
+0x019e7280, 0x10021267,
+0x009e7000, 0x100009e7,
+0x882dfff6, 0xd00258a1,
+0x0c9a7380, 0x10020867,
+0x089e7240, 0x10020867,
+0x2006700e, 0x100049e1,
+0x019e7280, 0x10021227,
+0x089c0fc0, 0xd0020867,
+0x159e7240, 0x10021027,
+0x159e7240, 0x10021067,
+0x159e7240, 0x100210a7,
+0x950a7276, 0x100250e1,
+0x159e7240, 0x100201e7,
+0x00000000, 0xe00211e7,
+0x009e7000, 0x100009e7,
+0x089c2fc0, 0xd0020867,
+0x209c1039, 0x100049c1,
+0x159c0fc0, 0x10020867,
+0x209c1039, 0x100049c1,
+0x159c9fc0, 0x10020867,
+0x019c1e40, 0x10021067,
+0x159c8fc0, 0x10020867,
+0x159c2fc0, 0x100208a7,
+0x819c347f, 0x10025021,
+0x009e7000, 0x100009e7,
+0x029c0e40, 0x10021027,
+0x009e7000, 0x100009e7,
+0x159c0fc0, 0x10020867,
+0x359c1fc9, 0x10024842,
+0x289c4fc9, 0xd0024843,
+0x159c2fc0, 0x100208a7,
+0x159c3fc0, 0x100208e7,
+0x019e74c0, 0x100208a7,
+0x029e7280, 0x100228e7,
+0x00000001, 0xe00811e7,
+0x0d1c1dc0, 0xd00221e7,
+0xffffff38, 0xf03809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x00101a00, 0xe00208a7,
+0x0c127c80, 0x10021c67,
+0x159c7fc0, 0x10020c27,
+0x009f2000, 0x100009e7,
+0x11107dc0, 0xd0020867,
+0x80904000, 0xe00208a7,
+0x8c2e72b6, 0x10025c61,
+0x119c23c0, 0xd0020867,
+0x0c327c40, 0x10020867,
+0x0d2d0dc0, 0xd00202e7,
+0x0c167c40, 0x10021ca7,
+0x151b2d80, 0x10020867,
+0x0d2e7c40, 0x10022867,
+0xfffffe48, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x150e7d80, 0x10020867,
+0x0c2a7c40, 0x100202a7,
+0x151a7d80, 0x10020867,
+0x0d2a7c40, 0x10022867,
+0xfffffdd0, 0xf0a809e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x300009e7,
+0x00000001, 0xe00209a7,
+0x009e7000, 0x100009e7
+};
+#ifdef __HIGHC__
+#pragma Align_to(8, mandelbrotshader_sched)
+#endif
+#ifdef __cplusplus
+}
+#endif
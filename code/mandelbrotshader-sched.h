@@ -0,0 +1,17 @@
+#ifndef mandelbrotshader_sched_H
+#define mandelbrotshader_sched_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mandelbrotshader after host/sched-shaders; regenerate with "make -C host shaders".
+extern uint32_t mandelbrotshader_sched[162];
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
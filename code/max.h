@@ -1,2 +1,4 @@
+
 #define N 1048576
+// QPUs the vector kernels use by default; pick 1..V3D_NUM_QPUS at run time.
 #define NUM_QPUS 16
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "rpi.h"
+#include <string.h>
+#include "mbox-prop.h"
+
+//
+// Property message builder.
+//
+
+void mbox_msg_init(mbox_msg_t *m, uint32_t *buf, unsigned max)
+{
+	assert(max >= 3);
+	m->buf = buf;
+	m->max = max;
+	m->buf[0] = 0;			  // size, set by mbox_msg_end
+	m->buf[1] = MBOX_REQUEST; // process request
+	m->n = 2;
+}
+
+int mbox_msg_add(mbox_msg_t *m, uint32_t tag, const uint32_t *in, unsigned nin, unsigned nout)
+{
+	unsigned len = nin > nout ? nin : nout;
+
+	// tag header, value buffer, and the end tag still to come.
+	if (m->n + 3 + len + 1 > m->max)
+		return -1;
+
+	uint32_t *p = &m->buf[m->n];
+	p[0] = tag;						// (the tag id)
+	p[1] = len * sizeof(uint32_t);	// (size of the buffer)
+	p[2] = nin * sizeof(uint32_t);	// (size of the data)
+	for (unsigned i = 0; i < len; i++)
+		p[3 + i] = i < nin ? in[i] : 0;
+
+	m->n += 3 + len;
+	return m->n - len;
+}
+
+void mbox_msg_end(mbox_msg_t *m)
+{
+	m->buf[m->n] = 0; // end tag
+	m->buf[0] = (m->n + 1) * sizeof(uint32_t);
+}
+
+int mbox_msg_send(mbox_msg_t *m)
+{
+	mbox_msg_end(m);
+	return mbox_property(m->buf) ? 0 : -1;
+}
+
+int mbox_msg_start(mbox_msg_t *m)
+{
+	mbox_msg_end(m);
+	return mbox_property_start(m->buf);
+}
+
+int mbox_msg_done(mbox_msg_t *m)
+{
+	return mbox_property_done(m->buf);
+}
+
+uint32_t *mbox_msg_resp(mbox_msg_t *m, int tag, unsigned *nbytes)
+{
+	if (tag < 5 || tag > m->n)
+		return NULL;
+	uint32_t code = m->buf[tag - 1];
+	if (!(code & MBOX_TAG_RESPONSE))
+		return NULL;
+	if (nbytes)
+		*nbytes = code & ~MBOX_TAG_RESPONSE;
+	return &m->buf[tag];
+}
+
+//
+// Mailbox property calls for GPU memory and QPU control.
+// All property messages are sent on mailbox channel 8.
+//
+
+// One-tag call; returns the first word of the response.
+static uint32_t mbox_call1(uint32_t tag, const uint32_t *in, unsigned nin)
+{
+	uint32_t buf[12] __attribute__((aligned(16)));
+	mbox_msg_t m;
+
+	mbox_msg_init(&m, buf, 12);
+	int t = mbox_msg_add(&m, tag, in, nin, 1);
+	assert(t >= 0);
+	assert(mbox_msg_send(&m) == 0);
+	return buf[t];
+}
+
+uint32_t mem_alloc(uint32_t size, uint32_t align, uint32_t flags)
+{
+	return mbox_call1(MBOX_TAG_ALLOCATE_MEMORY, (uint32_t[]){ size, align, flags }, 3);
+}
+
+uint32_t mem_free(uint32_t handle)
+{
+	return mbox_call1(MBOX_TAG_RELEASE_MEMORY, &handle, 1);
+}
+
+uint32_t mem_lock(uint32_t handle)
+{
+	return mbox_call1(MBOX_TAG_LOCK_MEMORY, &handle, 1);
+}
+
+uint32_t mem_unlock(uint32_t handle)
+{
+	return mbox_call1(MBOX_TAG_UNLOCK_MEMORY, &handle, 1);
+}
+
+uint32_t qpu_enable(uint32_t enable)
+{
+	return mbox_call1(MBOX_TAG_ENABLE_QPU, &enable, 1);
+}
+
+int mbox_gpu_mem_open(mbox_gpu_mem_t *g, uint32_t size, uint32_t align, uint32_t flags, int enable_qpu)
+{
+	uint32_t buf[32] __attribute__((aligned(16)));
+	mbox_msg_t m;
+	int qpu = -1;
+	uint32_t *r;
+
+	memset(g, 0, sizeof *g);
+	mbox_msg_init(&m, buf, 32);
+	if (enable_qpu)
+		qpu = mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1);
+	int arm = mbox_msg_add(&m, MBOX_TAG_GET_ARM_MEMORY, NULL, 0, 2);
+	int vc = mbox_msg_add(&m, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+	int alloc = mbox_msg_add(&m, MBOX_TAG_ALLOCATE_MEMORY, (uint32_t[]){ size, align, flags }, 3, 1);
+	if (mbox_msg_send(&m) < 0)
+		return enable_qpu ? -2 : -3;
+
+	if ((r = mbox_msg_resp(&m, arm, NULL)))
+	{
+		g->arm_base = r[0];
+		g->arm_size = r[1];
+	}
+	if ((r = mbox_msg_resp(&m, vc, NULL)))
+	{
+		g->vc_base = r[0];
+		g->vc_size = r[1];
+	}
+	int enabled = enable_qpu && (r = mbox_msg_resp(&m, qpu, NULL)) && r[0] == 0;
+	if ((r = mbox_msg_resp(&m, alloc, NULL)))
+		g->handle = r[0];
+
+	if (enable_qpu && !enabled)
+	{
+		if (g->handle)
+			mem_free(g->handle);
+		return -2;
+	}
+	if (!g->handle)
+	{
+		if (enabled)
+			qpu_enable(0);
+		return -3;
+	}
+
+	// the lock needs the handle, so it cannot ride in the first message.
+	mbox_msg_init(&m, buf, 32);
+	int lock = mbox_msg_add(&m, MBOX_TAG_LOCK_MEMORY, &g->handle, 1, 1);
+	if (mbox_msg_send(&m) == 0 && (r = mbox_msg_resp(&m, lock, NULL)))
+		g->bus = r[0];
+	if (!g->bus)
+	{
+		mem_free(g->handle);
+		if (enabled)
+			qpu_enable(0);
+		return -4;
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef MBOX_PROP_H
+#define MBOX_PROP_H
+
+#include <stdint.h>
+#include "mailbox.h"
+
+/*
+ * Mailbox property message builder.
+ *
+ * Packs several property tags into one message so they cost one mailbox
+ * round trip, then hands back each tag's response:
+ *
+ *	uint32_t buf[32] __attribute__((aligned(16)));
+ *	mbox_msg_t m;
+ *	mbox_msg_init(&m, buf, 32);
+ *	int vc = mbox_msg_add(&m, MBOX_TAG_GET_VC_MEMORY, NULL, 0, 2);
+ *	int qpu = mbox_msg_add(&m, MBOX_TAG_ENABLE_QPU, (uint32_t[]){ 1 }, 1, 1);
+ *	if (mbox_msg_send(&m) == 0)
+ *		... mbox_msg_resp(&m, vc, NULL)[1] is the VC memory size ...
+ *
+ * The firmware runs the tags in order but cannot feed one tag's result
+ * into another, so dependent calls (lock after allocate) still need a
+ * second message.
+ */
+
+// property tags (firmware mailbox property interface).
+#define MBOX_TAG_GET_ARM_MEMORY 0x00010005
+#define MBOX_TAG_GET_VC_MEMORY 0x00010006
+#define MBOX_TAG_ALLOCATE_MEMORY 0x0003000c
+#define MBOX_TAG_LOCK_MEMORY 0x0003000d
+#define MBOX_TAG_UNLOCK_MEMORY 0x0003000e
+#define MBOX_TAG_RELEASE_MEMORY 0x0003000f
+#define MBOX_TAG_ENABLE_QPU 0x00030012
+
+#define MBOX_REQUEST 0x00000000
+#define MBOX_RESPONSE_OK 0x80000000
+#define MBOX_TAG_RESPONSE 0x80000000 // set in a tag's code word once answered
+
+typedef struct mbox_msg
+{
+	uint32_t *buf;	// 16-byte aligned
+	unsigned max;	// words in buf
+	unsigned n;		// words used, not counting the end tag
+} mbox_msg_t;
+
+void mbox_msg_init(mbox_msg_t *m, uint32_t *buf, unsigned max);
+
+/*
+ * Append 'tag' with 'nin' request words and room for 'nout' response
+ * words.  Returns a handle for mbox_msg_resp, or -1 if 'buf' is full.
+ */
+int mbox_msg_add(mbox_msg_t *m, uint32_t tag, const uint32_t *in, unsigned nin, unsigned nout);
+
+// Terminate the message and fix up its size word.
+void mbox_msg_end(mbox_msg_t *m);
+
+// End and send the message.  Returns 0 if the firmware processed it.
+int mbox_msg_send(mbox_msg_t *m);
+
+// End and send the message without waiting: 0, or -1 if the mailbox is full.
+int mbox_msg_start(mbox_msg_t *m);
+// 1 once the firmware has replied to a started message, else 0.
+int mbox_msg_done(mbox_msg_t *m);
+
+/*
+ * Response words of the tag added as 'tag', or NULL if the firmware did
+ * not answer it.  The response length in bytes goes to *nbytes if given.
+ */
+uint32_t *mbox_msg_resp(mbox_msg_t *m, int tag, unsigned *nbytes);
+
+// GPU memory set up by mbox_gpu_mem_open.
+typedef struct mbox_gpu_mem
+{
+	uint32_t handle;
+	uint32_t bus;					// bus address of the locked allocation
+	uint32_t arm_base, arm_size;	// firmware memory split
+	uint32_t vc_base, vc_size;
+} mbox_gpu_mem_t;
+
+/*
+ * Bring-up in two round trips: enable the QPUs (if 'enable_qpu'), read the
+ * memory split and allocate 'size' bytes in the first; lock the allocation
+ * in the second.  Returns 0, -2 if the QPUs could not be enabled, -3 if
+ * the allocation failed, -4 if it could not be locked.  On failure nothing
+ * stays allocated or enabled.
+ */
+int mbox_gpu_mem_open(mbox_gpu_mem_t *g, uint32_t size, uint32_t align, uint32_t flags, int enable_qpu);
+
+#endif /* MBOX_PROP_H */
@@ -0,0 +1,60 @@
+#include "mulshader-sched.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _MSC_VER
+__declspec(align(8))
+#elif defined(__GNUC__)
+__attribute__((aligned(8)))
+#endif
+uint32_t mulshader_sched[82] = {
+0x15827d80, 0x10020027,
+0x15827d80, 0x10020067,
+0x15827d80, 0x100200a7,
+0x15827d80, 0x100200e7,
+0x00000100, 0xe00208e7,
+0x90000040, 0xe0020c67,
+0x80042000, 0xe0020c67,
+0x15067d80, 0x10020ca7,
+0x00ca7000, 0x100009e7,
+0x90000040, 0xe0020c67,
+0x80042010, 0xe0020c67,
+0x150a7d80, 0x10020ca7,
+0x00ca7000, 0x100009e7,
+0x0c067cc0, 0x10020067,
+0x0c0a7cc0, 0x100200a7,
+0x00801a00, 0xe0020c67,
+0x00401a08, 0xe0021c67,
+0x00000004, 0xe00202a7,
+0x009e7000, 0x100009e7,
+0x15c27d80, 0x10020867,
+0x009f2000, 0x100009e7,
+0x15c27d80, 0x100208a7,
+0x409f200a, 0x100049e1,
+0x0d281dc0, 0xd00222a7,
+0x159e7240, 0x10020c27,
+0xffffffb0, 0xf03809e7,
+0x009f2000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x82104400, 0xe0021c67,
+0x0d001dc0, 0xd0022027,
+0x8c0e7cf6, 0x100240f2,
+0xffffff00, 0xf03809e7,
+0x009f2000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x100009e7,
+0x009e7000, 0x300009e7,
+0x00000001, 0xe00209a7,
+0x009e7000, 0x100009e7
+};
+#ifdef __HIGHC__
+#pragma Align_to(8, mulshader_sched)
+#endif
+#ifdef __cplusplus
+}
+#endif
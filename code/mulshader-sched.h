@@ -0,0 +1,17 @@
+#ifndef mulshader_sched_H
+#define mulshader_sched_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// mulshader after host/sched-shaders; regenerate with "make -C host shaders".
+extern uint32_t mulshader_sched[82];
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
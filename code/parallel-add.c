@@ -4,85 +4,193 @@
 #include "parallel-add.h"
 #include "mailbox.h"
 #include "addshader.h"
+#include "kernel-variants.h"
+#include "kernel-abi.h"
+#include "qpu-builder.h"
 
-#define GPU_MEM_FLG 0xC // cached=0xC; direct=0x4
-#define GPU_BASE 0x40000000
+// vectors are rounded up to a whole kernel block, so the last QPU's final
+// (partial) block runs into padding instead of past the allocation; each
+// vector also starts on a VPM-row boundary.
+#define VEC_ALIGN 64
+
+// vectors are also rounded up to a whole number of 4-row blocks, which
+// the run-time kernels (qb_map2_tmu, qb_map2_pipe) can always use.
+#define VEC_BLOCK 64
+
+// set_qpus builds the run-time kernels here.
+#define BUILT_MAX QB_MAP2_TMU_MAX
+_Static_assert(QB_MAP2_PIPE_MAX <= BUILT_MAX && QB_MAP2_MAX <= BUILT_MAX, "built kernels fit");
+
+// the variants use the uniforms allocated for addshader.
+_Static_assert(sizeof(struct qb_map2_unifs) <= sizeof(struct addshader_unifs), "variant uniforms fit");
+_Static_assert(sizeof(struct qb_map2_tmu_unifs) <= sizeof(struct addshader_unifs), "TMU uniforms fit");
+
+static uint32_t padded(int n)
+{
+	return (n + ADD_BLOCK - 1) / ADD_BLOCK * ADD_BLOCK;
+}
+
+// ... and to VEC_BLOCK, which the vectors are.
+static uint32_t vec_padded(int n)
+{
+	return (n + VEC_BLOCK - 1) / VEC_BLOCK * VEC_BLOCK;
+}
+
+uint32_t vec_add_size(int n)
+{
+	uint32_t vec = vec_padded(n) * sizeof(uint32_t);
+	return sizeof(struct addGPU) + sizeof addshader
+		+ 8 * BUILT_MAX
+		+ kernel_variants_size(add_variants, padded(n))
+		+ V3D_NUM_QPUS * sizeof(struct addshader_unifs) + 3 * vec + 6 * VEC_ALIGN;
+}
 
 int add_gpu_prepare(
-	volatile struct addGPU **gpu)
+	gpu_ctx_t *ctx,
+	struct addGPU **gpu,
+	int n)
 {
-	uint32_t handle, vc;
-	volatile struct addGPU *ptr;
+	struct addGPU *ptr;
+	uint32_t vec = vec_padded(n) * sizeof(uint32_t);
 
-	if (qpu_enable(1))
-		return -2;
+	ptr = (struct addGPU *)gpu_alloc(ctx, sizeof *ptr, 8);
+	if (ptr == NULL)
+		return -3;
+	ptr->ctx = ctx;
+	ptr->n = n;
+	ptr->load = QB_LOAD_VPM;
+	ptr->rows = 0;
 
-	handle = mem_alloc(sizeof(struct addGPU), 4096, GPU_MEM_FLG);
-	if (!handle)
+	// uniforms for every QPU, so the split can change later.
+	if (KERNEL_INIT(addshader, ctx, &ptr->kernel, addshader, sizeof addshader, V3D_NUM_QPUS) < 0
+		|| kernel_variants_load(ctx, add_variants, padded(n), ptr->special) < 0)
 	{
-		qpu_enable(0);
+		gpu_free(ctx, ptr);
 		return -3;
 	}
-	vc = mem_lock(handle);
-
-	ptr = (volatile struct addGPU *)(vc - 0x40000000);
-	if (ptr == NULL)
+	ptr->generic = ptr->kernel.code;
+	volatile void *code = gpu_alloc(ctx, 8 * BUILT_MAX, 8);
+	ptr->built = code ? gpu_bus(ctx, code) : 0;
+	ptr->A = gpu_alloc(ctx, vec, VEC_ALIGN);
+	ptr->B = gpu_alloc(ctx, vec, VEC_ALIGN);
+	ptr->C = gpu_alloc(ctx, vec, VEC_ALIGN);
+	if (!ptr->A || !ptr->B || !ptr->C)
 	{
-		mem_free(handle);
-		mem_unlock(handle);
-		qpu_enable(0);
-		return -4;
+		gpu_free(ctx, ptr);
+		return -3;
 	}
-
-	ptr->handle = handle;
-	ptr->mail[0] = GPU_BASE + (uint32_t)&ptr->code;
-	ptr->mail[1] = GPU_BASE + (uint32_t)&ptr->unif;
+	ptr->end = ctx->used;
 
 	*gpu = ptr;
 	return 0;
 }
 
-uint32_t add_gpu_execute(volatile struct addGPU *gpu)
+// build the kernel for 'load' on num_qpus QPUs and split the vectors over
+// them, gpu->rows rows a block (or the most that fit) but never more than
+// the VPM has room for, nor more than divide the vectors.
+static int set_built(struct addGPU *gpu, int load, int num_qpus)
 {
-	return gpu_fft_base_exec_direct(
-		(uint32_t)gpu->mail[0],
-		(uint32_t *)gpu->unif_ptr,
-		NUM_QPUS
-	);
+	uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+	gpu_ctx_t *ctx = gpu->ctx;
+	uint32_t a = gpu_bus(ctx, gpu->A), b = gpu_bus(ctx, gpu->B), c = gpu_bus(ctx, gpu->C);
+	int max = load == QB_LOAD_TMU ? qb_map2_tmu_rows(num_qpus)
+		: load == QB_LOAD_PIPE ? qb_map2_pipe_rows(num_qpus) : qb_map2_rows(num_qpus);
+	uint32_t rows = gpu->rows > 0 && gpu->rows < max ? gpu->rows : max, nrows = vec_padded(gpu->n) / 16;
+	qb_t qb;
+
+	while (nrows % rows)
+		rows--;
+	qb_init(&qb, (uint32_t *)gpu_bus_to_cpu(gpu->built), BUILT_MAX);
+	if (load == QB_LOAD_TMU)
+		qb_map2_tmu(&qb, QPU_A_ADD, rows, 0);
+	else if (load == QB_LOAD_PIPE)
+		qb_map2_pipe(&qb, QPU_A_ADD, rows, 0);
+	else
+		qb_map2(&qb, QPU_A_ADD, rows, 0);
+	assert(!qb.err);
+	gpu_dirty(GPU_DIRTY_CODE);
+	gpu->tex = load == QB_LOAD_TMU;
+
+	// qb_map2 and qb_map2_pipe's uniforms are laid out as qb_map2_tmu's.
+	struct qb_map2_tmu_unifs u[V3D_NUM_QPUS];
+	int used = gpu_partition(nrows / rows, num_qpus, first, count);
+	for (int i = 0; i < used; i++)
+	{
+		uint32_t off = first[i] * rows * 64;
+		u[i] = (struct qb_map2_tmu_unifs){ .blocks = count[i], .a = a + off, .b = b + off, .c = c + off, .qpu = i };
+	}
+	KERNEL_SET_UNIFS(qb_map2_tmu, ctx, &gpu->kernel, u, used);
+	gpu->kernel.code = gpu->built;
+	gpu->kernel.num_qpus = used;
+	return used;
+}
+
+int vec_add_set_qpus(struct addGPU *gpu, int num_qpus)
+{
+	uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+	gpu_ctx_t *ctx = gpu->ctx;
+	uint32_t a = gpu_bus(ctx, gpu->A), b = gpu_bus(ctx, gpu->B), c = gpu_bus(ctx, gpu->C);
+
+	assert(num_qpus >= 1 && num_qpus <= V3D_NUM_QPUS);
+	gpu->tex = 0;
+	if (gpu->load != QB_LOAD_VPM && gpu->built)
+		return set_built(gpu, gpu->load, num_qpus);
+	if (gpu->special[num_qpus])
+	{
+		// every QPU does the same share, the sizes built into the code.
+		struct qb_map2_unifs u[V3D_NUM_QPUS];
+		uint32_t share = padded(gpu->n) / num_qpus * sizeof(uint32_t);
+		for (int i = 0; i < num_qpus; i++)
+			u[i] = (struct qb_map2_unifs){ .a = a + i * share, .b = b + i * share, .c = c + i * share, .qpu = i };
+		KERNEL_SET_UNIFS(qb_map2, ctx, &gpu->kernel, u, num_qpus);
+		gpu->kernel.code = gpu->special[num_qpus];
+		gpu->kernel.num_qpus = num_qpus;
+		return num_qpus;
+	}
+
+	struct addshader_unifs u[V3D_NUM_QPUS];
+	int used = gpu_partition(padded(gpu->n) / ADD_BLOCK, num_qpus, first, count);
+	for (int i = 0; i < used; i++)
+	{
+		uint32_t off = first[i] * ADD_BLOCK * sizeof(uint32_t);
+		u[i] = (struct addshader_unifs){ .blocks = count[i], .a = a + off, .b = b + off, .c = c + off, .qpu = i };
+	}
+	KERNEL_SET_UNIFS(addshader, ctx, &gpu->kernel, u, used);
+	gpu->kernel.code = gpu->generic;
+	gpu->kernel.num_qpus = used;
+	return used;
 }
 
-void vec_add_release(volatile struct addGPU *gpu)
+unsigned add_gpu_execute(struct addGPU *gpu)
 {
-	uint32_t handle = gpu->handle;
-	mem_unlock(handle);
-	mem_free(handle);
-	qpu_enable(0);
+	// code and uniforms are fixed at init; only A/B change between calls,
+	// and the TMU kernel reads them through the texture cache.
+	if (gpu->tex)
+		gpu_dirty(GPU_DIRTY_TEX);
+	return gpu_launch_resident(&gpu->kernel);
 }
 
-void vec_add_init(volatile struct addGPU **gpu, int n)
+void vec_add_release(struct addGPU *gpu)
 {
-	int ret = add_gpu_prepare(gpu);
+	// gpu_free would take anything allocated since with it.
+	assert(gpu->ctx->used == gpu->end);
+	gpu_free(gpu->ctx, gpu);
+}
+
+void vec_add_init(gpu_ctx_t *ctx, struct addGPU **gpu, int n, int num_qpus)
+{
+	int ret = add_gpu_prepare(ctx, gpu, n);
 	if (ret < 0)
 		return;
-
-	volatile struct addGPU *ptr = *gpu;
-	memcpy((void *)ptr->code, addshader, sizeof ptr->code);
-	for (int i=0; i<NUM_QPUS; i++) {
-	    ptr->unif[i][0] = N / (16*NUM_QPUS); // gpu->mail[0] - offsetof(struct GPU, code);
-	    ptr->unif[i][1] = GPU_BASE + (uint32_t)&ptr->A + i*N*4 / NUM_QPUS;
-	    ptr->unif[i][2] = GPU_BASE + (uint32_t)&ptr->B + i*N*4 / NUM_QPUS;
-	    ptr->unif[i][3] = GPU_BASE + (uint32_t)&ptr->C + i*N*4 / NUM_QPUS;
-	    ptr->unif[i][4] = i;
-	    ptr->unif_ptr[i] = GPU_BASE + (uint32_t)&ptr->unif[i];
-	}
+	vec_add_set_qpus(*gpu, num_qpus);
 }
 
-int vec_add_exec(volatile struct addGPU *gpu)
+int vec_add_exec(struct addGPU *gpu)
 {
 	int start_time = timer_get_usec();
-	int iret = add_gpu_execute(gpu);
+	if (add_gpu_execute(gpu) != 0)
+		return -1;
 	int end_time = timer_get_usec();
 
 	return end_time - start_time;
 }
-
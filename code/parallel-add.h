@@ -1,27 +1,48 @@
 #include "addshader.h"
 #include "rpi.h"
 #include <stdint.h>
+#include "max.h"
+#include "gpu-runtime.h"
 
-
-#define N 1048576
-#define NUM_QPUS 8
+// elements each QPU adds per kernel loop iteration (one VPM row).
+#define ADD_BLOCK 16
 
 
 
 struct addGPU
 {
-	uint32_t A[N];
-	uint32_t B[N];
-	uint32_t C[N];
-	uint32_t code[sizeof(addshader) / sizeof(uint32_t)];
-	uint32_t unif[NUM_QPUS][5];
-	uint32_t unif_ptr[NUM_QPUS];
-	uint32_t mail[2];
-	uint32_t handle;
+	volatile uint32_t *A;
+	volatile uint32_t *B;
+	volatile uint32_t *C;
+	int n;			// elements; A/B/C are padded to a whole block
+	gpu_kernel_t kernel;
+	uint32_t generic;	// bus address of addshader
+	uint32_t special[V3D_NUM_QPUS + 1]; // ... of the variant for n on that many QPUs, or 0
+	uint32_t built;	// ... of the kernel set_qpus builds for load, or 0
+	int load;		// QB_LOAD_*: the path the next set_qpus picks
+	int rows;		// VPM rows a QPU moves at a time in the built kernels; 0: the most that fit
+	int tex;		// the kernel reads A and B through the TMU cache
+	gpu_ctx_t *ctx;
+	uint32_t end;	// ctx->used after the last of its allocations
 };
 
-void vec_add_init(volatile struct addGPU **gpu, int n);
+// context bytes vec_add_init needs for an n-element add.
+uint32_t vec_add_size(int n);
+
+// Set up an n-element add on up to num_qpus (1..16) QPUs.
+void vec_add_init(gpu_ctx_t *ctx, struct addGPU **gpu, int n, int num_qpus);
+
+// Re-split the add over up to num_qpus QPUs; returns how many got work.
+// Loads A and B through the TMUs if load is QB_LOAD_TMU, or overlaps the
+// DMA with the arithmetic if it is QB_LOAD_PIPE, or moves 'rows' rows a
+// DMA if it is QB_LOAD_DMA; otherwise uses the kernel specialized to n on
+// exactly num_qpus QPUs if there is one.
+int vec_add_set_qpus(struct addGPU *gpu, int num_qpus);
 
-int vec_add_exec(volatile struct addGPU *gpu);
+// Launch the add; returns the usecs it took, or -1 if the launch failed.
+int vec_add_exec(struct addGPU *gpu);
 
-void vec_add_release(volatile struct addGPU *gpu);
\ No newline at end of file
+// Give back everything vec_add_init allocated.  Its context memory is
+// freed LIFO (gpu_free), so whatever was allocated in ctx after it must
+// be released first (checked).
+void vec_add_release(struct addGPU *gpu);
@@ -0,0 +1,741 @@
+#include "rpi.h"
+#include <string.h>
+#include "qpu-builder.h"
+
+// instructions between a VPM read setup and the first read.
+#define VPM_READ_DELAY 3
+
+#define NOP_LO (QPU_R_NOP << 18 | QPU_R_NOP << 12)
+#define NOP_HI(sig) ((uint32_t)(sig) << 28 | QPU_W_NOP << 6 | QPU_W_NOP)
+
+// how the operands of one instruction get in: the read addresses taken.
+typedef struct ports
+{
+	int a, b;	// -1: free
+	int small;	// b is a small immediate
+} ports_t;
+
+static int is_reg(qb_var_t v)
+{
+	return v >= 0 && v < 64;
+}
+
+static void put(qb_t *b, uint32_t lo, uint32_t hi, int wrote)
+{
+	if (b->err)
+		return;
+	if (b->n >= b->max)
+	{
+		b->err = 1;
+		return;
+	}
+	b->code[2 * b->n] = lo;
+	b->code[2 * b->n + 1] = hi;
+	b->n++;
+	b->last = wrote;
+}
+
+static void nop(qb_t *b)
+{
+	put(b, NOP_LO, NOP_HI(QPU_SIG_NONE), -1);
+}
+
+// the mux for 'v', taking a read address if it needs one; -1 if taken.
+static int port(ports_t *p, qb_var_t v)
+{
+	if (v >= QB_R(0) && v <= QB_R(5))
+		return v - QB_R(0);
+	if (v & 0x100)
+	{
+		if (p->b >= 0 && (!p->small || p->b != (v & 31)))
+			return -1;
+		p->b = v & 31;
+		p->small = 1;
+		return QPU_MUX_B;
+	}
+
+	int file = is_reg(v) ? v >= 32 : (v >> 6) & 3;
+	int addr = is_reg(v) ? v & 31 : v & 63;
+	if (file != 1 && (p->a < 0 || p->a == addr))
+	{
+		p->a = addr;
+		return QPU_MUX_A;
+	}
+	if (file != 0 && !p->small && (p->b < 0 || p->b == addr))
+	{
+		p->b = addr;
+		return QPU_MUX_B;
+	}
+	return -1;
+}
+
+// write address and file (0 A, 1 B, 2 either) of 'v'.
+static int dest(qb_var_t v, int *file)
+{
+	if (is_reg(v))
+	{
+		*file = v >= 32;
+		return v & 31;
+	}
+	if (v >= QB_R(0) && v <= QB_R(5))
+	{
+		*file = 2;
+		return QPU_W_R0 + v - QB_R(0);
+	}
+	*file = (v >> 6) & 3;
+	return v & 63;
+}
+
+// a nop first if 'x' or 'y' is what the last instruction wrote, and the
+// VPM read delay.
+static void before_read(qb_t *b, qb_var_t x, qb_var_t y)
+{
+	if (b->last >= 0 && (x == b->last || y == b->last))
+		nop(b);
+	while ((x == QB_VPM || y == QB_VPM) && b->n < b->vpm_ready && !b->err)
+		nop(b);
+}
+
+void qb_init(qb_t *b, uint32_t *code, int max)
+{
+	memset(b, 0, sizeof *b);
+	b->code = code;
+	b->max = max;
+	b->last = -1;
+}
+
+int qb_init_gpu(qb_t *b, gpu_ctx_t *ctx, int max)
+{
+	uint32_t *code = (uint32_t *)gpu_alloc(ctx, 8 * max, 8);
+
+	qb_init(b, code, max);
+	b->ctx = ctx;
+	if (!code)
+		b->err = 1;
+	return code ? 0 : -1;
+}
+
+int qb_kernel_init(qb_t *b, gpu_ctx_t *ctx, gpu_kernel_t *k, int num_qpus)
+{
+	memset(k, 0, sizeof *k);
+	if (b->err || num_qpus <= 0 || num_qpus > V3D_NUM_QPUS)
+		return -1;
+	if (b->ctx != ctx)
+		return gpu_kernel_init(ctx, k, b->code, 8 * b->n, num_qpus);
+	k->code = gpu_bus(ctx, b->code);
+	k->num_qpus = num_qpus;
+	gpu_dirty(GPU_DIRTY_CODE);
+	return 0;
+}
+
+qb_var_t qb_var(qb_t *b)
+{
+	for (int t = 0; t < 2; t++, b->next_b = !b->next_b)
+	{
+		uint32_t *used = b->next_b ? &b->used_b : &b->used;
+		for (int r = 0; r < 32; r++)
+			if (!(*used & 1u << r))
+			{
+				*used |= 1u << r;
+				qb_var_t v = b->next_b ? QB_B(r) : QB_A(r);
+				b->next_b = !b->next_b;
+				return v;
+			}
+	}
+	b->err = 1;
+	return QB_NONE;
+}
+
+void qb_free(qb_t *b, qb_var_t v)
+{
+	if (is_reg(v))
+		*(v >= 32 ? &b->used_b : &b->used) &= ~(1u << (v & 31));
+}
+
+qb_var_t qb_uniform(qb_t *b)
+{
+	qb_var_t v = qb_var(b);
+	qb_mov(b, v, QB_UNIF);
+	b->nunifs++;
+	return v;
+}
+
+// the VPM slot of the map kernels: the index uniform, or the QPU number
+// if b->qpu_num is set (the uniform is read either way).
+static qb_var_t vpm_slot(qb_t *b)
+{
+	qb_var_t q = qb_uniform(b);
+	if (b->qpu_num)
+		qb_mov(b, q, QB_QPU_NUM);
+	return q;
+}
+
+// QB_MUL32: with x = xh << 24 | xl and y likewise, x * y mod 2^32 is
+// xl * yl + ((xh * yl + xl * yh) << 24), and mul24 only sees xl and yl.
+static void mul32(qb_t *b, unsigned flags, qb_var_t d, qb_var_t x, qb_var_t y)
+{
+	// shifts use the low 5 bits: -8 is 24.
+	qb_op(b, QPU_A_SHR, 0, QB_R(2), x, QB_IMM(-8));
+	qb_op(b, QB_MUL24, 0, QB_R(2), QB_R(2), y);
+	qb_op(b, QPU_A_SHR, 0, QB_R(3), y, QB_IMM(-8));
+	qb_op(b, QB_MUL24, 0, QB_R(3), x, QB_R(3));
+	qb_op(b, QPU_A_ADD, 0, QB_R(2), QB_R(2), QB_R(3));
+	qb_op(b, QPU_A_SHL, 0, QB_R(2), QB_R(2), QB_IMM(-8));
+	qb_op(b, QB_MUL24, 0, QB_R(3), x, y);
+	qb_op(b, QPU_A_ADD, flags, d, QB_R(3), QB_R(2));
+}
+
+void qb_op(qb_t *b, int op, unsigned flags, qb_var_t d, qb_var_t x, qb_var_t y)
+{
+	ports_t p = { -1, -1, 0 };
+	int mul = op >= 32;
+
+	if (b->err)
+		return;
+	if (op == QB_MUL32)
+	{
+		mul32(b, flags, d, x, y);
+		return;
+	}
+	if (op == QPU_A_FTOI || op == QPU_A_ITOF || op == QPU_A_NOT || op == QPU_A_CLZ)
+		y = x;
+	int mx = port(&p, x), my = port(&p, y);
+	if (mx < 0)
+	{
+		b->err = 1;
+		return;
+	}
+	if (my < 0)
+	{
+		// two registers from one file: the second goes through r3.
+		qb_mov(b, QB_R(3), y);
+		qb_op(b, op, flags, d, x, QB_R(3));
+		return;
+	}
+	before_read(b, x, y);
+
+	int file, waddr = dest(d, &file);
+	int cond = flags >> 9 & 7 ? flags >> 9 & 7 : QPU_COND_ALWAYS;
+	// ws=0 sends the add result to file A and the mul result to B.
+	int ws = file == 2 ? 0 : mul ? file == 0 : file == 1;
+	uint32_t sig = p.small ? QPU_SIG_SMALL_IMM : QPU_SIG_NONE;
+	uint32_t raddr_a = p.a >= 0 ? p.a : QPU_R_NOP, raddr_b = p.b >= 0 ? p.b : QPU_R_NOP;
+	uint32_t lo = raddr_a << 18 | raddr_b << 12, hi = sig << 28 | !!(flags & QB_SETF) << 13 | ws << 12;
+
+	if (mul)
+	{
+		lo |= (op - 32) << 29 | mx << 3 | my;
+		hi |= QPU_COND_NEVER << 17 | cond << 14 | QPU_W_NOP << 6 | waddr;
+	}
+	else
+	{
+		lo |= op << 24 | mx << 9 | my << 6;
+		hi |= cond << 17 | QPU_COND_NEVER << 14 | waddr << 6 | QPU_W_NOP;
+	}
+	put(b, lo, hi, is_reg(d) ? d : -1);
+}
+
+void qb_mov(qb_t *b, qb_var_t d, qb_var_t x)
+{
+	qb_op(b, QPU_A_OR, 0, d, x, x);
+}
+
+void qb_ldi(qb_t *b, qb_var_t d, uint32_t imm)
+{
+	int file, waddr = dest(d, &file);
+
+	put(b, imm, (uint32_t)QPU_SIG_LOAD_IMM << 28 | QPU_LDI_32 << 25 | QPU_COND_ALWAYS << 17
+		| QPU_COND_NEVER << 14 | (file == 1) << 12 | waddr << 6 | QPU_W_NOP, is_reg(d) ? d : -1);
+}
+
+void qb_reduce(qb_t *b, int op, qb_var_t d, qb_var_t x)
+{
+	qb_mov(b, QB_R(2), x);
+	for (int s = 8; s >= 1; s /= 2)
+	{
+		// r3 = r2 rotated by s lanes (v8min of a value with itself), which
+		// needs r2 unwritten by the instruction before.
+		nop(b);
+		put(b, QPU_M_V8MIN << 29 | QPU_R_NOP << 18 | (48 + s) << 12 | QPU_MUX_R2 << 3 | QPU_MUX_R2,
+			(uint32_t)QPU_SIG_SMALL_IMM << 28 | QPU_COND_NEVER << 17 | QPU_COND_ALWAYS << 14
+			| QPU_W_NOP << 6 | QPU_W_R3, -1);
+		qb_op(b, op, 0, QB_R(2), QB_R(2), QB_R(3));
+	}
+	qb_mov(b, d, QB_R(2));
+}
+
+void qb_ldtmu(qb_t *b, int tmu)
+{
+	uint32_t sig = QPU_SIG_LOAD_TMU0 + tmu;
+	uint32_t *hi = &b->code[2 * b->n - 1];
+
+	// the last instruction still reads the old r4, so it can load the new one.
+	if (!b->err && b->n > b->label && QPU_SIG((uint64_t)*hi << 32) == QPU_SIG_NONE)
+		*hi = (*hi & 0x0fffffff) | sig << 28;
+	else
+		put(b, NOP_LO, NOP_HI(sig), -1);
+}
+
+int qb_label(qb_t *b)
+{
+	b->label = b->n;
+	return b->n;
+}
+
+void qb_branch(qb_t *b, int cond, int label)
+{
+	put(b, 8 * (label - (b->n + 4)), (uint32_t)QPU_SIG_BRANCH << 28 | cond << 20 | 1 << 19
+		| QPU_W_NOP << 6 | QPU_W_NOP, -1);
+	for (int i = 0; i < QPU_BRANCH_DELAY; i++)
+		nop(b);
+	// the delay slots run on both paths.
+	b->label = b->n;
+}
+
+int qb_branch_fwd(qb_t *b, int cond)
+{
+	int at = b->n;
+	qb_branch(b, cond, at + 4);
+	return at;
+}
+
+void qb_patch(qb_t *b, int at, int label)
+{
+	if (!b->err)
+		b->code[2 * at] = 8 * (label - (at + 4));
+}
+
+void qb_loop_while(qb_t *b, qb_var_t counter, int label)
+{
+	qb_op(b, QPU_A_SUB, QB_SETF, counter, counter, QB_IMM(1));
+	qb_branch(b, QPU_BR_ANYNZ, label);
+}
+
+// reg = setup with 'row' (a var or QB_IMM) shifted into place.
+static void setup(qb_t *b, qb_var_t reg, uint32_t setup, qb_var_t row, int shift)
+{
+	if (row & 0x100)
+	{
+		int r = row & 31;
+		qb_ldi(b, reg, setup + ((uint32_t)(r >= 16 ? r - 32 : r) << shift));
+		return;
+	}
+	// the shift first: a B register shifted by an immediate goes through r3.
+	if (shift)
+	{
+		qb_op(b, QPU_A_SHL, 0, QB_R(2), row, QB_IMM(shift));
+		row = QB_R(2);
+	}
+	qb_ldi(b, QB_R(3), setup);
+	qb_op(b, QPU_A_ADD, 0, reg, row, QB_R(3));
+}
+
+void qb_dma_load_start(qb_t *b, qb_var_t addr, qb_var_t row, int nrows, int vpitch)
+{
+	// 16-word rows, 64 bytes apart in memory (vdr_setup_1(64), vdr_setup_0).
+	qb_ldi(b, QB_VR_SETUP, 0x90000000 | 64);
+	setup(b, QB_VR_SETUP, 0x80000000 | (nrows & 0xf) << 16 | (vpitch & 0xf) << 12, row, 4);
+	qb_mov(b, QB_VR_ADDR, addr);
+}
+
+void qb_dma_load(qb_t *b, qb_var_t addr, qb_var_t row, int nrows, int vpitch)
+{
+	qb_dma_load_start(b, addr, row, nrows, vpitch);
+	qb_mov(b, QB_NONE, QB_VR_WAIT);
+}
+
+void qb_dma_store_start(qb_t *b, qb_var_t addr, qb_var_t row, int nrows)
+{
+	// vdw_setup_0(nrows, 16, dma_h32(row, 0))
+	setup(b, QB_VW_SETUP, 0x80000000 | (nrows & 0x7f) << 23 | 16 << 16 | 0x4000, row, 7);
+	qb_mov(b, QB_VW_ADDR, addr);
+}
+
+void qb_dma_store(qb_t *b, qb_var_t addr, qb_var_t row, int nrows)
+{
+	qb_dma_store_start(b, addr, row, nrows);
+	qb_mov(b, QB_NONE, QB_VW_WAIT);
+}
+
+void qb_vpm_read_setup(qb_t *b, qb_var_t row, int nrows)
+{
+	// vpm_setup(nrows, 1, h32(row))
+	setup(b, QB_VR_SETUP, (nrows & 0xf) << 20 | 1 << 12 | 0xa00, row, 0);
+	b->vpm_ready = b->n + VPM_READ_DELAY;
+}
+
+void qb_vpm_write_setup(qb_t *b, qb_var_t row, int nrows)
+{
+	setup(b, QB_VW_SETUP, (nrows & 0xf) << 20 | 1 << 12 | 0xa00, row, 0);
+}
+
+void qb_end(qb_t *b)
+{
+	qb_mov(b, QB_HOST_INT, QB_IMM(1));
+	put(b, NOP_LO, NOP_HI(QPU_SIG_PROG_END), -1);
+	for (int i = 0; i < QPU_END_DELAY; i++)
+		nop(b);
+}
+
+// d = x + c
+static void add_const(qb_t *b, qb_var_t d, qb_var_t x, uint32_t c)
+{
+	if (c < 16)
+		qb_op(b, QPU_A_ADD, 0, d, x, QB_IMM(c));
+	else
+	{
+		qb_ldi(b, QB_R(3), c);
+		qb_op(b, QPU_A_ADD, 0, d, x, QB_R(3));
+	}
+}
+
+int qb_map2_rows(int num_qpus)
+{
+	// A and B interleaved, then C; one read stream covers A and B (16 rows).
+	int k = 64 / (3 * num_qpus);
+	return k > 8 ? 8 : k;
+}
+
+// d = x op y in the map kernels, which read each VPM word once: QB_MUL32
+// reads its operands twice, so takes them from r0 and r1.
+static void map_op(qb_t *b, int op, qb_var_t d, qb_var_t x, qb_var_t y)
+{
+	if (op == QB_MUL32 && x == QB_VPM)
+	{
+		qb_mov(b, QB_R(0), x);
+		x = QB_R(0);
+	}
+	if (op == QB_MUL32 && y == QB_VPM)
+	{
+		qb_mov(b, QB_R(1), y);
+		y = QB_R(1);
+	}
+	qb_op(b, op, 0, d, x, y);
+}
+
+/*
+ * C[i] = f(inputs) for qb_map2, qb_map1s and qb_fma: 'nin' input vectors
+ * interleaved in the VPM, then C.  One input is op with a uniform scalar,
+ * two are op, three are op(A, B) op2 D.
+ */
+static void map(qb_t *b, int nin, int op, int op2, int rows, uint32_t blocks)
+{
+	int k = rows;
+	qb_var_t n = !blocks ? qb_uniform(b) : blocks > 1 ? qb_var(b) : QB_NONE;
+	qb_var_t in[3], s = QB_NONE, row[3];
+
+	for (int i = 0; i < nin; i++)
+		in[i] = qb_uniform(b);
+	if (nin == 1)
+		s = qb_uniform(b);
+	qb_var_t c = qb_uniform(b), q = vpm_slot(b);
+	for (int i = 0; i < nin; i++)
+		row[i] = qb_var(b);
+	qb_var_t row_c = qb_var(b);
+
+	if (blocks > 1)
+		qb_ldi(b, n, blocks);
+	qb_ldi(b, QB_R(3), (nin + 1) * k);
+	qb_op(b, QB_MUL24, 0, row[0], q, QB_R(3));
+	for (int i = 1; i < nin; i++)
+		add_const(b, row[i], row[0], i);
+	add_const(b, row_c, row[0], nin * k);
+
+	int top = qb_label(b);
+	for (int i = 0; i < nin; i++)
+		qb_dma_load(b, in[i], row[i], k, nin);
+	if (blocks != 1)
+		for (int i = 0; i < nin; i++)
+			add_const(b, in[i], in[i], 64 * k);
+	qb_vpm_read_setup(b, row[0], nin * k);
+	qb_vpm_write_setup(b, row_c, k);
+	// unrolled over the block's rows.
+	for (int i = 0; i < k; i++)
+	{
+		if (nin == 1)
+			map_op(b, op, QB_VPM, QB_VPM, s);
+		else if (nin == 2)
+		{
+			qb_mov(b, QB_R(0), QB_VPM);
+			map_op(b, op, QB_VPM, QB_R(0), QB_VPM);
+		}
+		else
+		{
+			qb_mov(b, QB_R(0), QB_VPM);
+			qb_mov(b, QB_R(1), QB_VPM);
+			qb_op(b, op, 0, QB_R(0), QB_R(0), QB_R(1));
+			qb_op(b, op2, 0, QB_VPM, QB_R(0), QB_VPM);
+		}
+	}
+	qb_dma_store(b, c, row_c, k);
+	// a single block needs no loop.
+	if (blocks != 1)
+	{
+		add_const(b, c, c, 64 * k);
+		qb_loop_while(b, n, top);
+	}
+	qb_end(b);
+}
+
+void qb_map2(qb_t *b, int op, int rows, uint32_t blocks)
+{
+	map(b, 2, op, 0, rows, blocks);
+}
+
+int qb_map1s_rows(int num_qpus)
+{
+	int k = 64 / (2 * num_qpus);
+	return k > 16 ? 16 : k;
+}
+
+void qb_map1s(qb_t *b, int op, int rows, uint32_t blocks)
+{
+	map(b, 1, op, 0, rows, blocks);
+}
+
+int qb_fma_rows(int num_qpus)
+{
+	// the three inputs are read in one go, at most 16 rows.
+	int k = 64 / (4 * num_qpus);
+	return k > 5 ? 5 : k;
+}
+
+void qb_fma(qb_t *b, int rows, uint32_t blocks)
+{
+	map(b, 3, QB_FMUL, QPU_A_FADD, rows, blocks);
+}
+
+int qb_map2_pipe_rows(int num_qpus)
+{
+	// two buffers of A and B interleaved; C goes over them.
+	int k = 64 / (4 * num_qpus);
+	return k > 8 ? 8 : k;
+}
+
+void qb_map2_pipe(qb_t *b, int op, int rows, uint32_t blocks)
+{
+	int k = rows, more = blocks != 1;
+	qb_var_t n = !blocks ? qb_uniform(b) : blocks > 1 ? qb_var(b) : QB_NONE;
+	qb_var_t a = qb_uniform(b), bb = qb_uniform(b), c = qb_uniform(b), q = vpm_slot(b);
+	qb_var_t cur = qb_var(b), next = qb_var(b), sum = qb_var(b);
+
+	if (blocks > 1)
+		qb_ldi(b, n, blocks);
+	qb_ldi(b, QB_R(3), 4 * k);
+	qb_op(b, QB_MUL24, 0, cur, q, QB_R(3));
+	add_const(b, next, cur, 2 * k);
+	// cur + next: the buffers swap by subtracting from it.
+	qb_op(b, QPU_A_ADD, 0, sum, cur, next);
+
+	qb_dma_load_start(b, a, cur, k, 2);
+	qb_mov(b, QB_NONE, QB_VR_WAIT);
+	add_const(b, QB_R(1), cur, 1);
+	qb_dma_load_start(b, bb, QB_R(1), k, 2);
+
+	int top = qb_label(b);
+	if (more)
+	{
+		// the last block loads itself again instead of reading past the end.
+		qb_op(b, QPU_A_SUB, QB_SETF, QB_NONE, n, QB_IMM(1));
+		qb_ldi(b, QB_R(3), 64 * k);
+		qb_op(b, QPU_A_ADD, QB_IF(QPU_COND_ZC), a, a, QB_R(3));
+		qb_op(b, QPU_A_ADD, QB_IF(QPU_COND_ZC), bb, bb, QB_R(3));
+	}
+	// this block's B is in; the last block's C is out of the other buffer.
+	qb_mov(b, QB_NONE, QB_VR_WAIT);
+	qb_mov(b, QB_NONE, QB_VW_WAIT);
+	if (more)
+		qb_dma_load_start(b, a, next, k, 2);
+	qb_vpm_read_setup(b, cur, 2 * k);
+	qb_vpm_write_setup(b, cur, k);
+	for (int i = 0; i < k; i++)
+	{
+		qb_mov(b, QB_R(0), QB_VPM);
+		map_op(b, op, QB_VPM, QB_R(0), QB_VPM);
+	}
+	if (more)
+	{
+		qb_mov(b, QB_NONE, QB_VR_WAIT);
+		add_const(b, QB_R(1), next, 1);
+		qb_dma_load_start(b, bb, QB_R(1), k, 2);
+	}
+	qb_dma_store_start(b, c, cur, k);
+	if (more)
+	{
+		add_const(b, c, c, 64 * k);
+		qb_op(b, QPU_A_SUB, 0, cur, sum, cur);
+		qb_op(b, QPU_A_SUB, 0, next, sum, next);
+		qb_loop_while(b, n, top);
+	}
+	// nothing may be in flight at the end.
+	qb_mov(b, QB_NONE, QB_VW_WAIT);
+	qb_mov(b, QB_NONE, QB_VR_WAIT);
+	qb_end(b);
+}
+
+int qb_map2_tmu_rows(int num_qpus)
+{
+	// only C is in the VPM.
+	int k = 64 / num_qpus;
+	return k > 16 ? 16 : k;
+}
+
+void qb_map2_tmu(qb_t *b, int op, int rows, uint32_t blocks)
+{
+	int k = rows;
+	qb_var_t n = !blocks ? qb_uniform(b) : blocks > 1 ? qb_var(b) : QB_NONE;
+	qb_var_t a = qb_uniform(b), bb = qb_uniform(b), c = qb_uniform(b), q = vpm_slot(b);
+	// a and bb are in different files: step in r1 is read with either.
+	qb_var_t row_c = qb_var(b), step = QB_R(1);
+
+	if (blocks > 1)
+		qb_ldi(b, n, blocks);
+	qb_ldi(b, QB_R(3), k);
+	qb_op(b, QB_MUL24, 0, row_c, q, QB_R(3));
+	qb_ldi(b, step, 64);
+	// lane i looks up word i of each row.
+	qb_op(b, QPU_A_SHL, 0, QB_R(0), QB_ELEM_NUM, QB_IMM(2));
+	qb_op(b, QPU_A_ADD, 0, a, a, QB_R(0));
+	qb_op(b, QPU_A_ADD, 0, bb, bb, QB_R(0));
+	qb_mov(b, QB_TMU0_S, a);
+	qb_mov(b, QB_TMU1_S, bb);
+
+	int top = qb_label(b);
+	qb_vpm_write_setup(b, row_c, k);
+	for (int i = 0; i < k; i++)
+	{
+		// ask for the next row, then use this one.  The last row of the
+		// last block asks for itself again instead of reading past the end.
+		unsigned cond = 0;
+		if (i == k - 1 && blocks != 1)
+		{
+			qb_op(b, QPU_A_SUB, QB_SETF, QB_NONE, n, QB_IMM(1));
+			cond = QB_IF(QPU_COND_ZC);
+		}
+		if (i < k - 1 || blocks != 1)
+		{
+			qb_op(b, QPU_A_ADD, cond, a, a, step);
+			qb_op(b, QPU_A_ADD, cond, bb, bb, step);
+		}
+		qb_mov(b, QB_TMU0_S, a);
+		qb_mov(b, QB_TMU1_S, bb);
+		qb_ldtmu(b, 0);
+		qb_mov(b, QB_R(0), QB_R(4));
+		qb_ldtmu(b, 1);
+		qb_op(b, op, 0, QB_VPM, QB_R(0), QB_R(4));
+	}
+	qb_dma_store(b, c, row_c, k);
+	if (blocks != 1)
+	{
+		add_const(b, c, c, 64 * k);
+		qb_loop_while(b, n, top);
+	}
+	// nothing may be left in the TMU FIFOs at the end.
+	qb_ldtmu(b, 0);
+	qb_ldtmu(b, 1);
+	qb_end(b);
+}
+
+void qb_fold(qb_t *b, int op, uint32_t blocks)
+{
+	qb_var_t n = blocks ? qb_var(b) : qb_uniform(b);
+	qb_var_t a = qb_uniform(b), out = qb_uniform(b), row = qb_uniform(b), s = qb_var(b);
+
+	if (blocks)
+		qb_ldi(b, n, blocks);
+	// the first block starts the fold; the loop does the rest.
+	qb_dma_load(b, a, row, 1, 1);
+	qb_vpm_read_setup(b, row, 1);
+	qb_mov(b, s, QB_VPM);
+	add_const(b, a, a, 64);
+	qb_op(b, QPU_A_SUB, QB_SETF, n, n, QB_IMM(1));
+	int done = qb_branch_fwd(b, QPU_BR_ALLZ);
+
+	int top = qb_label(b);
+	qb_dma_load(b, a, row, 1, 1);
+	qb_vpm_read_setup(b, row, 1);
+	qb_op(b, op, 0, s, s, QB_VPM);
+	add_const(b, a, a, 64);
+	qb_loop_while(b, n, top);
+
+	qb_patch(b, done, qb_label(b));
+	qb_reduce(b, op, s, s);
+	qb_vpm_write_setup(b, row, 1);
+	qb_mov(b, QB_VPM, s);
+	qb_dma_store(b, out, row, 1);
+	qb_end(b);
+}
+
+void qb_mandelbrot(qb_t *b, int res, uint32_t step, int max_iter, int num_qpus)
+{
+	// iterations per trip round the inner loop.
+	int unroll = max_iter % 4 == 0 ? 4 : max_iter % 2 == 0 ? 2 : 1;
+	qb_var_t q = qb_uniform(b), addr = qb_uniform(b);
+	qb_var_t inc = qb_var(b), m1 = qb_var(b), four = qb_var(b), two = qb_var(b);
+	qb_var_t i = qb_var(b), j = qb_var(b), y = qb_var(b), row = qb_var(b);
+	qb_var_t u2 = qb_var(b), v2 = qb_var(b), out = qb_var(b), x = qb_var(b);
+	qb_var_t n = qb_var(b), dst = qb_var(b);
+	qb_var_t u = QB_R(0), v = QB_R(1);
+
+	qb_ldi(b, inc, step);
+	qb_ldi(b, m1, 0xbf800000);	// -1.0
+	qb_ldi(b, four, 0x40800000);
+	qb_ldi(b, two, 0x40000000);
+	qb_mov(b, i, q);
+
+	int row_loop = qb_label(b);
+	// y = -1 + i / res, and this row's words.
+	qb_op(b, QPU_A_ITOF, 0, QB_R(0), i, i);
+	qb_op(b, QB_FMUL, 0, QB_R(0), QB_R(0), inc);
+	qb_op(b, QPU_A_FADD, 0, y, QB_R(0), m1);
+	qb_ldi(b, QB_R(3), 8 * res);
+	qb_op(b, QB_MUL24, 0, QB_R(0), i, QB_R(3));
+	qb_op(b, QPU_A_ADD, 0, row, addr, QB_R(0));
+	qb_mov(b, j, QB_IMM(0));
+
+	int column_loop = qb_label(b);
+	qb_op(b, QPU_A_ADD, 0, QB_R(0), j, QB_ELEM_NUM);
+	qb_op(b, QPU_A_ITOF, 0, QB_R(0), QB_R(0), QB_R(0));
+	qb_op(b, QB_FMUL, 0, QB_R(0), QB_R(0), inc);
+	qb_op(b, QPU_A_FADD, 0, x, QB_R(0), m1);
+	qb_mov(b, u, QB_IMM(0));
+	qb_mov(b, v, QB_IMM(0));
+	qb_mov(b, u2, QB_IMM(0));
+	qb_mov(b, v2, QB_IMM(0));
+	qb_mov(b, out, QB_IMM(0));
+	qb_ldi(b, n, max_iter / unroll);
+
+	int inner_loop = qb_label(b);
+	for (int k = 0; k < unroll; k++)
+	{
+		// the float ops of mandelbrot.qasm, in its order.
+		qb_op(b, QB_FMUL, 0, v, v, two);
+		qb_op(b, QB_FMUL, 0, v, v, u);
+		qb_op(b, QPU_A_FADD, 0, v, v, y);
+		qb_op(b, QPU_A_FADD, 0, u, u2, x);
+		qb_op(b, QPU_A_FSUB, 0, u, u, v2);
+		qb_op(b, QB_FMUL, 0, u2, u, u);
+		qb_op(b, QB_FMUL, 0, v2, v, v);
+		qb_op(b, QPU_A_FADD, 0, QB_R(2), u2, v2);
+		qb_op(b, QPU_A_FSUB, QB_SETF, QB_NONE, four, QB_R(2));
+		qb_op(b, QPU_A_OR, QB_IF(QPU_COND_NS), out, QB_IMM(1), QB_IMM(1));
+	}
+	qb_loop_while(b, n, inner_loop);
+
+	qb_vpm_write_setup(b, q, 1);
+	qb_mov(b, QB_VPM, out);
+	qb_op(b, QPU_A_SHL, 0, QB_R(0), j, QB_IMM(2));
+	qb_op(b, QPU_A_ADD, 0, dst, row, QB_R(0));
+	qb_dma_store(b, dst, q, 1);
+
+	add_const(b, j, j, 16);
+	qb_ldi(b, QB_R(3), 2 * res);
+	qb_op(b, QPU_A_SUB, QB_SETF, QB_NONE, j, QB_R(3));
+	qb_branch(b, QPU_BR_ANYC, column_loop);
+
+	add_const(b, i, i, num_qpus);
+	qb_ldi(b, QB_R(3), 2 * res);
+	qb_op(b, QPU_A_SUB, QB_SETF, QB_NONE, i, QB_R(3));
+	qb_branch(b, QPU_BR_ANYC, row_loop);
+	qb_end(b);
+}
@@ -0,0 +1,225 @@
+#ifndef QPU_BUILDER_H
+#define QPU_BUILDER_H
+
+#include <stdint.h>
+#include "qpu-isa.h"
+#include "gpu-runtime.h"
+
+/*
+ * QPU kernel builder: emits VideoCore IV code at run time, so kernels can
+ * be specialized on problem size, QPU count and element type without
+ * going through vc4asm.
+ *
+ * Kernels are written as C calls on "vars": registers the builder hands
+ * out from files A and B in turn, accumulators r0/r1, and the special
+ * registers below.  The builder takes care of what vc4asm leaves to the
+ * author: a regfile register read by the instruction after the one that
+ * wrote it gets a nop in between, and an instruction that needs two
+ * registers from one file moves one of them through r3 first.  r2 and r3
+ * belong to the builder.
+ *
+ *	qb_t b;
+ *	qb_init_gpu(&b, &ctx, 256);
+ *	qb_var_t n = qb_uniform(&b), p = qb_uniform(&b), x = qb_var(&b);
+ *	int top = qb_label(&b);
+ *	    ...
+ *	qb_loop_while(&b, n, top);	// --n, back to top while n != 0
+ *	qb_end(&b);
+ *	qb_kernel_init(&b, &ctx, &k, num_qpus);
+ *
+ * Errors (out of code space or registers, bad operands) are sticky: the
+ * calls after one do nothing, and qb_kernel_init returns -1.
+ */
+
+typedef int qb_var_t;
+
+#define QB_A(n) (n)			// regfile A register
+#define QB_B(n) (32 + (n))		// regfile B register
+#define QB_R(k) (64 + (k))		// accumulator
+#define QB_IMM(i) (0x100 | ((i) & 31))	// small immediate, -16..15
+#define QB_SPECIAL(file, addr) (0x200 | (file) << 6 | (addr)) // file 0 A, 1 B, 2 either
+
+#define QB_NONE QB_SPECIAL(2, QPU_W_NOP)
+#define QB_UNIF QB_SPECIAL(2, QPU_R_UNIF)
+#define QB_VPM QB_SPECIAL(2, QPU_R_VPM)
+#define QB_ELEM_NUM QB_SPECIAL(0, QPU_R_ELEM_QPU)
+#define QB_QPU_NUM QB_SPECIAL(1, QPU_R_ELEM_QPU)
+#define QB_VR_WAIT QB_SPECIAL(0, QPU_R_VPM_WAIT)
+#define QB_VW_WAIT QB_SPECIAL(1, QPU_R_VPM_WAIT)
+#define QB_VR_SETUP QB_SPECIAL(0, QPU_W_VPM_SETUP)
+#define QB_VW_SETUP QB_SPECIAL(1, QPU_W_VPM_SETUP)
+#define QB_VR_ADDR QB_SPECIAL(0, QPU_W_VPM_ADDR)
+#define QB_VW_ADDR QB_SPECIAL(1, QPU_W_VPM_ADDR)
+#define QB_HOST_INT QB_SPECIAL(2, QPU_W_HOST_INT)
+#define QB_TMU0_S QB_SPECIAL(2, QPU_W_TMU0_S)	// per-lane address: a TMU memory lookup
+#define QB_TMU1_S QB_SPECIAL(2, QPU_W_TMU1_S)
+
+// operations: add pipe ops are QPU_A_*, mul pipe ops QB_MUL(QPU_M_*).
+#define QB_MUL(op) (32 + (op))
+#define QB_FMUL QB_MUL(QPU_M_FMUL)
+#define QB_MUL24 QB_MUL(QPU_M_MUL24)
+// x * y on all 32 bits, from three mul24s: eight instructions through r2
+// and r3, and x and y are each read twice (so neither may be QB_VPM).
+#define QB_MUL32 64
+
+// flags for qb_op: set the flags, write only where 'cond' (QPU_COND_*) holds.
+#define QB_SETF (1 << 8)
+#define QB_IF(cond) ((cond) << 9)
+
+typedef struct qb
+{
+	uint32_t *code;		// two words per instruction, low word first
+	int n, max;		// instructions
+	int nunifs;		// uniforms the kernel reads
+	uint32_t used;		// regfile registers handed out: A in bits 0-31 ...
+	uint32_t used_b;	// ... B here
+	int next_b;		// file the next var comes from
+	int last;		// regfile register the last instruction wrote, or -1
+	int vpm_ready;		// first instruction that may read the VPM
+	int label;		// the last label or branch target: signals stay after it
+	int err;
+	int qpu_num;		// the map kernels' VPM rows follow the QPU number, not the index
+	gpu_ctx_t *ctx;		// qb_init_gpu: the context the code is in
+} qb_t;
+
+// Build into 'code', which has room for 'max' instructions.
+void qb_init(qb_t *b, uint32_t *code, int max);
+// Build straight into a code buffer allocated from 'ctx'.
+int qb_init_gpu(qb_t *b, gpu_ctx_t *ctx, int max);
+/*
+ * Set up 'k' to run the finished kernel on 'num_qpus' QPUs: in place if
+ * qb_init_gpu put the code in 'ctx', else copied into it.  Returns 0, or -1
+ * if the build failed or the copy did not fit.
+ */
+int qb_kernel_init(qb_t *b, gpu_ctx_t *ctx, gpu_kernel_t *k, int num_qpus);
+
+// A fresh regfile register, or a register back to the pool.
+qb_var_t qb_var(qb_t *b);
+void qb_free(qb_t *b, qb_var_t v);
+// A fresh register holding the next uniform.
+qb_var_t qb_uniform(qb_t *b);
+
+// d = x op y, op an add pipe op QPU_A_* or QB_MUL(QPU_M_*), with QB_SETF/QB_IF flags.
+void qb_op(qb_t *b, int op, unsigned flags, qb_var_t d, qb_var_t x, qb_var_t y);
+void qb_mov(qb_t *b, qb_var_t d, qb_var_t x);
+// d = imm, any 32-bit value (a load immediate).
+void qb_ldi(qb_t *b, qb_var_t d, uint32_t imm);
+/*
+ * Every lane of d = op over the 16 lanes of x, op one of QPU_A_ADD,
+ * QPU_A_FADD, QPU_A_MIN, QPU_A_MAX, QPU_A_FMIN, QPU_A_FMAX.  Uses r2, r3.
+ */
+void qb_reduce(qb_t *b, int op, qb_var_t d, qb_var_t x);
+
+/*
+ * r4 = the oldest lookup on TMU 'tmu' (0 or 1) not loaded yet, from the
+ * instruction after the ones so far on.  The signal goes on the last
+ * instruction if it can take one.
+ */
+void qb_ldtmu(qb_t *b, int tmu);
+
+// Control flow: a label is the index of the next instruction.
+int qb_label(qb_t *b);
+// Branch to 'label' on QPU_BR_* 'cond'; the delay slots are nops.
+void qb_branch(qb_t *b, int cond, int label);
+// Forward branch to a label not yet known: returns what qb_patch needs.
+int qb_branch_fwd(qb_t *b, int cond);
+void qb_patch(qb_t *b, int at, int label);
+// --counter; branch back to 'label' while it is not zero.
+void qb_loop_while(qb_t *b, qb_var_t counter, int label);
+
+/*
+ * VPM and DMA, on 16-word rows; 'row' is a var or QB_IMM holding the first
+ * VPM row.  Loads put row i of memory in VPM row row + i * vpitch; both
+ * wait for the DMA to finish.  Reads of QB_VPM are kept three
+ * instructions after their setup.
+ *
+ * The _start versions leave the DMA running: read QB_VR_WAIT (QB_VW_WAIT)
+ * before using those rows or starting another load (store).
+ */
+void qb_dma_load(qb_t *b, qb_var_t addr, qb_var_t row, int nrows, int vpitch);
+void qb_dma_store(qb_t *b, qb_var_t addr, qb_var_t row, int nrows);
+void qb_dma_load_start(qb_t *b, qb_var_t addr, qb_var_t row, int nrows, int vpitch);
+void qb_dma_store_start(qb_t *b, qb_var_t addr, qb_var_t row, int nrows);
+void qb_vpm_read_setup(qb_t *b, qb_var_t row, int nrows);
+void qb_vpm_write_setup(qb_t *b, qb_var_t row, int nrows);
+
+// End the program: signal the host, then thrend.
+void qb_end(qb_t *b);
+
+/*
+ * Ready-made kernels.
+ *
+ * qb_map2: C[i] = A[i] op B[i] on 32-bit elements, op as for qb_op (the
+ * element type follows from it: QPU_A_FADD/QB_FMUL for floats, ...).  Each
+ * QPU streams 'rows' VPM rows (16 elements each) of A, B and C at a time,
+ * at most qb_map2_rows(num_qpus); a "block" is that many rows.  Uniforms,
+ * per QPU: the number of blocks (only if 'blocks' is 0; otherwise every
+ * QPU does 'blocks' blocks), then the bus addresses of its A, B and C,
+ * then its index 0..num_qpus-1.
+ *
+ * qb_map1s: C[i] = A[i] op s, s a scalar of A's type, 'rows' rows at a
+ * time, at most qb_map1s_rows(num_qpus).  Uniforms as for qb_map2 with s
+ * in place of B.
+ *
+ * qb_fma: D[i] = A[i] * B[i] + C[i] on floats, at most qb_fma_rows(num_qpus)
+ * rows.  The QPUs have no fused multiply-add: the product is rounded
+ * before the add.  Uniforms as for qb_map2 with A, B, C, D.
+ *
+ * qb_fold: each QPU reduces its blocks of A (one row each) with op as for
+ * qb_reduce and writes the result to all 16 words of its row of OUT.
+ * Uniforms: the number of blocks (if 'blocks' is 0), A, OUT + 64 * index,
+ * and the index.
+ *
+ * qb_map2_tmu: qb_map2 loading A and B through the TMUs instead of VPM
+ * DMA: each lane looks up its own word, and the next row's lookups are
+ * issued before the current row's results are used, across blocks too.
+ * Only C goes through the VPM, 'rows' rows a QPU, at most
+ * qb_map2_tmu_rows(num_qpus).  Uniforms as for qb_map2.  A and B are read
+ * through the TMU cache: launch with GPU_DIRTY_TEX after the CPU writes
+ * them.
+ *
+ * qb_map2_pipe: qb_map2 with the DMA overlapped: each QPU has two
+ * buffers of 'rows' rows of A and B, and loads the next block into one
+ * while it computes the block in the other, whose C goes back out while
+ * the next block's B comes in.  C is written over A and B.  At most
+ * qb_map2_pipe_rows(num_qpus) rows; uniforms as for qb_map2.
+ *
+ * With b->qpu_num set, qb_map2, qb_map1s, qb_fma, qb_map2_tmu and
+ * qb_map2_pipe still read the index but put each QPU in the rows of its
+ * hardware QPU number (QB_QPU_NUM) instead.  Built at the rows for 16
+ * QPUs, such kernels can run alongside each other in a gpu_batch_t.
+ *
+ * qb_mandelbrot: mandelbrot.qasm with its sizes built in: 'res' (a multiple
+ * of 8), the float bits of 1/res in 'step', 'max_iter' and 'num_qpus'.
+ * Uniforms: the QPU's index, then the output address.
+ */
+int qb_map2_rows(int num_qpus);
+void qb_map2(qb_t *b, int op, int rows, uint32_t blocks);
+int qb_map1s_rows(int num_qpus);
+void qb_map1s(qb_t *b, int op, int rows, uint32_t blocks);
+int qb_fma_rows(int num_qpus);
+void qb_fma(qb_t *b, int rows, uint32_t blocks);
+int qb_map2_tmu_rows(int num_qpus);
+void qb_map2_tmu(qb_t *b, int op, int rows, uint32_t blocks);
+int qb_map2_pipe_rows(int num_qpus);
+void qb_map2_pipe(qb_t *b, int op, int rows, uint32_t blocks);
+void qb_fold(qb_t *b, int op, uint32_t blocks);
+void qb_mandelbrot(qb_t *b, int res, uint32_t step, int max_iter, int num_qpus);
+
+// instructions qb_map2_tmu needs at most, at up to 16 rows.
+#define QB_MAP2_TMU_MAX 160
+// ... qb_map2_pipe, at up to 8.
+#define QB_MAP2_PIPE_MAX 96
+// ... qb_map2 at up to 8, qb_map1s at up to 16 and qb_fma at up to 5.
+#define QB_MAP2_MAX 80
+// QB_MUL32 takes ten instructions a row: qb_map2, qb_map2_pipe and
+// qb_map2_tmu all fit QB_MAP2_TMU_MAX with it at up to this many rows.
+#define QB_MUL32_ROWS 8
+
+// how the vector launchers load their inputs (struct addGPU's load, ...).
+#define QB_LOAD_VPM 0	// VPM DMA: addshader, mulshader and their variants
+#define QB_LOAD_TMU 1	// qb_map2_tmu
+#define QB_LOAD_PIPE 2	// qb_map2_pipe
+#define QB_LOAD_DMA 3	// qb_map2
+
+#endif /* QPU_BUILDER_H */
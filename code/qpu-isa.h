@@ -0,0 +1,223 @@
+#ifndef QPU_ISA_H
+#define QPU_ISA_H
+
+#include <stdint.h>
+
+/*
+ * VideoCore IV QPU instruction encoding (Architecture Reference Guide,
+ * p. 26-37).  An instruction is 64 bits, stored as two words: the low word
+ * first, as vc4asm emits them into the *shader.c arrays.  QPU_FIELD
+ * extracts bits [hi:lo] of the 64-bit instruction.
+ */
+
+#define QPU_FIELD(ins, hi, lo) ((uint32_t)(((ins) >> (lo)) & ((1ull << ((hi) - (lo) + 1)) - 1)))
+
+#define QPU_INS(lo, hi) ((uint64_t)(hi) << 32 | (lo))
+
+// every instruction
+#define QPU_SIG(i) QPU_FIELD(i, 63, 60)
+
+// ALU and load-immediate instructions
+#define QPU_UNPACK(i) QPU_FIELD(i, 59, 57)
+#define QPU_PM(i) QPU_FIELD(i, 56, 56)
+#define QPU_PACK(i) QPU_FIELD(i, 55, 52)
+#define QPU_COND_ADD(i) QPU_FIELD(i, 51, 49)
+#define QPU_COND_MUL(i) QPU_FIELD(i, 48, 46)
+#define QPU_SF(i) QPU_FIELD(i, 45, 45)
+#define QPU_WS(i) QPU_FIELD(i, 44, 44)
+#define QPU_WADDR_ADD(i) QPU_FIELD(i, 43, 38)
+#define QPU_WADDR_MUL(i) QPU_FIELD(i, 37, 32)
+#define QPU_OP_MUL(i) QPU_FIELD(i, 31, 29)
+#define QPU_OP_ADD(i) QPU_FIELD(i, 28, 24)
+#define QPU_RADDR_A(i) QPU_FIELD(i, 23, 18)
+#define QPU_RADDR_B(i) QPU_FIELD(i, 17, 12)
+#define QPU_ADD_A(i) QPU_FIELD(i, 11, 9)
+#define QPU_ADD_B(i) QPU_FIELD(i, 8, 6)
+#define QPU_MUL_A(i) QPU_FIELD(i, 5, 3)
+#define QPU_MUL_B(i) QPU_FIELD(i, 2, 0)
+
+// load immediate: the low word is the immediate; bits 59:57 pick the kind.
+#define QPU_LDI_MODE(i) QPU_FIELD(i, 59, 57)
+#define QPU_IMM(i) QPU_FIELD(i, 31, 0)
+
+// branches
+#define QPU_BR_COND(i) QPU_FIELD(i, 55, 52)
+#define QPU_BR_REL(i) QPU_FIELD(i, 51, 51)
+#define QPU_BR_REG(i) QPU_FIELD(i, 50, 50)
+#define QPU_BR_RADDR_A(i) QPU_FIELD(i, 49, 45)
+
+// signals (bits 63:60)
+enum
+{
+	QPU_SIG_BREAK = 0,
+	QPU_SIG_NONE = 1,
+	QPU_SIG_THREAD_SWITCH = 2,
+	QPU_SIG_PROG_END = 3,
+	QPU_SIG_WAIT_SCORE = 4,
+	QPU_SIG_UNLOCK_SCORE = 5,
+	QPU_SIG_LAST_THREAD_SWITCH = 6,
+	QPU_SIG_COVERAGE_LOAD = 7,
+	QPU_SIG_COLOR_LOAD = 8,
+	QPU_SIG_COLOR_LOAD_END = 9,
+	QPU_SIG_LOAD_TMU0 = 10,
+	QPU_SIG_LOAD_TMU1 = 11,
+	QPU_SIG_ALPHA_LOAD = 12,
+	QPU_SIG_SMALL_IMM = 13,
+	QPU_SIG_LOAD_IMM = 14,
+	QPU_SIG_BRANCH = 15,
+};
+
+// load immediate kinds
+enum
+{
+	QPU_LDI_32 = 0,
+	QPU_LDI_EL_SIGNED = 1,
+	QPU_LDI_EL_UNSIGNED = 3,
+	QPU_LDI_SEMA = 4,
+};
+
+// semaphore instruction: low word bit 4 acquires, bits 3:0 the semaphore.
+#define QPU_SEMA_ACQUIRE(i) QPU_FIELD(i, 4, 4)
+#define QPU_SEMA_NUM(i) QPU_FIELD(i, 3, 0)
+#define QPU_NUM_SEMAS 16
+
+// add pipe ops
+enum
+{
+	QPU_A_NOP = 0,
+	QPU_A_FADD = 1,
+	QPU_A_FSUB = 2,
+	QPU_A_FMIN = 3,
+	QPU_A_FMAX = 4,
+	QPU_A_FMINABS = 5,
+	QPU_A_FMAXABS = 6,
+	QPU_A_FTOI = 7,
+	QPU_A_ITOF = 8,
+	QPU_A_ADD = 12,
+	QPU_A_SUB = 13,
+	QPU_A_SHR = 14,
+	QPU_A_ASR = 15,
+	QPU_A_ROR = 16,
+	QPU_A_SHL = 17,
+	QPU_A_MIN = 18,
+	QPU_A_MAX = 19,
+	QPU_A_AND = 20,
+	QPU_A_OR = 21,
+	QPU_A_XOR = 22,
+	QPU_A_NOT = 23,
+	QPU_A_CLZ = 24,
+	QPU_A_V8ADDS = 30,
+	QPU_A_V8SUBS = 31,
+};
+
+// mul pipe ops
+enum
+{
+	QPU_M_NOP = 0,
+	QPU_M_FMUL = 1,
+	QPU_M_MUL24 = 2,
+	QPU_M_V8MULD = 3,
+	QPU_M_V8MIN = 4,
+	QPU_M_V8MAX = 5,
+	QPU_M_V8ADDS = 6,
+	QPU_M_V8SUBS = 7,
+};
+
+// input muxes
+enum
+{
+	QPU_MUX_R0 = 0,
+	QPU_MUX_R1,
+	QPU_MUX_R2,
+	QPU_MUX_R3,
+	QPU_MUX_R4,
+	QPU_MUX_R5,
+	QPU_MUX_A,
+	QPU_MUX_B, // or the small immediate with QPU_SIG_SMALL_IMM
+};
+
+// condition codes (ALU writes)
+enum
+{
+	QPU_COND_NEVER = 0,
+	QPU_COND_ALWAYS,
+	QPU_COND_ZS,
+	QPU_COND_ZC,
+	QPU_COND_NS,
+	QPU_COND_NC,
+	QPU_COND_CS,
+	QPU_COND_CC,
+};
+
+// branch conditions
+enum
+{
+	QPU_BR_ALLZ = 0,
+	QPU_BR_ALLNZ,
+	QPU_BR_ANYZ,
+	QPU_BR_ANYNZ,
+	QPU_BR_ALLN,
+	QPU_BR_ALLNN,
+	QPU_BR_ANYN,
+	QPU_BR_ANYNN,
+	QPU_BR_ALLC,
+	QPU_BR_ALLNC,
+	QPU_BR_ANYC,
+	QPU_BR_ANYNC,
+	QPU_BR_ALWAYS = 15,
+};
+
+// branch delay slots: the instructions after a branch that always run.
+#define QPU_BRANCH_DELAY 3
+// instructions that still run after the program-end signal.
+#define QPU_END_DELAY 2
+
+// read addresses (regfile A / B); 0-31 are the register files.
+enum
+{
+	QPU_R_UNIF = 32,
+	QPU_R_VARY = 35,
+	QPU_R_ELEM_QPU = 38, // A: element number, B: QPU number
+	QPU_R_NOP = 39,
+	QPU_R_XY = 41,
+	QPU_R_MS_FLAGS = 42,
+	QPU_R_VPM = 48,
+	QPU_R_VPM_BUSY = 49,
+	QPU_R_VPM_WAIT = 50,
+	QPU_R_MUTEX = 51,
+};
+
+// write addresses; 0-31 are the register files.
+enum
+{
+	QPU_W_R0 = 32,
+	QPU_W_R1,
+	QPU_W_R2,
+	QPU_W_R3,
+	QPU_W_TMU_NOSWAP = 36,
+	QPU_W_R5 = 37,
+	QPU_W_HOST_INT = 38,
+	QPU_W_NOP = 39,
+	QPU_W_UNIF_ADDR = 40,
+	QPU_W_VPM = 48,
+	QPU_W_VPM_SETUP = 49, // A: vr_setup, B: vw_setup
+	QPU_W_VPM_ADDR = 50,  // A: vr_addr, B: vw_addr
+	QPU_W_MUTEX = 51,
+	QPU_W_SFU_RECIP = 52,
+	QPU_W_SFU_RECIPSQRT,
+	QPU_W_SFU_EXP,
+	QPU_W_SFU_LOG,
+	QPU_W_TMU0_S = 56,
+	QPU_W_TMU0_T,
+	QPU_W_TMU0_R,
+	QPU_W_TMU0_B,
+	QPU_W_TMU1_S,
+	QPU_W_TMU1_T,
+	QPU_W_TMU1_R,
+	QPU_W_TMU1_B,
+};
+
+#define QPU_NUM_REGS 32
+#define QPU_NUM_LANES 16
+
+#endif /* QPU_ISA_H */
@@ -1,10 +1,17 @@
 #!/bin/bash
 
+# kernels written with virtual registers (*.vqasm) -> *-ra.qasm
+make -C host regalloc
+
 # VC4ASM
 vc4asm -c mulshader.c -h mulshader.h vector-multiply.qasm
 vc4asm -c addshader.c -h addshader.h parallel-add.qasm
 vc4asm -c simpleshader.c -h simpleshader.h deadbeef.qasm
 vc4asm -c mandelbrotshader.c -h mandelbrotshader.h mandelbrot.qasm
+vc4asm -c mandelbrotrashader.c -h mandelbrotrashader.h mandelbrot-ra.qasm
+
+# scheduled copies (*shader-sched.c) and the before/after report
+make -C host shaders
 
 # run tests
 make run
\ No newline at end of file
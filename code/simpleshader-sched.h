@@ -0,0 +1,17 @@
+#ifndef simpleshader_sched_H
+#define simpleshader_sched_H
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// simpleshader after host/sched-shaders; regenerate with "make -C host shaders".
+extern uint32_t simpleshader_sched[20];
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
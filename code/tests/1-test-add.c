@@ -3,8 +3,11 @@
 void test_add(void)
 {
     int i, j;
-    volatile struct addGPU *add_gpu;
-    vec_add_init(&add_gpu, N);
+    gpu_ctx_t ctx;
+    struct addGPU *add_gpu;
+    if (gpu_init(&ctx, vec_add_size(N)) < 0)
+        panic("could not set up the GPU\n");
+    vec_add_init(&ctx, &add_gpu, N, 8);
 
     for (i = 0; i < N; i++)
     {
@@ -51,6 +54,7 @@ void test_add(void)
     printk("Speedup: %dx\n", cpu_add_time / gpu_add_time);
 
     vec_add_release(add_gpu);
+    gpu_release(&ctx);
 }
 
 void notmain(void)
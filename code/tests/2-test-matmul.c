@@ -7,13 +7,25 @@
 void test_matmul(void)
 {
     int i, j, k;
-    volatile struct mulGPU *mul_gpu;
-    volatile struct addGPU *add_gpu;
+    gpu_ctx_t ctx;
+    // one multiply per output column, so a whole row of C is one batch.
+    struct mulGPU *mul_gpu[MATRIX_SIZE];
+    static qpu_req_t reqs[MATRIX_SIZE * V3D_NUM_QPUS];
+    gpu_batch_t batch;
     volatile int *A, *B, *C;
 
     kmalloc_init(1024);
 
-    vec_mul_init(&mul_gpu, MATRIX_SIZE);
+    if (gpu_init(&ctx, MATRIX_SIZE * vec_mul_size(MATRIX_SIZE)) < 0)
+        panic("could not set up the GPU\n");
+    gpu_batch_init(&batch, reqs, MATRIX_SIZE * V3D_NUM_QPUS);
+    for (j = 0; j < MATRIX_SIZE; j++)
+    {
+        vec_mul_init(&ctx, &mul_gpu[j], MATRIX_SIZE, NUM_QPUS);
+        // the multiplies of a row run at once: each in its own QPU's VPM rows.
+        mul_gpu[j]->batch = 1;
+        vec_mul_set_qpus(mul_gpu[j], 1);
+    }
 
     A = (volatile int *)kmalloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
     B = (volatile int *)kmalloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
@@ -42,32 +54,36 @@ void test_matmul(void)
         {
             for (k = 0; k < MATRIX_SIZE; k++)
             {
-                mul_gpu->A[k] = A[i * MATRIX_SIZE + k];
-                mul_gpu->B[k] = B[j * MATRIX_SIZE + k];
-                mul_gpu->C[k] = 0;
+                mul_gpu[j]->A[k] = A[i * MATRIX_SIZE + k];
+                mul_gpu[j]->B[k] = B[j * MATRIX_SIZE + k];
+                mul_gpu[j]->C[k] = 0;
             }
+            assert(gpu_batch_add(&batch, &mul_gpu[j]->kernel) == 0);
+        }
 
-            start_time = timer_get_usec();
+        start_time = timer_get_usec();
 
-            vec_mul_exec(mul_gpu);
+        gpu_batch_run(&batch);
 
-            end_time = timer_get_usec();
-            gpu_matmul_time += end_time - start_time;
+        end_time = timer_get_usec();
+        gpu_matmul_time += end_time - start_time;
 
-            start_time = timer_get_usec();
+        start_time = timer_get_usec();
 
+        for (j = 0; j < MATRIX_SIZE; j++)
+        {
             int dot_sum = 0;
 
             for (k = 0; k < MATRIX_SIZE; k++)
             {
-                dot_sum += mul_gpu->C[k];
+                dot_sum += mul_gpu[j]->C[k];
             }
 
-            end_time = timer_get_usec();
-            gpu_matmul_time += end_time - start_time;
-
             C[i * MATRIX_SIZE + j] = dot_sum;
         }
+
+        end_time = timer_get_usec();
+        gpu_matmul_time += end_time - start_time;
     }
 
     
@@ -145,7 +161,9 @@ void test_matmul(void)
         printk("\n");
     }
 
-    vec_mul_release(mul_gpu);
+    for (j = MATRIX_SIZE - 1; j >= 0; j--)
+        vec_mul_release(mul_gpu[j]);
+    gpu_release(&ctx);
 
     printk("\n\nCPU Matrix Multiplication Time: %d us\n", cpu_matmul_time);
     printk("GPU Matrix Multiplication Time: %d us\n", gpu_matmul_time);
@@ -8,8 +8,9 @@
 #define DECAY_FACTOR 100
 
 unsigned int heat[WIDTH * HEIGHT];
-volatile struct mulGPU *mul_gpu;
-volatile struct addGPU *add_gpu;
+gpu_ctx_t ctx;
+struct mulGPU *mul_gpu;
+struct addGPU *add_gpu;
 
 void fire_init(void)
 {
@@ -26,8 +27,11 @@ void fire_init(void)
         heat[i] = 0;
     }
 
-    vec_mul_init(&mul_gpu, VEC_WIDTH);
-    vec_add_init(&add_gpu, VEC_WIDTH);
+    // both kernels share one GPU mapping.
+    if (gpu_init(&ctx, vec_mul_size(VEC_WIDTH) + vec_add_size(VEC_WIDTH)) < 0)
+        panic("could not set up the GPU\n");
+    vec_mul_init(&ctx, &mul_gpu, VEC_WIDTH, NUM_QPUS);
+    vec_add_init(&ctx, &add_gpu, VEC_WIDTH, NUM_QPUS);
 }
 
 void update_fire_row(int row)
@@ -141,8 +145,9 @@ void fire_animation(void)
         delay_ms(10);
     }
 
-    vec_mul_release(mul_gpu);
     vec_add_release(add_gpu);
+    vec_mul_release(mul_gpu);
+    gpu_release(&ctx);
 }
 
 void notmain(void)
@@ -3,76 +3,14 @@
 #include <string.h>
 #include "fat32/code/pi-sd.h"
 #include "fat32/code/fat32.h"
-#include "mailbox.h"
-#include "mandelbrotshader.h"
-
-#define GPU_MEM_FLG 0xC // cached=0xC; direct=0x4
+#include "gpu-runtime.h"
+#include "mandelbrot.h"
+#include "gpu-capture.h"
 
 #define RESOLUTION 64
 #define MAX_ITERS 100
 #define NUM_QPUS 8 
 
-struct GPU
-{
-	uint32_t output[2*RESOLUTION][2*RESOLUTION];
-	uint32_t code[sizeof(mandelbrotshader) / sizeof(uint32_t)];
-	uint32_t unif[NUM_QPUS][6];
-	uint32_t unif_ptr[NUM_QPUS];
-	uint32_t mail[2];
-	uint32_t handle;
-};
-
-int gpu_prepare(
-	volatile struct GPU **gpu)
-{
-	uint32_t handle, vc;
-	volatile struct GPU *ptr;
-
-	if (qpu_enable(1))
-		return -2;
-
-	handle = mem_alloc(sizeof(struct GPU), 4096, GPU_MEM_FLG);
-	if (!handle)
-	{
-		qpu_enable(0);
-		return -3;
-	}
-	vc = mem_lock(handle);
-
-	ptr = (volatile struct GPU *)(vc - 0x40000000);
-	if (ptr == NULL)
-	{
-		mem_free(handle);
-		mem_unlock(handle);
-		qpu_enable(0);
-		return -4;
-	}
-
-	ptr->handle = handle;
-	ptr->mail[0] = vc + offsetof(struct GPU, code);
-	ptr->mail[1] = vc + offsetof(struct GPU, unif);
-
-	*gpu = ptr;
-	return 0;
-}
-
-uint32_t gpu_execute(volatile struct GPU *gpu)
-{
-	return gpu_fft_base_exec_direct(
-		(uint32_t)gpu->mail[0],
-		(uint32_t *)gpu->unif_ptr,
-		NUM_QPUS
-	);
-}
-
-void gpu_release(volatile struct GPU *gpu)
-{
-	uint32_t handle = gpu->handle;
-	mem_unlock(handle);
-	mem_free(handle);
-	qpu_enable(0);
-}
-
 // A small helper function to convert a positive integer to decimal ASCII.
 // Returns the number of characters written into 'buf'. No sign handling.
 static int int_to_ascii(int val, char *buf)
@@ -145,42 +83,30 @@ char *buildPGM(int *outSize, int HEIGHT, int WIDTH, const unsigned char input_im
 
 void notmain(void)
 {
-	volatile struct GPU *gpu;
-	int ret = gpu_prepare(&gpu);
-	if (ret < 0)
+	gpu_ctx_t ctx;
+	gpu_kernel_t kernel;
+	if (gpu_init(&ctx, 2*RESOLUTION * 2*RESOLUTION * sizeof(uint32_t) + 4096) < 0)
 		return;
+	volatile uint32_t (*output)[2*RESOLUTION] = gpu_alloc(&ctx, 2*RESOLUTION * 2*RESOLUTION * sizeof(uint32_t), 16);
+	assert(output);
+	// the kernel specialized to these sizes if there is one.
+	assert(mandelbrot_init(&ctx, &kernel, RESOLUTION, MAX_ITERS, NUM_QPUS, &output[0][0]) == 0);
 
-	float res = (float) RESOLUTION;
 	union {
 		float f;
 		uint32_t i;
 	} pun;
-	pun.f = res;
-	pun.i = 0x7EF127EA - pun.i;
-	float r = pun.f;
-	r = r*(2.0f - res*r);
-	r = r*(2.0f - res*r);
-	r = r*(2.0f - res*r);
-	pun.f = r;
-	memcpy((void *)gpu->code, mandelbrotshader, sizeof gpu->code);
-	for (int i=0; i<NUM_QPUS; i++) {
-	    gpu->unif[i][0] = RESOLUTION;
-	    gpu->unif[i][1] = pun.i;
-	    gpu->unif[i][2] = MAX_ITERS;
-	    gpu->unif[i][3] = NUM_QPUS;
-	    gpu->unif[i][4] = i;
-	    gpu->unif[i][5] = gpu->mail[0] - offsetof(struct GPU, code) + offsetof(struct GPU, output);
-	    gpu->unif_ptr[i] = gpu->mail[0] - offsetof(struct GPU, code) + (uint32_t) &gpu->unif[i][0] - (uint32_t) gpu;
-	}
+	pun.i = mandelbrot_step(RESOLUTION);
 	for (int i=0; i<2*RESOLUTION; i++) {
 		for (int j=0; j<2*RESOLUTION; j++) {
-			gpu->output[i][j] = 0;
+			output[i][j] = 0;
 		}
 	}
 	printk("Running code on GPU...\n");
 
 	int start_time = timer_get_usec();
-	int iret = gpu_execute(gpu);
+	if (gpu_launch(&kernel) != 0)
+		panic("launch failed\n");
 	int end_time = timer_get_usec();
 	printk("DONE!\n");
 	int gpu_time = end_time - start_time;
@@ -224,7 +150,7 @@ void notmain(void)
 	unsigned char GPU_OUT[2*RESOLUTION][2*RESOLUTION];
         for (int i=0; i<2*RESOLUTION; i++) {
             for (int j=0; j<2*RESOLUTION; j++) {
-                if (gpu->output[i][j] > 0) {
+                if (output[i][j] > 0) {
                     GPU_OUT[i][j] = 255;
                 } else {
                     GPU_OUT[i][j] = 0;
@@ -257,6 +183,25 @@ void notmain(void)
 
   	fat32_write(&fs, &root, hello_name, &hello);
 
-
-	gpu_release(gpu);
+	// the same launch again, captured for host/replay.
+	for (int i=0; i<2*RESOLUTION; i++)
+		for (int j=0; j<2*RESOLUTION; j++)
+			output[i][j] = 0;
+	uint32_t cap_size = gpu_capture_size(&ctx);
+	char *cap = kmalloc(cap_size);
+	int ncap = gpu_launch_captured(&ctx, &kernel, 0, cap, cap_size);
+	assert(ncap > 0);
+	char *cap_name = "MANDEL.QCP";
+	fat32_delete(&fs, &root, cap_name);
+	fat32_create(&fs, &root, cap_name, 0);
+	pi_file_t capture = (pi_file_t) {
+		.data = cap,
+		.n_data = ncap,
+		.n_alloc = cap_size,
+	};
+	fat32_write(&fs, &root, cap_name, &capture);
+	printk("captured the launch in %s: %d bytes\n", cap_name, ncap);
+
+
+	gpu_release(&ctx);
 }
@@ -0,0 +1,51 @@
+// launch overhead microbenchmark: time back-to-back launches of a tiny
+// multiply (the shape of the per-element launches in 2-test-matmul.c)
+// through the full launch path and the resident fast path.
+#include "rpi.h"
+#include "vector-multiply.h"
+
+#define VEC_SIZE 64
+#define ITERS 4096
+
+static int time_launches(struct mulGPU *gpu, unsigned (*launch)(gpu_kernel_t *))
+{
+    int start_time = timer_get_usec();
+    for (int i = 0; i < ITERS; i++)
+        launch(&gpu->kernel);
+    int end_time = timer_get_usec();
+    return end_time - start_time;
+}
+
+void notmain(void)
+{
+    gpu_ctx_t ctx;
+    struct mulGPU *mul_gpu;
+
+    if (gpu_init(&ctx, vec_mul_size(VEC_SIZE)) < 0)
+        panic("could not set up the GPU\n");
+    vec_mul_init(&ctx, &mul_gpu, VEC_SIZE, NUM_QPUS);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+    {
+        mul_gpu->A[i] = i;
+        mul_gpu->B[i] = 3;
+    }
+
+    // warm up so both runs start from the same state.
+    gpu_launch(&mul_gpu->kernel);
+
+    int full_time = time_launches(mul_gpu, gpu_launch);
+    int resident_time = time_launches(mul_gpu, gpu_launch_resident);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        if (mul_gpu->C[i] != 3 * i)
+            panic("C[%d] = %d, expected %d\n", i, mul_gpu->C[i], 3 * i);
+
+    printk("%d launches of a %d-element multiply on %d QPUs\n", ITERS, VEC_SIZE, mul_gpu->kernel.num_qpus);
+    printk("full launch:     %d us total, %d ns/launch\n", full_time, full_time * 1000 / ITERS);
+    printk("resident launch: %d us total, %d ns/launch\n", resident_time, resident_time * 1000 / ITERS);
+    printk("SUCCESS: launch overhead\n");
+
+    vec_mul_release(mul_gpu);
+    gpu_release(&ctx);
+}
@@ -0,0 +1,79 @@
+// cache maintenance benchmark: time repeated small add, multiply and
+// mandelbrot launches with every launch flushing all V3D caches versus
+// clearing only what the CPU dirtied, for each memory attribute.
+#include "rpi.h"
+#include "vector-multiply.h"
+#include "parallel-add.h"
+#include "mandelbrot.h"
+
+#define VEC_SIZE 1024
+#define ITERS 1024
+
+#define RESOLUTION 16
+#define MAX_ITERS 100
+#define MANDEL_QPUS 8
+#define MANDEL_BYTES (2 * RESOLUTION * 2 * RESOLUTION * sizeof(uint32_t))
+
+static const uint32_t mems[] = { GPU_MEM_CACHED, GPU_MEM_COHERENT, GPU_MEM_DIRECT };
+static const char *mem_names[] = { "cached", "coherent", "direct" };
+static const char *policy_names[] = { "tracked", "flush-all" };
+
+static int time_launches(gpu_kernel_t *k)
+{
+    int start_time = timer_get_usec();
+    for (int i = 0; i < ITERS; i++)
+        gpu_launch_resident(k);
+    int end_time = timer_get_usec();
+    return end_time - start_time;
+}
+
+void notmain(void)
+{
+    printk("%d launches each; ns/launch\n", ITERS);
+    printk("%s\t%s\t%s\t%s\t%s\n", "policy", "memory", "add", "mul", "mandelbrot");
+
+    for (int p = 0; p < 2; p++)
+    {
+        v3d_cache_policy(p ? V3D_CACHE_FLUSH_ALL : V3D_CACHE_TRACKED);
+        for (int m = 0; m < 3; m++)
+        {
+            gpu_ctx_t ctx;
+            struct addGPU *add_gpu;
+            struct mulGPU *mul_gpu;
+            gpu_kernel_t mandel;
+
+            if (gpu_init_mem(&ctx, vec_add_size(VEC_SIZE) + vec_mul_size(VEC_SIZE) + MANDEL_BYTES + 4096, mems[m]) < 0)
+                panic("could not set up the GPU\n");
+            vec_add_init(&ctx, &add_gpu, VEC_SIZE, NUM_QPUS);
+            // the multiply kernel's QPUs share VPM rows, so keep it on one.
+            vec_mul_init(&ctx, &mul_gpu, VEC_SIZE, 1);
+            volatile uint32_t *out = gpu_alloc(&ctx, MANDEL_BYTES, 16);
+            assert(out);
+            assert(mandelbrot_init(&ctx, &mandel, RESOLUTION, MAX_ITERS, MANDEL_QPUS, out) == 0);
+
+            for (int i = 0; i < VEC_SIZE; i++)
+            {
+                add_gpu->A[i] = mul_gpu->A[i] = i;
+                add_gpu->B[i] = mul_gpu->B[i] = 3;
+            }
+
+            int add_time = time_launches(&add_gpu->kernel);
+            int mul_time = time_launches(&mul_gpu->kernel);
+            int mandel_time = time_launches(&mandel);
+
+            for (int i = 0; i < VEC_SIZE; i++)
+            {
+                if (add_gpu->C[i] != i + 3)
+                    panic("add: C[%d] = %d, expected %d\n", i, add_gpu->C[i], i + 3);
+                if (mul_gpu->C[i] != 3 * i)
+                    panic("mul: C[%d] = %d, expected %d\n", i, mul_gpu->C[i], 3 * i);
+            }
+
+            printk("%s\t%s\t%d\t%d\t%d\n", policy_names[p], mem_names[m],
+                add_time * 1000 / ITERS, mul_time * 1000 / ITERS, mandel_time * 1000 / ITERS);
+            gpu_release(&ctx);
+        }
+    }
+    v3d_cache_policy(V3D_CACHE_TRACKED);
+    printk("SUCCESS: cache policy\n");
+}
@@ -0,0 +1,75 @@
+// load path benchmark: bandwidth of 1M-element add and multiply with A and
+// B loaded by VPM DMA, by pipelined VPM DMA and by per-lane TMU lookups.
+// Counts the 12 bytes of A, B and C each element moves.
+#include "rpi.h"
+#include "vector-multiply.h"
+#include "parallel-add.h"
+#include "qpu-builder.h"
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERS 8
+#define VEC_BYTES (12 * VEC_SIZE)
+
+static const char *load_names[] = { "vpm", "tmu", "pipe" };
+
+// MB/s of ITERS launches.
+static int bandwidth(int (*exec)(void *), void *gpu)
+{
+    int usec = 0;
+    for (int i = 0; i < ITERS; i++)
+        usec += exec(gpu);
+    return (int)((unsigned long long)VEC_BYTES * ITERS / usec);
+}
+
+static int add_exec(void *gpu)
+{
+    return vec_add_exec(gpu);
+}
+
+static int mul_exec(void *gpu)
+{
+    return vec_mul_exec(gpu);
+}
+
+void notmain(void)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *add_gpu;
+    struct mulGPU *mul_gpu;
+
+    if (gpu_init(&ctx, vec_add_size(VEC_SIZE) + vec_mul_size(VEC_SIZE)) < 0)
+        panic("could not set up the GPU\n");
+    vec_add_init(&ctx, &add_gpu, VEC_SIZE, NUM_QPUS);
+    vec_mul_init(&ctx, &mul_gpu, VEC_SIZE, 1);
+    for (int i = 0; i < VEC_SIZE; i++)
+    {
+        add_gpu->A[i] = mul_gpu->A[i] = i;
+        add_gpu->B[i] = mul_gpu->B[i] = 3;
+    }
+
+    printk("%d elements, %d launches each; MB/s\n", VEC_SIZE, ITERS);
+    printk("%s\t%s\t%s\t%s\n", "load", "add", "mul(1)", "mul");
+    for (int load = QB_LOAD_VPM; load <= QB_LOAD_PIPE; load++)
+    {
+        add_gpu->load = mul_gpu->load = load;
+        vec_add_set_qpus(add_gpu, NUM_QPUS);
+        int add = bandwidth(add_exec, add_gpu);
+        vec_mul_set_qpus(mul_gpu, 1);
+        int mul1 = bandwidth(mul_exec, mul_gpu);
+
+        // on all QPUs the VPM path is qb_map2, not mulshader.
+        vec_mul_set_qpus(mul_gpu, NUM_QPUS);
+        int mul = bandwidth(mul_exec, mul_gpu);
+
+        for (int i = 0; i < VEC_SIZE; i++)
+        {
+            if (add_gpu->C[i] != i + 3)
+                panic("%s add: C[%d] = %d, expected %d\n", load_names[load], i, add_gpu->C[i], i + 3);
+            if (mul_gpu->C[i] != 3 * i)
+                panic("%s mul: C[%d] = %d, expected %d\n", load_names[load], i, mul_gpu->C[i], 3 * i);
+        }
+        printk("%s\t%d\t%d\t%d\n", load_names[load], add, mul1, mul);
+    }
+    gpu_release(&ctx);
+    printk("SUCCESS: tmu bandwidth\n");
+}
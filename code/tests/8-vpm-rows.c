@@ -0,0 +1,64 @@
+// block size sweep: bandwidth of a 1M-element add for every count of VPM
+// rows a DMA moves, on 1 to 16 QPUs, with and without the DMA overlapped,
+// and the best rows for each QPU count.
+#include "rpi.h"
+#include "parallel-add.h"
+#include "qpu-builder.h"
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERS 4
+#define VEC_BYTES (12 * VEC_SIZE)
+
+static const int loads[] = { QB_LOAD_DMA, QB_LOAD_PIPE };
+static const char *load_names[] = { "dma", "pipe" };
+static const int qpus[] = { 1, 2, 4, 8, 12, 16 };
+
+void notmain(void)
+{
+    gpu_ctx_t ctx;
+    struct addGPU *gpu;
+
+    if (gpu_init(&ctx, vec_add_size(VEC_SIZE)) < 0)
+        panic("could not set up the GPU\n");
+    vec_add_init(&ctx, &gpu, VEC_SIZE, 1);
+    for (int i = 0; i < VEC_SIZE; i++)
+    {
+        gpu->A[i] = i;
+        gpu->B[i] = 3;
+    }
+
+    printk("%d elements, %d launches each; MB/s by rows a transfer\n", VEC_SIZE, ITERS);
+    for (int l = 0; l < 2; l++)
+        for (int q = 0; q < sizeof qpus / sizeof qpus[0]; q++)
+        {
+            int nq = qpus[q];
+            int max = loads[l] == QB_LOAD_PIPE ? qb_map2_pipe_rows(nq) : qb_map2_rows(nq);
+            int best = 0, best_mbs = 0;
+
+            gpu->load = loads[l];
+            printk("%s\t%d QPUs:", load_names[l], nq);
+            // the vectors are whole 2^k-row blocks; other counts round down.
+            for (int rows = 1; rows <= max; rows *= 2)
+            {
+                gpu->rows = rows;
+                vec_add_set_qpus(gpu, nq);
+                int usec = 0;
+                for (int i = 0; i < ITERS; i++)
+                    usec += vec_add_exec(gpu);
+                int mbs = (int)((unsigned long long)VEC_BYTES * ITERS / usec);
+                if (mbs > best_mbs)
+                {
+                    best = rows;
+                    best_mbs = mbs;
+                }
+                printk("\t%d: %d", rows, mbs);
+
+                for (int i = 0; i < VEC_SIZE; i++)
+                    if (gpu->C[i] != i + 3)
+                        panic("%d rows: C[%d] = %d, expected %d\n", rows, i, gpu->C[i], i + 3);
+            }
+            printk("\tbest %d\n", best);
+        }
+    gpu_release(&ctx);
+    printk("SUCCESS: vpm rows\n");
+}
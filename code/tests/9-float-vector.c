@@ -0,0 +1,53 @@
+// float vectors: D = A * B + C and C = A * s on the GPU against the ARM,
+// checked bit for bit.
+#include "rpi.h"
+#include "float-vector.h"
+
+#define VEC_SIZE (256 * 1024)
+
+static float cpu_d[VEC_SIZE];
+
+void notmain(void)
+{
+    gpu_ctx_t ctx;
+    fvec_gpu_t g;
+    fvec_t a, b, c, d;
+
+    if (gpu_init(&ctx, fvec_gpu_size() + 4 * fvec_size(VEC_SIZE)) < 0
+        || fvec_gpu_init(&ctx, &g, V3D_NUM_QPUS) < 0
+        || fvec_alloc(&ctx, &a, VEC_SIZE) < 0 || fvec_alloc(&ctx, &b, VEC_SIZE) < 0
+        || fvec_alloc(&ctx, &c, VEC_SIZE) < 0 || fvec_alloc(&ctx, &d, VEC_SIZE) < 0)
+        panic("could not set up the GPU\n");
+    for (int i = 0; i < VEC_SIZE; i++)
+    {
+        a.v[i] = i * 0.5f;
+        b.v[i] = 3.0f - i * 0.25f;
+        c.v[i] = i;
+    }
+
+    int start = timer_get_usec();
+    if (fvec_fma(&g, &d, &a, &b, &c) < 0)
+        panic("fvec_fma failed\n");
+    int gpu = timer_get_usec() - start;
+
+    start = timer_get_usec();
+    for (int i = 0; i < VEC_SIZE; i++)
+    {
+        float p = a.v[i] * b.v[i];
+        cpu_d[i] = p + c.v[i];
+    }
+    int cpu = timer_get_usec() - start;
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        if (d.v[i] != cpu_d[i])
+            panic("fma: D[%d] differs from the ARM\n", i);
+    printk("fma of %d floats: GPU %d usec, ARM %d usec\n", VEC_SIZE, gpu, cpu);
+
+    if (fvec_mul(&g, &c, &a, 2.0f) < 0)
+        panic("fvec_mul failed\n");
+    for (int i = 0; i < VEC_SIZE; i++)
+        if (c.v[i] != a.v[i] * 2.0f)
+            panic("mul: C[%d] differs from the ARM\n", i);
+    gpu_release(&ctx);
+    printk("SUCCESS: float vector\n");
+}
@@ -5,10 +5,13 @@ void test_add_mul(void)
 {
     int i, j;
     //volatile struct mulGPU *gpu;
-    volatile struct addGPU *add_gpu;
+    gpu_ctx_t ctx;
+    struct addGPU *add_gpu;
 
     //vec_mul_init(&gpu, N);
-    vec_add_init(&add_gpu, N);
+    if (gpu_init(&ctx, vec_add_size(N)) < 0)
+        panic("could not set up the GPU\n");
+    vec_add_init(&ctx, &add_gpu, N, 8);
 
     //for (i = 0; i < N; i++)
     //{
@@ -94,6 +97,7 @@ void test_add_mul(void)
 
     //vec_mul_release(gpu);
     vec_add_release(add_gpu);
+    gpu_release(&ctx);
 }
 
 void notmain(void)
@@ -0,0 +1,253 @@
+#include "rpi.h"
+#include "v3d.h"
+
+static uint32_t hw_get32(uint32_t addr) { return GET32(addr); }
+static void hw_put32(uint32_t addr, uint32_t val) { PUT32(addr, val); }
+
+static const v3d_backend_t hw_backend = {
+	.get32 = hw_get32,
+	.put32 = hw_put32,
+};
+
+static const v3d_backend_t *backend = &hw_backend;
+
+// The job currently owning the QPU scheduler, if any.
+static qpu_job_t *volatile active;
+
+// What the last submit launched, for the QPU_JOB_RESIDENT fast path.
+static struct
+{
+	int valid;
+	uint32_t code;
+	uint32_t unifs[V3D_SRQ_DEPTH];
+	int num_qpus;
+	unsigned flags;
+	uint32_t ncompleted; // SRQCS completed count once it finishes
+} resident;
+
+static int cache_policy = V3D_CACHE_TRACKED;
+// caches that may hold stale lines; nothing is known about them at boot.
+static unsigned cache_dirty = V3D_CACHE_ALL;
+
+void v3d_set_backend(const v3d_backend_t *b)
+{
+	backend = b ? b : &hw_backend;
+	active = 0;
+	resident.valid = 0;
+	cache_dirty = V3D_CACHE_ALL;
+}
+
+void v3d_cache_policy(int policy)
+{
+	cache_policy = policy;
+}
+
+void v3d_cache_dirty(unsigned caches)
+{
+	cache_dirty |= caches & V3D_CACHE_ALL;
+}
+
+void v3d_invalidate(void)
+{
+	resident.valid = 0;
+}
+
+static int is_resident(uint32_t code, uint32_t unifs[], int num_qpus, unsigned flags)
+{
+	if (!resident.valid || resident.code != code || resident.num_qpus != num_qpus)
+		return 0;
+	if ((resident.flags & QPU_JOB_IRQ) != (flags & QPU_JOB_IRQ))
+		return 0;
+	for (int q = 0; q < num_qpus; q++)
+		if (resident.unifs[q] != unifs[q])
+			return 0;
+	return 1;
+}
+
+uint32_t v3d_get32(uint32_t addr) { return backend->get32(addr); }
+void v3d_put32(uint32_t addr, uint32_t val) { backend->put32(addr, val); }
+
+static void job_complete(qpu_job_t *job)
+{
+	job->state = QPU_JOB_DONE;
+	if (active == job)
+		active = 0;
+}
+
+// Clear whatever the policy says the next launch cannot trust.
+static void v3d_cache_clean(void)
+{
+	unsigned dirty = cache_policy == V3D_CACHE_FLUSH_ALL ? V3D_CACHE_ALL : cache_dirty;
+	uint32_t slc = 0;
+
+	cache_dirty = 0;
+	if (dirty == V3D_CACHE_ALL)
+	{
+		v3d_put32(V3D_L2CACTL, V3D_L2CACTL_L2CCLR);
+		v3d_put32(V3D_SLCACTL, -1);
+		return;
+	}
+	if (dirty & V3D_CACHE_L2)
+		v3d_put32(V3D_L2CACTL, V3D_L2CACTL_L2CCLR);
+	if (dirty & V3D_CACHE_INSN)
+		slc |= V3D_SLCACTL_ICC;
+	if (dirty & V3D_CACHE_UNIF)
+		slc |= V3D_SLCACTL_UCC;
+	if (dirty & V3D_CACHE_TMU)
+		slc |= V3D_SLCACTL_T0CC | V3D_SLCACTL_T1CC;
+	if (slc)
+		v3d_put32(V3D_SLCACTL, slc);
+}
+
+// Full scheduler setup: IRQ/debug config, caches, and counter reset.
+static void v3d_setup(unsigned flags)
+{
+	v3d_put32(V3D_DBCFG, 0); // Disallow IRQ
+
+	// Interrupt-driven jobs let every QPU raise the host interrupt on
+	// `mov interrupt, 1`; polled jobs keep it masked.
+	v3d_put32(V3D_DBQITE, (flags & QPU_JOB_IRQ) ? V3D_QPU_IRQ_MASK : 0);
+	v3d_put32(V3D_DBQITC, -1); // Resets IRQ flags
+
+	v3d_cache_clean();
+
+	v3d_put32(V3D_SRQCS, V3D_SRQCS_RESET); // Reset error bit and counts
+}
+
+int qpu_job_submit(
+	qpu_job_t *job,
+	uint32_t code,
+	uint32_t unifs[],
+	int num_qpus,
+	unsigned flags)
+{
+	uint32_t base;
+
+	if (active)
+		return -1;
+	// every request goes straight into the FIFO, which nothing else is
+	// using; longer runs go through qpu_batch_run.
+	if (num_qpus <= 0 || num_qpus > V3D_SRQ_DEPTH)
+		return -1;
+
+	job->code = code;
+	job->num_qpus = num_qpus;
+	job->flags = flags;
+	job->state = QPU_JOB_RUNNING;
+	active = job;
+
+	if ((flags & QPU_JOB_RESIDENT) && is_resident(code, unifs, num_qpus, flags))
+	{
+		v3d_cache_clean();
+		base = resident.ncompleted;
+	}
+	else
+	{
+		v3d_setup(flags);
+		base = 0;
+	}
+	job->target = (base + num_qpus) & 0xff;
+
+	resident.valid = 1;
+	resident.code = code;
+	resident.num_qpus = num_qpus;
+	resident.flags = flags;
+	resident.ncompleted = job->target;
+	for (int q = 0; q < num_qpus; q++)
+		resident.unifs[q] = unifs[q];
+
+	for (unsigned q = 0; q < num_qpus; q++)
+	{ // Launch shader(s)
+		v3d_put32(V3D_SRQUA, unifs[q]); // Set the uniforms address
+		v3d_put32(V3D_SRQPC, code);		// Set the program counter
+	}
+	return 0;
+}
+
+int qpu_job_is_done(qpu_job_t *job)
+{
+	if (job->state != QPU_JOB_RUNNING)
+		return job->state == QPU_JOB_DONE;
+
+	// interrupt-driven jobs are normally retired by v3d_irq_handler, but
+	// the last QPU's interrupt can come before the scheduler counts its
+	// program, and then no later interrupt finishes the job: the count
+	// settles it here.
+	if (V3D_SRQCS_NCOMPLETED(v3d_get32(V3D_SRQCS)) != job->target)
+		return 0;
+	job_complete(job);
+	return 1;
+}
+
+int qpu_job_wait(qpu_job_t *job)
+{
+	if (job->state == QPU_JOB_IDLE)
+		return -1;
+	while (!qpu_job_is_done(job))
+		;
+	return 0;
+}
+
+int qpu_batch_run(const qpu_req_t *reqs, int n)
+{
+	unsigned issued = 0, done = 0;
+	uint32_t last = 0;
+
+	if (active)
+		return -1;
+	if (n <= 0)
+		return 0;
+
+	v3d_setup(0);
+	// the completed count was reset under the resident kernel.
+	resident.valid = 0;
+
+	while (done < n)
+	{
+		uint32_t cs = v3d_get32(V3D_SRQCS);
+		uint32_t ncompleted = V3D_SRQCS_NCOMPLETED(cs);
+
+		// the count is 8 bits, but at most FIFO + QPUs requests are
+		// outstanding, so the delta since the last read is exact.
+		done += (ncompleted - last) & 0xff;
+		last = ncompleted;
+
+		unsigned qlen = V3D_SRQCS_QLEN(cs);
+		while (issued < n && qlen < V3D_SRQ_DEPTH)
+		{
+			v3d_put32(V3D_SRQUA, reqs[issued].unif);
+			v3d_put32(V3D_SRQPC, reqs[issued].code);
+			issued++;
+			qlen++;
+		}
+	}
+	return 0;
+}
+
+void v3d_irq_handler(void)
+{
+	uint32_t pending = v3d_get32(V3D_DBQITC);
+	if (!pending)
+		return;
+	v3d_put32(V3D_DBQITC, pending); // write-1-to-clear
+
+	// several programs can finish on the same QPU between interrupts, so
+	// the pending bits are only a hint: the scheduler count is the truth.
+	qpu_job_t *job = active;
+	if (job && V3D_SRQCS_NCOMPLETED(v3d_get32(V3D_SRQCS)) == job->target)
+		job_complete(job);
+}
+
+unsigned gpu_fft_base_exec_direct(
+	uint32_t code,
+	uint32_t unifs[],
+	int num_qpus)
+{
+	qpu_job_t job = {0};
+
+	if (qpu_job_submit(&job, code, unifs, num_qpus, 0) < 0)
+		return -1;
+	// Busy wait polling
+	qpu_job_wait(&job);
+	return 0;
+}
@@ -0,0 +1,165 @@
+#ifndef V3D_H
+#define V3D_H
+
+#include <stdint.h>
+
+/*
+ * V3D (VideoCore IV 3D block) registers and QPU job submission.
+ *
+ * Register offsets are from the VideoCore IV 3D Architecture Reference
+ * Guide, p. 82-91.  User programs are launched through the QPU scheduler:
+ * write the uniforms address to SRQUA, then the code address to SRQPC, once
+ * per QPU request.  SRQCS[23:16] counts completed programs.
+ *
+ * Job API:
+ *   - qpu_job_submit():  start a job and return immediately.
+ *   - qpu_job_is_done(): non-blocking completion check.
+ *   - qpu_job_wait():    block until the job completes.
+ *
+ * Only one job is in flight at a time; submitting while another job runs
+ * fails.  With QPU_JOB_IRQ the job completes through the V3D QPU interrupt
+ * (kernels end with `mov interrupt, 1`) instead of polling SRQCS: the caller
+ * routes the V3D interrupt to the ARM and calls v3d_irq_handler() from its
+ * interrupt vector.  A QPU raises its interrupt before the scheduler counts
+ * its program, so the handler can see the last interrupt and a count one
+ * short; is_done/wait then finish the job from SRQCS.
+ *
+ * QPU_JOB_RESIDENT is the fast path for relaunching the kernel that ran
+ * last with the same code and uniform addresses: it skips the IRQ/debug
+ * setup and the SRQCS counter reset (the completed count just keeps
+ * running).  If anything differs from the previous launch, or
+ * v3d_invalidate() was called since, submit quietly takes the full path.
+ *
+ * qpu_batch_run() runs an arbitrary list of independent requests, each
+ * with its own code and uniforms, in one scheduler pass: it keeps the
+ * V3D_SRQ_DEPTH-entry request FIFO topped up as QPUs free slots and
+ * returns once all of them have completed.
+ *
+ * Cache maintenance: under V3D_CACHE_TRACKED (the default) a launch clears
+ * only the V3D caches named in v3d_cache_dirty() calls since the previous
+ * launch, so callers must report CPU writes to code, uniforms or texture
+ * data.  VPM DMA does not go through these caches, so rewriting DMA'd
+ * vectors needs nothing.  V3D_CACHE_FLUSH_ALL clears everything on every
+ * launch, like the original driver.
+ */
+
+#define V3D_BASE 0x20C00000
+#define V3D_L2CACTL (V3D_BASE + 0x0020)
+#define V3D_SLCACTL (V3D_BASE + 0x0024)
+#define V3D_SRQSC (V3D_BASE + 0x0418)
+#define V3D_SRQPC (V3D_BASE + 0x0430)
+#define V3D_SRQUA (V3D_BASE + 0x0434)
+#define V3D_SRQUL (V3D_BASE + 0x0438)
+#define V3D_SRQCS (V3D_BASE + 0x043c)
+#define V3D_DBCFG (V3D_BASE + 0x0e00)
+#define V3D_DBQITE (V3D_BASE + 0x0e2c)
+#define V3D_DBQITC (V3D_BASE + 0x0e30)
+
+// SRQCS fields.
+#define V3D_SRQCS_QLEN(x) ((x) & 0x3f)
+#define V3D_SRQCS_NCOMPLETED(x) (((x) >> 16) & 0xff)
+#define V3D_SRQCS_RESET ((1 << 7) | (1 << 8) | (1 << 16)) // error bit and counts
+
+// SLCACTL clear bits: instruction, uniforms, TMU0 and TMU1 caches.
+#define V3D_SLCACTL_ICC 0x0000000f
+#define V3D_SLCACTL_UCC 0x00000f00
+#define V3D_SLCACTL_T0CC 0x000f0000
+#define V3D_SLCACTL_T1CC 0x0f000000
+
+#define V3D_L2CACTL_L2CCLR (1 << 2)
+
+#define V3D_NUM_QPUS 16
+#define V3D_SRQ_DEPTH 16 // user program request FIFO entries
+#define V3D_QPU_IRQ_MASK ((1 << V3D_NUM_QPUS) - 1)
+
+/*
+ * Register backend.  The default talks to the hardware with GET32/PUT32;
+ * host builds swap in a mock (host/v3d-mock.c) so the job state machine can
+ * run on Linux.  Passing NULL restores the hardware backend.
+ */
+typedef struct v3d_backend
+{
+	uint32_t (*get32)(uint32_t addr);
+	void (*put32)(uint32_t addr, uint32_t val);
+} v3d_backend_t;
+
+void v3d_set_backend(const v3d_backend_t *b);
+uint32_t v3d_get32(uint32_t addr);
+void v3d_put32(uint32_t addr, uint32_t val);
+
+enum
+{
+	QPU_JOB_IDLE = 0,
+	QPU_JOB_RUNNING,
+	QPU_JOB_DONE,
+};
+
+// V3D caches a launch may have to clear; see v3d_cache_dirty().
+#define V3D_CACHE_L2 (1 << 0)	// V3D L2, in front of the three below
+#define V3D_CACHE_INSN (1 << 1)
+#define V3D_CACHE_UNIF (1 << 2)
+#define V3D_CACHE_TMU (1 << 3)
+#define V3D_CACHE_ALL 0xf
+
+enum
+{
+	V3D_CACHE_TRACKED = 0,
+	V3D_CACHE_FLUSH_ALL,
+};
+
+// Pick the cache maintenance policy for later launches.
+void v3d_cache_policy(int policy);
+// The CPU wrote memory the QPUs read through 'caches' (V3D_CACHE_*).
+void v3d_cache_dirty(unsigned caches);
+
+// qpu_job_submit flags.
+#define QPU_JOB_IRQ (1 << 0)		// complete via the V3D interrupt, not polling
+#define QPU_JOB_RESIDENT (1 << 1)	// same kernel as last launch: fast path
+
+typedef struct qpu_job
+{
+	uint32_t code;
+	int num_qpus;
+	unsigned flags;
+	uint32_t target;	// SRQCS completed count when the job is done
+	volatile int state;
+} qpu_job_t;
+
+/*
+ * Launch 'num_qpus' requests of 'code', QPU q reading its uniforms from
+ * unifs[q] (bus addresses).  Every request goes into the scheduler FIFO
+ * at once, so 'num_qpus' is at most V3D_SRQ_DEPTH.  Returns 0 on success,
+ * -1 if another job is still running or 'num_qpus' is out of range.
+ */
+int qpu_job_submit(qpu_job_t *job, uint32_t code, uint32_t unifs[], int num_qpus, unsigned flags);
+
+// Returns 1 once every request of 'job' has completed, 0 otherwise.
+int qpu_job_is_done(qpu_job_t *job);
+
+// Block until 'job' completes.  Returns 0, or -1 if 'job' was never submitted.
+int qpu_job_wait(qpu_job_t *job);
+
+// One user program request: what gets written to SRQPC/SRQUA.
+typedef struct qpu_req
+{
+	uint32_t code;
+	uint32_t unif;
+} qpu_req_t;
+
+/*
+ * Run 'n' requests to completion.  Requests may run in any order and on
+ * any QPU, so they must be independent.  Returns 0, or -1 if a job is
+ * still running.
+ */
+int qpu_batch_run(const qpu_req_t *reqs, int n);
+
+// Call from the ARM interrupt vector when the V3D interrupt fires.
+void v3d_irq_handler(void);
+
+// Forget the resident kernel: code or uniforms memory changed.
+void v3d_invalidate(void);
+
+// Submit and wait: the synchronous launch every kernel used originally.
+unsigned gpu_fft_base_exec_direct(uint32_t code, uint32_t unifs[], int num_qpus);
+
+#endif /* V3D_H */
@@ -4,84 +4,248 @@
 #include "vector-multiply.h"
 #include "mailbox.h"
 #include "mulshader.h"
+#include "kernel-variants.h"
+#include "kernel-abi.h"
+#include "qpu-builder.h"
 
-#define GPU_MEM_FLG 0xC // cached=0xC; direct=0x4
+// vectors are rounded up to a whole kernel block, so the last QPU's final
+// (partial) block runs into padding instead of past the allocation; each
+// vector also starts on a VPM-row boundary.
+#define VEC_ALIGN 64
+
+// vectors are also rounded up to a whole number of 4-row blocks, which
+// the run-time kernels (qb_map2_tmu, qb_map2_pipe) can always use.
+#define VEC_BLOCK 64
+
+// set_qpus builds the run-time kernels here.
+#define BUILT_MAX QB_MAP2_TMU_MAX
+_Static_assert(QB_MAP2_PIPE_MAX <= BUILT_MAX && QB_MAP2_MAX <= BUILT_MAX, "built kernels fit");
+
+// the variants and mulshader use the uniforms allocated for the TMU kernel.
+_Static_assert(sizeof(struct qb_map2_unifs) <= sizeof(struct qb_map2_tmu_unifs), "variant uniforms fit");
+_Static_assert(sizeof(struct mulshader_unifs) <= sizeof(struct qb_map2_tmu_unifs), "mulshader uniforms fit");
+
+static uint32_t padded(int n)
+{
+	return (n + MUL_BLOCK - 1) / MUL_BLOCK * MUL_BLOCK;
+}
+
+// ... and to VEC_BLOCK, which the vectors are.
+static uint32_t vec_padded(int n)
+{
+	return (n + VEC_BLOCK - 1) / VEC_BLOCK * VEC_BLOCK;
+}
+
+uint32_t vec_mul_size(int n)
+{
+	uint32_t vec = vec_padded(n) * sizeof(uint32_t);
+	return sizeof(struct mulGPU) + sizeof mulshader
+		+ 8 * BUILT_MAX
+		+ kernel_variants_size(mul_variants, padded(n))
+		+ V3D_NUM_QPUS * sizeof(struct qb_map2_tmu_unifs) + 3 * vec + 6 * VEC_ALIGN;
+}
 
 int mul_gpu_prepare(
-	volatile struct mulGPU **gpu)
+	gpu_ctx_t *ctx,
+	struct mulGPU **gpu,
+	int n)
 {
-	unsigned handle, vc;
-	volatile struct mulGPU *ptr;
+	struct mulGPU *ptr;
+	uint32_t vec = vec_padded(n) * sizeof(uint32_t);
 
-	if (qpu_enable(1))
-		return -2;
+	ptr = (struct mulGPU *)gpu_alloc(ctx, sizeof *ptr, 8);
+	if (ptr == NULL)
+		return -3;
+	ptr->ctx = ctx;
+	ptr->n = n;
+	ptr->load = QB_LOAD_VPM;
+	ptr->rows = 0;
+	ptr->batch = 0;
+	ptr->wide = 0;
+	ptr->qpus = 1;
+	ptr->op = QB_MUL24;
 
-	handle = mem_alloc(sizeof(struct mulGPU), 4096, GPU_MEM_FLG);
-	if (!handle)
+	// uniforms for every QPU, so the split can change later.
+	if (KERNEL_INIT(qb_map2_tmu, ctx, &ptr->kernel, mulshader, sizeof mulshader, V3D_NUM_QPUS) < 0
+		|| kernel_variants_load(ctx, mul_variants, padded(n), ptr->special) < 0)
 	{
-		qpu_enable(0);
+		gpu_free(ctx, ptr);
 		return -3;
 	}
-	vc = mem_lock(handle);
-
-	ptr = (volatile struct mulGPU *)(vc - 0x40000000);
-	if (ptr == NULL)
+	ptr->generic = ptr->kernel.code;
+	volatile void *code = gpu_alloc(ctx, 8 * BUILT_MAX, 8);
+	ptr->built = code ? gpu_bus(ctx, code) : 0;
+	ptr->A = gpu_alloc(ctx, vec, VEC_ALIGN);
+	ptr->B = gpu_alloc(ctx, vec, VEC_ALIGN);
+	ptr->C = gpu_alloc(ctx, vec, VEC_ALIGN);
+	if (!ptr->A || !ptr->B || !ptr->C)
 	{
-		mem_free(handle);
-		mem_unlock(handle);
-		qpu_enable(0);
-		return -4;
+		gpu_free(ctx, ptr);
+		return -3;
 	}
-
-	qpu_enable(1);
-	ptr->handle = handle;
-	ptr->mail[0] = vc + offsetof(struct mulGPU, code);
-	ptr->mail[1] = vc + offsetof(struct mulGPU, unif);
-
+	ptr->end = ctx->used;
 	*gpu = ptr;
 	return 0;
 }
 
-unsigned mul_gpu_execute(volatile struct mulGPU *gpu)
+// some element of A or B has bits above the low 24: set_qpus looks, once,
+// when wide is -1.
+static int wide_inputs(struct mulGPU *gpu)
 {
-	return gpu_fft_base_exec_direct(
-		(uint32_t)gpu->mail[0],
-		(uint32_t *)gpu->unif_ptr,
-		NUM_QPUS
-	);
+	for (int i = 0; i < gpu->n; i++)
+		if ((gpu->A[i] | gpu->B[i]) >> 24)
+			return 1;
+	return 0;
 }
 
-void vec_mul_release(volatile struct mulGPU *gpu)
+// build the kernel for 'load' on num_qpus QPUs, multiplying with 'op', and
+// split the vectors over them, gpu->rows rows a block (or the most that
+// fit) but never more than the VPM or BUILT_MAX has room for, nor more
+// than divide the vectors.  For a batch, the rows are by QPU number and
+// there are as many as leave room for every QPU.
+static int set_built(struct mulGPU *gpu, int load, int op, int num_qpus)
 {
-	uint32_t handle = gpu->handle;
-	mem_unlock(handle);
-	mem_free(handle);
-	qpu_enable(0);
+	uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+	gpu_ctx_t *ctx = gpu->ctx;
+	uint32_t a = gpu_bus(ctx, gpu->A), b = gpu_bus(ctx, gpu->B), c = gpu_bus(ctx, gpu->C);
+	int sharing = gpu->batch ? V3D_NUM_QPUS : num_qpus;
+	int max = load == QB_LOAD_TMU ? qb_map2_tmu_rows(sharing)
+		: load == QB_LOAD_PIPE ? qb_map2_pipe_rows(sharing) : qb_map2_rows(sharing);
+	if (op == QB_MUL32 && max > QB_MUL32_ROWS)
+		max = QB_MUL32_ROWS;
+	uint32_t rows = gpu->rows > 0 && gpu->rows < max ? gpu->rows : max, nrows = vec_padded(gpu->n) / 16;
+	qb_t qb;
+
+	while (nrows % rows)
+		rows--;
+	qb_init(&qb, (uint32_t *)gpu_bus_to_cpu(gpu->built), BUILT_MAX);
+	qb.qpu_num = gpu->batch;
+	if (load == QB_LOAD_TMU)
+		qb_map2_tmu(&qb, op, rows, 0);
+	else if (load == QB_LOAD_PIPE)
+		qb_map2_pipe(&qb, op, rows, 0);
+	else
+		qb_map2(&qb, op, rows, 0);
+	assert(!qb.err);
+	gpu_dirty(GPU_DIRTY_CODE);
+	gpu->tex = load == QB_LOAD_TMU;
+	gpu->op = op;
+
+	// qb_map2 and qb_map2_pipe's uniforms are laid out as qb_map2_tmu's.
+	struct qb_map2_tmu_unifs u[V3D_NUM_QPUS];
+	int used = gpu_partition(nrows / rows, num_qpus, first, count);
+	for (int i = 0; i < used; i++)
+	{
+		uint32_t off = first[i] * rows * 64;
+		u[i] = (struct qb_map2_tmu_unifs){ .blocks = count[i], .a = a + off, .b = b + off, .c = c + off, .qpu = i };
+	}
+	KERNEL_SET_UNIFS(qb_map2_tmu, ctx, &gpu->kernel, u, used);
+	gpu->kernel.code = gpu->built;
+	gpu->kernel.num_qpus = used;
+	gpu->kernel.any_qpu = gpu->batch;
+	return used;
 }
 
-void vec_mul_init(volatile struct mulGPU **gpu, int n) {
-	int ret = mul_gpu_prepare(gpu);
-	if (ret < 0)
-		return;
+int vec_mul_set_qpus(struct mulGPU *gpu, int num_qpus)
+{
+	uint32_t first[V3D_NUM_QPUS], count[V3D_NUM_QPUS];
+	gpu_ctx_t *ctx = gpu->ctx;
+	uint32_t a = gpu_bus(ctx, gpu->A), b = gpu_bus(ctx, gpu->B), c = gpu_bus(ctx, gpu->C);
+
+	assert(num_qpus >= 1 && num_qpus <= V3D_NUM_QPUS);
+	gpu->qpus = num_qpus;
+	gpu->tex = 0;
+	gpu->op = QB_MUL24;
+	gpu->kernel.any_qpu = 0;
+	// the VPM path's kernels are all mul24.
+	if (gpu->wide > 0 || (gpu->wide < 0 && wide_inputs(gpu)))
+	{
+		// mul24 would drop the high bits: launch nothing rather than that.
+		if (!gpu->built)
+		{
+			gpu->kernel.num_qpus = 0;
+			return -1;
+		}
+		return set_built(gpu, gpu->load == QB_LOAD_VPM ? QB_LOAD_DMA : gpu->load, QB_MUL32, num_qpus);
+	}
+	if (gpu->built && (gpu->load != QB_LOAD_VPM || gpu->batch))
+		return set_built(gpu, gpu->load == QB_LOAD_VPM ? QB_LOAD_DMA : gpu->load, QB_MUL24, num_qpus);
+	if (gpu->special[num_qpus])
+	{
+		// every QPU does the same share, the sizes built into the code.
+		struct qb_map2_unifs u[V3D_NUM_QPUS];
+		uint32_t share = padded(gpu->n) / num_qpus * sizeof(uint32_t);
+		for (int i = 0; i < num_qpus; i++)
+			u[i] = (struct qb_map2_unifs){ .a = a + i * share, .b = b + i * share, .c = c + i * share, .qpu = i };
+		KERNEL_SET_UNIFS(qb_map2, ctx, &gpu->kernel, u, num_qpus);
+		gpu->kernel.code = gpu->special[num_qpus];
+		gpu->kernel.num_qpus = num_qpus;
+		return num_qpus;
+	}
+
+	struct mulshader_unifs u[V3D_NUM_QPUS];
+	int used = gpu_partition(padded(gpu->n) / MUL_BLOCK, num_qpus, first, count);
+	// mulshader's QPUs all use the same VPM rows.
+	if (used > 1 && gpu->built)
+		return set_built(gpu, QB_LOAD_DMA, QB_MUL24, num_qpus);
+	for (int i = 0; i < used; i++)
+	{
+		uint32_t off = first[i] * MUL_BLOCK * sizeof(uint32_t);
+		u[i] = (struct mulshader_unifs){ .blocks = count[i], .a = a + off, .b = b + off, .c = c + off };
+	}
+	KERNEL_SET_UNIFS(mulshader, ctx, &gpu->kernel, u, used);
+	gpu->kernel.code = gpu->generic;
+	gpu->kernel.num_qpus = used;
+	return used;
+}
+
+unsigned mul_gpu_execute(struct mulGPU *gpu)
+{
+	// code and uniforms are fixed at init; only A/B change between calls,
+	// and the TMU kernel reads them through the texture cache.
+	if (gpu->tex)
+		gpu_dirty(GPU_DIRTY_TEX);
+	return gpu_launch_resident(&gpu->kernel);
+}
 
-	volatile struct mulGPU *ptr = *gpu;
-	memcpy((void *)ptr->code, mulshader, sizeof ptr->code);
+void vec_mul_fill(struct mulGPU *gpu, const uint32_t *a, const uint32_t *b)
+{
+	uint32_t high = 0;
 
-	for (int i = 0; i < NUM_QPUS; i++)
+	for (int i = 0; i < gpu->n; i++)
 	{
-		ptr->unif[i][0] = n / (16 * NUM_QPUS);
-		ptr->unif[i][1] = ptr->mail[0] - offsetof(struct mulGPU, code) + offsetof(struct mulGPU, A) + i * n * 4 / NUM_QPUS;
-		ptr->unif[i][2] = ptr->mail[0] - offsetof(struct mulGPU, code) + offsetof(struct mulGPU, B) + i * n * 4 / NUM_QPUS;
-		ptr->unif[i][3] = ptr->mail[0] - offsetof(struct mulGPU, code) + offsetof(struct mulGPU, C) + i * n * 4 / NUM_QPUS;
-		ptr->unif[i][4] = i;
-		ptr->unif_ptr[i] = ptr->mail[0] - offsetof(struct mulGPU, code) + (uint32_t)&ptr->unif[i][0] - (uint32_t)ptr;
+		gpu->A[i] = a[i];
+		gpu->B[i] = b[i];
+		high |= a[i] | b[i];
 	}
+	if (high >> 24)
+		gpu->wide = 1;
+}
+
+void vec_mul_release(struct mulGPU *gpu)
+{
+	// gpu_free would take anything allocated since with it.
+	assert(gpu->ctx->used == gpu->end);
+	gpu_free(gpu->ctx, gpu);
 }
 
-int vec_mul_exec(volatile struct mulGPU * gpu)
+void vec_mul_init(gpu_ctx_t *ctx, struct mulGPU **gpu, int n, int num_qpus)
 {
+	int ret = mul_gpu_prepare(ctx, gpu, n);
+	if (ret < 0)
+		return;
+	vec_mul_set_qpus(*gpu, num_qpus);
+}
+
+int vec_mul_exec(struct mulGPU *gpu)
+{
+	// vec_mul_fill saw wide inputs after set_qpus.
+	if (gpu->wide > 0 && gpu->op != QB_MUL32 && vec_mul_set_qpus(gpu, gpu->qpus) < 0)
+		return -1;
+
 	int start_time = timer_get_usec();
-	int iret = mul_gpu_execute(gpu);
+	if (mul_gpu_execute(gpu) != 0)
+		return -1;
 	int end_time = timer_get_usec();
 
 	return end_time - start_time;
@@ -2,21 +2,64 @@
 #include "rpi.h"
 #include <stdint.h>
 #include "max.h"
+#include "gpu-runtime.h"
+
+// elements each QPU multiplies per kernel loop iteration (four VPM rows).
+#define MUL_BLOCK 64
 
 struct mulGPU
 {
-    uint32_t A[N];
-    uint32_t B[N];
-    uint32_t C[N];
-    uint32_t code[sizeof(mulshader) / sizeof(uint32_t)];
-    uint32_t unif[NUM_QPUS][5];
-    uint32_t unif_ptr[NUM_QPUS];
-    uint32_t mail[2];
-    uint32_t handle;
+    volatile uint32_t *A;
+    volatile uint32_t *B;
+    volatile uint32_t *C;
+    int n;          // elements; A/B/C are padded to a whole block
+    gpu_kernel_t kernel;
+    uint32_t generic;    // bus address of mulshader
+    uint32_t special[V3D_NUM_QPUS + 1]; // ... of the variant for n on that many QPUs, or 0
+    uint32_t built;    // ... of the kernel set_qpus builds for load, or 0
+    int load;          // QB_LOAD_*: the path the next set_qpus picks
+    int rows;          // VPM rows a QPU moves at a time in the built kernels; 0: the most that fit
+    int batch;         // 1: set_qpus builds a kernel gpu_batch_add takes
+    int tex;           // the kernel reads A and B through the TMU cache
+    int wide;          // 1: A or B may not fit in 24 bits (vec_mul_fill notes it); 0 (the default): they do; -1: set_qpus looks
+    int qpus;          // the num_qpus set_qpus was last asked for
+    int op;            // what the kernel multiplies with: QB_MUL24, or QB_MUL32 for wide inputs
+    gpu_ctx_t *ctx;
+    uint32_t end;      // ctx->used after the last of its allocations
 };
 
-void vec_mul_init(volatile struct mulGPU **gpu, int n);
+// context bytes vec_mul_init needs for an n-element multiply.
+uint32_t vec_mul_size(int n);
+
+// Set up an n-element multiply on up to num_qpus (1..16) QPUs.
+void vec_mul_init(gpu_ctx_t *ctx, struct mulGPU **gpu, int n, int num_qpus);
+
+// Re-split the multiply over up to num_qpus QPUs; returns how many got work.
+// Loads A and B through the TMUs if load is QB_LOAD_TMU, or overlaps the
+// DMA with the arithmetic if it is QB_LOAD_PIPE, or moves 'rows' rows a
+// DMA if it is QB_LOAD_DMA; otherwise uses the kernel specialized to n on
+// exactly num_qpus QPUs if there is one, and QB_LOAD_DMA
+// if there is not and more than one QPU gets work.  mul24 only multiplies
+// the low 24 bits, so for wide inputs every path builds its kernel with
+// QB_MUL32 instead (QB_LOAD_DMA for QB_LOAD_VPM).  With batch set, the
+// built kernel always runs (QB_LOAD_DMA for QB_LOAD_VPM), in the VPM rows
+// of whichever QPUs it lands on, so it can share a gpu_batch_t.  Returns
+// -1 for wide inputs if the context had no room for a built kernel.
+int vec_mul_set_qpus(struct mulGPU *gpu, int num_qpus);
+
+// Copy n elements from a and b into A and B, setting wide if any of them
+// has bits above the low 24.  Cheaper than a scan: the check rides on the
+// copy.  Writes straight to A and B are not seen; set wide for those.
+void vec_mul_fill(struct mulGPU *gpu, const uint32_t *a, const uint32_t *b);
 
-int vec_mul_exec(volatile struct mulGPU * gpu);
+// Launch the multiply with the kernel set_qpus last picked, or, if wide
+// was set since, re-split it with QB_MUL32 first.  Returns the usecs the
+// launch took, or -1 if it failed or there is no QB_MUL32 kernel to run
+// (the context had no room for the built kernel) and wide is set.  A batched launch
+// goes through gpu_batch_add, not here: call set_qpus after filling.
+int vec_mul_exec(struct mulGPU * gpu);
 
-void vec_mul_release(volatile struct mulGPU * gpu);
\ No newline at end of file
+// Give back everything vec_mul_init allocated.  Its context memory is
+// freed LIFO (gpu_free), so whatever was allocated in ctx after it must
+// be released first (checked).
+void vec_mul_release(struct mulGPU * gpu);